@@ -0,0 +1,482 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+
+#include <sys/ioctl.h>
+#include <sys/types.h>
+
+#include <linux/videodev2.h>
+
+#include "media-bus-format.h"
+#include "nx-drm-allocator.h"
+#include "nx-v4l2.h"
+#ifdef NX_V4L2_MOCK
+#include "nx-v4l2-mock.h"
+#endif
+
+#include "option.h"
+#include "frame-sync.h"
+
+#ifndef ALIGN
+#define ALIGN(x, a) (((x) + (a) - 1) & ~((a) - 1))
+#endif
+
+#ifdef NX_V4L2_MOCK
+#define close_device(fd)	nx_v4l2_mock_close(fd)
+#else
+#define close_device(fd)	close(fd)
+#endif
+
+#define MAX_BUFFER_COUNT	4
+#define POLL_TIMEOUT		100	/* ms, to notice the end of the test */
+/* half a frame period at 30 fps, a frame can match only one other */
+#define DEFAULT_TOLERANCE_US	16666
+
+struct camera {
+	int stream;
+	uint32_t module;
+	int sensor_fd;
+	int csi_subdev_fd;
+	int clipper_subdev_fd;
+	int video_fd;
+	bool mplane;
+	int gem_fds[MAX_BUFFER_COUNT];
+	int dma_fds[MAX_BUFFER_COUNT];
+	size_t alloc_size;
+	struct frame_sync *fs;
+	pthread_t thread;
+};
+
+static struct camera cameras[MAX_SYNC_STREAMS];
+static volatile bool stop_capture;
+static uint32_t sets_wanted;		/* 0: until interrupted */
+
+static size_t calc_alloc_size(uint32_t w, uint32_t h, uint32_t f)
+{
+	uint32_t y_stride = ALIGN(w, 32);
+	uint32_t y_size = y_stride * ALIGN(h, 16);
+	size_t size = 0;
+
+	switch (f) {
+	case V4L2_PIX_FMT_YUYV:
+	case V4L2_PIX_FMT_NV16:
+	case V4L2_PIX_FMT_NV61:
+		size = y_size << 1;
+		break;
+
+	case V4L2_PIX_FMT_YUV420:
+		size = y_size +
+			2 * (ALIGN(y_stride >> 1, 16) * ALIGN(h >> 1, 16));
+		break;
+
+	case V4L2_PIX_FMT_NV21:
+	case V4L2_PIX_FMT_NV12:
+		size = y_size + y_stride * ALIGN(h >> 1, 16);
+		break;
+	}
+
+	return size;
+}
+
+static int setup_camera(struct camera *cam, int drm_fd, uint32_t w,
+			uint32_t h, uint32_t f, uint32_t bus_f)
+{
+	uint32_t m = cam->module;
+	bool is_mipi;
+	int ret, i;
+
+	cam->sensor_fd = nx_v4l2_open_device(nx_sensor_subdev, m);
+	if (cam->sensor_fd < 0) {
+		fprintf(stderr, "failed to open camera %d sensor\n", m);
+		return -ENODEV;
+	}
+
+	is_mipi = nx_v4l2_is_mipi_camera(m);
+	if (is_mipi) {
+		cam->csi_subdev_fd = nx_v4l2_open_device(nx_csi_subdev, m);
+		if (cam->csi_subdev_fd < 0) {
+			fprintf(stderr, "failed open mipi csi %d\n", m);
+			return -ENODEV;
+		}
+	}
+
+	cam->clipper_subdev_fd = nx_v4l2_open_device(nx_clipper_subdev, m);
+	if (cam->clipper_subdev_fd < 0) {
+		fprintf(stderr, "failed to open clipper_subdev %d\n", m);
+		return -ENODEV;
+	}
+
+	cam->video_fd = nx_v4l2_open_device(nx_clipper_video, m);
+	if (cam->video_fd < 0) {
+		fprintf(stderr, "failed to open clipper_video %d\n", m);
+		return -ENODEV;
+	}
+
+	nx_v4l2_streamoff(cam->video_fd, nx_clipper_video);
+
+	ret = nx_v4l2_link(true, m, nx_clipper_subdev, 1,
+			   nx_clipper_video, 0);
+
+	if (is_mipi) {
+		ret = nx_v4l2_link(true, m, nx_sensor_subdev, 0, nx_csi_subdev,
+				   0);
+		if (ret) {
+			fprintf(stderr, "failed to link sensor to csi\n");
+			return ret;
+		}
+
+		ret = nx_v4l2_link(true, m, nx_csi_subdev, 1, nx_clipper_subdev,
+				   0);
+		if (ret) {
+			fprintf(stderr, "failed to link csi to clipper\n");
+			return ret;
+		}
+	} else {
+		ret = nx_v4l2_link(true, m, nx_sensor_subdev, 0,
+				   nx_clipper_subdev, 0);
+		if (ret) {
+			fprintf(stderr, "failed to link sensor to clipper\n");
+			return ret;
+		}
+	}
+
+	ret = nx_v4l2_set_format(cam->sensor_fd, nx_sensor_subdev, w, h,
+				 bus_f);
+	if (ret) {
+		fprintf(stderr, "failed to set_format for sensor %d\n", m);
+		return ret;
+	}
+
+	if (is_mipi) {
+		ret = nx_v4l2_set_format(cam->csi_subdev_fd, nx_csi_subdev,
+					 w, h, f);
+		if (ret) {
+			fprintf(stderr, "failed to set_format for csi %d\n", m);
+			return ret;
+		}
+	}
+
+	ret = nx_v4l2_set_format(cam->clipper_subdev_fd, nx_clipper_subdev,
+				 w, h, bus_f);
+	if (ret) {
+		fprintf(stderr, "failed to set_format for clipper subdev\n");
+		return ret;
+	}
+
+	ret = nx_v4l2_set_format(cam->video_fd, nx_clipper_video, w, h, f);
+	if (ret) {
+		fprintf(stderr, "failed to set_format for clipper video\n");
+		return ret;
+	}
+
+	ret = nx_v4l2_set_crop(cam->clipper_subdev_fd, nx_clipper_subdev,
+			       0, 0, w, h);
+	if (ret) {
+		fprintf(stderr, "failed to set_crop for clipper subdev\n");
+		return ret;
+	}
+
+#ifndef NX_V4L2_MOCK
+	struct v4l2_capability cap;
+
+	memset(&cap, 0, sizeof(cap));
+	if (ioctl(cam->video_fd, VIDIOC_QUERYCAP, &cap)) {
+		fprintf(stderr, "failed to querycap %d\n", m);
+		return -errno;
+	}
+	cam->mplane = !!((cap.device_caps ? cap.device_caps : cap.capabilities)
+			 & V4L2_CAP_VIDEO_CAPTURE_MPLANE);
+#endif
+
+	ret = nx_v4l2_reqbuf(cam->video_fd, nx_clipper_video,
+			     MAX_BUFFER_COUNT);
+	if (ret) {
+		fprintf(stderr, "failed to reqbuf %d\n", m);
+		return ret;
+	}
+
+	cam->alloc_size = calc_alloc_size(w, h, f);
+	if (cam->alloc_size <= 0) {
+		fprintf(stderr, "invalid alloc size %lu\n", cam->alloc_size);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
+		cam->gem_fds[i] = alloc_gem(drm_fd, cam->alloc_size, 0);
+		if (cam->gem_fds[i] < 0) {
+			fprintf(stderr, "failed to alloc_gem\n");
+			return -ENOMEM;
+		}
+
+		cam->dma_fds[i] = gem_to_dmafd(drm_fd, cam->gem_fds[i]);
+		if (cam->dma_fds[i] < 0) {
+			fprintf(stderr, "failed to gem_to_dmafd\n");
+			return -ENOMEM;
+		}
+
+		ret = nx_v4l2_qbuf(cam->video_fd, nx_clipper_video, 1, i,
+				   &cam->dma_fds[i], (int *)&cam->alloc_size);
+		if (ret) {
+			fprintf(stderr, "failed qbuf index %d\n", i);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static void release_camera(struct camera *cam)
+{
+	int i;
+
+	if (cam->video_fd >= 0)
+		nx_v4l2_streamoff(cam->video_fd, nx_clipper_video);
+
+	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
+		if (cam->dma_fds[i] >= 0)
+			close(cam->dma_fds[i]);
+		if (cam->gem_fds[i] >= 0)
+			close(cam->gem_fds[i]);
+	}
+
+	if (cam->video_fd >= 0)
+		close_device(cam->video_fd);
+	if (cam->clipper_subdev_fd >= 0)
+		close_device(cam->clipper_subdev_fd);
+	if (cam->csi_subdev_fd >= 0)
+		close_device(cam->csi_subdev_fd);
+	if (cam->sensor_fd >= 0)
+		close_device(cam->sensor_fd);
+}
+
+/*
+ * nx_v4l2_dqbuf() drops the driver timestamp, so dequeue by hand. The
+ * clipper stamps buffers with CLOCK_MONOTONIC, which is what makes the
+ * timestamps of different modules comparable.
+ */
+static int dequeue_frame(struct camera *cam, int *index, uint64_t *ts_us)
+{
+#ifdef NX_V4L2_MOCK
+	uint64_t ts_ns;
+	int ret;
+
+	ret = nx_v4l2_dqbuf(cam->video_fd, nx_clipper_video, 1, index);
+	if (ret)
+		return ret;
+
+	ret = nx_v4l2_mock_get_buf_info(cam->video_fd, *index, &ts_ns, NULL);
+	*ts_us = ts_ns / 1000;
+	return ret;
+#else
+	struct v4l2_buffer buf;
+	struct v4l2_plane plane;
+
+	memset(&buf, 0, sizeof(buf));
+	memset(&plane, 0, sizeof(plane));
+	buf.memory = V4L2_MEMORY_DMABUF;
+	if (cam->mplane) {
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+		buf.m.planes = &plane;
+		buf.length = 1;
+	} else {
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	}
+
+	if (ioctl(cam->video_fd, VIDIOC_DQBUF, &buf))
+		return -errno;
+
+	*index = buf.index;
+	*ts_us = (uint64_t)buf.timestamp.tv_sec * 1000000 +
+		buf.timestamp.tv_usec;
+	return 0;
+#endif
+}
+
+static void *capture_thread(void *arg)
+{
+	struct camera *cam = (struct camera *)arg;
+	struct pollfd pfd;
+	uint64_t ts_us;
+	int index;
+	int ret;
+
+	pfd.fd = cam->video_fd;
+	pfd.events = POLLIN;
+
+	while (!stop_capture) {
+		ret = poll(&pfd, 1, POLL_TIMEOUT);
+		if (ret <= 0)
+			continue;
+
+		ret = dequeue_frame(cam, &index, &ts_us);
+		if (ret) {
+			fprintf(stderr, "failed to dqbuf module %d\n",
+				cam->module);
+			stop_capture = true;
+			break;
+		}
+
+		frame_sync_push(cam->fs, cam->stream, index, ts_us);
+	}
+
+	return NULL;
+}
+
+static int release_frame(void *priv, int stream, int index)
+{
+	struct camera *cam = &cameras[stream];
+
+	return nx_v4l2_qbuf(cam->video_fd, nx_clipper_video, 1, index,
+			    &cam->dma_fds[index], (int *)&cam->alloc_size);
+}
+
+static void emit_set(void *priv, const struct sync_frame *frames, int num,
+		     uint64_t skew_us)
+{
+	struct frame_sync *fs = (struct frame_sync *)priv;
+	int i;
+
+	printf("set %u:", fs->sets);
+	for (i = 0; i < num; i++)
+		printf(" m%d[%d] %llu", cameras[frames[i].stream].module,
+		       frames[i].index,
+		       (unsigned long long)frames[i].timestamp_us);
+	printf(", skew %llu us\n", (unsigned long long)skew_us);
+
+	if (sets_wanted && fs->sets >= sets_wanted)
+		stop_capture = true;
+}
+
+static void stop_handler(int sig)
+{
+	stop_capture = true;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t modules[MAX_SYNC_STREAMS];
+	uint32_t w = 0, h = 0, f = 0, bus_f = 0, count = 0;
+	uint32_t tolerance_us = DEFAULT_TOLERANCE_US;
+	struct frame_sync fs;
+	int num = 0;
+	int started;
+	int drm_fd;
+	int ret, i;
+
+	ret = handle_option(argc, argv, modules, &num, MAX_SYNC_STREAMS, &w,
+			    &h, &f, &bus_f, &count, &tolerance_us);
+	if (ret) {
+		fprintf(stderr, "failed to handle_option\n");
+		return ret;
+	}
+
+	if (f == 0)
+		f = V4L2_PIX_FMT_YUV420;
+
+	if (bus_f == 0)
+		bus_f = MEDIA_BUS_FMT_YUYV8_2X8;
+
+	sets_wanted = count;
+
+	drm_fd = open_drm_device();
+	if (drm_fd < 0) {
+		fprintf(stderr, "failed to open_drm_device\n");
+		return -ENODEV;
+	}
+
+	/* the sync thread emits and releases, capture threads only push */
+	ret = frame_sync_init(&fs, num, tolerance_us, MAX_BUFFER_COUNT - 1,
+			      emit_set, release_frame, &fs);
+	if (ret) {
+		fprintf(stderr, "failed to init frame sync\n");
+		close(drm_fd);
+		return ret;
+	}
+
+	/* cleanup only touches what setup_camera() got to */
+	for (i = 0; i < num; i++) {
+		struct camera *cam = &cameras[i];
+
+		memset(cam, 0, sizeof(*cam));
+		memset(cam->gem_fds, -1, sizeof(cam->gem_fds));
+		memset(cam->dma_fds, -1, sizeof(cam->dma_fds));
+		cam->sensor_fd = -1;
+		cam->csi_subdev_fd = -1;
+		cam->clipper_subdev_fd = -1;
+		cam->video_fd = -1;
+		cam->stream = i;
+		cam->module = modules[i];
+		cam->fs = &fs;
+	}
+
+	for (i = 0; i < num; i++) {
+		ret = setup_camera(&cameras[i], drm_fd, w, h, f, bus_f);
+		if (ret)
+			goto out;
+	}
+
+	ret = frame_sync_start(&fs);
+	if (ret)
+		goto out;
+
+	/* -c 0 runs until ^C, the sets so far are still reported */
+	signal(SIGINT, stop_handler);
+
+	/* back to back, so the streams start as close together as we can */
+	for (i = 0; i < num; i++) {
+		ret = nx_v4l2_streamon(cameras[i].video_fd, nx_clipper_video);
+		if (ret) {
+			fprintf(stderr, "failed to streamon module %d\n",
+				cameras[i].module);
+			goto out_sync;
+		}
+	}
+
+	for (started = 0; started < num; started++) {
+		ret = pthread_create(&cameras[started].thread, NULL,
+				     capture_thread, &cameras[started]);
+		if (ret) {
+			fprintf(stderr, "failed to create capture thread\n");
+			ret = -ret;
+			stop_capture = true;
+			break;
+		}
+	}
+
+	for (i = 0; i < started; i++)
+		pthread_join(cameras[i].thread, NULL);
+
+out_sync:
+	frame_sync_stop(&fs);
+	frame_sync_print_stats(&fs);
+
+out:
+	for (i = 0; i < num; i++)
+		release_camera(&cameras[i]);
+
+	close(drm_fd);
+
+	return ret;
+}
@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "frame-sync.h"
+
+#define RING_MASK	(SYNC_RING_SIZE - 1)
+
+static inline uint32_t ring_count(struct sync_ring *r)
+{
+	return __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) - r->head;
+}
+
+static inline struct sync_frame *ring_peek(struct sync_ring *r)
+{
+	return &r->slots[r->head & RING_MASK];
+}
+
+static inline void ring_pop(struct sync_ring *r)
+{
+	/* the slot may be reused by the producer after this store */
+	__atomic_store_n(&r->head, r->head + 1, __ATOMIC_RELEASE);
+}
+
+static void release_frame(struct frame_sync *fs, const struct sync_frame *f)
+{
+	if (fs->release(fs->priv, f->stream, f->index))
+		fprintf(stderr, "failed to release stream %d index %d\n",
+			f->stream, f->index);
+}
+
+static void account_set(struct frame_sync *fs, uint64_t skew)
+{
+	uint32_t bucket = fs->tolerance_us ? skew * 4 / fs->tolerance_us : 0;
+
+	if (bucket > 3)
+		bucket = 3;
+	fs->skew_hist[bucket]++;
+
+	if (!fs->sets || skew < fs->skew_min)
+		fs->skew_min = skew;
+	if (skew > fs->skew_max)
+		fs->skew_max = skew;
+	fs->skew_sum += skew;
+	fs->sets++;
+}
+
+/*
+ * Matches as long as every stream has a frame waiting. Each round either
+ * emits one set or drops one frame, so this always terminates.
+ */
+static void match_frames(struct frame_sync *fs)
+{
+	struct sync_frame set[MAX_SYNC_STREAMS];
+	int i, oldest;
+	uint64_t min, max;
+
+	for (i = 0; i < fs->num; i++) {
+		struct sync_ring *r = &fs->rings[i];
+
+		while (ring_count(r) > fs->max_pending) {
+			struct sync_frame f = *ring_peek(r);
+
+			ring_pop(r);
+			fs->stats[i].unmatched++;
+			release_frame(fs, &f);
+		}
+	}
+
+	for (;;) {
+		for (i = 0; i < fs->num; i++)
+			if (!ring_count(&fs->rings[i]))
+				return;
+
+		oldest = 0;
+		min = max = ring_peek(&fs->rings[0])->timestamp_us;
+		for (i = 1; i < fs->num; i++) {
+			uint64_t ts = ring_peek(&fs->rings[i])->timestamp_us;
+
+			if (ts < min) {
+				min = ts;
+				oldest = i;
+			}
+			if (ts > max)
+				max = ts;
+		}
+
+		if (max - min > fs->tolerance_us) {
+			/* no later frame of the others can come closer */
+			struct sync_frame f = *ring_peek(&fs->rings[oldest]);
+
+			ring_pop(&fs->rings[oldest]);
+			fs->stats[oldest].unmatched++;
+			release_frame(fs, &f);
+			continue;
+		}
+
+		for (i = 0; i < fs->num; i++) {
+			set[i] = *ring_peek(&fs->rings[i]);
+			ring_pop(&fs->rings[i]);
+			fs->stats[i].matched++;
+		}
+
+		account_set(fs, max - min);
+		if (fs->emit)
+			fs->emit(fs->priv, set, fs->num, max - min);
+
+		for (i = 0; i < fs->num; i++)
+			release_frame(fs, &set[i]);
+	}
+}
+
+static void *sync_thread(void *arg)
+{
+	struct frame_sync *fs = (struct frame_sync *)arg;
+
+	for (;;) {
+		while (sem_wait(&fs->pending) && errno == EINTR)
+			;
+		if (__atomic_load_n(&fs->stop, __ATOMIC_ACQUIRE))
+			break;
+		match_frames(fs);
+	}
+
+	return NULL;
+}
+
+int frame_sync_init(struct frame_sync *fs, int num, uint64_t tolerance_us,
+		    uint32_t max_pending, frame_sync_emit_t emit,
+		    frame_sync_release_t release, void *priv)
+{
+	if (num < 1 || num > MAX_SYNC_STREAMS || !release ||
+	    max_pending < 1 || max_pending > SYNC_RING_SIZE)
+		return -EINVAL;
+
+	memset(fs, 0, sizeof(*fs));
+	fs->num = num;
+	fs->tolerance_us = tolerance_us;
+	fs->max_pending = max_pending;
+	fs->emit = emit;
+	fs->release = release;
+	fs->priv = priv;
+
+	if (sem_init(&fs->pending, 0, 0)) {
+		fprintf(stderr, "failed to init semaphore\n");
+		return -errno;
+	}
+
+	return 0;
+}
+
+int frame_sync_start(struct frame_sync *fs)
+{
+	int ret;
+
+	ret = pthread_create(&fs->thread, NULL, sync_thread, fs);
+	if (ret) {
+		fprintf(stderr, "failed to create sync thread\n");
+		return -ret;
+	}
+
+	return 0;
+}
+
+void frame_sync_push(struct frame_sync *fs, int stream, int index,
+		     uint64_t timestamp_us)
+{
+	struct sync_ring *r = &fs->rings[stream];
+	uint32_t tail = r->tail;
+	struct sync_frame *slot;
+
+	fs->stats[stream].pushed++;
+
+	if (tail - __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) >=
+	    SYNC_RING_SIZE) {
+		struct sync_frame f = { stream, index, timestamp_us };
+
+		/* consumer stalled, keep the driver supplied */
+		fs->stats[stream].overflow++;
+		release_frame(fs, &f);
+		return;
+	}
+
+	slot = &r->slots[tail & RING_MASK];
+	slot->stream = stream;
+	slot->index = index;
+	slot->timestamp_us = timestamp_us;
+	__atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+
+	sem_post(&fs->pending);
+}
+
+void frame_sync_stop(struct frame_sync *fs)
+{
+	int i;
+
+	__atomic_store_n(&fs->stop, true, __ATOMIC_RELEASE);
+	sem_post(&fs->pending);
+	pthread_join(fs->thread, NULL);
+
+	/* producers are gone, whatever is left goes back to the drivers */
+	for (i = 0; i < fs->num; i++) {
+		struct sync_ring *r = &fs->rings[i];
+
+		while (ring_count(r)) {
+			release_frame(fs, ring_peek(r));
+			ring_pop(r);
+		}
+	}
+
+	sem_destroy(&fs->pending);
+}
+
+void frame_sync_print_stats(struct frame_sync *fs)
+{
+	int i;
+
+	printf("sync: %u sets, skew min %llu avg %llu max %llu us "
+	       "(tolerance %llu us)\n", fs->sets,
+	       (unsigned long long)fs->skew_min,
+	       fs->sets ? (unsigned long long)(fs->skew_sum / fs->sets) : 0ULL,
+	       (unsigned long long)fs->skew_max,
+	       (unsigned long long)fs->tolerance_us);
+	printf("sync: skew histogram %u / %u / %u / %u (quarters of tolerance)\n",
+	       fs->skew_hist[0], fs->skew_hist[1], fs->skew_hist[2],
+	       fs->skew_hist[3]);
+
+	for (i = 0; i < fs->num; i++)
+		printf("stream %d: pushed %u, matched %u, unmatched %u, "
+		       "overflow %u\n", i, fs->stats[i].pushed,
+		       fs->stats[i].matched, fs->stats[i].unmatched,
+		       fs->stats[i].overflow);
+}
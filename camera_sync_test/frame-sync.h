@@ -0,0 +1,94 @@
+#ifndef _FRAME_SYNC_H
+#define _FRAME_SYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_SYNC_STREAMS	4
+#define SYNC_RING_SIZE		8	/* power of two, >= buffers per stream */
+
+/*
+ * Groups frames of several capture streams by driver timestamp.
+ *
+ * Every stream pushes from its own capture thread into a single
+ * producer / single consumer ring, the sync thread is the only consumer
+ * of all rings. Nothing on that path takes a lock: ring indexes are
+ * published with release stores and a counting semaphore only wakes
+ * the sync thread up.
+ *
+ * The sync thread looks at the oldest frame of every stream. When they
+ * all lie within the tolerance window they are emitted as one set,
+ * otherwise the oldest frame can never be matched any more (the other
+ * streams only get newer) and is released as unmatched. A stream that
+ * stops delivering must not starve the others of buffers, so no stream
+ * holds more than max_pending frames either.
+ */
+struct sync_frame {
+	int stream;
+	int index;
+	uint64_t timestamp_us;
+};
+
+/* called on the sync thread, frames[stream] for every stream */
+typedef void (*frame_sync_emit_t)(void *priv, const struct sync_frame *frames,
+				  int num, uint64_t skew_us);
+/* hands index back to the driver of stream */
+typedef int (*frame_sync_release_t)(void *priv, int stream, int index);
+
+struct sync_ring {
+	struct sync_frame slots[SYNC_RING_SIZE];
+	uint32_t head;		/* written by the consumer only */
+	uint32_t tail;		/* written by the producer only */
+};
+
+struct sync_stream_stats {
+	uint32_t pushed;
+	uint32_t matched;
+	uint32_t unmatched;
+	uint32_t overflow;	/* ring full, released by the producer */
+};
+
+struct frame_sync {
+	int num;
+	uint64_t tolerance_us;
+	uint32_t max_pending;	/* frames held per stream before dropping */
+	struct sync_ring rings[MAX_SYNC_STREAMS];
+	struct sync_stream_stats stats[MAX_SYNC_STREAMS];
+
+	frame_sync_emit_t emit;
+	frame_sync_release_t release;
+	void *priv;
+
+	sem_t pending;
+	volatile bool stop;
+	pthread_t thread;
+
+	uint32_t sets;
+	uint64_t skew_sum;
+	uint64_t skew_min;
+	uint64_t skew_max;
+	uint32_t skew_hist[4];	/* < tol/4, < tol/2, < 3tol/4, <= tol */
+};
+
+int frame_sync_init(struct frame_sync *fs, int num, uint64_t tolerance_us,
+		    uint32_t max_pending, frame_sync_emit_t emit,
+		    frame_sync_release_t release, void *priv);
+int frame_sync_start(struct frame_sync *fs);
+/* capture thread of stream, never blocks */
+void frame_sync_push(struct frame_sync *fs, int stream, int index,
+		     uint64_t timestamp_us);
+/* stops the sync thread and releases every frame still waiting */
+void frame_sync_stop(struct frame_sync *fs);
+void frame_sync_print_stats(struct frame_sync *fs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
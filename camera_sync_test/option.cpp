@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+
+#include "option.h"
+
+/* "0,1,2" */
+static int parse_modules(char *arg, uint32_t *modules, int max)
+{
+	char *save = NULL;
+	char *tok;
+	int num = 0;
+
+	for (tok = strtok_r(arg, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		if (num >= max) {
+			fprintf(stderr, "at most %d modules\n", max);
+			return -EINVAL;
+		}
+		modules[num++] = atoi(tok);
+	}
+
+	return num;
+}
+
+int handle_option(int argc, char **argv, uint32_t *modules, int *num,
+		  int max, uint32_t *w, uint32_t *h, uint32_t *f,
+		  uint32_t *bus_f, uint32_t *c, uint32_t *tolerance_us)
+{
+	int opt;
+	int i;
+
+	while ((opt = getopt(argc, argv, "m:w:h:f:F:c:t:")) != -1) {
+		switch (opt) {
+		case 'm':
+			*num = parse_modules(optarg, modules, max);
+			if (*num < 0)
+				return *num;
+			break;
+		case 'w':
+			*w = atoi(optarg);
+			break;
+		case 'h':
+			*h = atoi(optarg);
+			break;
+		case 'f':
+			*f = atoi(optarg);
+			break;
+		case 'F':
+			*bus_f = atoi(optarg);
+			break;
+		case 'c':
+			*c = atoi(optarg);
+			break;
+		case 't':
+			*tolerance_us = atoi(optarg);
+			break;
+		}
+	}
+
+	if (*num < 2) {
+		fprintf(stderr, "need at least two modules, -m 0,1\n");
+		return -EINVAL;
+	}
+
+	printf("m:");
+	for (i = 0; i < *num; i++)
+		printf(" %d", modules[i]);
+	printf(", w: %d, h: %d, f: %d, bus_f: %d, c: %d, tolerance: %d us\n",
+	       *w, *h, *f, *bus_f, *c, *tolerance_us);
+
+	return 0;
+}
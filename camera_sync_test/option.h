@@ -0,0 +1,16 @@
+#ifndef _OPTION_H
+#define _OPTION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int handle_option(int argc, char **argv, uint32_t *modules, int *num,
+		  int max, uint32_t *w, uint32_t *h, uint32_t *f,
+		  uint32_t *bus_f, uint32_t *count, uint32_t *tolerance_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,309 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include <linux/videodev2.h>
+#include <linux/dma-buf.h>
+
+#include "analytics-tap.h"
+
+#ifndef ALIGN
+#define ALIGN(x, a) (((x) + (a) - 1) & ~((a) - 1))
+#endif
+
+static uint64_t tap_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void tap_sync(struct analytics_tap *tap, int index, bool start)
+{
+#ifdef DMA_BUF_IOCTL_SYNC
+	struct dma_buf_sync sync;
+
+	sync.flags = DMA_BUF_SYNC_READ |
+		(start ? DMA_BUF_SYNC_START : DMA_BUF_SYNC_END);
+	if (ioctl(tap->dma_fds[index], DMA_BUF_IOCTL_SYNC, &sync) &&
+	    !tap->sync_warned) {
+		fprintf(stderr, "dma-buf sync failed: %s\n", strerror(errno));
+		tap->sync_warned = true;
+	}
+#endif
+}
+
+/* same layout calc_alloc_size() in cam-test.cpp allocates for */
+static void tap_fill_view(struct analytics_tap *tap, int index,
+			  struct tap_frame *frame)
+{
+	uint32_t y_stride = ALIGN(tap->width, 32);
+	uint32_t y_size = y_stride * ALIGN(tap->height, 16);
+	uint32_t c_stride;
+	uint8_t *base = tap->vaddr[index];
+
+	memset(frame, 0, sizeof(*frame));
+	frame->index = index;
+	frame->width = tap->width;
+	frame->height = tap->height;
+	frame->format = tap->format;
+	frame->plane[0] = base;
+	frame->stride[0] = y_stride;
+	frame->num_planes = 1;
+
+	switch (tap->format) {
+	case V4L2_PIX_FMT_YUYV:
+		frame->stride[0] = y_stride << 1;
+		break;
+
+	case V4L2_PIX_FMT_YUV420:
+		c_stride = ALIGN(y_stride >> 1, 16);
+		frame->plane[1] = base + y_size;
+		frame->plane[2] = frame->plane[1] +
+			c_stride * ALIGN(tap->height >> 1, 16);
+		frame->stride[1] = c_stride;
+		frame->stride[2] = c_stride;
+		frame->num_planes = 3;
+		break;
+
+	case V4L2_PIX_FMT_NV12:
+	case V4L2_PIX_FMT_NV21:
+	case V4L2_PIX_FMT_NV16:
+	case V4L2_PIX_FMT_NV61:
+		frame->plane[1] = base + y_size;
+		frame->stride[1] = y_stride;
+		frame->num_planes = 2;
+		break;
+	}
+}
+
+static void *tap_worker(void *arg)
+{
+	struct analytics_tap *tap = (struct analytics_tap *)arg;
+	struct tap_frame frame;
+	uint64_t start, elapsed;
+	int index;
+
+	for (;;) {
+		pthread_mutex_lock(&tap->lock);
+		while (!tap->pending && !tap->closed)
+			pthread_cond_wait(&tap->cond, &tap->lock);
+		if (!tap->pending) {
+			pthread_mutex_unlock(&tap->lock);
+			break;
+		}
+		index = tap->fifo[tap->head];
+		pthread_mutex_unlock(&tap->lock);
+
+		start = tap_now_us();
+		tap_fill_view(tap, index, &frame);
+		frame.sequence = tap->sequence++;
+
+		tap_sync(tap, index, true);
+		if (tap->callback)
+			tap->callback(&frame, tap->callback_priv);
+		tap_sync(tap, index, false);
+
+		elapsed = tap_now_us() - start;
+		tap->frames++;
+		tap->busy_us += elapsed;
+		if (elapsed > tap->max_us)
+			tap->max_us = elapsed;
+
+		/* the slot stays taken until the driver owns the buffer again */
+		if (tap->requeue(tap->requeue_priv, index))
+			fprintf(stderr, "failed to requeue index %d\n", index);
+
+		pthread_mutex_lock(&tap->lock);
+		tap->head = (tap->head + 1) % MAX_TAP_BUFFERS;
+		tap->pending--;
+		pthread_mutex_unlock(&tap->lock);
+	}
+
+	return NULL;
+}
+
+int analytics_tap_init(struct analytics_tap *tap, const int *dma_fds,
+		       int count, size_t size, uint32_t w, uint32_t h,
+		       uint32_t f, tap_requeue_t requeue, void *priv)
+{
+	int i;
+
+	if (count < 1 || count > MAX_TAP_BUFFERS || !requeue)
+		return -EINVAL;
+
+	memset(tap, 0, sizeof(*tap));
+	tap->count = count;
+	tap->size = size;
+	tap->width = w;
+	tap->height = h;
+	tap->format = f;
+	tap->requeue = requeue;
+	tap->requeue_priv = priv;
+
+	for (i = 0; i < count; i++) {
+		void *vaddr;
+
+		tap->dma_fds[i] = dma_fds[i];
+		vaddr = mmap(NULL, size, PROT_READ, MAP_SHARED, dma_fds[i], 0);
+		if (vaddr == MAP_FAILED) {
+			fprintf(stderr, "failed to mmap index %d: %s\n", i,
+				strerror(errno));
+			while (--i >= 0)
+				munmap(tap->vaddr[i], size);
+			return -ENOMEM;
+		}
+		tap->vaddr[i] = (uint8_t *)vaddr;
+	}
+
+	pthread_mutex_init(&tap->lock, NULL);
+	pthread_cond_init(&tap->cond, NULL);
+
+	return 0;
+}
+
+void analytics_tap_register(struct analytics_tap *tap, tap_callback_t cb,
+			    void *priv)
+{
+	pthread_mutex_lock(&tap->lock);
+	tap->callback = cb;
+	tap->callback_priv = priv;
+	pthread_mutex_unlock(&tap->lock);
+}
+
+int analytics_tap_start(struct analytics_tap *tap)
+{
+	int ret;
+
+	ret = pthread_create(&tap->thread, NULL, tap_worker, tap);
+	if (ret) {
+		fprintf(stderr, "failed to create analytics thread\n");
+		return -ret;
+	}
+
+	return 0;
+}
+
+void analytics_tap_submit(struct analytics_tap *tap, int index)
+{
+	pthread_mutex_lock(&tap->lock);
+	/* at most count buffers can be out of the driver at once */
+	tap->fifo[(tap->head + tap->pending) % MAX_TAP_BUFFERS] = index;
+	tap->pending++;
+	pthread_cond_signal(&tap->cond);
+	pthread_mutex_unlock(&tap->lock);
+}
+
+void analytics_tap_deinit(struct analytics_tap *tap)
+{
+	int i;
+
+	pthread_mutex_lock(&tap->lock);
+	tap->closed = true;
+	pthread_cond_broadcast(&tap->cond);
+	pthread_mutex_unlock(&tap->lock);
+
+	pthread_join(tap->thread, NULL);
+
+	for (i = 0; i < tap->count; i++) {
+		if (tap->vaddr[i])
+			munmap(tap->vaddr[i], tap->size);
+		tap->vaddr[i] = NULL;
+	}
+
+	pthread_cond_destroy(&tap->cond);
+	pthread_mutex_destroy(&tap->lock);
+}
+
+void analytics_tap_print_stats(struct analytics_tap *tap)
+{
+	printf("analytics: %u frames, avg %llu us, max %llu us\n",
+	       tap->frames,
+	       tap->frames ? (unsigned long long)(tap->busy_us / tap->frames)
+			   : 0ULL,
+	       (unsigned long long)tap->max_us);
+}
+
+static inline uint32_t tap_luma_step(const struct tap_frame *frame)
+{
+	/* YUYV keeps luma in every other byte */
+	return frame->format == V4L2_PIX_FMT_YUYV ? 2 : 1;
+}
+
+uint32_t tap_luma_mean(const struct tap_frame *frame, uint32_t step)
+{
+	uint32_t bpp = tap_luma_step(frame);
+	uint64_t sum = 0;
+	uint32_t n = 0;
+	uint32_t x, y;
+
+	if (!step)
+		step = 1;
+
+	for (y = 0; y < frame->height; y += step) {
+		const uint8_t *row = frame->plane[0] + y * frame->stride[0];
+
+		for (x = 0; x < frame->width; x += step) {
+			sum += row[x * bpp];
+			n++;
+		}
+	}
+
+	return n ? sum / n : 0;
+}
+
+uint32_t tap_laplacian_var(const struct tap_frame *frame, uint32_t step)
+{
+	uint32_t bpp = tap_luma_step(frame);
+	uint32_t stride = frame->stride[0];
+	int64_t sum = 0;
+	uint64_t sq = 0;
+	uint32_t n = 0;
+	uint32_t x, y;
+
+	if (!step)
+		step = 1;
+
+	for (y = 1; y + 1 < frame->height; y += step) {
+		const uint8_t *row = frame->plane[0] + y * stride;
+
+		for (x = 1; x + 1 < frame->width; x += step) {
+			const uint8_t *p = row + x * bpp;
+			int32_t l = 4 * p[0] - p[-(int)bpp] - p[bpp] -
+				p[-(int)stride] - p[stride];
+
+			sum += l;
+			sq += (int64_t)l * l;
+			n++;
+		}
+	}
+
+	if (!n)
+		return 0;
+
+	return (sq - (uint64_t)(sum * sum / n)) / n;
+}
@@ -0,0 +1,88 @@
+#ifndef _ANALYTICS_TAP_H
+#define _ANALYTICS_TAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_TAP_BUFFERS		8
+
+/*
+ * Read-only view of a captured frame. The planes point straight into the
+ * persistent mapping of the capture buffer, nothing is copied. A view is
+ * only valid inside the callback: the buffer is requeued right after.
+ */
+struct tap_frame {
+	int index;
+	uint32_t sequence;
+	uint32_t width;
+	uint32_t height;
+	uint32_t format;
+	int num_planes;
+	const uint8_t *plane[3];
+	uint32_t stride[3];
+};
+
+typedef void (*tap_callback_t)(const struct tap_frame *frame, void *priv);
+/* gives index back to the driver */
+typedef int (*tap_requeue_t)(void *priv, int index);
+
+struct analytics_tap {
+	int count;
+	size_t size;
+	int dma_fds[MAX_TAP_BUFFERS];
+	uint8_t *vaddr[MAX_TAP_BUFFERS];
+	uint32_t width;
+	uint32_t height;
+	uint32_t format;
+
+	tap_callback_t callback;
+	void *callback_priv;
+	tap_requeue_t requeue;
+	void *requeue_priv;
+
+	/* fifo of dequeued indexes owned by the worker */
+	int fifo[MAX_TAP_BUFFERS];
+	int head;
+	int pending;
+	bool closed;
+	bool sync_warned;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+
+	uint32_t sequence;
+	uint32_t frames;
+	uint64_t busy_us;
+	uint64_t max_us;
+};
+
+/* maps every dma_fds[] once, for the whole capture session */
+int analytics_tap_init(struct analytics_tap *tap, const int *dma_fds,
+		       int count, size_t size, uint32_t w, uint32_t h,
+		       uint32_t f, tap_requeue_t requeue, void *priv);
+void analytics_tap_register(struct analytics_tap *tap, tap_callback_t cb,
+			    void *priv);
+int analytics_tap_start(struct analytics_tap *tap);
+/* hands a dequeued index to the worker, never blocks */
+void analytics_tap_submit(struct analytics_tap *tap, int index);
+/* drains the pending frames, stops the worker and unmaps */
+void analytics_tap_deinit(struct analytics_tap *tap);
+void analytics_tap_print_stats(struct analytics_tap *tap);
+
+/* sample analytics for callbacks, step subsamples the luma plane */
+uint32_t tap_luma_mean(const struct tap_frame *frame, uint32_t step);
+/* variance of the 4-neighbour laplacian, low means blurred */
+uint32_t tap_laplacian_var(const struct tap_frame *frame, uint32_t step);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -31,16 +31,31 @@
 
 #include <linux/videodev2.h>
 
+#include <drm/nexell_drm.h>
+
 #include "media-bus-format.h"
 #include "nx-drm-allocator.h"
 #include "nx-v4l2.h"
+#ifdef NX_V4L2_MOCK
+#include "nx-v4l2-mock.h"
+#endif
 
 #include "option.h"
+#include "analytics-tap.h"
+#include "capture-trace.h"
+#include "mem-bench.h"
+#include "stall-watchdog.h"
 
 #ifndef ALIGN
 #define ALIGN(x, a) (((x) + (a) - 1) & ~((a) - 1))
 #endif
 
+#ifdef NX_V4L2_MOCK
+#define close_device(fd)	nx_v4l2_mock_close(fd)
+#else
+#define close_device(fd)	close(fd)
+#endif
+
 static size_t calc_alloc_size(uint32_t w, uint32_t h, uint32_t f)
 {
 	uint32_t y_stride = ALIGN(w, 32);
@@ -70,12 +85,98 @@ static size_t calc_alloc_size(uint32_t w, uint32_t h, uint32_t f)
 
 #define MAX_BUFFER_COUNT	4
 
+struct capture_ctx {
+	int video_fd;
+	int *dma_fds;
+	size_t *alloc_size;
+	uint32_t owned;		/* indexes dequeued and not given back yet */
+
+	/* what the watchdog needs to bring a stalled stream back */
+	int sensor_fd;
+	int clipper_subdev_fd;
+	uint32_t w;
+	uint32_t h;
+	uint32_t f;
+	uint32_t bus_f;
+
+	/* the watchdog's queue lock, the analytics worker requeues too */
+	pthread_mutex_t lock;
+};
+
+static int requeue_buffer(void *priv, int index)
+{
+	struct capture_ctx *ctx = (struct capture_ctx *)priv;
+	int ret;
+
+	pthread_mutex_lock(&ctx->lock);
+	ret = nx_v4l2_qbuf(ctx->video_fd, nx_clipper_video, 1, index,
+			   &ctx->dma_fds[index], (int *)ctx->alloc_size);
+	/* only after qbuf, so recovery never queues it a second time */
+	if (!ret)
+		__atomic_fetch_and(&ctx->owned, ~(1U << index),
+				   __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&ctx->lock);
+
+	return ret;
+}
+
+static int recover_stream(void *priv, enum watchdog_level level)
+{
+	struct capture_ctx *ctx = (struct capture_ctx *)priv;
+	uint32_t owned;
+	int ret, i;
+
+	if (level == WATCHDOG_RESET) {
+		ret = nx_v4l2_set_format(ctx->sensor_fd, nx_sensor_subdev,
+					 ctx->w, ctx->h, ctx->bus_f);
+		if (!ret)
+			ret = nx_v4l2_set_format(ctx->clipper_subdev_fd,
+						 nx_clipper_subdev, ctx->w,
+						 ctx->h, ctx->bus_f);
+		if (!ret)
+			ret = nx_v4l2_set_crop(ctx->clipper_subdev_fd,
+					       nx_clipper_subdev, 0, 0,
+					       ctx->w, ctx->h);
+		if (ret) {
+			fprintf(stderr, "failed to reset subdevs\n");
+			return ret;
+		}
+	}
+
+	/* buffers the analytics worker still holds are requeued by it */
+	owned = __atomic_load_n(&ctx->owned, __ATOMIC_ACQUIRE);
+	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
+		if (owned & (1U << i))
+			continue;
+		ret = nx_v4l2_qbuf(ctx->video_fd, nx_clipper_video, 1, i,
+				   &ctx->dma_fds[i], (int *)ctx->alloc_size);
+		if (ret) {
+			fprintf(stderr, "failed qbuf index %d\n", i);
+			return ret;
+		}
+	}
+
+	return nx_v4l2_streamon(ctx->video_fd, nx_clipper_video);
+}
+
+static void frame_analytics(const struct tap_frame *frame, void *priv)
+{
+	printf("analytics index %d seq %u: luma %u, sharpness %u\n",
+	       frame->index, frame->sequence, tap_luma_mean(frame, 4),
+	       tap_laplacian_var(frame, 2));
+}
+
 int main(int argc, char *argv[])
 {
 	int ret;
 	uint32_t m, w, h, f, bus_f, count;
+	uint32_t timeout = WATCHDOG_DEFAULT_TIMEOUT;
+	bool analytics = false;
+	bool bench = false;
+	char *record = NULL;
 
-	ret = handle_option(argc, argv, &m, &w, &h, &f, &bus_f, &count);
+	ret = handle_option(argc, argv, &m, &w, &h, &f, &bus_f, &count,
+			    &analytics, &bench, &timeout, &record);
 	if (ret) {
 		fprintf(stderr, "failed to handle_option\n");
 		return ret;
@@ -96,7 +197,7 @@ int main(int argc, char *argv[])
 
 	bool is_mipi = nx_v4l2_is_mipi_camera(m);
 
-	int csi_subdev_fd;
+	int csi_subdev_fd = -1;
 	if (is_mipi) {
 		csi_subdev_fd = nx_v4l2_open_device(nx_csi_subdev, m);
 		if (csi_subdev_fd < 0) {
@@ -183,6 +284,20 @@ int main(int argc, char *argv[])
 		return ret;
 	}
 
+	// compare V4L2 memory types on this stream, then exit
+	if (bench) {
+		int drm_fd = open_drm_device();
+		if (drm_fd < 0) {
+			fprintf(stderr, "failed to open_drm_device\n");
+			return -ENODEV;
+		}
+
+		ret = mem_bench_run(clipper_video_fd, drm_fd,
+				    calc_alloc_size(w, h, f), count,
+				    MAX_BUFFER_COUNT);
+		close(drm_fd);
+		return ret;
+	}
 
 	ret = nx_v4l2_reqbuf(clipper_video_fd, nx_clipper_video,
 			     MAX_BUFFER_COUNT);
@@ -208,8 +323,14 @@ int main(int argc, char *argv[])
 	int dma_fds[MAX_BUFFER_COUNT] = { -1, };
 	int i;
 
+	/*
+	 * the tap and the recorder read the frames: cached buffers, cpu
+	 * access is bracketed with DMA_BUF_IOCTL_SYNC
+	 */
 	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
-		int gem_fd = alloc_gem(drm_fd, alloc_size, 0);
+		int gem_fd = alloc_gem(drm_fd, alloc_size,
+				       (analytics || record) ? NX_BO_CACHABLE :
+				       0);
 		if (gem_fd < 0) {
 			fprintf(stderr, "failed to alloc_gem\n");
 			return -ENOMEM;
@@ -235,6 +356,43 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	struct capture_ctx ctx = { clipper_video_fd, dma_fds, &alloc_size, 0,
+				   sensor_fd, clipper_subdev_fd, w, h, f,
+				   bus_f };
+	struct analytics_tap tap;
+	struct capture_trace trace;
+	struct stall_watchdog wd;
+
+	pthread_mutex_init(&ctx.lock, NULL);
+	stall_watchdog_init(&wd, clipper_video_fd, nx_clipper_video, 1,
+			    MAX_BUFFER_COUNT, timeout, recover_stream, &ctx);
+	stall_watchdog_set_queue_lock(&wd, &ctx.lock);
+
+	if (record) {
+		ret = trace_writer_open(&trace, record, w, h, f, bus_f,
+					clipper_video_fd, dma_fds,
+					MAX_BUFFER_COUNT, alloc_size);
+		if (ret) {
+			fprintf(stderr, "failed to open trace %s\n", record);
+			return ret;
+		}
+	}
+
+	if (analytics) {
+		ret = analytics_tap_init(&tap, dma_fds, MAX_BUFFER_COUNT,
+					 alloc_size, w, h, f, requeue_buffer,
+					 &ctx);
+		if (ret) {
+			fprintf(stderr, "failed to init analytics tap\n");
+			return ret;
+		}
+		analytics_tap_register(&tap, frame_analytics, NULL);
+
+		ret = analytics_tap_start(&tap);
+		if (ret)
+			return ret;
+	}
+
 	ret = nx_v4l2_streamon(clipper_video_fd, nx_clipper_video);
 	if (ret) {
 		fprintf(stderr, "failed to streamon\n");
@@ -244,24 +402,46 @@ int main(int argc, char *argv[])
 	int loop_count = count;
 	while (loop_count--) {
 		int dq_index;
-		ret = nx_v4l2_dqbuf(clipper_video_fd, nx_clipper_video, 1,
-				    &dq_index);
+		ret = stall_watchdog_dqbuf(&wd, &dq_index);
 		if (ret) {
 			fprintf(stderr, "failed to dqbuf\n");
 			return ret;
 		}
+		__atomic_fetch_or(&ctx.owned, 1U << dq_index, __ATOMIC_RELAXED);
 
 		printf("dq index : %d\n", dq_index);
 
-		ret = nx_v4l2_qbuf(clipper_video_fd, nx_clipper_video, 1,
-				   dq_index, &dma_fds[dq_index],
-				   (int *)&alloc_size);
+		/* synchronous, a slow disk shows up as capture drops */
+		if (record) {
+			ret = trace_writer_add(&trace, dq_index);
+			if (ret)
+				return ret;
+		}
+
+		if (analytics) {
+			/* the worker requeues once the callback returns */
+			analytics_tap_submit(&tap, dq_index);
+			continue;
+		}
+
+		ret = requeue_buffer(&ctx, dq_index);
 		if (ret) {
 			fprintf(stderr, "failed qbuf index %d\n", dq_index);
 			return ret;
 		}
 	}
 
+	if (analytics) {
+		analytics_tap_deinit(&tap);
+		analytics_tap_print_stats(&tap);
+	}
+
+	if (record)
+		trace_writer_close(&trace);
+
+	stall_watchdog_print_stats(&wd);
+	pthread_mutex_destroy(&ctx.lock);
+
 	nx_v4l2_streamoff(clipper_video_fd, nx_clipper_video);
 
 	// free buffers
@@ -272,5 +452,11 @@ int main(int argc, char *argv[])
 			close(gem_fds[i]);
 	}
 
+	close_device(clipper_video_fd);
+	close_device(clipper_subdev_fd);
+	if (csi_subdev_fd >= 0)
+		close_device(csi_subdev_fd);
+	close_device(sensor_fd);
+
 	return ret;
 }
@@ -0,0 +1,473 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include <linux/videodev2.h>
+#include <linux/dma-buf.h>
+
+#include <drm/nexell_drm.h>
+#include "nx-drm-allocator.h"
+
+#include "mem-bench.h"
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+#define MAX_BENCH_BUFFERS	8
+#define BENCH_POLL_TIMEOUT	3000	/* ms */
+
+enum bench_mode {
+	BENCH_DMABUF,
+	BENCH_DMABUF_CACHED,
+	BENCH_MMAP_EXPBUF,
+	BENCH_USERPTR,
+	BENCH_MODE_MAX,
+};
+
+static const char *bench_mode_name[BENCH_MODE_MAX] = {
+	"dmabuf", "dmabuf-cached", "mmap+expbuf", "userptr",
+};
+
+struct bench_buf {
+	int gem_fd;
+	int dma_fd;		/* dmabuf modes, or the EXPBUF result */
+	void *vaddr;
+	size_t length;		/* mapped / allocated bytes */
+	bool mmapped;		/* vaddr from mmap(), else malloc() */
+};
+
+struct bench_ctx {
+	int video_fd;
+	int drm_fd;
+	uint32_t type;
+	bool mplane;
+	size_t size;
+	int buf_count;
+	enum bench_mode mode;
+	uint32_t memory;
+	struct bench_buf bufs[MAX_BENCH_BUFFERS];
+};
+
+struct bench_result {
+	int error;
+	uint64_t setup_us;
+	uint32_t frames;
+	uint64_t dq_us;
+	uint64_t q_us;
+	uint64_t read_us;
+	uint64_t read_bytes;
+	uint64_t wall_us;
+	uint64_t cpu_us;
+};
+
+static volatile uint64_t bench_sink;
+
+static uint64_t bench_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t bench_cpu_us(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000 +
+		ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+/* what a CPU consumer does at least once: touch every byte */
+static void bench_read(const void *vaddr, size_t size)
+{
+	const uint64_t *p = (const uint64_t *)vaddr;
+	size_t n = size / sizeof(uint64_t);
+	uint64_t a = 0, b = 0, c = 0, d = 0;
+	size_t i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		a += p[i];
+		b += p[i + 1];
+		c += p[i + 2];
+		d += p[i + 3];
+	}
+	bench_sink = a + b + c + d;
+}
+
+static void bench_sync(int dma_fd, bool start)
+{
+#ifdef DMA_BUF_IOCTL_SYNC
+	struct dma_buf_sync sync;
+
+	sync.flags = DMA_BUF_SYNC_READ |
+		(start ? DMA_BUF_SYNC_START : DMA_BUF_SYNC_END);
+	ioctl(dma_fd, DMA_BUF_IOCTL_SYNC, &sync);
+#endif
+}
+
+static int bench_reqbuf(struct bench_ctx *ctx, int count)
+{
+	struct v4l2_requestbuffers req;
+
+	memset(&req, 0, sizeof(req));
+	req.count = count;
+	req.type = ctx->type;
+	req.memory = ctx->memory;
+
+	if (ioctl(ctx->video_fd, VIDIOC_REQBUFS, &req))
+		return -errno;
+
+	if (count && (int)req.count < count)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static void bench_fill_buf(struct bench_ctx *ctx, struct v4l2_buffer *buf,
+			   struct v4l2_plane *plane, int index)
+{
+	memset(buf, 0, sizeof(*buf));
+	memset(plane, 0, sizeof(*plane));
+	buf->type = ctx->type;
+	buf->memory = ctx->memory;
+	buf->index = index;
+	if (ctx->mplane) {
+		buf->m.planes = plane;
+		buf->length = 1;
+	}
+}
+
+static int bench_qbuf(struct bench_ctx *ctx, int index)
+{
+	struct bench_buf *b = &ctx->bufs[index];
+	struct v4l2_buffer buf;
+	struct v4l2_plane plane;
+
+	bench_fill_buf(ctx, &buf, &plane, index);
+
+	if (ctx->memory == V4L2_MEMORY_DMABUF) {
+		if (ctx->mplane) {
+			plane.m.fd = b->dma_fd;
+			plane.length = ctx->size;
+		} else {
+			buf.m.fd = b->dma_fd;
+			buf.length = ctx->size;
+		}
+	} else if (ctx->memory == V4L2_MEMORY_USERPTR) {
+		if (ctx->mplane) {
+			plane.m.userptr = (unsigned long)b->vaddr;
+			plane.length = ctx->size;
+		} else {
+			buf.m.userptr = (unsigned long)b->vaddr;
+			buf.length = ctx->size;
+		}
+	}
+
+	if (ioctl(ctx->video_fd, VIDIOC_QBUF, &buf))
+		return -errno;
+
+	return 0;
+}
+
+static int bench_dqbuf(struct bench_ctx *ctx, int *index)
+{
+	struct v4l2_buffer buf;
+	struct v4l2_plane plane;
+
+	bench_fill_buf(ctx, &buf, &plane, 0);
+
+	if (ioctl(ctx->video_fd, VIDIOC_DQBUF, &buf))
+		return -errno;
+
+	*index = buf.index;
+	return 0;
+}
+
+static int bench_map_mmap(struct bench_ctx *ctx, int index)
+{
+	struct bench_buf *b = &ctx->bufs[index];
+	struct v4l2_buffer buf;
+	struct v4l2_plane plane;
+	struct v4l2_exportbuffer exp;
+	uint32_t offset, length;
+
+	bench_fill_buf(ctx, &buf, &plane, index);
+	if (ioctl(ctx->video_fd, VIDIOC_QUERYBUF, &buf))
+		return -errno;
+
+	offset = ctx->mplane ? plane.m.mem_offset : buf.m.offset;
+	length = ctx->mplane ? plane.length : buf.length;
+
+	b->vaddr = mmap(NULL, length, PROT_READ, MAP_SHARED, ctx->video_fd,
+			offset);
+	if (b->vaddr == MAP_FAILED) {
+		b->vaddr = NULL;
+		return -errno;
+	}
+	b->length = length;
+	b->mmapped = true;
+
+	/* the fd a scaler or display stage would be handed */
+	memset(&exp, 0, sizeof(exp));
+	exp.type = ctx->type;
+	exp.index = index;
+	exp.flags = O_CLOEXEC | O_RDONLY;
+	if (ioctl(ctx->video_fd, VIDIOC_EXPBUF, &exp))
+		return -errno;
+	b->dma_fd = exp.fd;
+
+	return 0;
+}
+
+static int bench_alloc(struct bench_ctx *ctx, int index)
+{
+	struct bench_buf *b = &ctx->bufs[index];
+	void *vaddr;
+
+	switch (ctx->mode) {
+	case BENCH_DMABUF:
+	case BENCH_DMABUF_CACHED:
+		b->gem_fd = alloc_gem(ctx->drm_fd, ctx->size,
+				ctx->mode == BENCH_DMABUF_CACHED ?
+				NX_BO_CACHABLE : 0);
+		if (b->gem_fd < 0)
+			return -ENOMEM;
+		b->dma_fd = gem_to_dmafd(ctx->drm_fd, b->gem_fd);
+		if (b->dma_fd < 0)
+			return -ENOMEM;
+		vaddr = mmap(NULL, ctx->size, PROT_READ, MAP_SHARED, b->dma_fd,
+			     0);
+		if (vaddr == MAP_FAILED)
+			return -errno;
+		b->vaddr = vaddr;
+		b->length = ctx->size;
+		b->mmapped = true;
+		return 0;
+
+	case BENCH_MMAP_EXPBUF:
+		return bench_map_mmap(ctx, index);
+
+	case BENCH_USERPTR:
+		if (posix_memalign(&vaddr, sysconf(_SC_PAGESIZE), ctx->size))
+			return -ENOMEM;
+		b->vaddr = vaddr;
+		b->length = ctx->size;
+		return 0;
+
+	default:
+		return -EINVAL;
+	}
+}
+
+static void bench_free(struct bench_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < ctx->buf_count; i++) {
+		struct bench_buf *b = &ctx->bufs[i];
+
+		if (b->vaddr) {
+			if (b->mmapped)
+				munmap(b->vaddr, b->length);
+			else
+				free(b->vaddr);
+		}
+		if (b->dma_fd >= 0)
+			close(b->dma_fd);
+		if (b->gem_fd >= 0)
+			free_gem(ctx->drm_fd, b->gem_fd);
+
+		b->vaddr = NULL;
+		b->length = 0;
+		b->mmapped = false;
+		b->dma_fd = -1;
+		b->gem_fd = -1;
+	}
+}
+
+static void bench_one(struct bench_ctx *ctx, uint32_t count,
+		      struct bench_result *res)
+{
+	uint64_t t0, t1, cpu;
+	int i, ret, index;
+
+	static const uint32_t memory[BENCH_MODE_MAX] = {
+		V4L2_MEMORY_DMABUF, V4L2_MEMORY_DMABUF,
+		V4L2_MEMORY_MMAP, V4L2_MEMORY_USERPTR,
+	};
+
+	memset(res, 0, sizeof(*res));
+	ctx->memory = memory[ctx->mode];
+	for (i = 0; i < ctx->buf_count; i++) {
+		ctx->bufs[i].gem_fd = -1;
+		ctx->bufs[i].dma_fd = -1;
+		ctx->bufs[i].vaddr = NULL;
+		ctx->bufs[i].length = 0;
+		ctx->bufs[i].mmapped = false;
+	}
+
+	/* setup: buffers requested, allocated, mapped, queued, streaming */
+	t0 = bench_now_us();
+
+	ret = bench_reqbuf(ctx, ctx->buf_count);
+	if (ret) {
+		res->error = ret;
+		return;
+	}
+
+	for (i = 0; i < ctx->buf_count && !ret; i++) {
+		ret = bench_alloc(ctx, i);
+		if (!ret)
+			ret = bench_qbuf(ctx, i);
+	}
+
+	if (!ret && ioctl(ctx->video_fd, VIDIOC_STREAMON, &ctx->type))
+		ret = -errno;
+
+	res->setup_us = bench_now_us() - t0;
+	if (ret) {
+		res->error = ret;
+		goto out;
+	}
+
+	cpu = bench_cpu_us();
+	t0 = bench_now_us();
+
+	while (res->frames < count) {
+		struct pollfd pfd = { ctx->video_fd, POLLIN, 0 };
+		struct bench_buf *b;
+
+		/* waiting for the sensor is not dq cost */
+		ret = poll(&pfd, 1, BENCH_POLL_TIMEOUT);
+		if (ret <= 0) {
+			res->error = ret ? -errno : -ETIMEDOUT;
+			break;
+		}
+
+		t1 = bench_now_us();
+		ret = bench_dqbuf(ctx, &index);
+		res->dq_us += bench_now_us() - t1;
+		if (ret) {
+			res->error = ret;
+			break;
+		}
+
+		b = &ctx->bufs[index];
+		t1 = bench_now_us();
+		if (ctx->memory == V4L2_MEMORY_DMABUF)
+			bench_sync(b->dma_fd, true);
+		bench_read(b->vaddr, MIN(b->length, ctx->size));
+		if (ctx->memory == V4L2_MEMORY_DMABUF)
+			bench_sync(b->dma_fd, false);
+		res->read_us += bench_now_us() - t1;
+		res->read_bytes += MIN(b->length, ctx->size);
+
+		t1 = bench_now_us();
+		ret = bench_qbuf(ctx, index);
+		res->q_us += bench_now_us() - t1;
+		if (ret) {
+			res->error = ret;
+			break;
+		}
+
+		res->frames++;
+	}
+
+	res->wall_us = bench_now_us() - t0;
+	res->cpu_us = bench_cpu_us() - cpu;
+
+	ioctl(ctx->video_fd, VIDIOC_STREAMOFF, &ctx->type);
+
+out:
+	bench_free(ctx);
+	bench_reqbuf(ctx, 0);
+}
+
+int mem_bench_run(int video_fd, int drm_fd, size_t size, uint32_t count,
+		  int buf_count)
+{
+	struct bench_ctx ctx;
+	struct bench_result res[BENCH_MODE_MAX];
+	struct v4l2_capability cap;
+	int i;
+
+	if (buf_count < 2 || buf_count > MAX_BENCH_BUFFERS)
+		return -EINVAL;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.video_fd = video_fd;
+	ctx.drm_fd = drm_fd;
+	ctx.size = size;
+	ctx.buf_count = buf_count;
+
+	memset(&cap, 0, sizeof(cap));
+	if (ioctl(video_fd, VIDIOC_QUERYCAP, &cap)) {
+		fprintf(stderr, "failed to querycap: %s\n", strerror(errno));
+		return -errno;
+	}
+	ctx.mplane = !!((cap.device_caps ? cap.device_caps : cap.capabilities) &
+			V4L2_CAP_VIDEO_CAPTURE_MPLANE);
+	ctx.type = ctx.mplane ? V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE :
+		V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+	for (i = 0; i < BENCH_MODE_MAX; i++) {
+		ctx.mode = (enum bench_mode)i;
+		printf("memory bench: %s, %u frames of %zu bytes\n",
+		       bench_mode_name[i], count, size);
+		bench_one(&ctx, count, &res[i]);
+	}
+
+	printf("%-14s %10s %8s %8s %10s %7s\n", "mode", "setup(us)",
+	       "dq(us)", "q(us)", "read(MB/s)", "cpu(%)");
+
+	for (i = 0; i < BENCH_MODE_MAX; i++) {
+		struct bench_result *r = &res[i];
+
+		if (!r->frames) {
+			printf("%-14s %s (%s)\n", bench_mode_name[i],
+			       "not supported", strerror(-r->error));
+			continue;
+		}
+
+		printf("%-14s %10llu %8llu %8llu %10llu %7.1f%s\n",
+		       bench_mode_name[i],
+		       (unsigned long long)r->setup_us,
+		       (unsigned long long)(r->dq_us / r->frames),
+		       (unsigned long long)(r->q_us / r->frames),
+		       (unsigned long long)(r->read_us ?
+					    r->read_bytes / r->read_us : 0),
+		       r->wall_us ? 100.0 * r->cpu_us / r->wall_us : 0.0,
+		       r->error ? " (stopped early)" : "");
+	}
+
+	return 0;
+}
@@ -0,0 +1,30 @@
+#ifndef _MEM_BENCH_H
+#define _MEM_BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Runs the same capture stream once per V4L2 memory type and prints
+ * setup time, dq/q ioctl cost, CPU load and CPU read bandwidth:
+ *
+ *   dmabuf         GEM buffers (as every test does), CPU reads uncached
+ *   dmabuf-cached  GEM buffers allocated cached, reads bracketed with
+ *                  DMA_BUF_IOCTL_SYNC
+ *   mmap+expbuf    driver buffers, mmap()ed and exported as dma-buf fds
+ *   userptr        page aligned malloc() memory
+ *
+ * video_fd must have its format set and no buffers requested.
+ */
+int mem_bench_run(int video_fd, int drm_fd, size_t size, uint32_t count,
+		  int buf_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -6,11 +6,13 @@
 #include "option.h"
 
 int handle_option(int argc, char **argv, uint32_t *m, uint32_t *w,
-		  uint32_t *h, uint32_t *f, uint32_t *bus_f, uint32_t *c)
+		  uint32_t *h, uint32_t *f, uint32_t *bus_f, uint32_t *c,
+		  bool *analytics, bool *bench, uint32_t *timeout,
+		  char **record)
 {
 	int opt;
 
-	while ((opt = getopt(argc, argv, "m:w:h:f:F:c:")) != -1) {
+	while ((opt = getopt(argc, argv, "m:w:h:f:F:c:aBt:R:")) != -1) {
 		switch (opt) {
 		case 'm':
 			*m = atoi(optarg);
@@ -30,6 +32,18 @@ int handle_option(int argc, char **argv, uint32_t *m, uint32_t *w,
 		case 'c':
 			*c = atoi(optarg);
 			break;
+		case 'a':
+			*analytics = true;
+			break;
+		case 'B':
+			*bench = true;
+			break;
+		case 't':
+			*timeout = atoi(optarg);
+			break;
+		case 'R':
+			*record = optarg;
+			break;
 		}
 	}
 
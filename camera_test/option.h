@@ -6,7 +6,9 @@ extern "C" {
 #endif
 
 int handle_option(int argc, char **argv, uint32_t *m, uint32_t *w,
-		  uint32_t *h, uint32_t *f, uint32_t *bus_f, uint32_t *count);
+		  uint32_t *h, uint32_t *f, uint32_t *bus_f, uint32_t *count,
+		  bool *analytics, bool *bench, uint32_t *timeout,
+		  char **record);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,406 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <linux/videodev2.h>
+#include <linux/dma-buf.h>
+
+#ifdef NX_V4L2_MOCK
+#include "nx-v4l2-mock.h"
+#endif
+
+#include "capture-trace.h"
+
+#ifndef ALIGN
+#define ALIGN(x, a) (((x) + (a) - 1) & ~((a) - 1))
+#endif
+
+static uint64_t trace_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* same layout calc_alloc_size() allocates for */
+static void trace_fill_layout(struct trace_header *hdr)
+{
+	uint32_t y_stride = ALIGN(hdr->width, 32);
+	uint32_t y_size = y_stride * ALIGN(hdr->height, 16);
+	uint32_t c_stride;
+
+	hdr->num_planes = 1;
+	hdr->offset[0] = 0;
+	hdr->stride[0] = y_stride;
+
+	switch (hdr->format) {
+	case V4L2_PIX_FMT_YUYV:
+		hdr->stride[0] = y_stride << 1;
+		break;
+
+	case V4L2_PIX_FMT_YUV420:
+		c_stride = ALIGN(y_stride >> 1, 16);
+		hdr->num_planes = 3;
+		hdr->offset[1] = y_size;
+		hdr->offset[2] = y_size + c_stride * ALIGN(hdr->height >> 1, 16);
+		hdr->stride[1] = c_stride;
+		hdr->stride[2] = c_stride;
+		break;
+
+	case V4L2_PIX_FMT_NV12:
+	case V4L2_PIX_FMT_NV21:
+	case V4L2_PIX_FMT_NV16:
+	case V4L2_PIX_FMT_NV61:
+		hdr->num_planes = 2;
+		hdr->offset[1] = y_size;
+		hdr->stride[1] = y_stride;
+		break;
+	}
+}
+
+static void trace_sync(struct capture_trace *t, int index, bool start)
+{
+#ifdef DMA_BUF_IOCTL_SYNC
+	struct dma_buf_sync sync;
+
+	sync.flags = DMA_BUF_SYNC_READ |
+		(start ? DMA_BUF_SYNC_START : DMA_BUF_SYNC_END);
+	ioctl(t->dma_fds[index], DMA_BUF_IOCTL_SYNC, &sync);
+#endif
+}
+
+/*
+ * nx_v4l2_dqbuf() drops timestamp and sequence, but a dequeued buffer
+ * keeps both until it is queued again, so ask the driver for them.
+ */
+static int trace_buf_info(struct capture_trace *t, int index,
+			  struct trace_record *rec)
+{
+#ifdef NX_V4L2_MOCK
+	return nx_v4l2_mock_get_buf_info(t->video_fd, index,
+					 &rec->timestamp_ns, &rec->sequence);
+#else
+	struct v4l2_buffer buf;
+	struct v4l2_plane planes[VIDEO_MAX_PLANES];
+
+	memset(&buf, 0, sizeof(buf));
+	memset(planes, 0, sizeof(planes));
+	buf.index = index;
+	buf.memory = V4L2_MEMORY_DMABUF;
+	if (t->mplane) {
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+		buf.m.planes = planes;
+		buf.length = 1;
+	} else {
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	}
+
+	if (ioctl(t->video_fd, VIDIOC_QUERYBUF, &buf))
+		return -errno;
+
+	rec->sequence = buf.sequence;
+	rec->timestamp_ns = (uint64_t)buf.timestamp.tv_sec * 1000000000 +
+		(uint64_t)buf.timestamp.tv_usec * 1000;
+	return 0;
+#endif
+}
+
+/* the whole first page, so even an empty trace maps */
+static int trace_write_header(struct capture_trace *t)
+{
+	uint8_t page[TRACE_ALIGN];
+
+	memset(page, 0, sizeof(page));
+	memcpy(page, &t->hdr, sizeof(t->hdr));
+	if (pwrite(t->fd, page, sizeof(page), 0) != sizeof(page))
+		return -errno;
+	return 0;
+}
+
+int trace_writer_open(struct capture_trace *t, const char *path,
+		      uint32_t w, uint32_t h, uint32_t f, uint32_t bus_f,
+		      int video_fd, const int *dma_fds, int count,
+		      size_t size)
+{
+	struct v4l2_capability cap;
+	int ret, i;
+
+	if (count < 1 || count > MAX_TRACE_BUFFERS)
+		return -EINVAL;
+
+	memset(t, 0, sizeof(*t));
+	t->video_fd = video_fd;
+	t->count = count;
+	t->size = size;
+
+	memset(&cap, 0, sizeof(cap));
+	if (!ioctl(video_fd, VIDIOC_QUERYCAP, &cap))
+		t->mplane = (cap.device_caps ? cap.device_caps :
+			     cap.capabilities) &
+			V4L2_CAP_VIDEO_CAPTURE_MPLANE;
+
+	t->hdr.magic = TRACE_MAGIC;
+	t->hdr.version = TRACE_VERSION;
+	t->hdr.header_size = TRACE_ALIGN;
+	t->hdr.frame_size = size;
+	t->hdr.record_size = ALIGN(size + sizeof(struct trace_record),
+				   TRACE_ALIGN);
+	t->hdr.width = w;
+	t->hdr.height = h;
+	t->hdr.format = f;
+	t->hdr.bus_format = bus_f;
+	trace_fill_layout(&t->hdr);
+
+	t->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (t->fd < 0) {
+		fprintf(stderr, "failed to create %s: %s\n", path,
+			strerror(errno));
+		return -errno;
+	}
+
+	/* readable as an empty trace until the first frame lands */
+	ret = trace_write_header(t);
+	if (ret) {
+		fprintf(stderr, "failed to write trace header\n");
+		close(t->fd);
+		return ret;
+	}
+
+	for (i = 0; i < count; i++) {
+		void *vaddr;
+
+		t->dma_fds[i] = dma_fds[i];
+		vaddr = mmap(NULL, size, PROT_READ, MAP_SHARED, dma_fds[i], 0);
+		if (vaddr == MAP_FAILED) {
+			fprintf(stderr, "failed to mmap index %d: %s\n", i,
+				strerror(errno));
+			while (--i >= 0)
+				munmap(t->vaddr[i], size);
+			close(t->fd);
+			return -ENOMEM;
+		}
+		t->vaddr[i] = (uint8_t *)vaddr;
+	}
+
+	return 0;
+}
+
+int trace_writer_add(struct capture_trace *t, int index)
+{
+	struct trace_record rec;
+	uint64_t start = trace_now_us();
+	uint64_t elapsed;
+	off_t off;
+	ssize_t len;
+	int ret;
+
+	if (index < 0 || index >= t->count)
+		return -EINVAL;
+
+	memset(&rec, 0, sizeof(rec));
+	ret = trace_buf_info(t, index, &rec);
+	if (ret) {
+		fprintf(stderr, "failed to query index %d: %d\n", index, ret);
+		return ret;
+	}
+	rec.magic = TRACE_RECORD_MAGIC;
+	rec.bytesused = t->hdr.frame_size;
+	rec.index = index;
+
+	if (t->hdr.frame_count) {
+		/* what the capture dropped, not what the recorder lost */
+		if (rec.sequence > t->last_sequence + 1)
+			t->dropped += rec.sequence - t->last_sequence - 1;
+	} else {
+		t->hdr.first_ts_ns = rec.timestamp_ns;
+	}
+
+	off = (off_t)t->hdr.header_size +
+		(off_t)t->hdr.frame_count * t->hdr.record_size;
+
+	trace_sync(t, index, true);
+	len = pwrite(t->fd, t->vaddr[index], t->hdr.frame_size, off);
+	trace_sync(t, index, false);
+	if (len != (ssize_t)t->hdr.frame_size) {
+		fprintf(stderr, "failed to write frame %u: %s\n",
+			t->hdr.frame_count, len < 0 ? strerror(errno) :
+			"short write");
+		return len < 0 ? -errno : -EIO;
+	}
+
+	/* the padding in between stays a hole */
+	off += t->hdr.record_size - sizeof(rec);
+	if (pwrite(t->fd, &rec, sizeof(rec), off) != sizeof(rec)) {
+		fprintf(stderr, "failed to write record %u\n",
+			t->hdr.frame_count);
+		return -EIO;
+	}
+
+	t->last_sequence = rec.sequence;
+	t->hdr.last_ts_ns = rec.timestamp_ns;
+	t->hdr.frame_count++;
+
+	elapsed = trace_now_us() - start;
+	t->write_us += elapsed;
+	if (elapsed > t->max_write_us)
+		t->max_write_us = elapsed;
+
+	return 0;
+}
+
+void trace_writer_close(struct capture_trace *t)
+{
+	int i;
+
+	if (trace_write_header(t))
+		fprintf(stderr, "failed to finalize trace header\n");
+	close(t->fd);
+
+	for (i = 0; i < t->count; i++) {
+		if (t->vaddr[i])
+			munmap(t->vaddr[i], t->size);
+		t->vaddr[i] = NULL;
+	}
+
+	printf("trace: recorded %u frames, %u dropped by capture, "
+	       "write avg %llu us, max %llu us\n", t->hdr.frame_count,
+	       t->dropped, t->hdr.frame_count ?
+	       (unsigned long long)(t->write_us / t->hdr.frame_count) : 0ULL,
+	       (unsigned long long)t->max_write_us);
+}
+
+int trace_reader_open(struct capture_trace *t, const char *path)
+{
+	struct stat st;
+	void *map;
+	uint32_t n;
+
+	memset(t, 0, sizeof(*t));
+
+	t->fd = open(path, O_RDONLY);
+	if (t->fd < 0) {
+		fprintf(stderr, "failed to open %s: %s\n", path,
+			strerror(errno));
+		return -errno;
+	}
+
+	if (fstat(t->fd, &st) || st.st_size < TRACE_ALIGN) {
+		fprintf(stderr, "%s is not a capture trace\n", path);
+		close(t->fd);
+		return -EINVAL;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, t->fd, 0);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "failed to mmap %s: %s\n", path,
+			strerror(errno));
+		close(t->fd);
+		return -ENOMEM;
+	}
+	t->map = (uint8_t *)map;
+	t->map_size = st.st_size;
+	memcpy(&t->hdr, t->map, sizeof(t->hdr));
+
+	if (t->hdr.magic != TRACE_MAGIC || t->hdr.version != TRACE_VERSION ||
+	    t->hdr.header_size % TRACE_ALIGN ||
+	    t->hdr.record_size % TRACE_ALIGN ||
+	    t->hdr.frame_size + sizeof(struct trace_record) >
+	    t->hdr.record_size) {
+		fprintf(stderr, "%s: bad trace header\n", path);
+		trace_reader_close(t);
+		return -EINVAL;
+	}
+
+	/* an interrupted recording: count the complete records */
+	n = (t->map_size - t->hdr.header_size) / t->hdr.record_size;
+	if (!t->hdr.frame_count || t->hdr.frame_count > n) {
+		const struct trace_record *rec;
+
+		t->hdr.frame_count = n;
+		while (t->hdr.frame_count &&
+		       !trace_reader_frame(t, t->hdr.frame_count - 1, &rec))
+			t->hdr.frame_count--;
+		if (t->hdr.frame_count) {
+			trace_reader_frame(t, 0, &rec);
+			t->hdr.first_ts_ns = rec->timestamp_ns;
+			trace_reader_frame(t, t->hdr.frame_count - 1, &rec);
+			t->hdr.last_ts_ns = rec->timestamp_ns;
+		}
+		fprintf(stderr, "%s was not closed, %u frames recovered\n",
+			path, t->hdr.frame_count);
+	}
+
+	return 0;
+}
+
+const uint8_t *trace_reader_frame(struct capture_trace *t, uint32_t n,
+				  const struct trace_record **rec)
+{
+	size_t off = (size_t)t->hdr.header_size +
+		(size_t)n * t->hdr.record_size;
+	const struct trace_record *r;
+
+	if (off + t->hdr.record_size > t->map_size)
+		return NULL;
+
+	r = (const struct trace_record *)(t->map + off + t->hdr.record_size -
+					  sizeof(*r));
+	if (r->magic != TRACE_RECORD_MAGIC)
+		return NULL;
+
+	if (rec)
+		*rec = r;
+	return t->map + off;
+}
+
+void trace_reader_close(struct capture_trace *t)
+{
+	if (t->map)
+		munmap(t->map, t->map_size);
+	t->map = NULL;
+	close(t->fd);
+}
+
+void trace_print_info(struct capture_trace *t)
+{
+	uint64_t span = t->hdr.last_ts_ns - t->hdr.first_ts_ns;
+
+	printf("trace: %ux%u fourcc %c%c%c%c, %u frames over %llu ms",
+	       t->hdr.width, t->hdr.height,
+	       t->hdr.format & 0xff, (t->hdr.format >> 8) & 0xff,
+	       (t->hdr.format >> 16) & 0xff, (t->hdr.format >> 24) & 0xff,
+	       t->hdr.frame_count, (unsigned long long)(span / 1000000));
+	if (t->hdr.frame_count > 1 && span)
+		printf(", %llu.%02llu fps",
+		       (unsigned long long)((t->hdr.frame_count - 1) *
+					    1000000000ULL / span),
+		       (unsigned long long)((t->hdr.frame_count - 1) *
+					    100000000000ULL / span % 100));
+	printf("\n");
+}
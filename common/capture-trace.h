@@ -0,0 +1,101 @@
+#ifndef _CAPTURE_TRACE_H
+#define _CAPTURE_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_TRACE_BUFFERS	8
+
+/*
+ * On-disk capture trace, every offset is a multiple of TRACE_ALIGN so a
+ * reader can mmap the file and hand out frames in place:
+ *
+ *	0			struct trace_header, rest of the page is zero
+ *	header_size + n * record_size
+ *				frame n payload, plane layout from the header
+ *	... + record_size - sizeof(struct trace_record)
+ *				struct trace_record of frame n
+ *
+ * All fields are little endian, as written by the target.
+ */
+#define TRACE_MAGIC		0x5443584e	/* "NXCT" */
+#define TRACE_RECORD_MAGIC	0x5246584e	/* "NXFR" */
+#define TRACE_VERSION		1
+#define TRACE_ALIGN		4096
+
+struct trace_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t header_size;	/* offset of frame 0 */
+	uint32_t record_size;	/* payload + padding + trace_record */
+	uint32_t frame_size;	/* payload bytes */
+	uint32_t width;
+	uint32_t height;
+	uint32_t format;	/* V4L2_PIX_FMT_* */
+	uint32_t bus_format;	/* MEDIA_BUS_FMT_* the sensor ran at */
+	uint32_t num_planes;
+	uint32_t offset[3];	/* plane offsets inside the payload */
+	uint32_t stride[3];
+	uint32_t frame_count;	/* 0 if the recorder did not close the file */
+	uint32_t reserved;
+	uint64_t first_ts_ns;
+	uint64_t last_ts_ns;
+};
+
+struct trace_record {
+	uint32_t magic;
+	uint32_t sequence;	/* v4l2_buffer.sequence, gaps are drops */
+	uint64_t timestamp_ns;	/* v4l2_buffer.timestamp, CLOCK_MONOTONIC */
+	uint32_t bytesused;
+	uint32_t index;		/* capture buffer the frame came from */
+};
+
+struct capture_trace {
+	int fd;
+	struct trace_header hdr;
+
+	/* writer: persistent mappings of the capture buffers */
+	int count;
+	size_t size;
+	int dma_fds[MAX_TRACE_BUFFERS];
+	uint8_t *vaddr[MAX_TRACE_BUFFERS];
+	int video_fd;
+	bool mplane;
+	uint32_t last_sequence;
+	uint32_t dropped;	/* sequence gaps seen while recording */
+	uint64_t write_us;
+	uint64_t max_write_us;
+
+	/* reader: the whole file */
+	uint8_t *map;
+	size_t map_size;
+};
+
+/* layout of calc_alloc_size() buffers, dma_fds[] are mapped once */
+int trace_writer_open(struct capture_trace *t, const char *path,
+		      uint32_t w, uint32_t h, uint32_t f, uint32_t bus_f,
+		      int video_fd, const int *dma_fds, int count,
+		      size_t size);
+/* appends the frame just dequeued into index, with its v4l2 metadata */
+int trace_writer_add(struct capture_trace *t, int index);
+/* patches frame count and time span into the header */
+void trace_writer_close(struct capture_trace *t);
+
+int trace_reader_open(struct capture_trace *t, const char *path);
+/* payload of frame n, points into the mapping */
+const uint8_t *trace_reader_frame(struct capture_trace *t, uint32_t n,
+				  const struct trace_record **rec);
+void trace_reader_close(struct capture_trace *t);
+
+void trace_print_info(struct capture_trace *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
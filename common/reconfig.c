@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include <nx-v4l2.h>
+
+#include "reconfig.h"
+
+static void reconfig_stdio_log(bool err, const char *msg)
+{
+	fputs(msg, err ? stderr : stdout);
+}
+
+static reconfig_log_t reconfig_log_hook = reconfig_stdio_log;
+
+void reconfig_set_log(reconfig_log_t log)
+{
+	reconfig_log_hook = log ? log : reconfig_stdio_log;
+}
+
+static void reconfig_log(bool err, const char *fmt, ...)
+{
+	char msg[256];
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(msg, sizeof(msg), fmt, ap);
+	va_end(ap);
+
+	reconfig_log_hook(err, msg);
+}
+
+static uint64_t reconfig_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int reconfig_parse(const char *arg, struct reconfig_list *list)
+{
+	const char *p;
+	char *end;
+
+	memset(list, 0, sizeof(*list));
+
+	list->interval = strtol(arg, &end, 10);
+	if (*end != ':' || list->interval < 1) {
+		reconfig_log(true, "invalid reconfig interval %s\n", arg);
+		return -EINVAL;
+	}
+
+	for (p = end + 1; *p; ) {
+		struct reconfig_profile *prof;
+		int n, used = 0;
+
+		if (list->count == MAX_RECONFIG_PROFILES) {
+			reconfig_log(true,
+				     "too many reconfig profiles (max %d)\n",
+				     MAX_RECONFIG_PROFILES);
+			return -EINVAL;
+		}
+
+		prof = &list->profiles[list->count];
+		n = sscanf(p, "%d,%d,%d,%d%n", &prof->x, &prof->y,
+			   &prof->width, &prof->height, &used);
+		if (n != 4 || prof->x < 0 || prof->y < 0 ||
+		    prof->width <= 0 || prof->height <= 0) {
+			reconfig_log(true, "invalid reconfig profile %s\n", p);
+			return -EINVAL;
+		}
+		p += used;
+
+		if (*p == '@') {
+			n = sscanf(p + 1, "%d,%d%n", &prof->scale_width,
+				   &prof->scale_height, &used);
+			if (n != 2 || prof->scale_width <= 0 ||
+			    prof->scale_height <= 0) {
+				reconfig_log(true,
+					     "invalid reconfig scale %s\n", p);
+				return -EINVAL;
+			}
+			p += used + 1;
+		}
+
+		list->count++;
+
+		if (*p == '/')
+			p++;
+		else if (*p) {
+			reconfig_log(true, "invalid reconfig profile %s\n", p);
+			return -EINVAL;
+		}
+	}
+
+	if (!list->count) {
+		reconfig_log(true, "no reconfig profile in %s\n", arg);
+		return -EINVAL;
+	}
+
+	/* profiles[0] applies from the start */
+	return 0;
+}
+
+const struct reconfig_profile *reconfig_next(struct reconfig_list *list,
+					     uint32_t frame)
+{
+	if (list->count < 2 || !frame || frame % list->interval)
+		return NULL;
+
+	list->cur = (list->cur + 1) % list->count;
+	return &list->profiles[list->cur];
+}
+
+int reconfig_stream(int video_fd, int video_type, int *dma_fds, int count,
+		    size_t alloc_size, reconfig_apply_t apply, void *priv,
+		    const struct reconfig_profile *p)
+{
+	uint64_t start = reconfig_now_us();
+	bool released = false;
+	int ret, i;
+
+	ret = nx_v4l2_streamoff(video_fd, video_type);
+	if (ret) {
+		reconfig_log(true, "failed to streamoff for reconfig\n");
+		return ret;
+	}
+
+	ret = apply(priv, p);
+	if (ret) {
+		/* driver is busy while buffers are allocated */
+		released = true;
+		ret = nx_v4l2_reqbuf(video_fd, video_type, 0);
+		if (!ret)
+			ret = apply(priv, p);
+		if (!ret)
+			ret = nx_v4l2_reqbuf(video_fd, video_type, count);
+		if (ret) {
+			reconfig_log(true, "failed to apply %dx%d profile\n",
+				     p->width, p->height);
+			return ret;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		ret = nx_v4l2_qbuf(video_fd, video_type, 1, i, &dma_fds[i],
+				   (int *)&alloc_size);
+		if (ret) {
+			reconfig_log(true, "failed qbuf index %d\n", i);
+			return ret;
+		}
+	}
+
+	ret = nx_v4l2_streamon(video_fd, video_type);
+	if (ret) {
+		reconfig_log(true, "failed to streamon\n");
+		return ret;
+	}
+
+	reconfig_log(false, "reconfig %d,%d %dx%d -> %dx%d: %llu us%s\n",
+		     p->x, p->y, p->width, p->height,
+		     p->scale_width ? p->scale_width : p->width,
+		     p->scale_width ? p->scale_height : p->height,
+		     (unsigned long long)(reconfig_now_us() - start),
+		     released ? " (buffers re-requested)" : "");
+
+	return 0;
+}
@@ -0,0 +1,66 @@
+#ifndef _RECONFIG_H
+#define _RECONFIG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_RECONFIG_PROFILES	8
+
+/*
+ * One capture profile: the window of the source that is captured and
+ * the size it is scaled to (0: not scaled).
+ */
+struct reconfig_profile {
+	int x;
+	int y;
+	int width;
+	int height;
+	int scale_width;
+	int scale_height;
+};
+
+struct reconfig_list {
+	int interval;		/* frames between profile switches */
+	int count;
+	int cur;
+	struct reconfig_profile profiles[MAX_RECONFIG_PROFILES];
+};
+
+/* where the messages below go, one formatted line each; stdio if NULL */
+typedef void (*reconfig_log_t)(bool err, const char *msg);
+
+void reconfig_set_log(reconfig_log_t log);
+
+/*
+ * "<frames>:<x>,<y>,<w>,<h>[@<sw>,<sh>][/<x>,<y>,<w>,<h>[@<sw>,<sh>]...]"
+ * e.g. 60:0,0,1280,720@640,360/320,180,640,360
+ */
+int reconfig_parse(const char *arg, struct reconfig_list *list);
+
+/* profile to switch to after frame, or NULL */
+const struct reconfig_profile *reconfig_next(struct reconfig_list *list,
+					     uint32_t frame);
+
+/* sets the new format/crop on the stopped stream */
+typedef int (*reconfig_apply_t)(void *priv, const struct reconfig_profile *p);
+
+/*
+ * streamoff, apply, queue the same dma-bufs again and streamon.
+ * V4L2 buffers are only released (reqbuf 0) when the driver refuses the
+ * new format while they are allocated; the dma-bufs themselves are kept.
+ * streamoff hands every buffer back, so all count buffers are requeued.
+ */
+int reconfig_stream(int video_fd, int video_type, int *dma_fds, int count,
+		    size_t alloc_size, reconfig_apply_t apply, void *priv,
+		    const struct reconfig_profile *p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,302 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/dma-buf.h>
+
+#include "dp_common.h"
+#include "nexell_drmif.h"
+
+#include "snapshot.h"
+
+struct snapshot {
+	int drm_fd;
+	size_t size;
+	uint32_t width;
+	uint32_t height;
+	const char *prefix;
+
+	/* reserved buffer, -1 while it is being written out */
+	int spare_gem_fd;
+	int spare_dma_fd;
+	/* buffer handed over by the capture loop, -1 when none */
+	int busy_gem_fd;
+	int busy_dma_fd;
+
+	int count;
+	bool exit;
+	bool trigger_running;
+
+	pthread_t writer;
+	pthread_t trigger;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+};
+
+static struct snapshot snap = {
+	.spare_gem_fd = -1,
+	.spare_dma_fd = -1,
+	.busy_gem_fd = -1,
+	.busy_dma_fd = -1,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+static volatile sig_atomic_t snap_request;
+static volatile uint64_t snap_request_ns;
+
+static uint64_t snapshot_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* also called from the signal handler, async-signal-safe only */
+static void snapshot_request(void)
+{
+	if (snap_request)
+		return;
+
+	snap_request_ns = snapshot_now_ns();
+	snap_request = 1;
+}
+
+static void snapshot_signal(int sig)
+{
+	(void)sig;
+	snapshot_request();
+}
+
+static void *snapshot_trigger_thread(void *data)
+{
+	char line[64];
+
+	(void)data;
+
+	DP_LOG("snapshot: press Enter (or send SIGUSR1) to capture\n");
+	while (fgets(line, sizeof(line), stdin))
+		snapshot_request();
+
+	return NULL;
+}
+
+static int snapshot_write(int dma_fd, int index)
+{
+	char path[256];
+	void *vaddr;
+	ssize_t written;
+	int fd, ret = 0;
+#ifdef DMA_BUF_IOCTL_SYNC
+	struct dma_buf_sync sync;
+#endif
+
+	snprintf(path, sizeof(path), "%s-%03d-%ux%u.yuv", snap.prefix, index,
+		 snap.width, snap.height);
+
+	vaddr = mmap(NULL, snap.size, PROT_READ, MAP_SHARED, dma_fd, 0);
+	if (vaddr == MAP_FAILED) {
+		DP_ERR("snapshot: failed to mmap dma fd %d %m\n", dma_fd);
+		return -1;
+	}
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		DP_ERR("snapshot: failed to open %s %m\n", path);
+		munmap(vaddr, snap.size);
+		return -1;
+	}
+
+#ifdef DMA_BUF_IOCTL_SYNC
+	sync.flags = DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ;
+	ioctl(dma_fd, DMA_BUF_IOCTL_SYNC, &sync);
+#endif
+
+	written = write(fd, vaddr, snap.size);
+	if (written != (ssize_t)snap.size) {
+		DP_ERR("snapshot: short write %zd/%zu to %s\n", written,
+		       snap.size, path);
+		ret = -1;
+	}
+
+#ifdef DMA_BUF_IOCTL_SYNC
+	sync.flags = DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ;
+	ioctl(dma_fd, DMA_BUF_IOCTL_SYNC, &sync);
+#endif
+
+	close(fd);
+	munmap(vaddr, snap.size);
+
+	if (!ret)
+		DP_LOG("snapshot: wrote %s\n", path);
+
+	return ret;
+}
+
+static void *snapshot_writer_thread(void *data)
+{
+	int gem_fd, dma_fd, index;
+
+	(void)data;
+
+	pthread_mutex_lock(&snap.lock);
+	for (;;) {
+		while (!snap.exit && snap.busy_dma_fd < 0)
+			pthread_cond_wait(&snap.cond, &snap.lock);
+
+		if (snap.busy_dma_fd < 0)
+			break;
+
+		gem_fd = snap.busy_gem_fd;
+		dma_fd = snap.busy_dma_fd;
+		index = snap.count++;
+		pthread_mutex_unlock(&snap.lock);
+
+		snapshot_write(dma_fd, index);
+
+		pthread_mutex_lock(&snap.lock);
+		snap.busy_gem_fd = -1;
+		snap.busy_dma_fd = -1;
+		snap.spare_gem_fd = gem_fd;
+		snap.spare_dma_fd = dma_fd;
+	}
+	pthread_mutex_unlock(&snap.lock);
+
+	return NULL;
+}
+
+int snapshot_init(int drm_fd, size_t size, uint32_t w, uint32_t h,
+		  const char *prefix)
+{
+	struct sigaction sa;
+	int ret;
+
+	snap.drm_fd = drm_fd;
+	snap.size = size;
+	snap.width = w;
+	snap.height = h;
+	snap.prefix = prefix;
+
+	snap.spare_gem_fd = nx_alloc_gem(drm_fd, size, 0);
+	if (snap.spare_gem_fd < 0) {
+		DP_ERR("snapshot: failed to alloc_gem\n");
+		return -1;
+	}
+
+	snap.spare_dma_fd = nx_gem_to_dmafd(drm_fd, snap.spare_gem_fd);
+	if (snap.spare_dma_fd < 0) {
+		DP_ERR("snapshot: failed to gem_to_dmafd\n");
+		nx_free_gem(drm_fd, snap.spare_gem_fd);
+		snap.spare_gem_fd = -1;
+		return -1;
+	}
+
+	ret = pthread_create(&snap.writer, NULL, snapshot_writer_thread, NULL);
+	if (ret) {
+		DP_ERR("snapshot: failed to start writer thread: %s\n",
+		       strerror(ret));
+		close(snap.spare_dma_fd);
+		nx_free_gem(drm_fd, snap.spare_gem_fd);
+		snap.spare_gem_fd = -1;
+		snap.spare_dma_fd = -1;
+		return -ret;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = snapshot_signal;
+	sa.sa_flags = SA_RESTART;
+	sigaction(SIGUSR1, &sa, NULL);
+
+	if (!pthread_create(&snap.trigger, NULL, snapshot_trigger_thread, NULL))
+		snap.trigger_running = true;
+
+	return 0;
+}
+
+bool snapshot_pending(void)
+{
+	bool pending;
+
+	if (!snap_request)
+		return false;
+
+	pthread_mutex_lock(&snap.lock);
+	pending = snap.spare_dma_fd >= 0;
+	pthread_mutex_unlock(&snap.lock);
+
+	return pending;
+}
+
+/*
+ * Called with a freshly dequeued buffer. The caller gets the reserved
+ * buffer back and must queue it in place of the one it passed in.
+ */
+void snapshot_swap(int *gem_fd, int *dma_fd)
+{
+	uint64_t lag_ns = snapshot_now_ns() - snap_request_ns;
+
+	pthread_mutex_lock(&snap.lock);
+	snap.busy_gem_fd = *gem_fd;
+	snap.busy_dma_fd = *dma_fd;
+	*gem_fd = snap.spare_gem_fd;
+	*dma_fd = snap.spare_dma_fd;
+	snap.spare_gem_fd = -1;
+	snap.spare_dma_fd = -1;
+	snap_request = 0;
+	pthread_cond_signal(&snap.cond);
+	pthread_mutex_unlock(&snap.lock);
+
+	DP_LOG("snapshot: shutter lag %llu.%03llu ms\n",
+	       (unsigned long long)(lag_ns / 1000000),
+	       (unsigned long long)(lag_ns / 1000 % 1000));
+}
+
+void snapshot_deinit(void)
+{
+	signal(SIGUSR1, SIG_DFL);
+
+	if (snap.trigger_running) {
+		pthread_cancel(snap.trigger);
+		pthread_join(snap.trigger, NULL);
+		snap.trigger_running = false;
+	}
+
+	pthread_mutex_lock(&snap.lock);
+	snap.exit = true;
+	pthread_cond_signal(&snap.cond);
+	pthread_mutex_unlock(&snap.lock);
+
+	pthread_join(snap.writer, NULL);
+
+	if (snap.spare_dma_fd >= 0)
+		close(snap.spare_dma_fd);
+	if (snap.spare_gem_fd >= 0)
+		nx_free_gem(snap.drm_fd, snap.spare_gem_fd);
+
+	snap.spare_gem_fd = -1;
+	snap.spare_dma_fd = -1;
+}
@@ -0,0 +1,32 @@
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Full resolution still capture next to a running preview.
+ *
+ * One extra buffer is reserved up front. When a snapshot is requested
+ * (Enter on stdin or SIGUSR1) the capture loop hands the buffer it just
+ * dequeued to the writer thread with snapshot_swap() and queues the
+ * reserved buffer at that index instead, so the still is never copied
+ * and the stream never stops. The written buffer becomes the next
+ * reserved one.
+ */
+int snapshot_init(int drm_fd, size_t size, uint32_t w, uint32_t h,
+		  const char *prefix);
+bool snapshot_pending(void);
+void snapshot_swap(int *gem_fd, int *dma_fd);
+void snapshot_deinit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
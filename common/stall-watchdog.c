@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+
+#include <sys/ioctl.h>
+
+#include <linux/videodev2.h>
+
+#include "nx-v4l2.h"
+#ifdef NX_V4L2_MOCK
+#include "nx-v4l2-mock.h"
+#endif
+
+#include "stall-watchdog.h"
+
+static uint64_t wd_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* QUERYBUF index on a multi or single planar capture node */
+static int wd_querybuf(struct stall_watchdog *wd, int index,
+		       struct v4l2_buffer *buf, struct v4l2_plane *planes)
+{
+	memset(buf, 0, sizeof(*buf));
+	memset(planes, 0, sizeof(*planes) * VIDEO_MAX_PLANES);
+	buf->index = index;
+	buf->memory = V4L2_MEMORY_DMABUF;
+	buf->type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+	buf->m.planes = planes;
+	buf->length = wd->plane_num;
+	if (!ioctl(wd->video_fd, VIDIOC_QUERYBUF, buf))
+		return 0;
+
+	memset(buf, 0, sizeof(*buf));
+	buf->index = index;
+	buf->memory = V4L2_MEMORY_DMABUF;
+	buf->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+	return ioctl(wd->video_fd, VIDIOC_QUERYBUF, buf) ? -errno : 0;
+}
+
+/* buffers the driver still owns, -1 if it can not tell */
+static int wd_queued_count(struct stall_watchdog *wd)
+{
+	struct v4l2_buffer buf;
+	struct v4l2_plane planes[VIDEO_MAX_PLANES];
+	int queued = 0;
+	int i;
+
+	for (i = 0; i < wd->buf_count; i++) {
+		if (wd_querybuf(wd, i, &buf, planes))
+			return -1;
+		if (buf.flags & V4L2_BUF_FLAG_QUEUED)
+			queued++;
+	}
+
+	return queued;
+}
+
+/*
+ * Driver sequence of a buffer that was just dequeued, before the caller
+ * queues it again. Unlike the count of dequeued frames it also moves on
+ * for frames the driver dropped.
+ */
+static uint32_t wd_sequence(struct stall_watchdog *wd, int index)
+{
+#ifdef NX_V4L2_MOCK
+	uint32_t sequence = 0;
+
+	nx_v4l2_mock_get_buf_info(wd->video_fd, index, NULL, &sequence);
+
+	return sequence;
+#else
+	struct v4l2_buffer buf;
+	struct v4l2_plane planes[VIDEO_MAX_PLANES];
+
+	if (wd_querybuf(wd, index, &buf, planes))
+		return 0;
+
+	return buf.sequence;
+#endif
+}
+
+static int wd_recover(struct stall_watchdog *wd)
+{
+	enum watchdog_level level = wd->failed ? WATCHDOG_RESET :
+		WATCHDOG_RESTART;
+	uint64_t start = wd_now_us();
+	int ret;
+
+	if (wd->queue_lock)
+		pthread_mutex_lock(wd->queue_lock);
+
+	/* hands every buffer back, the hook queues them again */
+	nx_v4l2_streamoff(wd->video_fd, wd->video_type);
+
+	ret = wd->recover(wd->priv, level);
+
+	if (wd->queue_lock)
+		pthread_mutex_unlock(wd->queue_lock);
+	wd->failed++;
+	wd->recoveries++;
+
+	fprintf(stderr, "watchdog: %s %s in %llu us\n",
+		level == WATCHDOG_RESET ? "reset" : "restart",
+		ret ? "failed" : "done",
+		(unsigned long long)(wd_now_us() - start));
+
+	return ret;
+}
+
+void stall_watchdog_init(struct stall_watchdog *wd, int video_fd,
+			 int video_type, int plane_num, int buf_count,
+			 int timeout_ms, watchdog_recover_t recover,
+			 void *priv)
+{
+	memset(wd, 0, sizeof(*wd));
+	wd->video_fd = video_fd;
+	wd->video_type = video_type;
+	wd->plane_num = plane_num;
+	wd->buf_count = buf_count;
+	wd->timeout_ms = timeout_ms > 0 ? timeout_ms : WATCHDOG_DEFAULT_TIMEOUT;
+	wd->recover = recover;
+	wd->priv = priv;
+	wd->last_index = -1;
+	wd->last_frame_us = wd_now_us();
+}
+
+void stall_watchdog_set_queue_lock(struct stall_watchdog *wd,
+				   pthread_mutex_t *lock)
+{
+	wd->queue_lock = lock;
+}
+
+int stall_watchdog_dqbuf(struct stall_watchdog *wd, int *index)
+{
+	struct pollfd pfd;
+	uint64_t now;
+	int ret;
+
+	pfd.fd = wd->video_fd;
+	pfd.events = POLLIN;
+
+	for (;;) {
+		ret = poll(&pfd, 1, wd->timeout_ms);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "failed to poll: %s\n", strerror(errno));
+			return -errno;
+		}
+
+		if (ret > 0)
+			break;
+
+		now = wd_now_us();
+		wd->stalls++;
+		fprintf(stderr, "watchdog: stall, no frame for %llu ms, "
+			"%d of %d buffers queued, last sequence %u "
+			"(index %d)\n",
+			(unsigned long long)(now - wd->last_frame_us) / 1000,
+			wd_queued_count(wd), wd->buf_count, wd->last_sequence,
+			wd->last_index);
+
+		if (wd->failed >= WATCHDOG_MAX_RECOVERIES) {
+			fprintf(stderr, "watchdog: giving up after %d "
+				"recoveries\n", wd->failed);
+			return -ETIMEDOUT;
+		}
+
+		ret = wd_recover(wd);
+		if (ret)
+			return ret;
+	}
+
+	ret = nx_v4l2_dqbuf(wd->video_fd, wd->video_type, wd->plane_num,
+			    index);
+	if (ret)
+		return ret;
+
+	now = wd_now_us();
+	if (wd->failed)
+		wd->stalled_us += now - wd->last_frame_us;
+	wd->last_frame_us = now;
+	wd->last_index = *index;
+	wd->last_sequence = wd_sequence(wd, *index);
+	wd->frames++;
+	wd->failed = 0;
+
+	return 0;
+}
+
+void stall_watchdog_print_stats(struct stall_watchdog *wd)
+{
+	printf("watchdog: %u frames, %u stalls, %u recoveries, %llu ms "
+	       "without frames\n", wd->frames, wd->stalls, wd->recoveries,
+	       (unsigned long long)(wd->stalled_us / 1000));
+}
+
+int stall_watchdog_restart(void *priv, enum watchdog_level level)
+{
+	struct watchdog_stream *s = (struct watchdog_stream *)priv;
+	int ret, i;
+
+	for (i = 0; i < s->buf_count; i++) {
+		ret = nx_v4l2_qbuf(s->video_fd, s->video_type, 1, i,
+				   &s->dma_fds[i], (int *)&s->alloc_size);
+		if (ret) {
+			fprintf(stderr, "failed qbuf index %d\n", i);
+			return ret;
+		}
+	}
+
+	return nx_v4l2_streamon(s->video_fd, s->video_type);
+}
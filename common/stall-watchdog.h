@@ -0,0 +1,89 @@
+#ifndef _STALL_WATCHDOG_H
+#define _STALL_WATCHDOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WATCHDOG_DEFAULT_TIMEOUT	1000	/* ms */
+#define WATCHDOG_MAX_RECOVERIES		3	/* in a row, then give up */
+
+/*
+ * Recovery hooks, called with the stream stopped and every buffer back
+ * in user space:
+ *   WATCHDOG_RESTART	queue the buffers again and streamon
+ *   WATCHDOG_RESET	reprogram the sensor / clipper subdevs first,
+ *			for a sensor that stopped sending after a glitch
+ */
+enum watchdog_level {
+	WATCHDOG_RESTART = 1,
+	WATCHDOG_RESET,
+};
+
+typedef int (*watchdog_recover_t)(void *priv, enum watchdog_level level);
+
+struct stall_watchdog {
+	int video_fd;
+	int video_type;
+	int plane_num;
+	int buf_count;
+	int timeout_ms;
+	watchdog_recover_t recover;
+	void *priv;
+	pthread_mutex_t *queue_lock;
+
+	uint64_t last_frame_us;
+	uint32_t frames;
+	int last_index;
+	uint32_t last_sequence;	/* V4L2 sequence of last_index */
+	int failed;		/* recoveries since the last frame */
+
+	uint32_t stalls;
+	uint32_t recoveries;
+	uint64_t stalled_us;
+};
+
+void stall_watchdog_init(struct stall_watchdog *wd, int video_fd,
+			 int video_type, int plane_num, int buf_count,
+			 int timeout_ms, watchdog_recover_t recover,
+			 void *priv);
+/*
+ * nx_v4l2_dqbuf() that never blocks longer than timeout_ms. A stall is
+ * logged with the queue state and recovered, escalating from restart to
+ * reset; -ETIMEDOUT once WATCHDOG_MAX_RECOVERIES did not bring a frame.
+ */
+int stall_watchdog_dqbuf(struct stall_watchdog *wd, int *index);
+/*
+ * For streams where other threads queue buffers: lock is held from
+ * streamoff until the recover hook returns, those threads take it around
+ * their qbuf, so the hook never queues a buffer a second time.
+ */
+void stall_watchdog_set_queue_lock(struct stall_watchdog *wd,
+				   pthread_mutex_t *lock);
+void stall_watchdog_print_stats(struct stall_watchdog *wd);
+
+/*
+ * Recover hook for loops that queue each buffer again right after dqbuf,
+ * so streamoff hands all of them back: queue every buffer and streamon.
+ * Nothing is reprogrammed, WATCHDOG_RESET hooks call it after their own
+ * subdev setup.
+ */
+struct watchdog_stream {
+	int video_fd;
+	int video_type;
+	int *dma_fds;
+	int buf_count;
+	size_t alloc_size;
+};
+
+int stall_watchdog_restart(void *priv, enum watchdog_level level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -21,6 +21,8 @@
 #include "nx-v4l2.h"
 
 #include "option.h"
+#include "negotiate.h"
+#include "stall-watchdog.h"
 
 #ifndef ALIGN
 #define ALIGN(x, a) (((x) + (a) - 1) & ~((a) - 1))
@@ -28,6 +30,41 @@
 
 #define MAX_BUFFER_COUNT	4
 
+/* what the watchdog needs to bring a stalled stream back */
+struct capture_ctx {
+	struct watchdog_stream stream;
+	int sensor_fd;
+	int clipper_subdev_fd;
+	uint32_t w;
+	uint32_t h;
+	uint32_t bus_f;
+};
+
+static int recover_stream(void *priv, enum watchdog_level level)
+{
+	struct capture_ctx *ctx = (struct capture_ctx *)priv;
+	int ret;
+
+	if (level == WATCHDOG_RESET) {
+		ret = nx_v4l2_set_format(ctx->sensor_fd, nx_sensor_subdev,
+					 ctx->w, ctx->h, ctx->bus_f);
+		if (!ret)
+			ret = nx_v4l2_set_format(ctx->clipper_subdev_fd,
+						 nx_clipper_subdev, ctx->w,
+						 ctx->h, ctx->bus_f);
+		if (!ret)
+			ret = nx_v4l2_set_crop(ctx->clipper_subdev_fd,
+					       nx_clipper_subdev, 0, 0,
+					       ctx->w, ctx->h);
+		if (ret) {
+			DP_ERR("failed to reset subdevs\n");
+			return ret;
+		}
+	}
+
+	return stall_watchdog_restart(&ctx->stream, level);
+}
+
 static const uint32_t dp_formats[] = {
 
 	/* 1 buffer */
@@ -159,13 +196,14 @@ int dp_plane_update(struct dp_device *device, struct dp_framebuffer *fb, uint32_
 	return 1;
 }
 
-struct dp_framebuffer * dp_buffer_init(struct dp_device *device, int  x, int y, int gem_fd)
+/* format 0: the default plane format */
+struct dp_framebuffer * dp_buffer_init(struct dp_device *device, int  x, int y,
+				       int gem_fd, uint32_t format)
 {
 	struct dp_framebuffer *fb = NULL;
 	int d_idx = 0, p_idx = 0, op_format = 8/*YUV420*/;
 	struct dp_plane *plane;
 
-	uint32_t format;
 	int err;
 
 	plane = dp_device_find_plane_by_index(device,
@@ -178,7 +216,8 @@ struct dp_framebuffer * dp_buffer_init(struct dp_device *device, int  x, int y,
 	/*
 	 * set plane format
 	 */
-	format = choose_format(plane, op_format);
+	if (!format)
+		format = choose_format(plane, op_format);
 	if (!format) {
 		DP_ERR("fail : no matching format found\n");
 		return NULL;
@@ -209,7 +248,8 @@ struct dp_framebuffer * dp_buffer_init(struct dp_device *device, int  x, int y,
 
 int camera_test(struct dp_device *device, int drm_fd, uint32_t m, uint32_t w,
 		uint32_t h, uint32_t sw, uint32_t sh, uint32_t f,
-		uint32_t bus_f, uint32_t count)
+		uint32_t bus_f, uint32_t count, uint32_t consumers,
+		uint32_t timeout)
 {
 	int ret;
 	int gem_fds[MAX_BUFFER_COUNT] = { -1, };
@@ -272,6 +312,30 @@ int camera_test(struct dp_device *device, int drm_fd, uint32_t m, uint32_t w,
 	ret = nx_v4l2_link(true, m, nx_clipper_subdev, 1,
 			   nx_clipper_video, 0);
 
+	/* -N: formats from what the devices report, not from -f/-F */
+	uint32_t fb_format = 0;
+	if (consumers) {
+		struct neg_pipeline np;
+		struct neg_result nr;
+
+		np.sensor_fd = sensor_fd;
+		np.csi_fd = is_mipi ? csi_subdev_fd : -1;
+		np.clipper_subdev_fd = clipper_subdev_fd;
+		np.clipper_video_fd = clipper_video_fd;
+		np.plane = dp_device_find_plane_by_index(device, 0, 0);
+		np.consumers = consumers;
+		np.width = w;
+		np.height = h;
+
+		ret = negotiate_formats(&np, &nr);
+		if (ret)
+			return ret;
+
+		bus_f = nr.bus_format;
+		f = nr.pix_format;
+		fb_format = nr.pix_format;
+	}
+
 	if (is_mipi) {
 		// link sensor to mipi csi
 		ret = nx_v4l2_link(true, m, nx_sensor_subdev, 0, nx_csi_subdev,
@@ -370,7 +434,8 @@ int camera_test(struct dp_device *device, int drm_fd, uint32_t m, uint32_t w,
 			return -1;
 		}
 
-		struct dp_framebuffer *fb = dp_buffer_init(device, w,h,gem_fd);
+		struct dp_framebuffer *fb = dp_buffer_init(device, w, h, gem_fd,
+							   fb_format);
 		if (!fb) {
 			DP_ERR("fail : framebuffer Init %m\n");
 			ret = -1;
@@ -390,6 +455,16 @@ int camera_test(struct dp_device *device, int drm_fd, uint32_t m, uint32_t w,
 		}
 	}
 
+	struct capture_ctx ctx = {
+		{ clipper_video_fd, nx_clipper_video, dma_fds,
+		  MAX_BUFFER_COUNT, alloc_size },
+		sensor_fd, clipper_subdev_fd, w, h, bus_f
+	};
+	struct stall_watchdog wd;
+
+	stall_watchdog_init(&wd, clipper_video_fd, nx_clipper_video, 1,
+			    MAX_BUFFER_COUNT, timeout, recover_stream, &ctx);
+
 	ret = nx_v4l2_streamon(clipper_video_fd, nx_clipper_video);
 	if (ret) {
 		DP_ERR("failed to streamon\n");
@@ -400,8 +475,7 @@ int camera_test(struct dp_device *device, int drm_fd, uint32_t m, uint32_t w,
 	while (loop_count--) {
 		int dq_index;
 
-		ret = nx_v4l2_dqbuf(clipper_video_fd, nx_clipper_video, 1,
-				    &dq_index);
+		ret = stall_watchdog_dqbuf(&wd, &dq_index);
 		if (ret) {
 			DP_ERR("failed to dqbuf\n");
 			return ret;
@@ -421,6 +495,7 @@ int camera_test(struct dp_device *device, int drm_fd, uint32_t m, uint32_t w,
 		}*/
 	}
 
+	stall_watchdog_print_stats(&wd);
 	nx_v4l2_streamoff(clipper_video_fd, nx_clipper_video);
 
 
@@ -447,11 +522,13 @@ int main(int argc, char *argv[])
 	struct dp_device *device;
 	int dbg_on = 0;
 	uint32_t sw = 0, sh = 0;
+	uint32_t consumers = 0;
+	uint32_t timeout = WATCHDOG_DEFAULT_TIMEOUT;
 
 	dp_debug_on(dbg_on);
 
 	ret = handle_option(argc, argv, &m, &w, &h, &sw, &sh, &f, &bus_f,
-			&count);
+			&count, &consumers, &timeout);
 	if (ret) {
 		DP_ERR("failed to handle_option\n");
 		return ret;
@@ -469,7 +546,8 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
-	err = camera_test(device, drm_fd, m, w, h, sw, sh, f, bus_f, count);
+	err = camera_test(device, drm_fd, m, w, h, sw, sh, f, bus_f, count,
+			  consumers, timeout);
 	if (err < 0) {
 		DP_ERR("failed to do camera_test \n");
 		return -1;
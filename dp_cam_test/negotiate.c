@@ -0,0 +1,323 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <sys/ioctl.h>
+
+#include <drm_fourcc.h>
+#include "dp.h"
+#include "dp_common.h"
+
+#include <linux/videodev2.h>
+#include <linux/v4l2-subdev.h>
+#include "media-bus-format.h"
+
+#include "negotiate.h"
+
+#ifndef ALIGN
+#define ALIGN(x, a) (((x) + (a) - 1) & ~((a) - 1))
+#endif
+
+struct neg_list {
+	uint32_t count;
+	uint32_t formats[NEG_MAX_FORMATS];
+	bool assumed;		/* driver could not enumerate */
+};
+
+/* what the clipper takes on its bus, for drivers without ENUM_MBUS_CODE */
+static const uint32_t clipper_bus_formats[] = {
+	MEDIA_BUS_FMT_YUYV8_2X8,
+	MEDIA_BUS_FMT_UYVY8_2X8,
+	MEDIA_BUS_FMT_VYUY8_2X8,
+	MEDIA_BUS_FMT_YVYU8_2X8,
+};
+
+/* and what it writes to memory */
+static const uint32_t clipper_pix_formats[] = {
+	V4L2_PIX_FMT_YUV420,
+	V4L2_PIX_FMT_NV12,
+	V4L2_PIX_FMT_NV21,
+	V4L2_PIX_FMT_NV16,
+	V4L2_PIX_FMT_NV61,
+	V4L2_PIX_FMT_YUYV,
+};
+
+/* vpu input */
+static const uint32_t encoder_pix_formats[] = {
+	V4L2_PIX_FMT_YUV420,
+	V4L2_PIX_FMT_NV12,
+	V4L2_PIX_FMT_NV21,
+};
+
+static const char *bus_name(uint32_t code)
+{
+	static char unknown[16];
+
+	switch (code) {
+	case MEDIA_BUS_FMT_YUYV8_2X8:
+		return "YUYV8_2X8";
+	case MEDIA_BUS_FMT_UYVY8_2X8:
+		return "UYVY8_2X8";
+	case MEDIA_BUS_FMT_VYUY8_2X8:
+		return "VYUY8_2X8";
+	case MEDIA_BUS_FMT_YVYU8_2X8:
+		return "YVYU8_2X8";
+	}
+	snprintf(unknown, sizeof(unknown), "0x%04x", code);
+	return unknown;
+}
+
+static const char *pix_name(uint32_t f, char *buf)
+{
+	buf[0] = f & 0xff;
+	buf[1] = (f >> 8) & 0xff;
+	buf[2] = (f >> 16) & 0xff;
+	buf[3] = (f >> 24) & 0xff;
+	buf[4] = '\0';
+	return buf;
+}
+
+/* same layout calc_alloc_size() allocates */
+static uint32_t frame_size(uint32_t w, uint32_t h, uint32_t f)
+{
+	uint32_t y_stride = ALIGN(w, 32);
+	uint32_t y_size = y_stride * ALIGN(h, 16);
+
+	switch (f) {
+	case V4L2_PIX_FMT_YUYV:
+	case V4L2_PIX_FMT_NV16:
+	case V4L2_PIX_FMT_NV61:
+		return y_size << 1;
+	case V4L2_PIX_FMT_YUV420:
+		return y_size +
+			2 * (ALIGN(y_stride >> 1, 16) * ALIGN(h >> 1, 16));
+	case V4L2_PIX_FMT_NV21:
+	case V4L2_PIX_FMT_NV12:
+		return y_size + y_stride * ALIGN(h >> 1, 16);
+	}
+	return 0;
+}
+
+static void list_static(struct neg_list *l, const uint32_t *formats,
+			uint32_t count)
+{
+	memcpy(l->formats, formats, count * sizeof(*formats));
+	l->count = count;
+	l->assumed = true;
+}
+
+static bool list_has(const struct neg_list *l, uint32_t f)
+{
+	uint32_t i;
+
+	for (i = 0; i < l->count; i++)
+		if (l->formats[i] == f)
+			return true;
+	return false;
+}
+
+static void enum_bus(int fd, uint32_t pad, struct neg_list *l,
+		     const uint32_t *fallback, uint32_t fallback_count)
+{
+	struct v4l2_subdev_mbus_code_enum code;
+
+	memset(l, 0, sizeof(*l));
+	while (l->count < NEG_MAX_FORMATS) {
+		memset(&code, 0, sizeof(code));
+		code.pad = pad;
+		code.index = l->count;
+		code.which = V4L2_SUBDEV_FORMAT_ACTIVE;
+		if (ioctl(fd, VIDIOC_SUBDEV_ENUM_MBUS_CODE, &code))
+			break;
+		l->formats[l->count++] = code.code;
+	}
+
+	if (!l->count && fallback)
+		list_static(l, fallback, fallback_count);
+}
+
+/*
+ * The clipper list says nothing about what a sensor can send, so a
+ * sensor that does not enumerate is taken at the code it is set to.
+ */
+static int enum_sensor_bus(int fd, struct neg_list *l)
+{
+	struct v4l2_subdev_format fmt;
+
+	enum_bus(fd, 0, l, NULL, 0);
+	if (l->count)
+		return 0;
+
+	memset(&fmt, 0, sizeof(fmt));
+	fmt.pad = 0;
+	fmt.which = V4L2_SUBDEV_FORMAT_ACTIVE;
+	if (ioctl(fd, VIDIOC_SUBDEV_G_FMT, &fmt) || !fmt.format.code)
+		return -ENODEV;
+
+	l->formats[l->count++] = fmt.format.code;
+	l->assumed = true;
+
+	return 0;
+}
+
+static void enum_pix(int fd, struct neg_list *l)
+{
+	struct v4l2_fmtdesc desc;
+	uint32_t type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+
+	memset(l, 0, sizeof(*l));
+	while (l->count < NEG_MAX_FORMATS) {
+		memset(&desc, 0, sizeof(desc));
+		desc.index = l->count;
+		desc.type = type;
+		if (ioctl(fd, VIDIOC_ENUM_FMT, &desc)) {
+			/* single planar node */
+			if (!l->count && type != V4L2_BUF_TYPE_VIDEO_CAPTURE) {
+				type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+				continue;
+			}
+			break;
+		}
+		l->formats[l->count++] = desc.pixelformat;
+	}
+
+	if (!l->count)
+		list_static(l, clipper_pix_formats,
+			    ARRAY_SIZE(clipper_pix_formats));
+}
+
+static void print_list(const char *stage, const struct neg_list *l, bool bus)
+{
+	char name[5];
+	uint32_t i;
+
+	DP_LOG("  %-10s", stage);
+	for (i = 0; i < l->count; i++)
+		DP_LOG(" %s", bus ? bus_name(l->formats[i]) :
+		       pix_name(l->formats[i], name));
+	DP_LOG("%s\n", l->assumed ? " (assumed)" : "");
+}
+
+/* 8 bit yuv 4:2:2 on the bus, the clipper unpacks it into any layout */
+static bool clipper_converts(uint32_t bus, uint32_t pix)
+{
+	uint32_t i;
+
+	for (i = 0; i < ARRAY_SIZE(clipper_bus_formats); i++)
+		if (clipper_bus_formats[i] == bus)
+			break;
+	if (i == ARRAY_SIZE(clipper_bus_formats))
+		return false;
+
+	return frame_size(16, 16, pix) != 0;
+}
+
+static bool consumers_accept(struct neg_pipeline *p, uint32_t pix)
+{
+	uint32_t i;
+
+	/* display planes take the same fourcc, see dp_formats[] */
+	if ((p->consumers & NEG_CONSUMER_DISPLAY) &&
+	    (!p->plane || !dp_plane_supports_format(p->plane, pix)))
+		return false;
+
+	if (p->consumers & NEG_CONSUMER_ENCODER) {
+		for (i = 0; i < ARRAY_SIZE(encoder_pix_formats); i++)
+			if (encoder_pix_formats[i] == pix)
+				break;
+		if (i == ARRAY_SIZE(encoder_pix_formats))
+			return false;
+	}
+
+	return true;
+}
+
+int negotiate_formats(struct neg_pipeline *p, struct neg_result *r)
+{
+	struct neg_list sensor, csi, clipper, video;
+	uint32_t best_size = 0;
+	uint32_t b, v;
+	char name[5];
+
+	if (enum_sensor_bus(p->sensor_fd, &sensor)) {
+		DP_ERR("sensor reports no bus format, give it with -F "
+		       "instead of -N/-E\n");
+		return -ENODEV;
+	}
+	/* the csi passes the bus through to the clipper */
+	if (p->csi_fd >= 0)
+		enum_bus(p->csi_fd, 0, &csi, clipper_bus_formats,
+			 ARRAY_SIZE(clipper_bus_formats));
+	enum_bus(p->clipper_subdev_fd, 0, &clipper, clipper_bus_formats,
+		 ARRAY_SIZE(clipper_bus_formats));
+	enum_pix(p->clipper_video_fd, &video);
+
+	DP_LOG("format negotiation %ux%u:\n", p->width, p->height);
+	print_list("sensor", &sensor, true);
+	if (p->csi_fd >= 0)
+		print_list("csi", &csi, true);
+	print_list("clipper", &clipper, true);
+	print_list("memory", &video, false);
+
+	memset(r, 0, sizeof(*r));
+
+	/* sensor order first: its preferred code wins a tie */
+	for (b = 0; b < sensor.count; b++) {
+		uint32_t bus = sensor.formats[b];
+
+		if ((p->csi_fd >= 0 && !list_has(&csi, bus)) ||
+		    !list_has(&clipper, bus))
+			continue;
+
+		for (v = 0; v < video.count; v++) {
+			uint32_t pix = video.formats[v];
+			uint32_t size = frame_size(p->width, p->height, pix);
+
+			if (!clipper_converts(bus, pix) ||
+			    !consumers_accept(p, pix))
+				continue;
+
+			DP_LOG("  candidate %s -> %s, %u bytes\n",
+			       bus_name(bus), pix_name(pix, name), size);
+
+			if (!best_size || size < best_size) {
+				best_size = size;
+				r->bus_format = bus;
+				r->pix_format = pix;
+				r->frame_size = size;
+			}
+		}
+	}
+
+	if (!best_size) {
+		DP_ERR("no conversion free path from sensor to %s%s\n",
+		       p->consumers & NEG_CONSUMER_DISPLAY ? "display " : "",
+		       p->consumers & NEG_CONSUMER_ENCODER ? "encoder" : "");
+		return -EINVAL;
+	}
+
+	DP_LOG("path: sensor %s -> %sclipper -> %s (%u bytes/frame) ->%s%s\n",
+	       bus_name(r->bus_format), p->csi_fd >= 0 ? "csi -> " : "",
+	       pix_name(r->pix_format, name), r->frame_size,
+	       p->consumers & NEG_CONSUMER_DISPLAY ? " display" : "",
+	       p->consumers & NEG_CONSUMER_ENCODER ? " encoder" : "");
+
+	return 0;
+}
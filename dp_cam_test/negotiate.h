@@ -0,0 +1,49 @@
+#ifndef _NEGOTIATE_H
+#define _NEGOTIATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NEG_MAX_FORMATS		32
+
+/* consumers the captured buffers go to without any conversion */
+#define NEG_CONSUMER_DISPLAY	(1 << 0)
+#define NEG_CONSUMER_ENCODER	(1 << 1)
+
+struct dp_plane;
+
+struct neg_pipeline {
+	int sensor_fd;
+	int csi_fd;		/* -1 for a parallel camera */
+	int clipper_subdev_fd;
+	int clipper_video_fd;
+	struct dp_plane *plane;	/* display consumer */
+	uint32_t consumers;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct neg_result {
+	uint32_t bus_format;	/* MEDIA_BUS_FMT_* */
+	uint32_t pix_format;	/* V4L2_PIX_FMT_*, same fourcc as DRM */
+	uint32_t frame_size;	/* bytes per captured frame */
+};
+
+/*
+ * Intersects the bus codes of sensor, csi and clipper with the pixel
+ * formats of the clipper video node and every consumer. Only pairs the
+ * clipper turns into memory by itself are candidates, so the chosen path
+ * needs neither the cpu nor the scaler; among them the one with the
+ * fewest bytes per frame wins. The whole search is printed.
+ */
+int negotiate_formats(struct neg_pipeline *p, struct neg_result *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
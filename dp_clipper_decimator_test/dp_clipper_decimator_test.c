@@ -22,6 +22,8 @@
 #include "nx-v4l2.h"
 
 #include "option.h"
+#include "snapshot.h"
+#include "stall-watchdog.h"
 
 #ifndef ALIGN
 #define ALIGN(x, a) (((x) + (a) - 1) & ~((a) - 1))
@@ -45,6 +47,9 @@ struct thread_data {
 	int bus_format;
 	int count;
 	int display_idx;
+	int timeout;
+	char *snapshot;
+	bool preview;	/* decimator scaled down to -W/-H next to -s */
 };
 
 static const uint32_t dp_formats[] = {
@@ -243,6 +248,10 @@ int test_run(struct thread_data *p)
 	struct dp_device *device = p->device;
 	int count = p->count;
 	int d_idx = p->display_idx;
+	int sw = p->scale_width;
+	int sh = p->scale_height;
+	int disp_w = w;
+	int disp_h = h;
 
 
 #if 0
@@ -265,6 +274,19 @@ int test_run(struct thread_data *p)
 		return ret;
 	}
 
+	/* low resolution preview for the snapshot mode */
+	if (nx_video == nx_decimator_video && p->preview && sw > 0 &&
+	    sh > 0) {
+		ret = nx_v4l2_set_crop(video_fd, nx_video, 0, 0, sw, sh);
+		if (ret) {
+			DP_ERR("failed to set_crop for decimator videodev\n");
+			return ret;
+		}
+
+		disp_w = sw;
+		disp_h = sh;
+	}
+
 	ret = nx_v4l2_reqbuf(video_fd, nx_video,
 			MAX_BUFFER_COUNT);
 	if (ret) {
@@ -296,6 +318,13 @@ int test_run(struct thread_data *p)
 			return -1;
 		}
 
+		gem_fds[i] = gem_fd;
+		dma_fds[i] = dma_fd;
+
+		/* snapshot stream is not displayed, its buffers get swapped */
+		if (p->snapshot)
+			continue;
+
 		struct dp_framebuffer *fb = dp_buffer_init(device, w, h,
 							gem_fd, d_idx);
 		if (!fb) {
@@ -304,8 +333,12 @@ int test_run(struct thread_data *p)
 			return ret;
 		}
 		fbs[i] = fb;
-		gem_fds[i] = gem_fd;
-		dma_fds[i] = dma_fd;
+	}
+
+	if (p->snapshot) {
+		ret = snapshot_init(drm_fd, alloc_size, w, h, p->snapshot);
+		if (ret)
+			return ret;
 	}
 
 	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
@@ -317,6 +350,14 @@ int test_run(struct thread_data *p)
 		}
 	}
 
+	/* snapshot_swap() changes dma_fds[], the watchdog sees it */
+	struct watchdog_stream stream = { video_fd, nx_video, dma_fds,
+					  MAX_BUFFER_COUNT, alloc_size };
+	struct stall_watchdog wd;
+
+	stall_watchdog_init(&wd, video_fd, nx_video, 1, MAX_BUFFER_COUNT,
+			    p->timeout, stall_watchdog_restart, &stream);
+
 	ret = nx_v4l2_streamon(video_fd, nx_video);
 	if (ret) {
 		DP_ERR("failed to streamon\n");
@@ -328,13 +369,15 @@ int test_run(struct thread_data *p)
 	while (loop_count--) {
 		int dq_index;
 
-		ret = nx_v4l2_dqbuf(video_fd, nx_video, 1,
-				    &dq_index);
+		ret = stall_watchdog_dqbuf(&wd, &dq_index);
 		if (ret) {
 			DP_ERR("failed to dqbuf\n");
 			return ret;
 		}
 
+		if (p->snapshot && snapshot_pending())
+			snapshot_swap(&gem_fds[dq_index], &dma_fds[dq_index]);
+
 		ret = nx_v4l2_qbuf(video_fd, nx_video, 1,
 				   dq_index, &dma_fds[dq_index],
 				   (int *)&alloc_size);
@@ -342,7 +385,12 @@ int test_run(struct thread_data *p)
 			DP_ERR("failed qbuf index %d\n", dq_index);
 			return ret;
 		}
-		ret = dp_plane_update(device, fbs[dq_index], w, h, d_idx);
+
+		if (p->snapshot)
+			continue;
+
+		ret = dp_plane_update(device, fbs[dq_index], disp_w, disp_h,
+				      d_idx);
 		/*
 		if (ret) {
 			DP_ERR("failed plane update\n");
@@ -351,8 +399,12 @@ int test_run(struct thread_data *p)
 		*/
 	}
 
+	stall_watchdog_print_stats(&wd);
 	nx_v4l2_streamoff(video_fd, nx_video);
 
+	if (p->snapshot)
+		snapshot_deinit();
+
 	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
 		if (fbs[i])
 			dp_framebuffer_delfb2(fbs[i]);
@@ -416,11 +468,13 @@ int main(int argc, char *argv[])
 	pthread_t clipper_thread, decimator_thread;
 	int result_clipper, result_decimator;
 	int result[2];
+	char *snapshot = NULL;
+	uint32_t timeout = WATCHDOG_DEFAULT_TIMEOUT;
 
 	dp_debug_on(dbg_on);
 
 	ret = handle_option(argc, argv, &m, &w, &h, &sw, &sh, &f, &bus_f,
-			&count);
+			&count, &snapshot, &timeout);
 	if (ret) {
 		DP_ERR("failed to handle_option\n");
 		return ret;
@@ -464,6 +518,8 @@ int main(int argc, char *argv[])
 	s_thread_data0.device = device;
 	s_thread_data0.video_dev = nx_clipper_video;
 	s_thread_data0.display_idx = 0;
+	s_thread_data0.timeout = timeout;
+	s_thread_data0.snapshot = snapshot;
 
 	ret = pthread_create(&clipper_thread, NULL, test_thread,
 			&s_thread_data0);
@@ -485,6 +541,8 @@ int main(int argc, char *argv[])
 	s_thread_data1.device = device;
 	s_thread_data1.video_dev = nx_decimator_video;
 	s_thread_data1.display_idx = 1;
+	s_thread_data1.timeout = timeout;
+	s_thread_data1.preview = snapshot != NULL;
 
 	ret = pthread_create(&decimator_thread, NULL, test_thread,
 			&s_thread_data1);
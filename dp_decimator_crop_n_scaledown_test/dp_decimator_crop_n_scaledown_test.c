@@ -22,6 +22,9 @@
 #include "nx-v4l2.h"
 
 #include "option.h"
+#include "snapshot.h"
+#include "reconfig.h"
+#include "stall-watchdog.h"
 
 #ifndef ALIGN
 #define ALIGN(x, a) (((x) + (a) - 1) & ~((a) - 1))
@@ -49,6 +52,9 @@ struct thread_data {
 	int bus_format;
 	int count;
 	int display_idx;
+	int timeout;
+	char *snapshot;
+	char *reconfig;
 };
 
 static const uint32_t dp_formats[] = {
@@ -295,6 +301,13 @@ int clipper_test_run(struct thread_data *p)
 			return -1;
 		}
 
+		gem_fds[i] = gem_fd;
+		dma_fds[i] = dma_fd;
+
+		/* snapshot stream is not displayed, its buffers get swapped */
+		if (p->snapshot)
+			continue;
+
 		struct dp_framebuffer *fb = dp_buffer_init(device, w, h,
 							gem_fd, d_idx);
 		if (!fb) {
@@ -303,8 +316,12 @@ int clipper_test_run(struct thread_data *p)
 			return ret;
 		}
 		fbs[i] = fb;
-		gem_fds[i] = gem_fd;
-		dma_fds[i] = dma_fd;
+	}
+
+	if (p->snapshot) {
+		ret = snapshot_init(drm_fd, alloc_size, w, h, p->snapshot);
+		if (ret)
+			return ret;
 	}
 
 	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
@@ -316,6 +333,14 @@ int clipper_test_run(struct thread_data *p)
 		}
 	}
 
+	/* snapshot_swap() changes dma_fds[], the watchdog sees it */
+	struct watchdog_stream stream = { video_fd, nx_video, dma_fds,
+					  MAX_BUFFER_COUNT, alloc_size };
+	struct stall_watchdog wd;
+
+	stall_watchdog_init(&wd, video_fd, nx_video, 1, MAX_BUFFER_COUNT,
+			    p->timeout, stall_watchdog_restart, &stream);
+
 	ret = nx_v4l2_streamon(video_fd, nx_video);
 	if (ret) {
 		DP_ERR("failed to streamon\n");
@@ -327,13 +352,15 @@ int clipper_test_run(struct thread_data *p)
 	while (loop_count--) {
 		int dq_index;
 
-		ret = nx_v4l2_dqbuf(video_fd, nx_video, 1,
-				    &dq_index);
+		ret = stall_watchdog_dqbuf(&wd, &dq_index);
 		if (ret) {
 			DP_ERR("failed to dqbuf\n");
 			return ret;
 		}
 
+		if (p->snapshot && snapshot_pending())
+			snapshot_swap(&gem_fds[dq_index], &dma_fds[dq_index]);
+
 		ret = nx_v4l2_qbuf(video_fd, nx_video, 1,
 				   dq_index, &dma_fds[dq_index],
 				   (int *)&alloc_size);
@@ -342,6 +369,9 @@ int clipper_test_run(struct thread_data *p)
 			return ret;
 		}
 
+		if (p->snapshot)
+			continue;
+
 		ret = dp_plane_update(device, fbs[dq_index],
 			disp_width, disp_height, d_idx);
 		/*
@@ -352,8 +382,12 @@ int clipper_test_run(struct thread_data *p)
 		*/
 	}
 
+	stall_watchdog_print_stats(&wd);
 	nx_v4l2_streamoff(video_fd, nx_video);
 
+	if (p->snapshot)
+		snapshot_deinit();
+
 	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
 		if (fbs[i])
 			dp_framebuffer_delfb2(fbs[i]);
@@ -372,6 +406,71 @@ int clipper_test_run(struct thread_data *p)
 #endif
 
 #if DECIMATOR
+/* reconfig.c messages go through the dp debug macros */
+static void decimator_reconfig_log(bool err, const char *msg)
+{
+	if (err)
+		DP_ERR("%s", msg);
+	else
+		DP_LOG("%s", msg);
+}
+
+struct decimator_reconfig {
+	int subdev_fd;
+	int video_fd;
+	int nx_video;
+	struct reconfig_profile cur;	/* in use, set again on a reset */
+	struct watchdog_stream stream;
+};
+
+/* crop on the decimator subdev, scale through the video node crop */
+static int apply_decimator_profile(void *priv,
+				   const struct reconfig_profile *prof)
+{
+	struct decimator_reconfig *r = (struct decimator_reconfig *)priv;
+	int ret;
+
+	ret = nx_v4l2_set_crop(r->subdev_fd, nx_decimator_subdev, prof->x,
+			       prof->y, prof->width, prof->height);
+	if (ret)
+		return ret;
+
+	if (prof->scale_width > 0)
+		ret = nx_v4l2_set_crop(r->video_fd, r->nx_video, 0, 0,
+				       prof->scale_width, prof->scale_height);
+	else
+		ret = nx_v4l2_set_crop(r->video_fd, r->nx_video, 0, 0,
+				       prof->width, prof->height);
+	if (ret)
+		return ret;
+
+	if (prof->scale_width > 0) {
+		disp_width = prof->scale_width;
+		disp_height = prof->scale_height;
+	} else {
+		disp_width = prof->width;
+		disp_height = prof->height;
+	}
+
+	r->cur = *prof;
+
+	return 0;
+}
+
+/*
+ * A reset sets the crop in use again. The video node may refuse it while
+ * buffers are allocated (see reconfig_stream()), the restart still helps.
+ */
+static int recover_decimator(void *priv, enum watchdog_level level)
+{
+	struct decimator_reconfig *r = (struct decimator_reconfig *)priv;
+
+	if (level == WATCHDOG_RESET && apply_decimator_profile(r, &r->cur))
+		DP_ERR("failed to reset decimator crop, restarting only\n");
+
+	return stall_watchdog_restart(&r->stream, level);
+}
+
 int decimator_test_run(struct thread_data *p)
 {
 	int ret;
@@ -400,6 +499,29 @@ int decimator_test_run(struct thread_data *p)
 	size_t alloc_size;
 	int gem_fd;
 	int dma_fd;
+	struct reconfig_list profiles;
+	struct decimator_reconfig rc;
+	struct stall_watchdog wd;
+
+	if (p->reconfig) {
+		ret = reconfig_parse(p->reconfig, &profiles);
+		if (ret)
+			return ret;
+
+		/* every profile is captured into the w x h sized buffers */
+		for (i = 0; i < profiles.count; i++) {
+			struct reconfig_profile *prof = &profiles.profiles[i];
+
+			if (prof->x + prof->width > w ||
+			    prof->y + prof->height > h ||
+			    prof->scale_width > prof->width ||
+			    prof->scale_height > prof->height) {
+				DP_ERR("profile %d does not fit %dx%d\n", i,
+				       w, h);
+				return -1;
+			}
+		}
+	}
 
 	subdev_fd = nx_v4l2_open_device(nx_decimator_subdev, m);
 	if (subdev_fd < 0) {
@@ -433,10 +555,18 @@ int decimator_test_run(struct thread_data *p)
 
 		disp_width = c_w;
 		disp_height = c_h;
+		rc.cur.x = c_x;
+		rc.cur.y = c_y;
 	} else {
 		disp_width = w;
 		disp_height = h;
+		rc.cur.x = 0;
+		rc.cur.y = 0;
 	}
+	rc.cur.width = disp_width;
+	rc.cur.height = disp_height;
+	rc.cur.scale_width = 0;
+	rc.cur.scale_height = 0;
 
 	if (sw > 0 && sh > 0) {
 		ret = nx_v4l2_set_crop(video_fd, nx_video, 0, 0, sw, sh);
@@ -447,6 +577,21 @@ int decimator_test_run(struct thread_data *p)
 
 		disp_width = sw;
 		disp_height = sh;
+		rc.cur.scale_width = sw;
+		rc.cur.scale_height = sh;
+	}
+
+	rc.subdev_fd = subdev_fd;
+	rc.video_fd = video_fd;
+	rc.nx_video = nx_video;
+
+	if (p->reconfig) {
+		/* profile 0 replaces -C/-W/-H */
+		ret = apply_decimator_profile(&rc, &profiles.profiles[0]);
+		if (ret) {
+			DP_ERR("failed to apply first profile\n");
+			return ret;
+		}
 	}
 
 	ret = nx_v4l2_reqbuf(video_fd, nx_video,
@@ -496,6 +641,14 @@ int decimator_test_run(struct thread_data *p)
 		}
 	}
 
+	rc.stream.video_fd = video_fd;
+	rc.stream.video_type = nx_video;
+	rc.stream.dma_fds = dma_fds;
+	rc.stream.buf_count = MAX_BUFFER_COUNT;
+	rc.stream.alloc_size = alloc_size;
+	stall_watchdog_init(&wd, video_fd, nx_video, 1, MAX_BUFFER_COUNT,
+			    p->timeout, recover_decimator, &rc);
+
 	ret = nx_v4l2_streamon(video_fd, nx_video);
 	if (ret) {
 		DP_ERR("failed to streamon\n");
@@ -507,13 +660,25 @@ int decimator_test_run(struct thread_data *p)
 	while (loop_count--) {
 		int dq_index;
 
-		ret = nx_v4l2_dqbuf(video_fd, nx_video, 1,
-				    &dq_index);
+		ret = stall_watchdog_dqbuf(&wd, &dq_index);
 		if (ret) {
 			DP_ERR("failed to dqbuf\n");
 			return ret;
 		}
 
+		const struct reconfig_profile *next = p->reconfig ?
+			reconfig_next(&profiles, count - loop_count) : NULL;
+		if (next) {
+			/* requeues every buffer, dq_index included */
+			ret = reconfig_stream(video_fd, nx_video, dma_fds,
+					      MAX_BUFFER_COUNT, alloc_size,
+					      apply_decimator_profile, &rc,
+					      next);
+			if (ret)
+				return ret;
+			continue;
+		}
+
 		ret = nx_v4l2_qbuf(video_fd, nx_video, 1,
 				   dq_index, &dma_fds[dq_index],
 				   (int *)&alloc_size);
@@ -532,6 +697,7 @@ int decimator_test_run(struct thread_data *p)
 		*/
 	}
 
+	stall_watchdog_print_stats(&wd);
 	nx_v4l2_streamoff(video_fd, nx_video);
 
 	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
@@ -617,6 +783,9 @@ int main(int argc, char *argv[])
 	int dbg_on = 0;
 	uint32_t sw = 0, sh = 0;
 	struct rect crop;
+	char *snapshot = NULL;
+	char *reconfig = NULL;
+	uint32_t timeout = WATCHDOG_DEFAULT_TIMEOUT;
 
 	crop.x = 0;
 	crop.y = 0;
@@ -634,9 +803,12 @@ int main(int argc, char *argv[])
 	int result[2];
 
 	dp_debug_on(dbg_on);
+#if DECIMATOR
+	reconfig_set_log(decimator_reconfig_log);
+#endif
 
 	ret = handle_option(argc, argv, &m, &w, &h, &sw, &sh, &f, &bus_f,
-			&count, &crop);
+			&count, &crop, &snapshot, &reconfig, &timeout);
 	if (ret) {
 		DP_ERR("failed to handle_option\n");
 		return ret;
@@ -682,6 +854,8 @@ int main(int argc, char *argv[])
 	s_thread_data0.device = device;
 	s_thread_data0.video_dev = nx_clipper_video;
 	s_thread_data0.display_idx = 0;
+	s_thread_data0.timeout = timeout;
+	s_thread_data0.snapshot = snapshot;
 
 	ret = pthread_create(&clipper_thread, NULL, clipper_test_thread,
 			&s_thread_data0);
@@ -703,7 +877,9 @@ int main(int argc, char *argv[])
 	s_thread_data1.device = device;
 	s_thread_data1.video_dev = nx_decimator_video;
 	s_thread_data1.display_idx = 1;
+	s_thread_data1.timeout = timeout;
 	s_thread_data1.crop = crop;
+	s_thread_data1.reconfig = reconfig;
 
 	ret = pthread_create(&decimator_thread, NULL, decimator_test_thread,
 			&s_thread_data1);
@@ -7,11 +7,11 @@
 
 int handle_option(int argc, char **argv, uint32_t *m, uint32_t *w, uint32_t *h,
 	uint32_t *W, uint32_t *H, uint32_t *f, uint32_t *bus_f, uint32_t *c,
-	struct rect *C)
+	struct rect *C, char **snapshot, char **reconfig, uint32_t *timeout)
 {
 	int opt;
 
-	while ((opt = getopt(argc, argv, "m:w:h:W:H:f:F:c:C:S:")) != -1) {
+	while ((opt = getopt(argc, argv, "m:w:h:W:H:f:F:c:C:S:s:Z:t:")) != -1) {
 		switch (opt) {
 		case 'm':
 			*m = atoi(optarg);
@@ -41,6 +41,16 @@ int handle_option(int argc, char **argv, uint32_t *m, uint32_t *w, uint32_t *h,
 			sscanf(optarg, "%d, %d, %d, %d",
 			&C->x, &C->y, &C->width, &C->height);
 			break;
+		case 's':
+			*snapshot = optarg;
+			break;
+		case 'Z':
+			*reconfig = optarg;
+			break;
+		case 't':
+			/* ms without a frame before the stream is recovered */
+			*timeout = atoi(optarg);
+			break;
 		}
 	}
 
@@ -14,7 +14,8 @@ struct rect {
 
 int handle_option(int argc, char **argv, uint32_t *m, uint32_t *w, uint32_t *h,
 	uint32_t *W, uint32_t *H, uint32_t *f, uint32_t *bus_f,
-	uint32_t *count, struct rect *C);
+	uint32_t *count, struct rect *C, char **snapshot, char **reconfig,
+	uint32_t *timeout);
 
 #ifdef __cplusplus
 }
@@ -21,6 +21,7 @@
 #include "nx-v4l2.h"
 
 #include "option.h"
+#include "stall-watchdog.h"
 
 #ifndef ALIGN
 #define ALIGN(x, a) (((x) + (a) - 1) & ~((a) - 1))
@@ -207,7 +208,7 @@ int gem_fd)
 
 int decimator_test(struct dp_device *device, int drm_fd, uint32_t m, uint32_t w,
 		uint32_t h, uint32_t sw, uint32_t sh, uint32_t f,
-		uint32_t bus_f, uint32_t count)
+		uint32_t bus_f, uint32_t count, uint32_t timeout)
 {
 	int ret;
 	int gem_fds[MAX_BUFFER_COUNT] = { -1, };
@@ -303,6 +304,16 @@ int decimator_test(struct dp_device *device, int drm_fd, uint32_t m, uint32_t w,
 		}
 	}
 
+	/* no subdev of its own, a reset restarts the stream as well */
+	struct watchdog_stream stream = { decimator_video_fd,
+					  nx_decimator_video, dma_fds,
+					  MAX_BUFFER_COUNT, alloc_size };
+	struct stall_watchdog wd;
+
+	stall_watchdog_init(&wd, decimator_video_fd, nx_decimator_video, 1,
+			    MAX_BUFFER_COUNT, timeout, stall_watchdog_restart,
+			    &stream);
+
 	ret = nx_v4l2_streamon(decimator_video_fd, nx_decimator_video);
 	if (ret) {
 		DP_ERR("failed to streamon\n");
@@ -314,8 +325,7 @@ int decimator_test(struct dp_device *device, int drm_fd, uint32_t m, uint32_t w,
 	while (loop_count--) {
 		int dq_index;
 
-		ret = nx_v4l2_dqbuf(decimator_video_fd, nx_decimator_video, 1,
-				    &dq_index);
+		ret = stall_watchdog_dqbuf(&wd, &dq_index);
 		if (ret) {
 			DP_ERR("failed to dqbuf\n");
 			return ret;
@@ -337,6 +347,7 @@ int decimator_test(struct dp_device *device, int drm_fd, uint32_t m, uint32_t w,
 		*/
 	}
 
+	stall_watchdog_print_stats(&wd);
 	nx_v4l2_streamoff(decimator_video_fd, nx_decimator_video);
 
 	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
@@ -362,11 +373,12 @@ int main(int argc, char *argv[])
 	struct dp_device *device;
 	int dbg_on = 0;
 	uint32_t sw = 0, sh = 0;
+	uint32_t timeout = WATCHDOG_DEFAULT_TIMEOUT;
 
 	dp_debug_on(dbg_on);
 
 	ret = handle_option(argc, argv, &m, &w, &h, &sw, &sh, &f, &bus_f,
-			&count);
+			&count, &timeout);
 	if (ret) {
 		DP_ERR("failed to handle_option\n");
 		return ret;
@@ -384,7 +396,8 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
-	err = decimator_test(device, drm_fd, m, w, h, sw, sh, f, bus_f, count);
+	err = decimator_test(device, drm_fd, m, w, h, sw, sh, f, bus_f, count,
+			     timeout);
 	if (err < 0) {
 		DP_ERR("failed to do decimator_test\n");
 		return -1;
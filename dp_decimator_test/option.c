@@ -7,11 +7,11 @@
 
 int handle_option(int argc, char **argv, uint32_t *m, uint32_t *w,
 		  uint32_t *h, uint32_t *W, uint32_t *H, uint32_t *f,
-		  uint32_t *bus_f, uint32_t *c)
+		  uint32_t *bus_f, uint32_t *c, uint32_t *timeout)
 {
 	int opt;
 
-	while ((opt = getopt(argc, argv, "m:w:h:f:F:c:W:H:")) != -1) {
+	while ((opt = getopt(argc, argv, "m:w:h:f:F:c:W:H:t:")) != -1) {
 		switch (opt) {
 		case 'm':
 			*m = atoi(optarg);
@@ -37,6 +37,10 @@ int handle_option(int argc, char **argv, uint32_t *m, uint32_t *w,
 		case 'H':
 			*H = atoi(optarg);
 			break;
+		case 't':
+			/* ms without a frame before the stream is recovered */
+			*timeout = atoi(optarg);
+			break;
 		}
 	}
 
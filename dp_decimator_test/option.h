@@ -7,7 +7,7 @@ extern "C" {
 
 int handle_option(int argc, char **argv, uint32_t *m, uint32_t *w,
 		  uint32_t *h, uint32_t *W, uint32_t *H, uint32_t *f,
-		  uint32_t *bus_f, uint32_t *count);
+		  uint32_t *bus_f, uint32_t *count, uint32_t *timeout);
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ */
+
+#ifndef __NX_V4L2_MOCK_H__
+#define __NX_V4L2_MOCK_H__
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * libnx_v4l2_mock implements the nx_v4l2_* helpers (nx-v4l2.h) and the
+ * nx-drm-allocator helpers in process, so capture loops can run on any
+ * Linux machine. Link it instead of -lnx_v4l2 -lnx_drm_allocator.
+ *
+ * Video nodes produce frames from a thread paced by CLOCK_MONOTONIC at
+ * the configured rate, in the size/format given by nx_v4l2_set_format()
+ * (or by nx_v4l2_set_crop() on the video node, like the decimator).
+ * Buffers only need to be mmap-able fds: dma-buf, or the memfd returned
+ * by the mock alloc_gem()/gem_to_dmafd().
+ *
+ * The device fd is an eventfd that becomes readable when a frame has
+ * been captured, so poll() based loops work unchanged. Release it with
+ * nx_v4l2_mock_close() rather than close(), or the device slot leaks.
+ *
+ * Defaults can be overridden from the environment:
+ *	NX_V4L2_MOCK_FPS		30 or 30000/1001
+ *	NX_V4L2_MOCK_DROP_EVERY		drop every Nth frame (0: off)
+ *	NX_V4L2_MOCK_DROP_PERCENT	drop frames at random (0 - 100)
+ *	NX_V4L2_MOCK_LATENCY_US		capture to dqbuf latency
+ *	NX_V4L2_MOCK_JITTER_US		random +- jitter of the frame period
+ *	NX_V4L2_MOCK_FILL		0: only write the frame header
+ *	NX_V4L2_MOCK_MIPI		1: report a mipi camera
+ */
+
+struct nx_v4l2_mock_config {
+	uint32_t fps_num;
+	uint32_t fps_den;
+	uint32_t drop_every;
+	uint32_t drop_percent;
+	uint32_t latency_us;
+	uint32_t jitter_us;
+	bool fill;
+	bool mipi;
+};
+
+struct nx_v4l2_mock_stats {
+	uint32_t sequence;		/* frames produced by the sensor */
+	uint32_t captured;		/* frames delivered to buffers */
+	uint32_t dropped_injected;	/* drop_every / drop_percent */
+	uint32_t dropped_overrun;	/* no buffer queued at capture time */
+};
+
+/*
+ * Written at offset 0 of plane 0 of every frame (when the plane is big
+ * enough), so consumers can check ordering and latency in the data.
+ */
+#define NX_V4L2_MOCK_MAGIC	0x4b4d584e	/* "NXMK" */
+
+struct nx_v4l2_mock_header {
+	uint32_t magic;
+	uint32_t sequence;
+	uint64_t timestamp_ns;		/* CLOCK_MONOTONIC */
+};
+
+/* stop streaming, drop the mappings and close the device fd */
+int nx_v4l2_mock_close(int fd);
+
+void nx_v4l2_mock_get_config(struct nx_v4l2_mock_config *cfg);
+void nx_v4l2_mock_set_config(const struct nx_v4l2_mock_config *cfg);
+
+/* capture timestamp and sequence of the last frame delivered to index */
+int nx_v4l2_mock_get_buf_info(int fd, int index, uint64_t *timestamp_ns,
+			      uint32_t *sequence);
+int nx_v4l2_mock_get_stats(int fd, struct nx_v4l2_mock_stats *stats);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* __NX_V4L2_MOCK_H__ */
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ */
+
+/*
+ * nx-drm-allocator stand-in for hosts without a Nexell DRM device.
+ * A "gem" is an anonymous shared memory fd, its "dma-buf" is a dup of it,
+ * so both can be mmap()ed by the capture code and by the v4l2 mock.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sys/syscall.h>
+
+#include <nx-drm-allocator.h>
+
+static int mock_shm_create(size_t size)
+{
+	char path[] = "/tmp/nx-drm-mock-XXXXXX";
+	int fd;
+
+#ifdef __NR_memfd_create
+	fd = syscall(__NR_memfd_create, "nx-drm-mock", 0);
+	if (fd < 0)
+#endif
+	{
+		fd = mkstemp(path);
+		if (fd >= 0)
+			unlink(path);
+	}
+
+	if (fd < 0)
+		return -1;
+
+	if (ftruncate(fd, size) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+int open_drm_device(void)
+{
+	return open("/dev/null", O_RDWR | O_CLOEXEC);
+}
+
+int alloc_gem(int drm_fd, int size, int flags)
+{
+	if (size <= 0)
+		return -EINVAL;
+
+	return mock_shm_create(size);
+}
+
+void free_gem(int drm_fd, int gem_fd)
+{
+	if (gem_fd >= 0)
+		close(gem_fd);
+}
+
+int gem_to_dmafd(int drm_fd, int gem_fd)
+{
+	return fcntl(gem_fd, F_DUPFD_CLOEXEC, 0);
+}
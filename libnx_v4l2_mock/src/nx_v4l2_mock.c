@@ -0,0 +1,711 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+
+#include <linux/videodev2.h>
+
+#include <nx-v4l2.h>
+#include "nx-v4l2-mock.h"
+
+#ifndef ALIGN
+#define ALIGN(x, a) (((x) + (a) - 1) & ~((a) - 1))
+#endif
+
+#define MOCK_MAX_DEVICES	32
+#define MOCK_MAX_BUFFERS	32
+#define MOCK_MAX_PLANES		3
+
+enum {
+	MOCK_BUF_DEQUEUED,
+	MOCK_BUF_QUEUED,
+	MOCK_BUF_ACTIVE,	/* owned by the capture thread */
+	MOCK_BUF_DONE,
+};
+
+struct mock_buffer {
+	int state;
+	int plane_num;
+	int fds[MOCK_MAX_PLANES];
+	int sizes[MOCK_MAX_PLANES];
+
+	/* mapping cache, redone only when the fd or size changes */
+	int map_fds[MOCK_MAX_PLANES];
+	int map_sizes[MOCK_MAX_PLANES];
+	void *vaddr[MOCK_MAX_PLANES];
+
+	uint64_t timestamp;
+	uint64_t ready;
+	uint32_t sequence;
+};
+
+/* index fifo */
+struct mock_fifo {
+	int idx[MOCK_MAX_BUFFERS];
+	int head;
+	int count;
+};
+
+struct mock_device {
+	bool used;
+	int fd;
+	int type;
+	int module;
+
+	uint32_t width;
+	uint32_t height;
+	uint32_t format;
+	int crop_w;
+	int crop_h;
+
+	int buf_count;
+	struct mock_buffer bufs[MOCK_MAX_BUFFERS];
+	struct mock_fifo queued;
+	struct mock_fifo done;
+
+	bool streaming;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	unsigned int seed;
+
+	struct nx_v4l2_mock_stats stats;
+};
+
+static struct mock_device devices[MOCK_MAX_DEVICES];
+static pthread_mutex_t devices_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct nx_v4l2_mock_config config = {
+	.fps_num = 30,
+	.fps_den = 1,
+	.fill = true,
+};
+static pthread_once_t config_once = PTHREAD_ONCE_INIT;
+
+static uint64_t mock_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void mock_ns_to_timespec(uint64_t ns, struct timespec *ts)
+{
+	ts->tv_sec = ns / 1000000000ULL;
+	ts->tv_nsec = ns % 1000000000ULL;
+}
+
+static uint32_t env_u32(const char *name, uint32_t def)
+{
+	const char *v = getenv(name);
+
+	return v ? (uint32_t)strtoul(v, NULL, 0) : def;
+}
+
+static void mock_load_config(void)
+{
+	const char *fps = getenv("NX_V4L2_MOCK_FPS");
+
+	if (fps) {
+		unsigned int num = 0, den = 1;
+
+		if (sscanf(fps, "%u/%u", &num, &den) >= 1 && num && den) {
+			config.fps_num = num;
+			config.fps_den = den;
+		}
+	}
+
+	config.drop_every = env_u32("NX_V4L2_MOCK_DROP_EVERY",
+				    config.drop_every);
+	config.drop_percent = env_u32("NX_V4L2_MOCK_DROP_PERCENT",
+				      config.drop_percent);
+	config.latency_us = env_u32("NX_V4L2_MOCK_LATENCY_US",
+				    config.latency_us);
+	config.jitter_us = env_u32("NX_V4L2_MOCK_JITTER_US", config.jitter_us);
+	config.fill = env_u32("NX_V4L2_MOCK_FILL", config.fill) != 0;
+	config.mipi = env_u32("NX_V4L2_MOCK_MIPI", config.mipi) != 0;
+}
+
+void nx_v4l2_mock_get_config(struct nx_v4l2_mock_config *cfg)
+{
+	pthread_once(&config_once, mock_load_config);
+	*cfg = config;
+}
+
+void nx_v4l2_mock_set_config(const struct nx_v4l2_mock_config *cfg)
+{
+	pthread_once(&config_once, mock_load_config);
+	config = *cfg;
+	if (!config.fps_num || !config.fps_den) {
+		config.fps_num = 30;
+		config.fps_den = 1;
+	}
+}
+
+static void fifo_push(struct mock_fifo *f, int idx)
+{
+	f->idx[(f->head + f->count) % MOCK_MAX_BUFFERS] = idx;
+	f->count++;
+}
+
+static int fifo_peek(struct mock_fifo *f)
+{
+	return f->idx[f->head];
+}
+
+static int fifo_pop(struct mock_fifo *f)
+{
+	int idx = f->idx[f->head];
+
+	f->head = (f->head + 1) % MOCK_MAX_BUFFERS;
+	f->count--;
+	return idx;
+}
+
+static struct mock_device *mock_find(int fd, int type)
+{
+	int i;
+
+	for (i = 0; i < MOCK_MAX_DEVICES; i++)
+		if (devices[i].used && devices[i].fd == fd &&
+		    devices[i].type == type)
+			return &devices[i];
+
+	errno = EBADF;
+	return NULL;
+}
+
+static bool mock_is_video(int type)
+{
+	return type == nx_clipper_video || type == nx_decimator_video;
+}
+
+static void mock_unmap(struct mock_buffer *buf)
+{
+	int i;
+
+	for (i = 0; i < MOCK_MAX_PLANES; i++) {
+		if (buf->vaddr[i])
+			munmap(buf->vaddr[i], buf->map_sizes[i]);
+		buf->vaddr[i] = NULL;
+		buf->map_fds[i] = -1;
+		buf->map_sizes[i] = 0;
+	}
+}
+
+static void *mock_map(struct mock_buffer *buf, int plane)
+{
+	void *vaddr;
+
+	if (buf->vaddr[plane] && buf->map_fds[plane] == buf->fds[plane] &&
+	    buf->map_sizes[plane] == buf->sizes[plane])
+		return buf->vaddr[plane];
+
+	if (buf->vaddr[plane])
+		munmap(buf->vaddr[plane], buf->map_sizes[plane]);
+	buf->vaddr[plane] = NULL;
+
+	vaddr = mmap(NULL, buf->sizes[plane], PROT_READ | PROT_WRITE,
+		     MAP_SHARED, buf->fds[plane], 0);
+	if (vaddr == MAP_FAILED)
+		return NULL;
+
+	buf->vaddr[plane] = vaddr;
+	buf->map_fds[plane] = buf->fds[plane];
+	buf->map_sizes[plane] = buf->sizes[plane];
+
+	return vaddr;
+}
+
+/* horizontal luma ramp scrolling with the sequence, flat chroma */
+static void mock_fill(struct mock_device *dev, struct mock_buffer *buf)
+{
+	uint32_t w = dev->crop_w > 0 ? (uint32_t)dev->crop_w : dev->width;
+	uint32_t h = dev->crop_h > 0 ? (uint32_t)dev->crop_h : dev->height;
+	uint32_t stride = ALIGN(w, 32);
+	uint32_t bpp = 1;
+	struct nx_v4l2_mock_header hdr;
+	uint8_t *p;
+	size_t luma, y;
+	int i;
+
+	if (dev->format == V4L2_PIX_FMT_YUYV || dev->format == V4L2_PIX_FMT_UYVY)
+		bpp = 2;
+
+	for (i = 0; i < buf->plane_num; i++) {
+		p = mock_map(buf, i);
+		if (!p)
+			continue;
+
+		if (i == 0 && config.fill) {
+			luma = (size_t)stride * bpp * h;
+			if (luma > (size_t)buf->sizes[0])
+				luma = buf->sizes[0];
+
+			for (y = 0; y < luma / (stride * bpp); y++)
+				memset(p + y * stride * bpp,
+				       (y + buf->sequence * 2) & 0xff,
+				       stride * bpp);
+			memset(p + luma, 0x80, buf->sizes[0] - luma);
+		} else if (config.fill) {
+			memset(p, 0x80, buf->sizes[i]);
+		}
+
+		if (i == 0 && buf->sizes[0] >= (int)sizeof(hdr)) {
+			hdr.magic = NX_V4L2_MOCK_MAGIC;
+			hdr.sequence = buf->sequence;
+			hdr.timestamp_ns = buf->timestamp;
+			memcpy(p, &hdr, sizeof(hdr));
+		}
+	}
+}
+
+static bool mock_drop(struct mock_device *dev, uint32_t sequence)
+{
+	if (config.drop_every && (sequence + 1) % config.drop_every == 0)
+		return true;
+
+	if (config.drop_percent &&
+	    (uint32_t)(rand_r(&dev->seed) % 100) < config.drop_percent)
+		return true;
+
+	return false;
+}
+
+static void *mock_capture_thread(void *data)
+{
+	struct mock_device *dev = data;
+	uint64_t period = 1000000000ULL * config.fps_den / config.fps_num;
+	uint64_t next = mock_now_ns();
+	struct timespec ts;
+	struct mock_buffer *buf;
+	uint64_t one = 1;
+	uint32_t sequence;
+	int64_t jitter;
+	int idx;
+
+	for (;;) {
+		jitter = 0;
+		if (config.jitter_us)
+			jitter = (int64_t)(rand_r(&dev->seed) %
+				 (2 * config.jitter_us + 1)) - config.jitter_us;
+
+		next += period;
+		mock_ns_to_timespec(next + jitter * 1000, &ts);
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts,
+				       NULL) == EINTR)
+			;
+
+		pthread_mutex_lock(&dev->lock);
+		if (!dev->streaming) {
+			pthread_mutex_unlock(&dev->lock);
+			break;
+		}
+
+		sequence = dev->stats.sequence++;
+
+		if (mock_drop(dev, sequence)) {
+			dev->stats.dropped_injected++;
+			pthread_mutex_unlock(&dev->lock);
+			continue;
+		}
+
+		if (!dev->queued.count) {
+			dev->stats.dropped_overrun++;
+			pthread_mutex_unlock(&dev->lock);
+			continue;
+		}
+
+		idx = fifo_pop(&dev->queued);
+		buf = &dev->bufs[idx];
+		buf->state = MOCK_BUF_ACTIVE;
+		buf->sequence = sequence;
+		buf->timestamp = mock_now_ns();
+		pthread_mutex_unlock(&dev->lock);
+
+		/* the buffer belongs to no queue, fill it unlocked */
+		mock_fill(dev, buf);
+
+		pthread_mutex_lock(&dev->lock);
+		buf->ready = buf->timestamp + config.latency_us * 1000ULL;
+		buf->state = MOCK_BUF_DONE;
+		fifo_push(&dev->done, idx);
+		dev->stats.captured++;
+		pthread_cond_broadcast(&dev->cond);
+		pthread_mutex_unlock(&dev->lock);
+
+		if (write(dev->fd, &one, sizeof(one)) < 0)
+			fprintf(stderr, "mock: failed to signal fd %d\n",
+				dev->fd);
+	}
+
+	return NULL;
+}
+
+int nx_v4l2_open_device(int type, int module)
+{
+	struct mock_device *dev = NULL;
+	pthread_condattr_t attr;
+	int fd, i;
+
+	pthread_once(&config_once, mock_load_config);
+
+	fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK | EFD_SEMAPHORE);
+	if (fd < 0)
+		return -1;
+
+	pthread_mutex_lock(&devices_lock);
+	for (i = 0; i < MOCK_MAX_DEVICES && !dev; i++)
+		if (!devices[i].used)
+			dev = &devices[i];
+
+	if (!dev) {
+		pthread_mutex_unlock(&devices_lock);
+		close(fd);
+		errno = EMFILE;
+		return -1;
+	}
+
+	memset(dev, 0, sizeof(*dev));
+	dev->used = true;
+	dev->fd = fd;
+	dev->type = type;
+	dev->module = module;
+	dev->seed = (unsigned int)fd * 2654435761u;
+	for (i = 0; i < MOCK_MAX_BUFFERS; i++)
+		mock_unmap(&dev->bufs[i]);
+
+	pthread_mutex_init(&dev->lock, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&dev->cond, &attr);
+	pthread_condattr_destroy(&attr);
+	pthread_mutex_unlock(&devices_lock);
+
+	return fd;
+}
+
+bool nx_v4l2_is_mipi_camera(int module)
+{
+	pthread_once(&config_once, mock_load_config);
+	return config.mipi;
+}
+
+int nx_v4l2_link(bool link, int module, int src_type, int src_pad,
+		 int sink_type, int sink_pad)
+{
+	return 0;
+}
+
+int nx_v4l2_set_format(int fd, int type, uint32_t w, uint32_t h,
+		       uint32_t format)
+{
+	struct mock_device *dev = mock_find(fd, type);
+
+	if (!dev)
+		return -EBADF;
+
+	pthread_mutex_lock(&dev->lock);
+	if (dev->streaming) {
+		pthread_mutex_unlock(&dev->lock);
+		return -EBUSY;
+	}
+	dev->width = w;
+	dev->height = h;
+	dev->format = format;
+	pthread_mutex_unlock(&dev->lock);
+
+	return 0;
+}
+
+int nx_v4l2_set_crop(int fd, int type, int x, int y, int w, int h)
+{
+	struct mock_device *dev = mock_find(fd, type);
+
+	if (!dev)
+		return -EBADF;
+
+	/* on a video node the crop is the (scaled) output size */
+	if (mock_is_video(type)) {
+		pthread_mutex_lock(&dev->lock);
+		dev->crop_w = w;
+		dev->crop_h = h;
+		pthread_mutex_unlock(&dev->lock);
+	}
+
+	return 0;
+}
+
+int nx_v4l2_reqbuf(int fd, int type, int count)
+{
+	struct mock_device *dev = mock_find(fd, type);
+	int i;
+
+	if (!dev || !mock_is_video(type))
+		return -EINVAL;
+
+	if (count < 0 || count > MOCK_MAX_BUFFERS)
+		return -EINVAL;
+
+	pthread_mutex_lock(&dev->lock);
+	if (dev->streaming) {
+		pthread_mutex_unlock(&dev->lock);
+		return -EBUSY;
+	}
+
+	for (i = 0; i < MOCK_MAX_BUFFERS; i++) {
+		mock_unmap(&dev->bufs[i]);
+		dev->bufs[i].state = MOCK_BUF_DEQUEUED;
+	}
+	memset(&dev->queued, 0, sizeof(dev->queued));
+	memset(&dev->done, 0, sizeof(dev->done));
+	dev->buf_count = count;
+	pthread_mutex_unlock(&dev->lock);
+
+	return 0;
+}
+
+int nx_v4l2_qbuf(int fd, int type, int plane_num, int index, int *fds,
+		 int *sizes)
+{
+	struct mock_device *dev = mock_find(fd, type);
+	struct mock_buffer *buf;
+	int i;
+
+	if (!dev || !mock_is_video(type))
+		return -EINVAL;
+
+	if (plane_num < 1 || plane_num > MOCK_MAX_PLANES)
+		return -EINVAL;
+
+	pthread_mutex_lock(&dev->lock);
+	if (index < 0 || index >= dev->buf_count ||
+	    dev->bufs[index].state != MOCK_BUF_DEQUEUED) {
+		pthread_mutex_unlock(&dev->lock);
+		return -EINVAL;
+	}
+
+	buf = &dev->bufs[index];
+	buf->plane_num = plane_num;
+	for (i = 0; i < plane_num; i++) {
+		buf->fds[i] = fds[i];
+		buf->sizes[i] = sizes[i];
+	}
+	buf->state = MOCK_BUF_QUEUED;
+	fifo_push(&dev->queued, index);
+	pthread_mutex_unlock(&dev->lock);
+
+	return 0;
+}
+
+int nx_v4l2_dqbuf(int fd, int type, int plane_num, int *index)
+{
+	struct mock_device *dev = mock_find(fd, type);
+	struct timespec ts;
+	uint64_t count;
+	int idx;
+
+	if (!dev || !mock_is_video(type))
+		return -EINVAL;
+
+	pthread_mutex_lock(&dev->lock);
+	for (;;) {
+		if (!dev->streaming) {
+			pthread_mutex_unlock(&dev->lock);
+			return -EINVAL;
+		}
+
+		if (!dev->done.count) {
+			pthread_cond_wait(&dev->cond, &dev->lock);
+			continue;
+		}
+
+		idx = fifo_peek(&dev->done);
+		if (dev->bufs[idx].ready <= mock_now_ns())
+			break;
+
+		/* injected latency */
+		mock_ns_to_timespec(dev->bufs[idx].ready, &ts);
+		pthread_cond_timedwait(&dev->cond, &dev->lock, &ts);
+	}
+
+	idx = fifo_pop(&dev->done);
+	dev->bufs[idx].state = MOCK_BUF_DEQUEUED;
+	pthread_mutex_unlock(&dev->lock);
+
+	/* one eventfd count per delivered frame */
+	if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+		fprintf(stderr, "mock: failed to consume fd %d event\n", fd);
+
+	*index = idx;
+
+	return 0;
+}
+
+int nx_v4l2_streamon(int fd, int type)
+{
+	struct mock_device *dev = mock_find(fd, type);
+	int ret;
+
+	if (!dev || !mock_is_video(type))
+		return -EINVAL;
+
+	pthread_mutex_lock(&dev->lock);
+	if (dev->streaming) {
+		pthread_mutex_unlock(&dev->lock);
+		return 0;
+	}
+
+	if (!dev->buf_count) {
+		pthread_mutex_unlock(&dev->lock);
+		return -EINVAL;
+	}
+
+	memset(&dev->stats, 0, sizeof(dev->stats));
+	dev->streaming = true;
+	pthread_mutex_unlock(&dev->lock);
+
+	ret = pthread_create(&dev->thread, NULL, mock_capture_thread, dev);
+	if (ret) {
+		pthread_mutex_lock(&dev->lock);
+		dev->streaming = false;
+		pthread_mutex_unlock(&dev->lock);
+		return -ret;
+	}
+
+	return 0;
+}
+
+/* like VIDIOC_STREAMOFF, every buffer returns to the application */
+static void mock_stop(struct mock_device *dev)
+{
+	uint64_t count;
+	int i;
+
+	pthread_mutex_lock(&dev->lock);
+	if (!dev->streaming) {
+		pthread_mutex_unlock(&dev->lock);
+		return;
+	}
+	dev->streaming = false;
+	pthread_cond_broadcast(&dev->cond);
+	pthread_mutex_unlock(&dev->lock);
+
+	pthread_join(dev->thread, NULL);
+
+	pthread_mutex_lock(&dev->lock);
+	for (i = 0; i < dev->buf_count; i++)
+		dev->bufs[i].state = MOCK_BUF_DEQUEUED;
+	memset(&dev->queued, 0, sizeof(dev->queued));
+	memset(&dev->done, 0, sizeof(dev->done));
+	pthread_mutex_unlock(&dev->lock);
+
+	/* drop the events of frames that were never dequeued */
+	while (read(dev->fd, &count, sizeof(count)) == sizeof(count))
+		;
+}
+
+int nx_v4l2_streamoff(int fd, int type)
+{
+	struct mock_device *dev = mock_find(fd, type);
+
+	if (!dev || !mock_is_video(type))
+		return -EINVAL;
+
+	mock_stop(dev);
+
+	return 0;
+}
+
+/*
+ * Release a device the way the driver release does: streaming stops,
+ * mappings go away and the slot is free for the next open.
+ */
+int nx_v4l2_mock_close(int fd)
+{
+	struct mock_device *dev = NULL;
+	int i;
+
+	pthread_mutex_lock(&devices_lock);
+	for (i = 0; i < MOCK_MAX_DEVICES && !dev; i++)
+		if (devices[i].used && devices[i].fd == fd)
+			dev = &devices[i];
+
+	if (!dev) {
+		pthread_mutex_unlock(&devices_lock);
+		return -EINVAL;
+	}
+
+	mock_stop(dev);
+	for (i = 0; i < MOCK_MAX_BUFFERS; i++)
+		mock_unmap(&dev->bufs[i]);
+	pthread_cond_destroy(&dev->cond);
+	pthread_mutex_destroy(&dev->lock);
+	dev->used = false;
+	pthread_mutex_unlock(&devices_lock);
+
+	return close(fd) ? -errno : 0;
+}
+
+int nx_v4l2_mock_get_buf_info(int fd, int index, uint64_t *timestamp_ns,
+			      uint32_t *sequence)
+{
+	struct mock_device *dev = NULL;
+	int i;
+
+	pthread_mutex_lock(&devices_lock);
+	for (i = 0; i < MOCK_MAX_DEVICES && !dev; i++)
+		if (devices[i].used && devices[i].fd == fd)
+			dev = &devices[i];
+
+	if (!dev || index < 0 || index >= dev->buf_count) {
+		pthread_mutex_unlock(&devices_lock);
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&dev->lock);
+	if (timestamp_ns)
+		*timestamp_ns = dev->bufs[index].timestamp;
+	if (sequence)
+		*sequence = dev->bufs[index].sequence;
+	pthread_mutex_unlock(&dev->lock);
+	pthread_mutex_unlock(&devices_lock);
+
+	return 0;
+}
+
+int nx_v4l2_mock_get_stats(int fd, struct nx_v4l2_mock_stats *stats)
+{
+	struct mock_device *dev = NULL;
+	int i;
+
+	pthread_mutex_lock(&devices_lock);
+	for (i = 0; i < MOCK_MAX_DEVICES && !dev; i++)
+		if (devices[i].used && devices[i].fd == fd)
+			dev = &devices[i];
+
+	if (!dev) {
+		pthread_mutex_unlock(&devices_lock);
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&dev->lock);
+	*stats = dev->stats;
+	pthread_mutex_unlock(&dev->lock);
+	pthread_mutex_unlock(&devices_lock);
+
+	return 0;
+}
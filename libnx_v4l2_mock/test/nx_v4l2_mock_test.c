@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ */
+
+/*
+ * Regression test of the mock itself: open, reqbuf, qbuf, dqbuf and close
+ * a clipper video node more times than the mock has device slots. Every
+ * other round closes the fd while streaming, which is how the capture
+ * tests leave on errors, so a slot that outlives its fd shows up as a
+ * failed open well before the last round.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+
+#include <linux/videodev2.h>
+
+#include <nx-v4l2.h>
+#include <nx-drm-allocator.h>
+#include "nx-v4l2-mock.h"
+
+#define TEST_ROUNDS	80	/* more than the mock has device slots */
+#define TEST_BUFFERS	4
+#define TEST_FRAMES	6
+#define TEST_WIDTH	64
+#define TEST_HEIGHT	32
+
+static int test_round(int drm_fd, int round)
+{
+	int size = TEST_WIDTH * TEST_HEIGHT * 3 / 2;
+	int gem_fds[TEST_BUFFERS], dma_fds[TEST_BUFFERS];
+	struct nx_v4l2_mock_header hdr;
+	uint32_t last = 0;
+	int fd, i, index, ret = -1;
+	void *p;
+
+	for (i = 0; i < TEST_BUFFERS; i++)
+		gem_fds[i] = dma_fds[i] = -1;
+
+	fd = nx_v4l2_open_device(nx_clipper_video, 0);
+	if (fd < 0) {
+		fprintf(stderr, "round %d: failed to open device: %s\n", round,
+			strerror(errno));
+		return -1;
+	}
+
+	if (nx_v4l2_set_format(fd, nx_clipper_video, TEST_WIDTH, TEST_HEIGHT,
+			       V4L2_PIX_FMT_YUV420) ||
+	    nx_v4l2_reqbuf(fd, nx_clipper_video, TEST_BUFFERS)) {
+		fprintf(stderr, "round %d: failed to set up device\n", round);
+		goto out;
+	}
+
+	for (i = 0; i < TEST_BUFFERS; i++) {
+		gem_fds[i] = alloc_gem(drm_fd, size, 0);
+		dma_fds[i] = gem_fds[i] < 0 ? -1 :
+			     gem_to_dmafd(drm_fd, gem_fds[i]);
+		if (dma_fds[i] < 0 ||
+		    nx_v4l2_qbuf(fd, nx_clipper_video, 1, i, &dma_fds[i],
+				 &size)) {
+			fprintf(stderr, "round %d: failed to queue %d\n",
+				round, i);
+			goto out;
+		}
+	}
+
+	if (nx_v4l2_streamon(fd, nx_clipper_video)) {
+		fprintf(stderr, "round %d: failed to streamon\n", round);
+		goto out;
+	}
+
+	for (i = 0; i < TEST_FRAMES; i++) {
+		if (nx_v4l2_dqbuf(fd, nx_clipper_video, 1, &index) ||
+		    index < 0 || index >= TEST_BUFFERS) {
+			fprintf(stderr, "round %d: failed to dqbuf\n", round);
+			goto out;
+		}
+
+		p = mmap(NULL, size, PROT_READ, MAP_SHARED, dma_fds[index], 0);
+		if (p == MAP_FAILED) {
+			fprintf(stderr, "round %d: failed to mmap\n", round);
+			goto out;
+		}
+		memcpy(&hdr, p, sizeof(hdr));
+		munmap(p, size);
+
+		if (hdr.magic != NX_V4L2_MOCK_MAGIC ||
+		    (i && hdr.sequence <= last)) {
+			fprintf(stderr, "round %d: bad frame %d (seq %u)\n",
+				round, i, hdr.sequence);
+			goto out;
+		}
+		last = hdr.sequence;
+
+		if (nx_v4l2_qbuf(fd, nx_clipper_video, 1, index,
+				 &dma_fds[index], &size)) {
+			fprintf(stderr, "round %d: failed to requeue\n", round);
+			goto out;
+		}
+	}
+
+	/* odd rounds leave the stream running for nx_v4l2_mock_close() */
+	if (!(round & 1) && nx_v4l2_streamoff(fd, nx_clipper_video)) {
+		fprintf(stderr, "round %d: failed to streamoff\n", round);
+		goto out;
+	}
+
+	ret = 0;
+out:
+	nx_v4l2_mock_close(fd);
+	for (i = 0; i < TEST_BUFFERS; i++) {
+		if (dma_fds[i] >= 0)
+			close(dma_fds[i]);
+		if (gem_fds[i] >= 0)
+			free_gem(drm_fd, gem_fds[i]);
+	}
+
+	return ret;
+}
+
+int main(void)
+{
+	struct nx_v4l2_mock_config cfg;
+	int drm_fd, i;
+
+	nx_v4l2_mock_get_config(&cfg);
+	cfg.fps_num = 1000;
+	cfg.fps_den = 1;
+	cfg.drop_every = 0;
+	cfg.drop_percent = 0;
+	cfg.latency_us = 0;
+	cfg.jitter_us = 0;
+	nx_v4l2_mock_set_config(&cfg);
+
+	drm_fd = open_drm_device();
+	if (drm_fd < 0) {
+		fprintf(stderr, "failed to open drm device\n");
+		return 1;
+	}
+
+	for (i = 0; i < TEST_ROUNDS; i++)
+		if (test_round(drm_fd, i))
+			break;
+
+	close(drm_fd);
+
+	printf("%s: %d/%d rounds\n", i == TEST_ROUNDS ? "PASS" : "FAIL", i,
+	       TEST_ROUNDS);
+
+	return i == TEST_ROUNDS ? 0 : 1;
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "crop-ctl.h"
+
+#define CROP_CTL_POLL_TIMEOUT	100	/* ms, to notice deinit */
+
+static int clamp(int v, int lo, int hi)
+{
+	return v < lo ? lo : (v > hi ? hi : v);
+}
+
+/* even origin and size keep the chroma planes on whole samples */
+static void crop_fit(struct crop_ctl *ctl, int x, int y, int w, int h,
+		     struct rect *r)
+{
+	w = clamp(w, CROP_CTL_MIN_SIZE, ctl->width) & ~1;
+	h = clamp(h, CROP_CTL_MIN_SIZE, ctl->height) & ~1;
+	x = clamp(x, 0, ctl->width - w) & ~1;
+	y = clamp(y, 0, ctl->height - h) & ~1;
+
+	r->x = x;
+	r->y = y;
+	r->width = w;
+	r->height = h;
+}
+
+static int crop_command(struct crop_ctl *ctl, const char *line,
+			struct rect *r)
+{
+	int cx = ctl->cur.x + ctl->cur.width / 2;
+	int cy = ctl->cur.y + ctl->cur.height / 2;
+	int a, b, c, d;
+
+	if (sscanf(line, "crop %d,%d,%d,%d", &a, &b, &c, &d) == 4) {
+		crop_fit(ctl, a, b, c, d, r);
+	} else if (sscanf(line, "zoom %d", &a) == 1) {
+		if (a < 100)
+			return -EINVAL;
+		c = ctl->width * 100 / a;
+		d = ctl->height * 100 / a;
+		crop_fit(ctl, cx - c / 2, cy - d / 2, c, d, r);
+	} else if (sscanf(line, "pan %d,%d", &a, &b) == 2) {
+		crop_fit(ctl, ctl->cur.x + a, ctl->cur.y + b, ctl->cur.width,
+			 ctl->cur.height, r);
+	} else if (sscanf(line, "center %d,%d", &a, &b) == 2) {
+		crop_fit(ctl, a - ctl->cur.width / 2, b - ctl->cur.height / 2,
+			 ctl->cur.width, ctl->cur.height, r);
+	} else if (!strncmp(line, "reset", 5)) {
+		crop_fit(ctl, 0, 0, ctl->width, ctl->height, r);
+	} else {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void crop_publish(struct crop_ctl *ctl, const struct rect *r)
+{
+	ctl->cur = *r;
+
+	pthread_mutex_lock(&ctl->lock);
+	ctl->pending = *r;
+	ctl->generation++;
+	pthread_mutex_unlock(&ctl->lock);
+
+	printf("crop: %d,%d %dx%d\n", r->x, r->y, r->width, r->height);
+}
+
+static void *crop_ctl_thread(void *arg)
+{
+	struct crop_ctl *ctl = (struct crop_ctl *)arg;
+	struct pollfd pfd;
+	char buf[256];
+	int len = 0;
+
+	pfd.fd = ctl->fd;
+	pfd.events = POLLIN;
+
+	while (!ctl->stop) {
+		char *nl;
+		ssize_t n;
+
+		if (poll(&pfd, 1, CROP_CTL_POLL_TIMEOUT) <= 0)
+			continue;
+
+		n = read(ctl->fd, buf + len, sizeof(buf) - 1 - len);
+		if (n <= 0)
+			continue;
+		len += n;
+		buf[len] = '\0';
+
+		while ((nl = strchr(buf, '\n')) != NULL) {
+			struct rect r;
+
+			*nl = '\0';
+			ctl->commands++;
+			if (crop_command(ctl, buf, &r)) {
+				fprintf(stderr, "crop: bad command '%s'\n",
+					buf);
+				ctl->rejected++;
+			} else {
+				crop_publish(ctl, &r);
+			}
+
+			len -= nl + 1 - buf;
+			memmove(buf, nl + 1, len + 1);
+		}
+
+		/* a line that does not fit is garbage */
+		if (len == sizeof(buf) - 1)
+			len = 0;
+	}
+
+	return NULL;
+}
+
+int crop_ctl_init(struct crop_ctl *ctl, const char *path, uint32_t w,
+		  uint32_t h, const struct rect *initial)
+{
+	memset(ctl, 0, sizeof(*ctl));
+	snprintf(ctl->path, sizeof(ctl->path), "%s", path);
+	ctl->width = w;
+	ctl->height = h;
+
+	if (w < CROP_CTL_MIN_SIZE || h < CROP_CTL_MIN_SIZE)
+		return -EINVAL;
+
+	if (initial && initial->width && initial->height)
+		crop_fit(ctl, initial->x, initial->y, initial->width,
+			 initial->height, &ctl->cur);
+	else
+		crop_fit(ctl, 0, 0, w, h, &ctl->cur);
+	ctl->pending = ctl->cur;
+
+	if (mkfifo(path, 0666) == 0) {
+		ctl->created = true;
+	} else if (errno != EEXIST) {
+		fprintf(stderr, "failed to mkfifo %s: %s\n", path,
+			strerror(errno));
+		return -errno;
+	}
+
+	/* opened for writing too, so the fifo never reads EOF between writers */
+	ctl->fd = open(path, O_RDWR | O_NONBLOCK);
+	if (ctl->fd < 0) {
+		fprintf(stderr, "failed to open %s: %s\n", path,
+			strerror(errno));
+		if (ctl->created)
+			unlink(path);
+		return -errno;
+	}
+
+	pthread_mutex_init(&ctl->lock, NULL);
+
+	return 0;
+}
+
+int crop_ctl_start(struct crop_ctl *ctl)
+{
+	int ret;
+
+	ret = pthread_create(&ctl->thread, NULL, crop_ctl_thread, ctl);
+	if (ret) {
+		fprintf(stderr, "failed to create crop control thread\n");
+		return -ret;
+	}
+	ctl->started = true;
+
+	return 0;
+}
+
+bool crop_ctl_fetch(struct crop_ctl *ctl, struct rect *crop)
+{
+	bool changed;
+
+	pthread_mutex_lock(&ctl->lock);
+	changed = ctl->fetched != ctl->generation;
+	if (changed) {
+		*crop = ctl->pending;
+		ctl->fetched = ctl->generation;
+	}
+	pthread_mutex_unlock(&ctl->lock);
+
+	if (changed)
+		ctl->applied++;
+
+	return changed;
+}
+
+void crop_ctl_deinit(struct crop_ctl *ctl)
+{
+	ctl->stop = true;
+	if (ctl->started)
+		pthread_join(ctl->thread, NULL);
+
+	close(ctl->fd);
+	if (ctl->created)
+		unlink(ctl->path);
+
+	pthread_mutex_destroy(&ctl->lock);
+}
+
+void crop_ctl_print_stats(struct crop_ctl *ctl)
+{
+	printf("crop: %u commands, %u rejected, %u windows applied\n",
+	       ctl->commands, ctl->rejected, ctl->applied);
+}
@@ -0,0 +1,71 @@
+#ifndef _CROP_CTL_H
+#define _CROP_CTL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include <nx-scaler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CROP_CTL_MIN_SIZE	32	/* smallest window, pixels */
+
+/*
+ * Digital zoom / pan: the scaler crop window is changed while the stream
+ * keeps running. Capture size, buffers and the scaler destination stay
+ * as they are, only the part of the source the scaler reads changes, so
+ * zooming costs no extra memory bandwidth.
+ *
+ * Commands come one per line from a fifo, e.g.
+ *	echo "zoom 200" > /tmp/crop
+ *
+ *	crop <x>,<y>,<w>,<h>	absolute window
+ *	zoom <percent>		100 = full frame, kept around the centre
+ *	pan <dx>,<dy>		move the window
+ *	center <x>,<y>		move the window centre
+ *	reset			full frame
+ *
+ * Windows are clamped to the frame and aligned for 4:2:0 chroma. The
+ * control thread only publishes a complete rectangle, the streaming side
+ * picks it up between two frames with crop_ctl_fetch(), so a frame is
+ * never scaled from a half updated window.
+ */
+struct crop_ctl {
+	char path[128];
+	int fd;
+	bool created;		/* fifo made by us, removed on deinit */
+	uint32_t width;		/* source frame */
+	uint32_t height;
+
+	struct rect cur;	/* owned by the control thread */
+	struct rect pending;
+	uint32_t generation;	/* bumped on every published window */
+	uint32_t fetched;	/* generation the streaming side has */
+
+	volatile bool stop;
+	bool started;
+	pthread_t thread;
+	pthread_mutex_t lock;
+
+	uint32_t commands;
+	uint32_t rejected;
+	uint32_t applied;
+};
+
+/* initial is the -S crop, a zero sized one means the full frame */
+int crop_ctl_init(struct crop_ctl *ctl, const char *path, uint32_t w,
+		  uint32_t h, const struct rect *initial);
+int crop_ctl_start(struct crop_ctl *ctl);
+/* true and the new window in crop when it changed since the last call */
+bool crop_ctl_fetch(struct crop_ctl *ctl, struct rect *crop);
+void crop_ctl_deinit(struct crop_ctl *ctl);
+void crop_ctl_print_stats(struct crop_ctl *ctl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
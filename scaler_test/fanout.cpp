@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <nx-scaler.h>
+
+#include "fanout.h"
+
+static uint64_t fanout_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int fanout_parse(const char *arg, struct fanout *fo)
+{
+	const char *p = arg;
+
+	memset(fo, 0, sizeof(*fo));
+
+	while (*p) {
+		struct fanout_rung *r;
+		int w, h, used = 0;
+
+		if (fo->count == MAX_FANOUT_RUNGS) {
+			fprintf(stderr, "too many ladder rungs (max %d)\n",
+				MAX_FANOUT_RUNGS);
+			return -EINVAL;
+		}
+
+		r = &fo->rungs[fo->count];
+		if (sscanf(p, "%dx%d%n", &w, &h, &used) != 2 || w <= 0 ||
+		    h <= 0) {
+			fprintf(stderr, "invalid ladder rung %s\n", p);
+			return -EINVAL;
+		}
+		r->width = w;
+		r->height = h;
+		p += used;
+
+		if (*p == '@') {
+			char *end;
+
+			r->code = strtoul(p + 1, &end, 0);
+			if (end == p + 1) {
+				fprintf(stderr, "invalid ladder code %s\n", p);
+				return -EINVAL;
+			}
+			p = end;
+		}
+
+		fo->count++;
+
+		if (*p == ',')
+			p++;
+		else if (*p) {
+			fprintf(stderr, "invalid ladder %s\n", arg);
+			return -EINVAL;
+		}
+	}
+
+	if (!fo->count) {
+		fprintf(stderr, "empty ladder\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+void fanout_setup(struct fanout *fo, scale_build_t build, uint32_t w,
+		  uint32_t h, uint32_t code)
+{
+	int i;
+
+	fo->src_width = w;
+	fo->src_height = h;
+	fo->src_code = code;
+	scale_cache_init(&fo->cache, build);
+
+	for (i = 0; i < fo->count; i++) {
+		fo->rungs[i].next = 0;
+		fo->rungs[i].last = -1;
+	}
+}
+
+void fanout_set_consumer(struct fanout *fo, int rung,
+			 fanout_consume_t consume, void *priv)
+{
+	fo->rungs[rung].consume = consume;
+	fo->rungs[rung].priv = priv;
+}
+
+int fanout_run(struct fanout *fo, int handle, int src_fd, struct rect crop)
+{
+	struct scale_job jobs[MAX_FANOUT_RUNGS];
+	int rung[MAX_FANOUT_RUNGS];
+	struct fanout_rung *r;
+	uint64_t start = fanout_now_us(), t;
+	int ret = 0;
+	int n = 0;
+	int i;
+
+	for (i = 0; i < fo->count; i++) {
+		r = &fo->rungs[i];
+		jobs[n].ctx = scale_cache_get(&fo->cache, fo->src_width,
+					      fo->src_height, crop, r->width,
+					      r->height, r->code ? r->code :
+					      fo->src_code);
+		if (!jobs[n].ctx) {
+			r->errors++;
+			ret = -1;
+			continue;
+		}
+		jobs[n].src_fd = src_fd;
+		jobs[n].dst_fd = r->dst_dma_fds[r->next];
+		rung[n++] = i;
+	}
+
+	if (scale_batch_run(handle, jobs, n))
+		ret = -1;
+
+	for (i = 0; i < n; i++) {
+		r = &fo->rungs[rung[i]];
+		if (jobs[i].ret) {
+			fprintf(stderr, "failed to scale rung %ux%u\n",
+				r->width, r->height);
+			r->errors++;
+			continue;
+		}
+
+		r->total_us += jobs[i].us;
+		if (jobs[i].us > r->max_us)
+			r->max_us = jobs[i].us;
+		r->frames++;
+
+		r->last = r->next;
+		r->next = (r->next + 1) % FANOUT_RING_SIZE;
+	}
+
+	/* the ladder cost is the scaling, not what the consumers do */
+	t = fanout_now_us() - start;
+	fo->total_us += t;
+	if (t > fo->max_us)
+		fo->max_us = t;
+	fo->frames++;
+
+	for (i = 0; i < n; i++) {
+		r = &fo->rungs[rung[i]];
+		if (!jobs[i].ret && r->consume)
+			r->consume(r->priv, rung[i], r->last);
+	}
+
+	return ret;
+}
+
+void fanout_print_stats(struct fanout *fo)
+{
+	uint64_t sum = 0;
+	int fit = 0;
+	int i;
+
+	if (!fo->frames)
+		return;
+
+	for (i = 0; i < fo->count; i++) {
+		struct fanout_rung *r = &fo->rungs[i];
+		uint64_t avg = r->frames ? r->total_us / r->frames : 0;
+
+		printf("ladder %ux%u: %u frames, %u errors, avg %llu us, "
+		       "max %llu us%s\n", r->width, r->height, r->frames,
+		       r->errors, (unsigned long long)avg,
+		       (unsigned long long)r->max_us,
+		       r->consume ? "" : " (no consumer, timed only)");
+
+		/* rungs in the given order, first ones matter most */
+		sum += avg;
+		if (sum <= FANOUT_BUDGET_US && fit == i)
+			fit = i + 1;
+	}
+
+	printf("ladder: %u frames, avg %llu us, max %llu us per frame, "
+	       "%d of %d rungs fit in %u us (30 fps), full ladder up to "
+	       "%llu fps\n", fo->frames,
+	       (unsigned long long)(fo->total_us / fo->frames),
+	       (unsigned long long)fo->max_us, fit, fo->count,
+	       FANOUT_BUDGET_US, fo->total_us ?
+	       (unsigned long long)(fo->frames * 1000000ULL / fo->total_us) :
+	       0ULL);
+	scale_cache_print_stats(&fo->cache);
+}
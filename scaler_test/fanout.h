@@ -0,0 +1,80 @@
+#ifndef _FANOUT_H
+#define _FANOUT_H
+
+#include <stdint.h>
+
+#include <nx-scaler.h>
+
+#include "scale-cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_FANOUT_RUNGS	4
+#define FANOUT_RING_SIZE	3	/* shown / ready / being written */
+#define FANOUT_BUDGET_US	33333	/* one source frame at 30 fps */
+
+/* a new frame of the rung is in dst_dma_fds[index] */
+typedef void (*fanout_consume_t)(void *priv, int rung, int index);
+
+/*
+ * Resolution ladder (-L option): every source frame is scaled once per
+ * rung, as one batch on the same scaler handle. Each rung is a stream of
+ * its own with a ring of destination buffers; after fanout_run() the
+ * newest frame of a rung is dst_dma_fds[last], which stays untouched
+ * for the next FANOUT_RING_SIZE - 1 runs. Every new frame is passed to
+ * the consumer of its rung; a rung without one is only timed.
+ */
+struct fanout_rung {
+	uint32_t width;
+	uint32_t height;
+	uint32_t code;		/* 0: same as the source */
+
+	int dst_dma_fds[FANOUT_RING_SIZE];
+	int next;
+	int last;
+
+	fanout_consume_t consume;
+	void *priv;
+
+	uint32_t frames;
+	uint32_t errors;
+	uint64_t total_us;
+	uint64_t max_us;
+};
+
+struct fanout {
+	int count;
+	struct fanout_rung rungs[MAX_FANOUT_RUNGS];
+
+	/* source, contexts per rung and crop come from the cache */
+	uint32_t src_width;
+	uint32_t src_height;
+	uint32_t src_code;
+	struct scale_cache cache;
+
+	uint32_t frames;
+	uint64_t total_us;	/* whole ladder, per source frame */
+	uint64_t max_us;
+};
+
+/* "<w>x<h>[@<code>][,<w>x<h>[@<code>]...]", e.g. 1920x1080,1280x720,640x360 */
+int fanout_parse(const char *arg, struct fanout *fo);
+void fanout_setup(struct fanout *fo, scale_build_t build, uint32_t w,
+		  uint32_t h, uint32_t code);
+void fanout_set_consumer(struct fanout *fo, int rung,
+			 fanout_consume_t consume, void *priv);
+/*
+ * every rung from the crop of src_fd, consumers are called once the
+ * whole batch is done; -1 if any rung failed
+ */
+int fanout_run(struct fanout *fo, int handle, int src_fd, struct rect crop);
+/* per rung cost and how many rungs fit in FANOUT_BUDGET_US */
+void fanout_print_stats(struct fanout *fo);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
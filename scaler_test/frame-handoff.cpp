@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "frame-handoff.h"
+
+uint64_t stage_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int handoff_parse_policy(const char *arg, enum handoff_policy *policy,
+			 uint32_t *nth, int *depth)
+{
+	const char *opt;
+	char *end;
+	long val;
+
+	*nth = 1;
+	*depth = 1;
+
+	if (!strncmp(arg, "oldest", 6)) {
+		*policy = HANDOFF_DROP_OLDEST;
+	} else if (!strncmp(arg, "newest", 6)) {
+		*policy = HANDOFF_DROP_NEWEST;
+	} else if (!strncmp(arg, "nth:", 4)) {
+		*policy = HANDOFF_KEEP_NTH;
+		val = strtol(arg + 4, &end, 10);
+		if (end == arg + 4 || (*end && *end != ',') || val < 1 ||
+		    val > INT32_MAX) {
+			fprintf(stderr, "invalid keep-nth interval %s\n", arg);
+			return -EINVAL;
+		}
+		*nth = val;
+	} else {
+		fprintf(stderr, "unknown drop policy %s\n", arg);
+		return -EINVAL;
+	}
+
+	opt = strchr(arg, ',');
+	if (opt) {
+		val = strtol(opt + 1, &end, 10);
+		if (end == opt + 1 || *end || val < 1 ||
+		    val > MAX_HANDOFF_DEPTH) {
+			fprintf(stderr, "hand-off depth must be 1 ~ %d\n",
+				MAX_HANDOFF_DEPTH);
+			return -EINVAL;
+		}
+		*depth = val;
+	}
+
+	return 0;
+}
+
+const char *handoff_policy_name(enum handoff_policy policy)
+{
+	switch (policy) {
+	case HANDOFF_DROP_OLDEST:
+		return "drop-oldest";
+	case HANDOFF_DROP_NEWEST:
+		return "drop-newest";
+	case HANDOFF_KEEP_NTH:
+		return "keep-nth";
+	case HANDOFF_BLOCK:
+		return "block";
+	default:
+		return "none";
+	}
+}
+
+int handoff_init(struct frame_handoff *ho, enum handoff_policy policy,
+		 uint32_t nth, int depth, handoff_release_t release,
+		 void *priv)
+{
+	if (depth < 1 || depth > MAX_HANDOFF_DEPTH)
+		return -EINVAL;
+
+	memset(ho, 0, sizeof(*ho));
+	ho->policy = policy;
+	ho->nth = nth ? nth : 1;
+	ho->depth = depth;
+	ho->release = release;
+	ho->priv = priv;
+
+	pthread_mutex_init(&ho->lock, NULL);
+	pthread_cond_init(&ho->cond, NULL);
+	pthread_cond_init(&ho->room, NULL);
+
+	return 0;
+}
+
+void handoff_deinit(struct frame_handoff *ho)
+{
+	pthread_cond_destroy(&ho->room);
+	pthread_cond_destroy(&ho->cond);
+	pthread_mutex_destroy(&ho->lock);
+}
+
+int handoff_put(struct frame_handoff *ho, int index, uint64_t *wait_us)
+{
+	uint64_t start;
+	int drop = -1;
+
+	pthread_mutex_lock(&ho->lock);
+	if (ho->policy == HANDOFF_BLOCK) {
+		if (ho->count == ho->depth && !ho->closed) {
+			start = stage_now_us();
+			while (ho->count == ho->depth && !ho->closed)
+				pthread_cond_wait(&ho->room, &ho->lock);
+			if (wait_us)
+				*wait_us += stage_now_us() - start;
+		}
+
+		if (ho->closed) {
+			pthread_mutex_unlock(&ho->lock);
+			return -1;
+		}
+	}
+
+	ho->offered++;
+
+	if (ho->policy == HANDOFF_KEEP_NTH &&
+	    (ho->offered - 1) % ho->nth) {
+		ho->skipped_nth++;
+		drop = index;
+	} else if (ho->count < ho->depth) {
+		ho->slots[(ho->head + ho->count) % MAX_HANDOFF_DEPTH] = index;
+		ho->count++;
+		pthread_cond_signal(&ho->cond);
+	} else if (ho->policy == HANDOFF_DROP_NEWEST) {
+		ho->dropped_newest++;
+		drop = index;
+	} else {
+		/* drop-oldest, also the overflow rule of keep-nth */
+		drop = ho->slots[ho->head];
+		ho->head = (ho->head + 1) % MAX_HANDOFF_DEPTH;
+		ho->slots[(ho->head + ho->count - 1) % MAX_HANDOFF_DEPTH] =
+			index;
+		ho->dropped_oldest++;
+		pthread_cond_signal(&ho->cond);
+	}
+	pthread_mutex_unlock(&ho->lock);
+
+	/* requeue outside the lock, it is an ioctl */
+	if (drop >= 0 && ho->release(ho->priv, drop))
+		fprintf(stderr, "failed to release dropped index %d\n", drop);
+
+	return 0;
+}
+
+int handoff_get(struct frame_handoff *ho, int *index, uint64_t *wait_us)
+{
+	uint64_t start;
+
+	pthread_mutex_lock(&ho->lock);
+	if (!ho->count && !ho->closed) {
+		start = stage_now_us();
+		while (!ho->count && !ho->closed)
+			pthread_cond_wait(&ho->cond, &ho->lock);
+		if (wait_us)
+			*wait_us += stage_now_us() - start;
+	}
+
+	if (!ho->count) {
+		pthread_mutex_unlock(&ho->lock);
+		return -1;
+	}
+
+	*index = ho->slots[ho->head];
+	ho->head = (ho->head + 1) % MAX_HANDOFF_DEPTH;
+	ho->count--;
+	ho->delivered++;
+	pthread_cond_signal(&ho->room);
+	pthread_mutex_unlock(&ho->lock);
+
+	return 0;
+}
+
+int handoff_done(struct frame_handoff *ho, int index)
+{
+	return ho->release(ho->priv, index);
+}
+
+void handoff_close(struct frame_handoff *ho)
+{
+	pthread_mutex_lock(&ho->lock);
+	ho->closed = true;
+	pthread_cond_broadcast(&ho->cond);
+	pthread_cond_broadcast(&ho->room);
+	pthread_mutex_unlock(&ho->lock);
+}
+
+void handoff_print_stats(struct frame_handoff *ho)
+{
+	pthread_mutex_lock(&ho->lock);
+	printf("hand-off %s (depth %d", handoff_policy_name(ho->policy),
+	       ho->depth);
+	if (ho->policy == HANDOFF_KEEP_NTH)
+		printf(", every %u", ho->nth);
+	printf("): offered %u, delivered %u, dropped oldest %u, "
+	       "dropped newest %u, skipped nth %u\n",
+	       ho->offered, ho->delivered, ho->dropped_oldest,
+	       ho->dropped_newest, ho->skipped_nth);
+	pthread_mutex_unlock(&ho->lock);
+}
+
+static unsigned int stage_permille(uint64_t part, uint64_t wall_us)
+{
+	return wall_us ? (unsigned int)(part * 1000 / wall_us) : 0;
+}
+
+void stage_print_stats(const struct stage_stats *stats, int count,
+		       uint64_t wall_us)
+{
+	const struct stage_stats *limit = NULL;
+	int i;
+
+	printf("pipeline: %llu ms", (unsigned long long)(wall_us / 1000));
+	if (count && wall_us)
+		printf(", %llu.%llu fps",
+		       (unsigned long long)(stats[count - 1].frames *
+					    1000000ULL / wall_us),
+		       (unsigned long long)(stats[count - 1].frames *
+					    10000000ULL / wall_us % 10));
+	printf("\n");
+
+	for (i = 0; i < count; i++) {
+		const struct stage_stats *s = &stats[i];
+		unsigned int work = stage_permille(s->work_us, wall_us);
+		unsigned int starved = stage_permille(s->starved_us, wall_us);
+		unsigned int blocked = stage_permille(s->blocked_us, wall_us);
+
+		printf("  %-8s %6u frames, work %3u.%u%%, starved %3u.%u%%, "
+		       "blocked %3u.%u%%, %llu us/frame\n", s->name,
+		       s->frames, work / 10, work % 10, starved / 10,
+		       starved % 10, blocked / 10, blocked % 10,
+		       s->frames ?
+		       (unsigned long long)(s->work_us / s->frames) : 0ULL);
+
+		if (!limit || s->work_us > limit->work_us)
+			limit = s;
+	}
+
+	if (limit)
+		printf("  busiest stage: %s\n", limit->name);
+}
@@ -0,0 +1,111 @@
+#ifndef _FRAME_HANDOFF_H
+#define _FRAME_HANDOFF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_HANDOFF_DEPTH	8
+
+/*
+ * Decoupled hand-off between the capture loop and a slow consumer.
+ * handoff_put() never blocks: a frame the policy discards is given back
+ * to the driver right away through the release callback, so the V4L2
+ * queue stays fed no matter how long the consumer takes.
+ *
+ *   drop-oldest  queue full: release the oldest waiting frame
+ *   drop-newest  queue full: release the frame being offered
+ *   keep-nth     forward every Nth frame only, then drop-oldest
+ *
+ * Between the stages of the pipeline nothing may be dropped:
+ *
+ *   block        queue full: handoff_put() waits for room
+ */
+enum handoff_policy {
+	HANDOFF_NONE = 0,	/* no hand-off, consumer runs in capture loop */
+	HANDOFF_DROP_OLDEST,
+	HANDOFF_DROP_NEWEST,
+	HANDOFF_KEEP_NTH,
+	HANDOFF_BLOCK,
+};
+
+/*
+ * Per stage time accounting, wall time splits into
+ *   work	doing its own job
+ *   starved	waiting for input from the stage before
+ *   blocked	waiting for room in the stage after (or a free buffer)
+ * The stage with the highest work share limits the frame rate; when
+ * every stage is mostly starved the source (sensor) is the limit.
+ * handoff_put() and handoff_get() add the time they wait to the counter
+ * they are given.
+ */
+struct stage_stats {
+	const char *name;
+	uint32_t frames;
+	uint64_t work_us;
+	uint64_t starved_us;
+	uint64_t blocked_us;
+};
+
+typedef int (*handoff_release_t)(void *priv, int index);
+
+struct frame_handoff {
+	enum handoff_policy policy;
+	uint32_t nth;
+	int depth;
+
+	int slots[MAX_HANDOFF_DEPTH];
+	int head;
+	int count;
+	bool closed;
+
+	handoff_release_t release;
+	void *priv;
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	pthread_cond_t room;	/* block policy */
+
+	uint32_t offered;
+	uint32_t delivered;
+	uint32_t dropped_oldest;
+	uint32_t dropped_newest;
+	uint32_t skipped_nth;
+};
+
+/* "oldest", "newest" or "nth:<n>", optionally followed by ",<depth>" */
+int handoff_parse_policy(const char *arg, enum handoff_policy *policy,
+			 uint32_t *nth, int *depth);
+const char *handoff_policy_name(enum handoff_policy policy);
+
+int handoff_init(struct frame_handoff *ho, enum handoff_policy policy,
+		 uint32_t nth, int depth, handoff_release_t release,
+		 void *priv);
+void handoff_deinit(struct frame_handoff *ho);
+
+/*
+ * Only the block policy waits, and only it fails: -1 once closed.
+ * wait_us (may be NULL) is charged with the time spent waiting.
+ */
+int handoff_put(struct frame_handoff *ho, int index, uint64_t *wait_us);
+/* blocks; returns -1 once closed and drained */
+int handoff_get(struct frame_handoff *ho, int *index, uint64_t *wait_us);
+/* consumer is done with index */
+int handoff_done(struct frame_handoff *ho, int index);
+/* wakes every waiter, pending entries can still be taken */
+void handoff_close(struct frame_handoff *ho);
+void handoff_print_stats(struct frame_handoff *ho);
+
+uint64_t stage_now_us(void);
+void stage_print_stats(const struct stage_stats *stats, int count,
+		       uint64_t wall_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,348 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include <linux/dma-buf.h>
+
+#include <drm/nexell_drm.h>
+#include <nx-drm-allocator.h>
+#include <nx-scaler.h>
+
+#include "mosaic.h"
+
+#ifndef ALIGN
+#define ALIGN(x, a) (((x) + (a) - 1) & ~((a) - 1))
+#endif
+
+static uint64_t mosaic_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void mosaic_sync(int fd, uint64_t flags)
+{
+#ifdef DMA_BUF_IOCTL_SYNC
+	struct dma_buf_sync sync;
+
+	sync.flags = flags;
+	ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync);
+#endif
+}
+
+/* calc_alloc_size() I420 layout at the scaler strides */
+static void mosaic_plane(const uint32_t *stride, uint32_t h, int p,
+			 uint32_t *offset, uint32_t *pstride)
+{
+	uint32_t y_size = stride[0] * ALIGN(h, 16);
+
+	*offset = p ? y_size + (p == 2 ? stride[1] * ALIGN(h >> 1, 16) : 0) : 0;
+	*pstride = stride[p];
+}
+
+/* cells start and end on even pixels, chroma is subsampled */
+static uint32_t mosaic_edge(uint32_t len, int k, int n)
+{
+	return (uint32_t)((uint64_t)len * k / n) & ~1u;
+}
+
+int mosaic_parse_grid(const char *arg, int *cols, int *rows)
+{
+	if (sscanf(arg, "%dx%d", cols, rows) != 2 ||
+	    *cols < 1 || *cols > MOSAIC_MAX_SPLIT ||
+	    *rows < 1 || *rows > MOSAIC_MAX_SPLIT) {
+		fprintf(stderr, "invalid mosaic grid %s\n", arg);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int mosaic_init(struct mosaic *m, int drm_fd, scale_build_t build, int cols,
+		int rows, uint32_t w, uint32_t h, const int *dst_fds,
+		size_t dst_size)
+{
+	struct nx_scaler_context full;
+	struct rect none;
+	uint32_t offset, pstride;
+	int i, p;
+
+	memset(m, 0, sizeof(*m));
+	memset(&none, 0, sizeof(none));
+	for (i = 0; i < MAX_MOSAIC_CELLS; i++) {
+		m->cells[i].gem_fd = -1;
+		m->cells[i].dma_fd = -1;
+		m->cells[i].src_fd = -1;
+	}
+
+	m->cols = cols;
+	m->rows = rows;
+	m->count = cols * rows;
+	m->width = w;
+	m->height = h;
+	m->dst_fds = dst_fds;
+	m->dst_size = dst_size;
+	scale_cache_init(&m->cache, build);
+
+	build(w, h, w, h, 0, 1, none, &full);
+	memcpy(m->dst_stride, full.dst_stride, sizeof(m->dst_stride));
+
+	for (i = 0; i < m->count; i++) {
+		struct mosaic_cell *c = &m->cells[i];
+		uint32_t x0 = mosaic_edge(w, i % cols, cols);
+		uint32_t x1 = mosaic_edge(w, i % cols + 1, cols);
+		uint32_t y0 = mosaic_edge(h, i / cols, rows);
+		uint32_t y1 = mosaic_edge(h, i / cols + 1, rows);
+		struct nx_scaler_context cell;
+		void *map;
+
+		c->out.x = x0;
+		c->out.y = y0;
+		c->out.width = x1 - x0;
+		c->out.height = y1 - y0;
+
+		/* dst strides only depend on the dst size */
+		build(c->out.width, c->out.height, c->out.width,
+		      c->out.height, 0, 1, none, &cell);
+		mosaic_plane(cell.dst_stride, c->out.height, 2, &offset,
+			     &pstride);
+		c->size = ALIGN(offset + pstride *
+				ALIGN(c->out.height >> 1, 16), 4096);
+
+		/* cached, cells are read back by the cpu */
+		c->gem_fd = alloc_gem(drm_fd, c->size, NX_BO_CACHABLE);
+		c->dma_fd = c->gem_fd < 0 ? -1 :
+			gem_to_dmafd(drm_fd, c->gem_fd);
+		if (c->dma_fd < 0) {
+			fprintf(stderr, "failed to alloc mosaic cell %d\n", i);
+			return -ENOMEM;
+		}
+
+		map = mmap(NULL, c->size, PROT_READ, MAP_SHARED, c->dma_fd, 0);
+		if (map == MAP_FAILED) {
+			fprintf(stderr, "failed to mmap mosaic cell %d\n", i);
+			return -ENOMEM;
+		}
+		c->map = (uint8_t *)map;
+	}
+
+	for (i = 0; i < MOSAIC_BUFFERS; i++) {
+		void *map = mmap(NULL, dst_size, PROT_READ | PROT_WRITE,
+				 MAP_SHARED, dst_fds[i], 0);
+
+		if (map == MAP_FAILED) {
+			fprintf(stderr, "failed to mmap mosaic dst %d\n", i);
+			return -ENOMEM;
+		}
+		m->dst_map[i] = (uint8_t *)map;
+
+		/* black until a feed delivers */
+		mosaic_sync(dst_fds[i], DMA_BUF_SYNC_START | DMA_BUF_SYNC_WRITE);
+		for (p = 0; p < 3; p++) {
+			mosaic_plane(m->dst_stride, h, p, &offset, &pstride);
+			memset(m->dst_map[i] + offset, p ? 128 : 16,
+			       pstride * ALIGN(p ? h >> 1 : h, 16));
+		}
+		mosaic_sync(dst_fds[i], DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE);
+	}
+
+	printf("mosaic %dx%d in %ux%u, cells of %ux%u\n", cols, rows, w, h,
+	       m->cells[0].out.width, m->cells[0].out.height);
+
+	return 0;
+}
+
+int mosaic_cell_source(struct mosaic *m, int i, uint32_t w, uint32_t h,
+		       uint32_t code)
+{
+	struct mosaic_cell *c = &m->cells[i];
+	struct rect none;
+
+	memset(&none, 0, sizeof(none));
+
+	/* at most MAX_MOSAIC_CELLS geometries, they are never evicted */
+	c->ctx = scale_cache_get(&m->cache, w, h, none, c->out.width,
+				 c->out.height, code);
+	if (!c->ctx) {
+		fprintf(stderr, "%ux%u can not be scaled to mosaic cell %d\n",
+			w, h, i);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+void mosaic_update(struct mosaic *m, int i, int src_fd)
+{
+	struct mosaic_cell *c = &m->cells[i];
+
+	c->src_fd = src_fd;
+	c->serial++;
+	c->updates++;
+}
+
+static void mosaic_copy(struct mosaic *m, const struct mosaic_cell *c,
+			uint8_t *dst)
+{
+	int p;
+
+	for (p = 0; p < 3; p++) {
+		uint32_t sub = p ? 1 : 0;
+		uint32_t s_off, s_stride, d_off, d_stride, r;
+		const uint8_t *s;
+		uint8_t *d;
+
+		mosaic_plane(c->ctx->dst_stride, c->out.height, p, &s_off,
+			     &s_stride);
+		mosaic_plane(m->dst_stride, m->height, p, &d_off, &d_stride);
+
+		s = c->map + s_off;
+		d = dst + d_off + (c->out.y >> sub) * d_stride +
+			(c->out.x >> sub);
+		for (r = 0; r < c->out.height >> sub; r++)
+			memcpy(d + r * d_stride, s + r * s_stride,
+			       c->out.width >> sub);
+	}
+}
+
+int mosaic_compose(struct mosaic *m, int handle)
+{
+	struct scale_job jobs[MAX_MOSAIC_CELLS];
+	struct mosaic_cell *scaled[MAX_MOSAIC_CELLS];
+	int front = m->back ^ 1;
+	int back = m->back;
+	uint64_t t0, t1, t2;
+	int n = 0, stale = 0;
+	int i;
+
+	for (i = 0; i < m->count; i++)
+		if (m->cells[i].shown[front] != m->cells[i].serial)
+			stale++;
+	if (!stale) {
+		m->idle++;
+		return -1;
+	}
+
+	for (i = 0; i < m->count; i++) {
+		struct mosaic_cell *c = &m->cells[i];
+
+		/* a frame the other buffer got is still in the cell */
+		if (c->shown[back] == c->serial || c->scaled == c->serial)
+			continue;
+
+		jobs[n].ctx = c->ctx;
+		jobs[n].src_fd = c->src_fd;
+		jobs[n].dst_fd = c->dma_fd;
+		scaled[n++] = c;
+	}
+
+	t0 = mosaic_now_us();
+	if (n && scale_batch_run(handle, jobs, n)) {
+		fprintf(stderr, "failed to scale mosaic cells\n");
+		m->errors++;
+		return -2;
+	}
+	for (i = 0; i < n; i++) {
+		scaled[i]->scaled = scaled[i]->serial;
+		scaled[i]->scales++;
+	}
+	t1 = mosaic_now_us();
+
+	mosaic_sync(m->dst_fds[back], DMA_BUF_SYNC_START | DMA_BUF_SYNC_WRITE);
+	for (i = 0; i < m->count; i++) {
+		struct mosaic_cell *c = &m->cells[i];
+		uint64_t bytes = (uint64_t)c->out.width * c->out.height * 3 / 2;
+
+		m->full_bytes += bytes;
+		if (c->shown[back] == c->serial)
+			continue;
+
+		mosaic_sync(c->dma_fd, DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ);
+		mosaic_copy(m, c, m->dst_map[back]);
+		mosaic_sync(c->dma_fd, DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ);
+		c->shown[back] = c->serial;
+		c->copies++;
+		m->copied_bytes += bytes;
+	}
+	mosaic_sync(m->dst_fds[back], DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE);
+	t2 = mosaic_now_us();
+
+	m->scale_us += t1 - t0;
+	m->copy_us += t2 - t1;
+	if (t2 - t0 > m->max_us)
+		m->max_us = t2 - t0;
+	m->composes++;
+	m->back = front;
+
+	return back;
+}
+
+void mosaic_print_stats(struct mosaic *m)
+{
+	int i;
+
+	if (!m->composes)
+		return;
+
+	printf("mosaic: %u composes, %u idle, %u errors, scale avg %llu us, "
+	       "copy avg %llu us, max %llu us, %llu%% of full copies\n",
+	       m->composes, m->idle, m->errors,
+	       (unsigned long long)(m->scale_us / m->composes),
+	       (unsigned long long)(m->copy_us / m->composes),
+	       (unsigned long long)m->max_us,
+	       (unsigned long long)(m->full_bytes ?
+		       m->copied_bytes * 100 / m->full_bytes : 0));
+
+	for (i = 0; i < m->count; i++) {
+		struct mosaic_cell *c = &m->cells[i];
+
+		printf("  cell %d %ux%u+%u+%u: %u frames, %u scales, "
+		       "%u copies\n", i, c->out.width, c->out.height,
+		       c->out.x, c->out.y, c->updates, c->scales, c->copies);
+	}
+}
+
+void mosaic_deinit(struct mosaic *m)
+{
+	int i;
+
+	for (i = 0; i < MAX_MOSAIC_CELLS; i++) {
+		struct mosaic_cell *c = &m->cells[i];
+
+		if (c->map)
+			munmap(c->map, c->size);
+		if (c->dma_fd >= 0)
+			close(c->dma_fd);
+		if (c->gem_fd >= 0)
+			close(c->gem_fd);
+	}
+
+	for (i = 0; i < MOSAIC_BUFFERS; i++)
+		if (m->dst_map[i])
+			munmap(m->dst_map[i], m->dst_size);
+}
@@ -0,0 +1,100 @@
+#ifndef _MOSAIC_H
+#define _MOSAIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <nx-scaler.h>
+
+#include "scale-cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MOSAIC_MAX_SPLIT	4	/* per axis */
+#define MAX_MOSAIC_CELLS	(MOSAIC_MAX_SPLIT * MOSAIC_MAX_SPLIT)
+#define MOSAIC_BUFFERS		2	/* composed while the other is shown */
+
+struct mosaic_cell {
+	struct rect out;	/* where the feed goes in the composed frame */
+	struct nx_scaler_context *ctx;
+	int gem_fd;
+	int dma_fd;
+	uint8_t *map;
+	size_t size;
+
+	/* latest frame of the feed, serial counts frames delivered */
+	int src_fd;
+	uint32_t serial;
+	uint32_t scaled;	/* serial in the cell buffer */
+	uint32_t shown[MOSAIC_BUFFERS];	/* serial in each composed buffer */
+
+	uint32_t updates;
+	uint32_t scales;
+	uint32_t copies;
+};
+
+/*
+ * Several feeds scaled into the cells of one I420 frame (-V option).
+ * The context has no dst offset, so every cell is scaled into a buffer
+ * of its own and copied into the composed frame, the way tiles are
+ * stitched. Feeds deliver at their own rate; a cell is scaled once per
+ * new frame of its feed and copied only into the composed buffers that
+ * do not hold that frame yet, cells that did not change cost nothing.
+ */
+struct mosaic {
+	int cols;
+	int rows;
+	int count;
+	struct mosaic_cell cells[MAX_MOSAIC_CELLS];
+	struct scale_cache cache;
+
+	uint32_t width;
+	uint32_t height;
+	uint32_t dst_stride[3];
+	const int *dst_fds;
+	uint8_t *dst_map[MOSAIC_BUFFERS];
+	size_t dst_size;
+	int back;		/* buffer the next compose writes */
+
+	uint32_t composes;
+	uint32_t idle;		/* composes with no cell to update */
+	uint32_t errors;
+	uint64_t scale_us;
+	uint64_t copy_us;
+	uint64_t max_us;
+	uint64_t copied_bytes;
+	uint64_t full_bytes;	/* what copying every cell would move */
+};
+
+/* "<cols>x<rows>", at most MOSAIC_MAX_SPLIT per axis */
+int mosaic_parse_grid(const char *arg, int *cols, int *rows);
+
+/*
+ * w x h frame of MOSAIC_BUFFERS dst_fds of dst_size bytes each, strides
+ * as build() sets them for a w x h dst. Composed buffers start black.
+ */
+int mosaic_init(struct mosaic *m, int drm_fd, scale_build_t build, int cols,
+		int rows, uint32_t w, uint32_t h, const int *dst_fds,
+		size_t dst_size);
+/* source geometry of the feed of cell i, before its first frame */
+int mosaic_cell_source(struct mosaic *m, int i, uint32_t w, uint32_t h,
+		       uint32_t code);
+/* the feed of cell i has a new frame in src_fd */
+void mosaic_update(struct mosaic *m, int i, int src_fd);
+/*
+ * Brings the back buffer up to date and makes it the front one. Returns
+ * the buffer to show, -1 if nothing changed and the front one still
+ * holds every cell, -2 if a scale failed.
+ */
+int mosaic_compose(struct mosaic *m, int handle);
+void mosaic_print_stats(struct mosaic *m);
+void mosaic_deinit(struct mosaic *m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
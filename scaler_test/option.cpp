@@ -18,57 +18,144 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <getopt.h>
 
 #include <nx-scaler.h>
 
 #include "option.h"
+#include "stall-watchdog.h"
 
+void usage(const char *name)
+{
+	printf(
+		"Usage : %s [options]\n"
+		"  capture options :\n"
+		"     -m [module]                : capture module\n"
+		"     -w [width] -h [height]     : capture size\n"
+		"     -f [format]                : pixel format\n"
+		"     -F [bus format]            : media bus format of the sensor\n"
+		"     -t [msec]                  : camera stall timeout (def:%d)\n"
+		"     -R [trace file]            : record the captured frames\n"
+		"     -I [trace file]            : replay recorded frames instead of capturing\n"
+		"     -X                         : replay as fast as possible (with -I)\n"
+		"  scaler options :\n"
+		"     -W [width] -H [height]     : scaled size\n"
+		"     -c [count]                 : frames to scale, with -I 0 plays the trace once\n"
+		"     -S [x],[y],[w],[h]         : crop of the source\n"
+		"     -P [policy][,depth]        : hand frames off to a consumer, policy oldest, newest or nth:[n]\n"
+		"     -Z [frames]:[x],[y],[w],[h][@[sw],[sh]][/...] : switch crop/size after each frame count\n"
+		"     -C [fifo]                  : crop control fifo (crop, zoom, pan, center)\n"
+		"     -L [w]x[h][@[code]],...    : scale every frame to a ladder of sizes\n"
+		"     -Q [filter][,threads]      : check every frame against the cpu scaler, filter bilinear or polyphase\n"
+		"     -G [w]x[h]                 : largest size the scaler takes, bigger frames are tiled\n"
+		"     -O [x],[y],[w],[h][/...]   : scale regions of interest, or @[file] to read them from\n"
+		"     -r [0|90|180|270][,h|v|hv][,sw] : rotate/flip the scaled frame\n"
+		"     -B [auto|off|[max down],[max up][,max width]] : split scales the scaler can not do in one pass\n"
+		"  other modes :\n"
+		"     -M [report]                : run the gsttest/nxscaler setups, report - is stdout, .json writes JSON\n"
+		"     -V [cols]x[rows]:[trace]@[fps],... : compose recorded feeds into a mosaic, bench to benchmark it\n"
+		"     -T [trace file]            : phase trace file (Chrome JSON)\n",
+		name, WATCHDOG_DEFAULT_TIMEOUT);
+}
 
-int handle_option(int argc, char **argv, uint32_t *m, uint32_t *w, uint32_t *h,
-	uint32_t *W, uint32_t *H, uint32_t *f, uint32_t *bus_f, uint32_t *c,
-	struct rect *S)
+int handle_option(int argc, char **argv, struct scaler_options *o)
 {
 	int opt;
 
-	while ((opt = getopt(argc, argv, "m:w:h:W:H:f:F:c:S:")) != -1) {
+	memset(o, 0, sizeof(*o));
+	o->timeout = WATCHDOG_DEFAULT_TIMEOUT;
+
+	while ((opt = getopt(argc, argv, "m:w:h:W:H:f:F:c:S:T:P:Z:C:t:R:I:XL:Q:M:G:O:r:B:V:")) != -1) {
 		switch (opt) {
 		case 'm':
-			*m = atoi(optarg);
+			o->m = atoi(optarg);
 			break;
 		case 'w':
-			*w = atoi(optarg);
+			o->w = atoi(optarg);
 			break;
 		case 'h':
-			*h = atoi(optarg);
+			o->h = atoi(optarg);
 			break;
 		case 'W':
-			*W = atoi(optarg);
+			o->s_w = atoi(optarg);
 			break;
 		case 'H':
-			*H = atoi(optarg);
+			o->s_h = atoi(optarg);
 			break;
 		case 'f':
-			*f = atoi(optarg);
+			o->f = atoi(optarg);
 			break;
 		case 'F':
-			*bus_f = atoi(optarg);
+			o->bus_f = atoi(optarg);
 			break;
 		case 'c':
-			*c = atoi(optarg);
+			o->count = atoi(optarg);
 			break;
 		case 'S':
 			sscanf(optarg, "%d, %d, %d, %d",
-			&S->x, &S->y, &S->width, &S->height);
+			&o->crop.x, &o->crop.y, &o->crop.width,
+			&o->crop.height);
 			break;
-
+		case 'T':
+			o->trace = optarg;
+			break;
+		case 'P':
+			o->policy = optarg;
+			break;
+		case 'Z':
+			o->reconfig = optarg;
+			break;
+		case 'C':
+			o->crop_pipe = optarg;
+			break;
+		case 't':
+			o->timeout = atoi(optarg);
+			break;
+		case 'R':
+			o->record = optarg;
+			break;
+		case 'I':
+			o->replay = optarg;
+			break;
+		case 'X':
+			o->fast = true;
+			break;
+		case 'L':
+			o->ladder = optarg;
+			break;
+		case 'Q':
+			o->oracle = optarg;
+			break;
+		case 'M':
+			o->bench = optarg;
+			break;
+		case 'G':
+			o->tile_limit = optarg;
+			break;
+		case 'O':
+			o->rois = optarg;
+			break;
+		case 'r':
+			o->rotate = optarg;
+			break;
+		case 'B':
+			o->bypass = optarg;
+			break;
+		case 'V':
+			o->mosaic = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return -EINVAL;
 		}
 	}
 
 	printf("m: %d, w: %d, h: %d, W: %d, H: %d, f: %d, bus_f: %d, c: %d\n",
-	       *m, *w, *h, *W, *H, *f, *bus_f, *c);
-	printf("c_x : %d, c_y : %d, c_w : %d, c_h : %d\n", S->x, S->y,
-		S->width, S->height);
+	       o->m, o->w, o->h, o->s_w, o->s_h, o->f, o->bus_f, o->count);
+	printf("c_x : %d, c_y : %d, c_w : %d, c_h : %d\n", o->crop.x,
+		o->crop.y, o->crop.width, o->crop.height);
 
 	return 0;
 }
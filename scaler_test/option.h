@@ -1,13 +1,62 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
 #ifndef _OPTION_H
 #define _OPTION_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <nx-scaler.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-int handle_option(int argc, char **argv, uint32_t *m, uint32_t *w, uint32_t *h,
-	uint32_t *W, uint32_t *H, uint32_t *f, uint32_t *bus_f,
-	uint32_t *count, struct rect *S);
+/* command line, NULL strings and zero values are options not given */
+struct scaler_options {
+	uint32_t m;		/* -m module */
+	uint32_t w;		/* -w, -h source size */
+	uint32_t h;
+	uint32_t s_w;		/* -W, -H scaled size */
+	uint32_t s_h;
+	uint32_t f;		/* -f pixel format */
+	uint32_t bus_f;		/* -F bus format */
+	uint32_t count;		/* -c frames */
+	struct rect crop;	/* -S */
+	char *trace;		/* -T */
+	char *policy;		/* -P */
+	char *reconfig;		/* -Z */
+	char *crop_pipe;	/* -C */
+	uint32_t timeout;	/* -t, WATCHDOG_DEFAULT_TIMEOUT if not given */
+	char *record;		/* -R */
+	char *replay;		/* -I */
+	bool fast;		/* -X */
+	char *ladder;		/* -L */
+	char *oracle;		/* -Q */
+	char *bench;		/* -M */
+	char *tile_limit;	/* -G */
+	char *rois;		/* -O */
+	char *rotate;		/* -r */
+	char *bypass;		/* -B */
+	char *mosaic;		/* -V */
+};
+
+void usage(const char *name);
+int handle_option(int argc, char **argv, struct scaler_options *opt);
 
 #ifdef __cplusplus
 }
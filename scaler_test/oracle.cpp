@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <linux/dma-buf.h>
+
+#include "oracle.h"
+
+void oracle_sync(int fd, uint64_t flags)
+{
+#ifdef DMA_BUF_IOCTL_SYNC
+	struct dma_buf_sync sync;
+
+	sync.flags = flags;
+	ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync);
+#endif
+}
+
+int oracle_init(struct scaler_oracle *o, const char *arg, uint32_t f,
+	const struct nx_scaler_context *s_ctx, int *src_fds, size_t src_size,
+	int *dst_fds, size_t dst_size)
+{
+	int ret;
+	int i;
+
+	memset(o->src, 0, sizeof(o->src));
+	memset(o->dst, 0, sizeof(o->dst));
+	o->src_fds = src_fds;
+	o->dst_fds = dst_fds;
+	o->src_size = src_size;
+	o->dst_size = dst_size;
+	o->fallbacks = 0;
+
+	ret = sw_compare_init(&o->cmp, arg, f, s_ctx, dst_size);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
+		void *src = mmap(NULL, src_size, PROT_READ, MAP_SHARED,
+				 src_fds[i], 0);
+		void *dst = mmap(NULL, dst_size, PROT_READ | PROT_WRITE,
+				 MAP_SHARED, dst_fds[i], 0);
+
+		if (src != MAP_FAILED)
+			o->src[i] = (uint8_t *)src;
+		if (dst != MAP_FAILED)
+			o->dst[i] = (uint8_t *)dst;
+		if (!o->src[i] || !o->dst[i]) {
+			fprintf(stderr, "failed to mmap buffer %d\n", i);
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+/* after the hardware wrote dst[index] from src[index] */
+void oracle_check(struct scaler_oracle *o, int index)
+{
+	oracle_sync(o->src_fds[index], DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ);
+	oracle_sync(o->dst_fds[index], DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ);
+	sw_compare_frame(&o->cmp, o->src[index], o->dst[index]);
+	oracle_sync(o->dst_fds[index], DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ);
+	oracle_sync(o->src_fds[index], DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ);
+}
+
+/* stands in for the hardware, which is busy with someone else */
+int oracle_scale(struct scaler_oracle *o, int index)
+{
+	int ret;
+
+	oracle_sync(o->src_fds[index], DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ);
+	oracle_sync(o->dst_fds[index], DMA_BUF_SYNC_START | DMA_BUF_SYNC_WRITE);
+	ret = sw_scaler_run(&o->cmp.scaler, o->src[index], o->dst[index]);
+	oracle_sync(o->dst_fds[index], DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE);
+	oracle_sync(o->src_fds[index], DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ);
+	o->fallbacks++;
+
+	return ret;
+}
+
+void oracle_deinit(struct scaler_oracle *o)
+{
+	int i;
+
+	sw_compare_print_stats(&o->cmp);
+	if (o->fallbacks)
+		printf("software scaler stood in for %u frames\n",
+		       o->fallbacks);
+
+	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
+		if (o->src[i])
+			munmap(o->src[i], o->src_size);
+		if (o->dst[i])
+			munmap(o->dst[i], o->dst_size);
+	}
+	sw_compare_deinit(&o->cmp);
+}
+
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _ORACLE_H
+#define _ORACLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <nx-scaler.h>
+
+#include "scaler-test.h"
+#include "sw-scaler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* cpu views of src and dst for the software scaler (-Q option) */
+struct scaler_oracle {
+	struct sw_compare cmp;
+	int *src_fds;
+	int *dst_fds;
+	uint8_t *src[MAX_BUFFER_COUNT];
+	uint8_t *dst[MAX_BUFFER_COUNT];
+	size_t src_size;
+	size_t dst_size;
+	uint32_t fallbacks;	/* frames scaled on the cpu, scaler busy */
+};
+
+/* DMA_BUF_IOCTL_SYNC on fd, a no-op where the kernel headers lack it */
+void oracle_sync(int fd, uint64_t flags);
+int oracle_init(struct scaler_oracle *o, const char *arg, uint32_t f,
+	const struct nx_scaler_context *s_ctx, int *src_fds, size_t src_size,
+	int *dst_fds, size_t dst_size);
+void oracle_check(struct scaler_oracle *o, int index);
+int oracle_scale(struct scaler_oracle *o, int index);
+void oracle_deinit(struct scaler_oracle *o);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <dp.h>
+#include <nx-scaler.h>
+
+#include "path-plan.h"
+
+static uint64_t plan_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int plane_caps_query(struct plane_caps *c, const char *arg,
+		     struct dp_plane *plane, uint32_t format)
+{
+	int down, up, width = PLANE_MAX_WIDTH;
+	int n;
+
+	memset(c, 0, sizeof(*c));
+	c->max_down = 1;
+	c->max_up = 1;
+	c->max_width = PLANE_MAX_WIDTH;
+
+	if (!strcmp(arg, "off"))
+		return 0;
+
+	if (!strcmp(arg, "auto")) {
+		/* RGB layers show 1:1, the video layer scales */
+		if (!plane || !dp_plane_supports_format(plane, format))
+			return 0;
+		c->can_scale = true;
+		c->max_down = PLANE_MAX_DOWN;
+		c->max_up = PLANE_MAX_UP;
+		return 0;
+	}
+
+	n = sscanf(arg, "%d,%d,%d", &down, &up, &width);
+	if (n < 2 || down < 1 || up < 1 || width < 2) {
+		fprintf(stderr, "invalid plane caps %s\n", arg);
+		return -EINVAL;
+	}
+
+	c->can_scale = down > 1 || up > 1;
+	c->max_down = down;
+	c->max_up = up;
+	c->max_width = width;
+	return 0;
+}
+
+static uint64_t frame_bytes(uint32_t w, uint32_t h)
+{
+	return (uint64_t)w * h * 3 / 2;
+}
+
+/* a in b * max, without overflow for any 32 bit sizes */
+static bool within(uint32_t a, uint32_t b, uint32_t max)
+{
+	return (uint64_t)a <= (uint64_t)b * max;
+}
+
+static bool plane_can(const struct plane_caps *c, uint32_t src_w,
+		      uint32_t src_h, uint32_t out_w, uint32_t out_h)
+{
+	if (src_w > c->max_width)
+		return false;
+
+	return within(src_w, out_w, c->max_down) &&
+		within(src_h, out_h, c->max_down) &&
+		within(out_w, src_w, c->max_up) &&
+		within(out_h, src_h, c->max_up);
+}
+
+/* smallest even size the plane can blow up to out, at least from */
+static uint32_t mid_size(uint32_t out, uint32_t from, uint32_t max_up)
+{
+	uint32_t m = (out + max_up - 1) / max_up;
+
+	m = (m + 1) & ~1U;
+	return m > from ? m : from;
+}
+
+void path_plan_build(struct path_plan *p, const struct plane_caps *c,
+		     uint32_t w, uint32_t h, struct rect crop, uint32_t out_w,
+		     uint32_t out_h, uint32_t scaler_max_w,
+		     uint32_t scaler_max_h, bool src_layout_ok)
+{
+	uint32_t cw, ch;
+
+	memset(p, 0, sizeof(*p));
+
+	if (!crop.width || !crop.height) {
+		crop.x = 0;
+		crop.y = 0;
+		crop.width = w;
+		crop.height = h;
+	}
+	cw = crop.width;
+	ch = crop.height;
+
+	p->crop = crop;
+	p->out_width = out_w;
+	p->out_height = out_h;
+	p->mid_width = out_w;
+	p->mid_height = out_h;
+	/* scaler reads the crop and writes out, the plane reads out */
+	p->scaler_bytes = frame_bytes(cw, ch) + 2 * frame_bytes(out_w, out_h);
+	p->path = SCALE_PATH_SCALER;
+	p->plan_bytes = p->scaler_bytes;
+
+	/* a 1:1 crop is a source window, any plane does that */
+	if (cw == out_w && ch == out_h && cw <= c->max_width) {
+		if (src_layout_ok) {
+			p->path = SCALE_PATH_PLANE;
+			p->reason = "1:1, the plane crops";
+		} else {
+			p->reason = "capture layout does not suit the plane";
+		}
+	} else if (!c->can_scale) {
+		p->reason = "plane does not scale";
+	} else if (plane_can(c, cw, ch, out_w, out_h)) {
+		if (src_layout_ok) {
+			p->path = SCALE_PATH_PLANE;
+			p->reason = "within the plane limits";
+		} else {
+			p->reason = "capture layout does not suit the plane";
+		}
+	} else if (out_w > cw || out_h > ch) {
+		/* too much blow-up: the scaler does as little as it can */
+		uint32_t mw = mid_size(out_w, cw, c->max_up);
+		uint32_t mh = mid_size(out_h, ch, c->max_up);
+
+		if ((mw < out_w || mh < out_h) && mw <= scaler_max_w &&
+		    mh <= scaler_max_h &&
+		    plane_can(c, mw, mh, out_w, out_h)) {
+			p->path = SCALE_PATH_BOTH;
+			p->mid_width = mw;
+			p->mid_height = mh;
+			p->reason = "upscale beyond the plane, scaler does the rest";
+		} else {
+			p->reason = "upscale beyond plane and scaler split";
+		}
+	} else {
+		/*
+		 * an intermediate larger than out only adds traffic, the
+		 * scaler takes a downscale the plane can not do on its own
+		 */
+		p->reason = "downscale beyond the plane";
+	}
+
+	if (p->path == SCALE_PATH_PLANE)
+		p->plan_bytes = frame_bytes(cw, ch);
+	else if (p->path == SCALE_PATH_BOTH)
+		p->plan_bytes = frame_bytes(cw, ch) +
+			2 * frame_bytes(p->mid_width, p->mid_height);
+}
+
+const char *path_plan_name(const struct path_plan *p)
+{
+	switch (p->path) {
+	case SCALE_PATH_PLANE:
+		return "plane";
+	case SCALE_PATH_BOTH:
+		return "scaler+plane";
+	default:
+		return "scaler";
+	}
+}
+
+void path_plan_print(const struct path_plan *p)
+{
+	printf("path %s: %ux%u+%u+%u to %ux%u", path_plan_name(p),
+	       p->crop.width, p->crop.height, p->crop.x, p->crop.y,
+	       p->out_width, p->out_height);
+	if (p->path == SCALE_PATH_BOTH)
+		printf(" via %ux%u", p->mid_width, p->mid_height);
+	printf(" (%s), %llu of %llu bytes per frame\n", p->reason,
+	       (unsigned long long)p->plan_bytes,
+	       (unsigned long long)p->scaler_bytes);
+}
+
+void path_plan_frame(struct path_plan *p)
+{
+	p->last_us = plan_now_us();
+	if (!p->frames)
+		p->first_us = p->last_us;
+	p->frames++;
+}
+
+void path_plan_show(struct path_plan *p, struct dp_device *device,
+		    struct dp_framebuffer *fb, bool src)
+{
+	struct dp_plane *plane;
+
+	plane = dp_device_find_plane_by_index(device, 0, 0);
+	if (!plane) {
+		printf("no overlay plane found\n");
+		return;
+	}
+
+	if (src)
+		dp_plane_set(plane, fb, 0, 0, p->out_width, p->out_height,
+			     p->crop.x, p->crop.y, p->crop.width,
+			     p->crop.height);
+	else
+		dp_plane_set(plane, fb, 0, 0, p->out_width, p->out_height,
+			     0, 0, p->mid_width, p->mid_height);
+	path_plan_frame(p);
+}
+
+void path_plan_print_stats(struct path_plan *p)
+{
+	uint64_t span = p->last_us - p->first_us;
+	uint64_t saved = p->scaler_bytes - p->plan_bytes;
+
+	if (p->frames < 2 || !span)
+		return;
+
+	/* frames after the first over the time between them */
+	printf("path %s: %u frames at %llu fps, %llu MB/s instead of %llu "
+	       "MB/s through the scaler, saves %llu MB/s (%llu%%)\n",
+	       path_plan_name(p), p->frames,
+	       (unsigned long long)((p->frames - 1) * 1000000ULL / span),
+	       (unsigned long long)(p->plan_bytes * (p->frames - 1) / span),
+	       (unsigned long long)(p->scaler_bytes * (p->frames - 1) / span),
+	       (unsigned long long)(saved * (p->frames - 1) / span),
+	       (unsigned long long)(saved * 100 / p->scaler_bytes));
+}
@@ -0,0 +1,88 @@
+#ifndef _PATH_PLAN_H
+#define _PATH_PLAN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <dp.h>
+#include <nx-scaler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * KMS has no way to ask a plane how far it scales, these are the limits
+ * of the video layer, which is the plane that takes YUV. -B overrides
+ * them for other boards.
+ */
+#define PLANE_MAX_DOWN		2	/* source / shown */
+#define PLANE_MAX_UP		8	/* shown / source */
+#define PLANE_MAX_WIDTH		2048	/* source pixels per line */
+
+struct plane_caps {
+	bool can_scale;
+	uint32_t max_down;
+	uint32_t max_up;
+	uint32_t max_width;
+};
+
+enum scale_path {
+	SCALE_PATH_SCALER,	/* scaler to the shown size, plane 1:1 */
+	SCALE_PATH_PLANE,	/* capture buffer shown as is, no scaler */
+	SCALE_PATH_BOTH,	/* scaler part of the way, plane the rest */
+};
+
+struct path_plan {
+	enum scale_path path;
+	struct rect crop;
+	uint32_t out_width;	/* on screen */
+	uint32_t out_height;
+	uint32_t mid_width;	/* scaler output, SCALER and BOTH */
+	uint32_t mid_height;
+	const char *reason;
+
+	/* bytes per frame, YUV420 */
+	uint64_t scaler_bytes;	/* what SCALE_PATH_SCALER would move */
+	uint64_t plan_bytes;
+
+	uint32_t frames;
+	uint64_t first_us;
+	uint64_t last_us;
+};
+
+/*
+ * "auto" takes the limits above if the plane shows format, "off" keeps
+ * the plane at 1:1, "<max_down>,<max_up>[,<max_width>]" sets them
+ */
+int plane_caps_query(struct plane_caps *c, const char *arg,
+		     struct dp_plane *plane, uint32_t format);
+
+/*
+ * crop of a w x h capture shown at out_w x out_h. scaler_max_* are the
+ * largest scaler output, src_layout_ok says a capture buffer can be
+ * handed to the plane as it is.
+ */
+void path_plan_build(struct path_plan *p, const struct plane_caps *c,
+		     uint32_t w, uint32_t h, struct rect crop, uint32_t out_w,
+		     uint32_t out_h, uint32_t scaler_max_w,
+		     uint32_t scaler_max_h, bool src_layout_ok);
+const char *path_plan_name(const struct path_plan *p);
+void path_plan_print(const struct path_plan *p);
+
+/* one frame on screen */
+void path_plan_frame(struct path_plan *p);
+/*
+ * fb on the overlay plane the way p says: src is a capture buffer shown
+ * as is, otherwise the scaler output. Counts as path_plan_frame().
+ */
+void path_plan_show(struct path_plan *p, struct dp_device *device,
+		    struct dp_framebuffer *fb, bool src);
+/* traffic of the plan and of the scaler path at the measured rate */
+void path_plan_print_stats(struct path_plan *p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
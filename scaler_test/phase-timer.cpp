@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "phase-timer.h"
+
+#define WATERFALL_COLUMNS	48
+
+struct phase {
+	const char *name;
+	uint64_t start_ns;
+	uint64_t end_ns;
+	int tid;
+};
+
+static struct phase phases[MAX_PHASE_COUNT];
+static int phase_count;
+
+uint64_t phase_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int phase_begin(const char *name)
+{
+	int idx = __sync_fetch_and_add(&phase_count, 1);
+
+	if (idx >= MAX_PHASE_COUNT)
+		return -1;
+
+	phases[idx].name = name;
+	phases[idx].tid = (int)syscall(SYS_gettid);
+	phases[idx].end_ns = 0;
+	phases[idx].start_ns = phase_now_ns();
+
+	return idx;
+}
+
+void phase_end(int idx)
+{
+	if (idx < 0 || idx >= MAX_PHASE_COUNT)
+		return;
+
+	phases[idx].end_ns = phase_now_ns();
+}
+
+static int phase_used(void)
+{
+	return phase_count > MAX_PHASE_COUNT ? MAX_PHASE_COUNT : phase_count;
+}
+
+/* number of closed phases that strictly enclose phase idx */
+static int phase_depth(int idx, int count)
+{
+	int i, depth = 0;
+
+	for (i = 0; i < count; i++) {
+		if (i == idx || !phases[i].end_ns)
+			continue;
+		if (phases[i].start_ns <= phases[idx].start_ns &&
+		    phases[i].end_ns >= phases[idx].end_ns &&
+		    (phases[i].start_ns != phases[idx].start_ns ||
+		     phases[i].end_ns != phases[idx].end_ns || i < idx))
+			depth++;
+	}
+
+	return depth;
+}
+
+void phase_print_waterfall(void)
+{
+	int count = phase_used();
+	uint64_t origin = UINT64_MAX, last = 0, span;
+	int i, c;
+
+	for (i = 0; i < count; i++) {
+		if (!phases[i].end_ns)
+			continue;
+		if (phases[i].start_ns < origin)
+			origin = phases[i].start_ns;
+		if (phases[i].end_ns > last)
+			last = phases[i].end_ns;
+	}
+
+	if (last == 0) {
+		printf("no phases recorded\n");
+		return;
+	}
+
+	span = last - origin;
+	if (span == 0)
+		span = 1;
+
+	printf("\n%-24s %10s %10s  waterfall (total %.3f ms)\n",
+	       "phase", "start(ms)", "dur(ms)", span / 1000000.0);
+
+	for (i = 0; i < count; i++) {
+		struct phase *p = &phases[i];
+		int depth, from, to;
+		char label[25];
+
+		if (!p->end_ns)
+			continue;
+
+		depth = phase_depth(i, count);
+		snprintf(label, sizeof(label), "%*s%s", depth * 2, "", p->name);
+
+		from = (int)((p->start_ns - origin) * WATERFALL_COLUMNS / span);
+		to = (int)((p->end_ns - origin) * WATERFALL_COLUMNS / span);
+		if (to == from)
+			to = from + 1;
+
+		printf("%-24s %10.3f %10.3f  |", label,
+		       (p->start_ns - origin) / 1000000.0,
+		       (p->end_ns - p->start_ns) / 1000000.0);
+		for (c = 0; c < WATERFALL_COLUMNS; c++)
+			putchar(c >= from && c < to ? '#' : ' ');
+		printf("|\n");
+	}
+}
+
+/* chrome://tracing or Perfetto "complete" events, timestamps in us */
+int phase_write_trace(const char *path)
+{
+	int count = phase_used();
+	int pid = (int)getpid();
+	int i, first = 1;
+	FILE *fp;
+
+	fp = fopen(path, "w");
+	if (!fp) {
+		fprintf(stderr, "failed to open trace file %s\n", path);
+		return -1;
+	}
+
+	fprintf(fp, "{\"traceEvents\":[\n");
+	for (i = 0; i < count; i++) {
+		struct phase *p = &phases[i];
+
+		if (!p->end_ns)
+			continue;
+
+		fprintf(fp, "%s{\"name\":\"%s\",\"cat\":\"startup\","
+			"\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+			"\"pid\":%d,\"tid\":%d}",
+			first ? "" : ",\n", p->name,
+			p->start_ns / 1000.0,
+			(p->end_ns - p->start_ns) / 1000.0,
+			pid, p->tid);
+		first = 0;
+	}
+	fprintf(fp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	fclose(fp);
+
+	printf("phase trace written to %s\n", path);
+
+	return 0;
+}
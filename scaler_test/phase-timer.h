@@ -0,0 +1,26 @@
+#ifndef _PHASE_TIMER_H
+#define _PHASE_TIMER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_PHASE_COUNT		64
+
+/*
+ * Lightweight startup profiler. A phase is opened with phase_begin() and
+ * closed with phase_end(); timestamps are CLOCK_MONOTONIC nanoseconds.
+ */
+uint64_t phase_now_ns(void);
+int phase_begin(const char *name);
+void phase_end(int idx);
+void phase_print_waterfall(void);
+int phase_write_trace(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
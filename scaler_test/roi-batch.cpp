@@ -0,0 +1,342 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <nx-drm-allocator.h>
+#include <nx-scaler.h>
+
+#include "roi-batch.h"
+#include "tile-scale.h"
+
+static uint64_t roi_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int roi_parse_list(const char *p, struct roi_frame *fr)
+{
+	const char *line = p;
+
+	memset(fr, 0, sizeof(*fr));
+
+	while (*p && *p != '\n' && *p != '#') {
+		struct rect *r;
+		int x, y, rw, rh;
+		int n, used = 0;
+
+		if (fr->count == MAX_ROIS) {
+			fprintf(stderr, "too many ROIs (max %d)\n", MAX_ROIS);
+			return -EINVAL;
+		}
+
+		r = &fr->rects[fr->count];
+		n = sscanf(p, "%d,%d,%d,%d%n", &x, &y, &rw, &rh, &used);
+		if (n != 4 || x < 0 || y < 0 || rw <= 0 || rh <= 0) {
+			fprintf(stderr, "invalid ROI %s\n", p);
+			return -EINVAL;
+		}
+		r->x = x;
+		r->y = y;
+		r->width = rw;
+		r->height = rh;
+		p += used;
+		fr->count++;
+
+		if (*p == '/')
+			p++;
+		else if (*p && *p != '\n' && *p != '#') {
+			fprintf(stderr, "invalid ROI list %s\n", line);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static int roi_parse_file(const char *path, struct roi_batch *b)
+{
+	char line[1024];
+	FILE *fp;
+	int ret = 0;
+
+	fp = fopen(path, "r");
+	if (!fp) {
+		fprintf(stderr, "failed to open ROI file %s\n", path);
+		return -errno;
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		struct roi_frame *fr;
+
+		if (line[0] == '\n' || line[0] == '#')
+			continue;
+
+		if (b->list_count == MAX_ROI_FRAMES) {
+			fprintf(stderr, "too many ROI frames in %s (max %d)\n",
+				path, MAX_ROI_FRAMES);
+			ret = -EINVAL;
+			break;
+		}
+
+		fr = &b->lists[b->list_count];
+		ret = roi_parse_list(line, fr);
+		if (ret)
+			break;
+		/* a frame without ROIs is kept, it skips a source frame */
+		b->list_count++;
+	}
+
+	fclose(fp);
+	return ret;
+}
+
+int roi_batch_parse(const char *arg, struct roi_batch *b)
+{
+	int ret;
+	int i;
+
+	memset(b, 0, sizeof(*b));
+	for (i = 0; i < MAX_ROIS; i++) {
+		b->slots[i].gem_fd = -1;
+		b->slots[i].dma_fd = -1;
+	}
+
+	if (arg[0] == '@') {
+		ret = roi_parse_file(arg + 1, b);
+	} else {
+		ret = roi_parse_list(arg, &b->lists[0]);
+		b->list_count = 1;
+	}
+	if (ret)
+		return ret;
+
+	for (i = 0; i < b->list_count; i++)
+		if (b->lists[i].count > b->max_rois)
+			b->max_rois = b->lists[i].count;
+
+	if (!b->max_rois) {
+		fprintf(stderr, "no ROI in %s\n", arg);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int roi_batch_check_limit(const struct roi_batch *b, uint32_t out_w,
+			  uint32_t out_h, uint32_t max_w, uint32_t max_h)
+{
+	int i, j;
+
+	for (i = 0; i < b->list_count; i++) {
+		const struct roi_frame *fr = &b->lists[i];
+
+		for (j = 0; j < fr->count; j++) {
+			if (!tile_needed(fr->rects[j], out_w, out_h, max_w,
+					 max_h))
+				continue;
+
+			fprintf(stderr, "ROI %d of list %d to %ux%u is over "
+				"the %ux%u scaler limit, tiling can not be "
+				"combined with -O\n", j, i, out_w, out_h,
+				max_w, max_h);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+int roi_batch_init(struct roi_batch *b, int drm_fd, scale_build_t build,
+		   uint32_t w, uint32_t h, uint32_t code, uint32_t out_w,
+		   uint32_t out_h, size_t size)
+{
+	int i, j;
+
+	for (i = 0; i < b->list_count; i++) {
+		struct roi_frame *fr = &b->lists[i];
+
+		for (j = 0; j < fr->count; j++) {
+			struct rect *r = &fr->rects[j];
+
+			if ((uint32_t)(r->x + r->width) > w ||
+			    (uint32_t)(r->y + r->height) > h) {
+				fprintf(stderr, "ROI %d of list %d is outside "
+					"%ux%u\n", j, i, w, h);
+				return -EINVAL;
+			}
+		}
+	}
+
+	b->src_width = w;
+	b->src_height = h;
+	b->code = code;
+	b->out_width = out_w;
+	b->out_height = out_h;
+	b->size = size;
+	scale_cache_init(&b->cache, build);
+
+	/* slot 0 writes to the buffer of the caller */
+	for (i = 1; i < b->max_rois; i++) {
+		struct roi_slot *s = &b->slots[i];
+
+		s->gem_fd = alloc_gem(drm_fd, size, 0);
+		s->dma_fd = s->gem_fd < 0 ? -1 :
+			gem_to_dmafd(drm_fd, s->gem_fd);
+		if (s->dma_fd < 0) {
+			fprintf(stderr, "failed to alloc ROI buffer %d\n", i);
+			return -ENOMEM;
+		}
+	}
+
+	printf("ROIs: %d frame lists, up to %d ROIs per frame to %ux%u, "
+	       "%d pooled buffers of %zu bytes\n", b->list_count,
+	       b->max_rois, out_w, out_h, b->max_rois - 1, size);
+
+	return 0;
+}
+
+int roi_batch_run(struct roi_batch *b, int handle, int src_fd, int shown_fd)
+{
+	struct roi_frame *fr = &b->lists[b->next];
+	struct scale_job jobs[MAX_ROIS];
+	int slot[MAX_ROIS];
+	struct roi_slot *s;
+	uint64_t start = roi_now_us(), t;
+	int ret = 0;
+	int n = 0;
+	int i;
+
+	b->next = (b->next + 1) % b->list_count;
+
+	for (i = 0; i < fr->count; i++) {
+		s = &b->slots[i];
+		jobs[n].ctx = scale_cache_get(&b->cache, b->src_width,
+					      b->src_height, fr->rects[i],
+					      b->out_width, b->out_height,
+					      b->code);
+		if (!jobs[n].ctx) {
+			s->errors++;
+			ret = -1;
+			continue;
+		}
+		jobs[n].src_fd = src_fd;
+		jobs[n].dst_fd = i ? s->dma_fd : shown_fd;
+		slot[n++] = i;
+	}
+
+	if (scale_batch_run(handle, jobs, n))
+		ret = -1;
+
+	for (i = 0; i < n; i++) {
+		const struct rect *r = &fr->rects[slot[i]];
+		double mp = (double)r->width * r->height / 1000000.0;
+
+		s = &b->slots[slot[i]];
+		if (jobs[i].ret) {
+			fprintf(stderr, "failed to scale ROI %d %ux%u+%u+%u\n",
+				slot[i], r->width, r->height, r->x, r->y);
+			s->errors++;
+			continue;
+		}
+
+		s->total_us += jobs[i].us;
+		if (jobs[i].us > s->max_us)
+			s->max_us = jobs[i].us;
+		s->src_pixels += (uint64_t)r->width * r->height;
+		s->jobs++;
+
+		b->fit_n += 1;
+		b->fit_x += mp;
+		b->fit_y += jobs[i].us;
+		b->fit_xx += mp * mp;
+		b->fit_xy += mp * jobs[i].us;
+	}
+
+	t = roi_now_us() - start;
+	b->total_us += t;
+	if (t > b->max_us)
+		b->max_us = t;
+	b->frames++;
+
+	return ret;
+}
+
+void roi_batch_print_stats(struct roi_batch *b)
+{
+	double fixed, per_mp, det;
+	uint64_t total = 0;
+	uint32_t jobs = 0;
+	int i;
+
+	if (!b->frames)
+		return;
+
+	for (i = 0; i < b->max_rois; i++) {
+		struct roi_slot *s = &b->slots[i];
+
+		if (!s->jobs && !s->errors)
+			continue;
+
+		printf("ROI %d: %u jobs, %u errors, avg %llu us, max %llu us, "
+		       "avg source %llu px\n", i, s->jobs, s->errors,
+		       (unsigned long long)(s->jobs ? s->total_us / s->jobs : 0),
+		       (unsigned long long)s->max_us,
+		       (unsigned long long)(s->jobs ? s->src_pixels / s->jobs :
+					    0));
+		total += s->total_us;
+		jobs += s->jobs;
+	}
+
+	printf("ROIs: %u frames, %u jobs, avg %llu us per frame, max %llu us, "
+	       "avg %llu us per ROI, up to %llu ROIs/s\n", b->frames, jobs,
+	       (unsigned long long)(b->total_us / b->frames),
+	       (unsigned long long)b->max_us,
+	       (unsigned long long)(jobs ? total / jobs : 0),
+	       total ? (unsigned long long)(jobs * 1000000ULL / total) : 0ULL);
+
+	/* job cost = fixed + per_mp * source megapixels, least squares */
+	det = b->fit_n * b->fit_xx - b->fit_x * b->fit_x;
+	if (b->fit_n >= 2 && det > 1e-12) {
+		per_mp = (b->fit_n * b->fit_xy - b->fit_x * b->fit_y) / det;
+		fixed = (b->fit_y - per_mp * b->fit_x) / b->fit_n;
+		printf("ROI cost: %.1f us per job + %.1f us per source "
+		       "megapixel\n", fixed, per_mp);
+	}
+
+	scale_cache_print_stats(&b->cache);
+}
+
+void roi_batch_deinit(struct roi_batch *b)
+{
+	int i;
+
+	for (i = 0; i < MAX_ROIS; i++) {
+		if (b->slots[i].dma_fd >= 0)
+			close(b->slots[i].dma_fd);
+		if (b->slots[i].gem_fd >= 0)
+			close(b->slots[i].gem_fd);
+	}
+}
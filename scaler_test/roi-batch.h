@@ -0,0 +1,95 @@
+#ifndef _ROI_BATCH_H
+#define _ROI_BATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <nx-scaler.h>
+
+#include "scale-cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_ROIS		16	/* per source frame */
+#define MAX_ROI_FRAMES		64	/* lines of a ROI file, then it repeats */
+
+struct roi_frame {
+	int count;
+	struct rect rects[MAX_ROIS];
+};
+
+/* ROI slot i of every frame */
+struct roi_slot {
+	int gem_fd;
+	int dma_fd;
+
+	uint32_t jobs;
+	uint32_t errors;
+	uint64_t total_us;
+	uint64_t max_us;
+	uint64_t src_pixels;
+};
+
+/*
+ * ROI extraction (-O option): every source frame is cropped at a list of
+ * rectangles and each one is scaled to the same output size, as one batch
+ * on the scaler handle. Output i lands in a pooled buffer of slot i that
+ * is reused every frame, except for ROI 0 which goes to the buffer the
+ * caller passes, so it can be shown. Contexts come from the scale cache,
+ * ROIs that stay put cost a lookup only.
+ */
+struct roi_batch {
+	int list_count;
+	struct roi_frame lists[MAX_ROI_FRAMES];
+	int next;
+	int max_rois;		/* largest frame, slots that are pooled */
+
+	uint32_t src_width;
+	uint32_t src_height;
+	uint32_t code;
+	uint32_t out_width;
+	uint32_t out_height;
+	size_t size;
+	struct scale_cache cache;
+	struct roi_slot slots[MAX_ROIS];
+
+	uint32_t frames;
+	uint64_t total_us;	/* whole batch, per source frame */
+	uint64_t max_us;
+	/* cost against source size over all jobs, for a linear fit */
+	double fit_n;
+	double fit_x;
+	double fit_y;
+	double fit_xx;
+	double fit_xy;
+};
+
+/*
+ * "<x>,<y>,<w>,<h>[/<x>,<y>,<w>,<h>...]" for the same ROIs on every
+ * frame, or "@<file>" with one such list per line and frame; lines repeat
+ * once the file is used up, '#' starts a comment.
+ */
+int roi_batch_parse(const char *arg, struct roi_batch *b);
+/*
+ * -EINVAL if a ROI scaled to out_w x out_h is more than the scaler takes
+ * in one go (-G option), ROIs are never tiled
+ */
+int roi_batch_check_limit(const struct roi_batch *b, uint32_t out_w,
+			  uint32_t out_h, uint32_t max_w, uint32_t max_h);
+/* size is the allocation of one out_w x out_h buffer */
+int roi_batch_init(struct roi_batch *b, int drm_fd, scale_build_t build,
+		   uint32_t w, uint32_t h, uint32_t code, uint32_t out_w,
+		   uint32_t out_h, size_t size);
+/* ROIs of the next frame from src_fd; -1 if any of them failed */
+int roi_batch_run(struct roi_batch *b, int handle, int src_fd, int shown_fd);
+/* per slot cost, fixed and per megapixel cost of a job, ROIs per second */
+void roi_batch_print_stats(struct roi_batch *b);
+void roi_batch_deinit(struct roi_batch *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
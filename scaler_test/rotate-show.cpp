@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <linux/dma-buf.h>
+#include <drm/nexell_drm.h>
+#include <nx-drm-allocator.h>
+#include <nx-scaler.h>
+#include <dp.h>
+#include <dp_common.h>
+
+#include "frame-handoff.h"
+#include "oracle.h"
+#include "rotate-show.h"
+
+/* before the scaler dst buffers exist, the cpu path wants them cached */
+int rotate_probe(struct scaler_rotate *r, struct dp_device *device,
+	int drm_fd, const char *arg)
+{
+	uint64_t value;
+	int ret;
+	int i;
+
+	memset(r, 0, sizeof(*r));
+	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
+		r->gem_fds[i] = -1;
+		r->dma_fds[i] = -1;
+	}
+
+	ret = rotate_parse(arg, &r->op);
+	if (ret)
+		return ret;
+
+	r->device = device;
+	r->drm_fd = drm_fd;
+	r->plane = dp_device_find_plane_by_index(device, 0, 0);
+	if (!r->plane) {
+		printf("no overlay plane found\n");
+		return -ENODEV;
+	}
+
+	if (!r->op.sw_only &&
+	    !rotate_plane_probe(drm_fd, r->plane->id, &r->op, &r->prop_id,
+				&value))
+		r->hw = !rotate_plane_set(drm_fd, r->plane->id, r->prop_id,
+					  value);
+
+	printf("rotation %s on %s\n", arg,
+	       r->hw ? "the display plane" : rotate_simd_name());
+	return 0;
+}
+
+int rotate_setup(struct scaler_rotate *r, uint32_t f, uint32_t s_w,
+	uint32_t s_h, const uint32_t *stride, int *src_fds, size_t src_size)
+{
+	struct nx_scaler_context r_ctx;
+	struct rect full = { 0, };
+	int ret;
+	int i;
+
+	r->src_w = s_w;
+	r->src_h = s_h;
+	rotate_dims(&r->op, s_w, s_h, &r->w, &r->h);
+	if (r->hw)
+		return 0;
+
+	/* rotated buffers keep the stride rules of the scaler dst */
+	init_scale_context(r->w, r->h, r->w, r->h, 0, 1, full, &r_ctx);
+	ret = rotator_init(&r->rot, &r->op, f, s_w, s_h, stride,
+			   r_ctx.dst_stride);
+	if (ret)
+		return ret;
+
+	r->src_fds = src_fds;
+	r->src_size = src_size;
+	r->dst_size = calc_alloc_size(r->w, r->h, f);
+
+	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
+		void *map = mmap(NULL, src_size, PROT_READ, MAP_SHARED,
+				 src_fds[i], 0);
+
+		if (map == MAP_FAILED) {
+			fprintf(stderr, "failed to mmap buffer %d\n", i);
+			return -ENOMEM;
+		}
+		r->src[i] = (uint8_t *)map;
+
+		r->gem_fds[i] = alloc_gem(r->drm_fd, r->dst_size,
+					  NX_BO_CACHABLE);
+		r->dma_fds[i] = r->gem_fds[i] < 0 ? -1 :
+			gem_to_dmafd(r->drm_fd, r->gem_fds[i]);
+		if (r->dma_fds[i] < 0) {
+			fprintf(stderr, "failed to alloc rotation buffer %d\n",
+				i);
+			return -ENOMEM;
+		}
+
+		map = mmap(NULL, r->dst_size, PROT_READ | PROT_WRITE,
+			   MAP_SHARED, r->dma_fds[i], 0);
+		if (map == MAP_FAILED) {
+			fprintf(stderr, "failed to mmap rotation buffer %d\n",
+				i);
+			return -ENOMEM;
+		}
+		r->dst[i] = (uint8_t *)map;
+
+		r->fbs[i] = display_buffer_init(r->device, r->w, r->h,
+				r->gem_fds[i], static_cast<int>(r->dst_size));
+		if (!r->fbs[i]) {
+			printf("fail : framebuffer Init %m\n");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* instead of set_plane() for the scaled frame in fb / index */
+void rotate_show(struct scaler_rotate *r, struct dp_framebuffer *fb,
+	int index)
+{
+	uint64_t start = stage_now_us(), t;
+
+	if (r->hw) {
+		/* the plane reads src_w x src_h and covers w x h on screen */
+		dp_plane_set(r->plane, fb, 0, 0, r->w, r->h, 0, 0, r->src_w,
+			     r->src_h);
+	} else {
+		oracle_sync(r->src_fds[index],
+			    DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ);
+		oracle_sync(r->dma_fds[index],
+			    DMA_BUF_SYNC_START | DMA_BUF_SYNC_WRITE);
+		rotator_run(&r->rot, r->src[index], r->dst[index]);
+		oracle_sync(r->dma_fds[index],
+			    DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE);
+		oracle_sync(r->src_fds[index],
+			    DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ);
+		dp_plane_set(r->plane, r->fbs[index], 0, 0, r->w, r->h, 0, 0,
+			     r->w, r->h);
+	}
+
+	t = stage_now_us() - start;
+	r->show_us += t;
+	if (t > r->max_us)
+		r->max_us = t;
+	r->frames++;
+}
+
+void rotate_deinit(struct scaler_rotate *r)
+{
+	struct rotate_op none = { 0, };
+	uint64_t value;
+	int i;
+
+	if (r->frames)
+		printf("rotation on %s: %u frames, shown in avg %llu us, "
+		       "max %llu us\n",
+		       r->hw ? "the display plane" : rotate_simd_name(),
+		       r->frames, (unsigned long long)(r->show_us / r->frames),
+		       (unsigned long long)r->max_us);
+
+	if (r->hw) {
+		/* the plane keeps the property after we are gone */
+		if (!rotate_plane_probe(r->drm_fd, r->plane->id, &none,
+					&r->prop_id, &value))
+			rotate_plane_set(r->drm_fd, r->plane->id, r->prop_id,
+					 value);
+		return;
+	}
+
+	rotator_print_stats(&r->rot);
+
+	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
+		if (r->fbs[i]) {
+			dp_framebuffer_delfb2(r->fbs[i]);
+			dp_framebuffer_free(r->fbs[i]);
+		}
+		if (r->dst[i])
+			munmap(r->dst[i], r->dst_size);
+		if (r->src[i])
+			munmap(r->src[i], r->src_size);
+		if (r->dma_fds[i] >= 0)
+			close(r->dma_fds[i]);
+		if (r->gem_fds[i] >= 0)
+			close(r->gem_fds[i]);
+	}
+}
+
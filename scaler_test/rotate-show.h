@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _ROTATE_SHOW_H
+#define _ROTATE_SHOW_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <dp.h>
+
+#include "rotate.h"
+#include "scaler-test.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* what is shown, turned by the display plane or the cpu (-r option) */
+struct scaler_rotate {
+	struct rotate_op op;
+	struct dp_device *device;
+	struct dp_plane *plane;
+	int drm_fd;
+	bool hw;
+	uint32_t prop_id;
+	uint32_t src_w;
+	uint32_t src_h;
+	uint32_t w;		/* rotated size */
+	uint32_t h;
+
+	/* cpu path: scaler dst in, rotated copies out to the plane */
+	struct rotator rot;
+	int *src_fds;
+	uint8_t *src[MAX_BUFFER_COUNT];
+	size_t src_size;
+	int gem_fds[MAX_BUFFER_COUNT];
+	int dma_fds[MAX_BUFFER_COUNT];
+	uint8_t *dst[MAX_BUFFER_COUNT];
+	size_t dst_size;
+	struct dp_framebuffer *fbs[MAX_BUFFER_COUNT];
+
+	uint32_t frames;
+	uint64_t show_us;
+	uint64_t max_us;
+};
+
+int rotate_probe(struct scaler_rotate *r, struct dp_device *device,
+	int drm_fd, const char *arg);
+int rotate_setup(struct scaler_rotate *r, uint32_t f, uint32_t s_w,
+	uint32_t s_h, const uint32_t *stride, int *src_fds, size_t src_size);
+void rotate_show(struct scaler_rotate *r, struct dp_framebuffer *fb,
+	int index);
+void rotate_deinit(struct scaler_rotate *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,592 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <linux/videodev2.h>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+#include <drm/nexell_drm.h>
+
+#include "rotate.h"
+
+#ifndef ALIGN
+#define ALIGN(x, a) (((x) + (a) - 1) & ~((a) - 1))
+#endif
+
+#ifndef DRM_MODE_PROP_BITMASK
+#define DRM_MODE_PROP_BITMASK	(1 << 5)
+#endif
+
+static uint64_t rotate_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int rotate_parse(const char *arg, struct rotate_op *op)
+{
+	const char *p;
+	char *end;
+	long deg;
+
+	memset(op, 0, sizeof(*op));
+
+	deg = strtol(arg, &end, 10);
+	switch (deg) {
+	case 0:
+		op->degree = NX_DRM_DEGREE_0;
+		break;
+	case 90:
+		op->degree = NX_DRM_DEGREE_90;
+		break;
+	case 180:
+		op->degree = NX_DRM_DEGREE_180;
+		break;
+	case 270:
+		op->degree = NX_DRM_DEGREE_270;
+		break;
+	default:
+		end = (char *)arg;
+		break;
+	}
+	if (end == arg) {
+		fprintf(stderr, "invalid rotation %s\n", arg);
+		return -EINVAL;
+	}
+
+	for (p = end; *p == ','; ) {
+		p++;
+		if (!strncmp(p, "hv", 2)) {
+			op->flip = NX_DRM_FLIP_BOTH;
+			p += 2;
+		} else if (*p == 'h') {
+			op->flip = NX_DRM_FLIP_HORIZONTAL;
+			p++;
+		} else if (*p == 'v') {
+			op->flip = NX_DRM_FLIP_VERTICAL;
+			p++;
+		} else if (!strncmp(p, "sw", 2)) {
+			op->sw_only = true;
+			p += 2;
+		} else {
+			break;
+		}
+	}
+
+	if (*p) {
+		fprintf(stderr, "invalid rotation %s\n", arg);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+void rotate_dims(const struct rotate_op *op, uint32_t w, uint32_t h,
+		 uint32_t *r_w, uint32_t *r_h)
+{
+	bool swap = op->degree == NX_DRM_DEGREE_90 ||
+		op->degree == NX_DRM_DEGREE_270;
+
+	*r_w = swap ? h : w;
+	*r_h = swap ? w : h;
+}
+
+const char *rotate_simd_name(void)
+{
+#if defined(__aarch64__)
+	return "NEON";
+#elif defined(__SSE2__)
+	return "SSE2";
+#else
+	return "C";
+#endif
+}
+
+static void rotate_layout(struct rotate_plane *pl, uint32_t f, uint32_t w,
+			  uint32_t h, const uint32_t *stride)
+{
+	uint32_t y_size = stride[0] * ALIGN(h, 16);
+
+	pl[0].offset = 0;
+	pl[0].stride = stride[0];
+	pl[0].width = w;
+	pl[0].height = h;
+	pl[0].elem = 1;
+
+	if (f == V4L2_PIX_FMT_NV12) {
+		pl[1].offset = y_size;
+		pl[1].stride = stride[0];
+		pl[1].width = w >> 1;
+		pl[1].height = h >> 1;
+		pl[1].elem = 2;
+		return;
+	}
+
+	pl[1].offset = y_size;
+	pl[1].stride = stride[1];
+	pl[2].offset = y_size + stride[1] * ALIGN(h >> 1, 16);
+	pl[2].stride = stride[2];
+	for (int p = 1; p < 3; p++) {
+		pl[p].width = w >> 1;
+		pl[p].height = h >> 1;
+		pl[p].elem = 1;
+	}
+}
+
+int rotator_init(struct rotator *r, const struct rotate_op *op, uint32_t f,
+		 uint32_t w, uint32_t h, const uint32_t *src_stride,
+		 const uint32_t *dst_stride)
+{
+	uint32_t r_w, r_h;
+	bool mx = false, my = false;
+
+	memset(r, 0, sizeof(*r));
+
+	if (f != V4L2_PIX_FMT_YUV420 && f != V4L2_PIX_FMT_NV12) {
+		fprintf(stderr, "rotation supports I420 and NV12 only\n");
+		return -EINVAL;
+	}
+
+	/*
+	 * dst(x, y) = src(y', x') for a transpose, src(x', y') otherwise,
+	 * where x' and y' are x and y mirrored on the destination
+	 */
+	switch (op->degree) {
+	case NX_DRM_DEGREE_90:
+		r->swap = true;
+		mx = true;
+		break;
+	case NX_DRM_DEGREE_180:
+		mx = true;
+		my = true;
+		break;
+	case NX_DRM_DEGREE_270:
+		r->swap = true;
+		my = true;
+		break;
+	}
+	r->mirror_x = mx != !!(op->flip & NX_DRM_FLIP_HORIZONTAL);
+	r->mirror_y = my != !!(op->flip & NX_DRM_FLIP_VERTICAL);
+
+	rotate_dims(op, w, h, &r_w, &r_h);
+	r->format = f;
+	r->planes = f == V4L2_PIX_FMT_NV12 ? 2 : 3;
+	rotate_layout(r->src, f, w, h, src_stride);
+	rotate_layout(r->dst, f, r_w, r_h, dst_stride);
+
+	return 0;
+}
+
+/* one 8x8 tile, rows of s become columns of d; strides may be negative */
+#if defined(__aarch64__)
+static void transpose8(const uint8_t *s, ptrdiff_t ss, uint8_t *d,
+		       ptrdiff_t ds)
+{
+	uint8x8x2_t t0 = vtrn_u8(vld1_u8(s), vld1_u8(s + ss));
+	uint8x8x2_t t1 = vtrn_u8(vld1_u8(s + 2 * ss), vld1_u8(s + 3 * ss));
+	uint8x8x2_t t2 = vtrn_u8(vld1_u8(s + 4 * ss), vld1_u8(s + 5 * ss));
+	uint8x8x2_t t3 = vtrn_u8(vld1_u8(s + 6 * ss), vld1_u8(s + 7 * ss));
+	/* columns 0+4 and 2+6, then 1+5 and 3+7, of four rows each */
+	uint16x4x2_t u0 = vtrn_u16(vreinterpret_u16_u8(t0.val[0]),
+				   vreinterpret_u16_u8(t1.val[0]));
+	uint16x4x2_t u1 = vtrn_u16(vreinterpret_u16_u8(t0.val[1]),
+				   vreinterpret_u16_u8(t1.val[1]));
+	uint16x4x2_t u2 = vtrn_u16(vreinterpret_u16_u8(t2.val[0]),
+				   vreinterpret_u16_u8(t3.val[0]));
+	uint16x4x2_t u3 = vtrn_u16(vreinterpret_u16_u8(t2.val[1]),
+				   vreinterpret_u16_u8(t3.val[1]));
+	uint32x2x2_t v0 = vtrn_u32(vreinterpret_u32_u16(u0.val[0]),
+				   vreinterpret_u32_u16(u2.val[0]));
+	uint32x2x2_t v1 = vtrn_u32(vreinterpret_u32_u16(u1.val[0]),
+				   vreinterpret_u32_u16(u3.val[0]));
+	uint32x2x2_t v2 = vtrn_u32(vreinterpret_u32_u16(u0.val[1]),
+				   vreinterpret_u32_u16(u2.val[1]));
+	uint32x2x2_t v3 = vtrn_u32(vreinterpret_u32_u16(u1.val[1]),
+				   vreinterpret_u32_u16(u3.val[1]));
+
+	vst1_u8(d, vreinterpret_u8_u32(v0.val[0]));
+	vst1_u8(d + ds, vreinterpret_u8_u32(v1.val[0]));
+	vst1_u8(d + 2 * ds, vreinterpret_u8_u32(v2.val[0]));
+	vst1_u8(d + 3 * ds, vreinterpret_u8_u32(v3.val[0]));
+	vst1_u8(d + 4 * ds, vreinterpret_u8_u32(v0.val[1]));
+	vst1_u8(d + 5 * ds, vreinterpret_u8_u32(v1.val[1]));
+	vst1_u8(d + 6 * ds, vreinterpret_u8_u32(v2.val[1]));
+	vst1_u8(d + 7 * ds, vreinterpret_u8_u32(v3.val[1]));
+}
+
+static void transpose8x16(const uint8_t *s, ptrdiff_t ss, uint8_t *d,
+			  ptrdiff_t ds)
+{
+	uint16x8x2_t t0 = vtrnq_u16(vld1q_u16((const uint16_t *)s),
+			vld1q_u16((const uint16_t *)(s + ss)));
+	uint16x8x2_t t1 = vtrnq_u16(vld1q_u16((const uint16_t *)(s + 2 * ss)),
+			vld1q_u16((const uint16_t *)(s + 3 * ss)));
+	uint16x8x2_t t2 = vtrnq_u16(vld1q_u16((const uint16_t *)(s + 4 * ss)),
+			vld1q_u16((const uint16_t *)(s + 5 * ss)));
+	uint16x8x2_t t3 = vtrnq_u16(vld1q_u16((const uint16_t *)(s + 6 * ss)),
+			vld1q_u16((const uint16_t *)(s + 7 * ss)));
+	uint32x4x2_t u0 = vtrnq_u32(vreinterpretq_u32_u16(t0.val[0]),
+				    vreinterpretq_u32_u16(t1.val[0]));
+	uint32x4x2_t u1 = vtrnq_u32(vreinterpretq_u32_u16(t0.val[1]),
+				    vreinterpretq_u32_u16(t1.val[1]));
+	uint32x4x2_t u2 = vtrnq_u32(vreinterpretq_u32_u16(t2.val[0]),
+				    vreinterpretq_u32_u16(t3.val[0]));
+	uint32x4x2_t u3 = vtrnq_u32(vreinterpretq_u32_u16(t2.val[1]),
+				    vreinterpretq_u32_u16(t3.val[1]));
+	/* u0/u2: columns 0+4 and 2+6, u1/u3: 1+5 and 3+7 */
+	const uint32x4_t *lo[8] = {
+		&u0.val[0], &u1.val[0], &u0.val[1], &u1.val[1],
+		&u0.val[0], &u1.val[0], &u0.val[1], &u1.val[1],
+	};
+	const uint32x4_t *hi[8] = {
+		&u2.val[0], &u3.val[0], &u2.val[1], &u3.val[1],
+		&u2.val[0], &u3.val[0], &u2.val[1], &u3.val[1],
+	};
+
+	for (int j = 0; j < 4; j++)
+		vst1q_u32((uint32_t *)(d + j * ds),
+			  vcombine_u32(vget_low_u32(*lo[j]),
+				       vget_low_u32(*hi[j])));
+	for (int j = 4; j < 8; j++)
+		vst1q_u32((uint32_t *)(d + j * ds),
+			  vcombine_u32(vget_high_u32(*lo[j]),
+				       vget_high_u32(*hi[j])));
+}
+
+static void reverse16(const uint8_t *s, uint8_t *d, uint32_t elem)
+{
+	uint8x16_t v = vld1q_u8(s);
+
+	v = elem == 2 ? vreinterpretq_u8_u16(vrev64q_u16(
+				vreinterpretq_u16_u8(v))) : vrev64q_u8(v);
+	vst1q_u8(d, vcombine_u8(vget_high_u8(v), vget_low_u8(v)));
+}
+#elif defined(__SSE2__)
+static void transpose8(const uint8_t *s, ptrdiff_t ss, uint8_t *d,
+		       ptrdiff_t ds)
+{
+	__m128i a0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)s),
+			_mm_loadl_epi64((const __m128i *)(s + ss)));
+	__m128i a1 = _mm_unpacklo_epi8(
+			_mm_loadl_epi64((const __m128i *)(s + 2 * ss)),
+			_mm_loadl_epi64((const __m128i *)(s + 3 * ss)));
+	__m128i a2 = _mm_unpacklo_epi8(
+			_mm_loadl_epi64((const __m128i *)(s + 4 * ss)),
+			_mm_loadl_epi64((const __m128i *)(s + 5 * ss)));
+	__m128i a3 = _mm_unpacklo_epi8(
+			_mm_loadl_epi64((const __m128i *)(s + 6 * ss)),
+			_mm_loadl_epi64((const __m128i *)(s + 7 * ss)));
+	/* 32 bit lanes hold one column of four rows */
+	__m128i b0 = _mm_unpacklo_epi16(a0, a1);
+	__m128i b1 = _mm_unpackhi_epi16(a0, a1);
+	__m128i b2 = _mm_unpacklo_epi16(a2, a3);
+	__m128i b3 = _mm_unpackhi_epi16(a2, a3);
+	__m128i c[4];
+
+	c[0] = _mm_unpacklo_epi32(b0, b2);
+	c[1] = _mm_unpackhi_epi32(b0, b2);
+	c[2] = _mm_unpacklo_epi32(b1, b3);
+	c[3] = _mm_unpackhi_epi32(b1, b3);
+
+	for (int j = 0; j < 4; j++) {
+		_mm_storel_epi64((__m128i *)(d + 2 * j * ds), c[j]);
+		_mm_storel_epi64((__m128i *)(d + (2 * j + 1) * ds),
+				 _mm_unpackhi_epi64(c[j], c[j]));
+	}
+}
+
+static void transpose8x16(const uint8_t *s, ptrdiff_t ss, uint8_t *d,
+			  ptrdiff_t ds)
+{
+	__m128i r[8], a[8], b[8];
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r[i] = _mm_loadu_si128((const __m128i *)(s + i * ss));
+
+	for (i = 0; i < 4; i++) {
+		a[2 * i] = _mm_unpacklo_epi16(r[2 * i], r[2 * i + 1]);
+		a[2 * i + 1] = _mm_unpackhi_epi16(r[2 * i], r[2 * i + 1]);
+	}
+
+	/* pairs of columns, rows 0-3 in b[0..3], rows 4-7 in b[4..7] */
+	for (i = 0; i < 2; i++) {
+		b[4 * i] = _mm_unpacklo_epi32(a[4 * i], a[4 * i + 2]);
+		b[4 * i + 1] = _mm_unpackhi_epi32(a[4 * i], a[4 * i + 2]);
+		b[4 * i + 2] = _mm_unpacklo_epi32(a[4 * i + 1], a[4 * i + 3]);
+		b[4 * i + 3] = _mm_unpackhi_epi32(a[4 * i + 1], a[4 * i + 3]);
+	}
+
+	for (i = 0; i < 4; i++) {
+		_mm_storeu_si128((__m128i *)(d + 2 * i * ds),
+				 _mm_unpacklo_epi64(b[i], b[i + 4]));
+		_mm_storeu_si128((__m128i *)(d + (2 * i + 1) * ds),
+				 _mm_unpackhi_epi64(b[i], b[i + 4]));
+	}
+}
+
+static void reverse16(const uint8_t *s, uint8_t *d, uint32_t elem)
+{
+	__m128i v = _mm_loadu_si128((const __m128i *)s);
+
+	if (elem == 1)
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+	v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+	v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+	_mm_storeu_si128((__m128i *)d, _mm_shuffle_epi32(v,
+				_MM_SHUFFLE(1, 0, 3, 2)));
+}
+#else
+static void transpose8(const uint8_t *s, ptrdiff_t ss, uint8_t *d,
+		       ptrdiff_t ds)
+{
+	for (int i = 0; i < 8; i++)
+		for (int j = 0; j < 8; j++)
+			d[j * ds + i] = s[i * ss + j];
+}
+
+static void transpose8x16(const uint8_t *s, ptrdiff_t ss, uint8_t *d,
+			  ptrdiff_t ds)
+{
+	for (int i = 0; i < 8; i++)
+		for (int j = 0; j < 8; j++)
+			memcpy(d + j * ds + 2 * i, s + i * ss + 2 * j, 2);
+}
+#endif
+
+/* dst row from src row, elements in reverse order */
+static void reverse_row(const uint8_t *s, uint8_t *d, uint32_t n,
+			uint32_t elem)
+{
+	uint32_t i = 0;
+
+#if defined(__aarch64__) || defined(__SSE2__)
+	for (; (i + 16 / elem) <= n; i += 16 / elem)
+		reverse16(s + (n - i) * elem - 16, d + i * elem, elem);
+#endif
+	for (; i < n; i++)
+		memcpy(d + i * elem, s + (n - 1 - i) * elem, elem);
+}
+
+static void rotate_copy(const struct rotator *r, const struct rotate_plane *sp,
+			const struct rotate_plane *dp, const uint8_t *src,
+			uint8_t *dst)
+{
+	for (uint32_t y = 0; y < dp->height; y++) {
+		uint32_t sy = r->mirror_y ? dp->height - 1 - y : y;
+		const uint8_t *s = src + sp->offset + sy * sp->stride;
+		uint8_t *d = dst + dp->offset + y * dp->stride;
+
+		if (r->mirror_x)
+			reverse_row(s, d, dp->width, dp->elem);
+		else
+			memcpy(d, s, dp->width * dp->elem);
+	}
+}
+
+/* src of dst element (x, y) of a transpose */
+static const uint8_t *rotate_src_at(const struct rotator *r,
+				    const struct rotate_plane *sp,
+				    const struct rotate_plane *dp,
+				    const uint8_t *src, uint32_t x, uint32_t y)
+{
+	uint32_t sx = r->mirror_y ? dp->height - 1 - y : y;
+	uint32_t sy = r->mirror_x ? dp->width - 1 - x : x;
+
+	return src + sp->offset + sy * sp->stride + sx * sp->elem;
+}
+
+static void rotate_transpose(const struct rotator *r,
+			     const struct rotate_plane *sp,
+			     const struct rotate_plane *dp,
+			     const uint8_t *src, uint8_t *dst)
+{
+	uint32_t e = dp->elem;
+	/* mirrors walk the source rows, or the dst rows, backwards */
+	ptrdiff_t ss = r->mirror_x ? -(ptrdiff_t)sp->stride : sp->stride;
+	ptrdiff_t ds = r->mirror_y ? -(ptrdiff_t)dp->stride : dp->stride;
+	uint32_t bx, by, x, y;
+
+	for (by = 0; by < dp->height; by += ROTATE_BLOCK) {
+		uint32_t ey = by + ROTATE_BLOCK < dp->height ?
+			by + ROTATE_BLOCK : dp->height;
+
+		for (bx = 0; bx < dp->width; bx += ROTATE_BLOCK) {
+			uint32_t ex = bx + ROTATE_BLOCK < dp->width ?
+				bx + ROTATE_BLOCK : dp->width;
+
+			for (y = by; y + 8 <= ey; y += 8) {
+				/* dst row of the lowest source column */
+				uint32_t dy = r->mirror_y ? y + 7 : y;
+
+				for (x = bx; x + 8 <= ex; x += 8) {
+					const uint8_t *s = rotate_src_at(r, sp,
+						dp, src, x, dy);
+					uint8_t *d = dst + dp->offset +
+						dy * dp->stride + x * e;
+
+					if (e == 2)
+						transpose8x16(s, ss, d, ds);
+					else
+						transpose8(s, ss, d, ds);
+				}
+
+				for (; x < ex; x++)
+					for (uint32_t k = y; k < y + 8; k++)
+						memcpy(dst + dp->offset +
+						       k * dp->stride + x * e,
+						       rotate_src_at(r, sp, dp,
+							src, x, k), e);
+			}
+
+			for (; y < ey; y++)
+				for (x = bx; x < ex; x++)
+					memcpy(dst + dp->offset +
+					       y * dp->stride + x * e,
+					       rotate_src_at(r, sp, dp, src,
+							     x, y), e);
+		}
+	}
+}
+
+void rotator_run(struct rotator *r, const uint8_t *src, uint8_t *dst)
+{
+	uint64_t start = rotate_now_us(), t;
+
+	for (int p = 0; p < r->planes; p++) {
+		if (r->swap)
+			rotate_transpose(r, &r->src[p], &r->dst[p], src, dst);
+		else
+			rotate_copy(r, &r->src[p], &r->dst[p], src, dst);
+	}
+
+	t = rotate_now_us() - start;
+	r->total_us += t;
+	if (t > r->max_us)
+		r->max_us = t;
+	r->frames++;
+}
+
+void rotator_print_stats(struct rotator *r)
+{
+	uint64_t avg;
+	uint32_t bytes = 0;
+
+	if (!r->frames)
+		return;
+
+	for (int p = 0; p < r->planes; p++)
+		bytes += r->dst[p].width * r->dst[p].height * r->dst[p].elem;
+
+	avg = r->total_us / r->frames;
+	printf("rotation: %s, %u frames, avg %llu us, max %llu us, "
+	       "%llu MB/s\n", rotate_simd_name(), r->frames,
+	       (unsigned long long)avg, (unsigned long long)r->max_us,
+	       avg ? (unsigned long long)(bytes / avg) : 0ULL);
+}
+
+int rotate_plane_probe(int drm_fd, uint32_t plane_id,
+		       const struct rotate_op *op, uint32_t *prop_id,
+		       uint64_t *value)
+{
+	static const char * const names[] = {
+		"rotate-0", "rotate-90", "rotate-180", "rotate-270",
+	};
+	drmModeObjectPropertiesPtr props;
+	drmModePropertyPtr prop = NULL;
+	uint32_t degree = op->degree;
+	uint32_t flip = op->flip;
+	const char *want[3];
+	int count = 0, found = 0;
+	uint32_t i;
+	int j, k;
+
+	/* half a turn is both flips, so 180 with a flip is a flip */
+	if (degree == NX_DRM_DEGREE_180 && flip) {
+		degree = NX_DRM_DEGREE_0;
+		flip ^= NX_DRM_FLIP_BOTH;
+	}
+	if (flip && degree != NX_DRM_DEGREE_0)
+		return -ENOTSUP;
+
+	want[count++] = names[degree];
+	if (flip & NX_DRM_FLIP_HORIZONTAL)
+		want[count++] = "reflect-x";
+	if (flip & NX_DRM_FLIP_VERTICAL)
+		want[count++] = "reflect-y";
+
+	props = drmModeObjectGetProperties(drm_fd, plane_id,
+					   DRM_MODE_OBJECT_PLANE);
+	if (!props)
+		return -ENOTSUP;
+
+	for (i = 0; i < props->count_props && !prop; i++) {
+		prop = drmModeGetProperty(drm_fd, props->props[i]);
+		if (prop && strcmp(prop->name, "rotation")) {
+			drmModeFreeProperty(prop);
+			prop = NULL;
+		}
+	}
+	drmModeFreeObjectProperties(props);
+
+	if (!prop)
+		return -ENOTSUP;
+
+	/* a bitmask, enum values are bit numbers */
+	*value = 0;
+	if (prop->flags & DRM_MODE_PROP_BITMASK) {
+		for (k = 0; k < count; k++) {
+			for (j = 0; j < prop->count_enums; j++) {
+				if (!strcmp(prop->enums[j].name, want[k])) {
+					*value |= 1ULL << prop->enums[j].value;
+					found++;
+					break;
+				}
+			}
+		}
+	}
+	*prop_id = prop->prop_id;
+	drmModeFreeProperty(prop);
+
+	return found == count ? 0 : -ENOTSUP;
+}
+
+int rotate_plane_set(int drm_fd, uint32_t plane_id, uint32_t prop_id,
+		     uint64_t value)
+{
+	if (drmModeObjectSetProperty(drm_fd, plane_id, DRM_MODE_OBJECT_PLANE,
+				     prop_id, value)) {
+		fprintf(stderr, "failed to set plane rotation\n");
+		return -errno;
+	}
+
+	return 0;
+}
@@ -0,0 +1,88 @@
+#ifndef _ROTATE_H
+#define _ROTATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ROTATE_BLOCK		64	/* pixels per side of a cache block */
+
+/*
+ * NX_DRM_DEGREE_* clockwise, then NX_DRM_FLIP_* on the rotated picture.
+ * sw_only skips the display plane, to compare both paths on one board.
+ */
+struct rotate_op {
+	uint32_t degree;
+	uint32_t flip;
+	bool sw_only;
+};
+
+/* one plane, width and height in elements of elem bytes */
+struct rotate_plane {
+	uint32_t offset;
+	uint32_t stride;
+	uint32_t width;
+	uint32_t height;
+	uint32_t elem;		/* 2 for NV12 chroma pairs */
+};
+
+/*
+ * CPU rotation of I420 and NV12 buffers in the one fd layout of
+ * calc_alloc_size(). Every op is one pass: a transpose for 90 and 270
+ * degrees, a row copy for the rest, with the mirrors folded into where
+ * rows are read and written. Transposes walk ROTATE_BLOCK blocks so that
+ * source rows and destination lines stay in cache, inside a block 8x8
+ * tiles go through NEON or SSE2 registers.
+ */
+struct rotator {
+	uint32_t format;	/* V4L2_PIX_FMT_YUV420 or V4L2_PIX_FMT_NV12 */
+	int planes;
+	bool swap;		/* width and height trade places */
+	bool mirror_x;		/* on the destination */
+	bool mirror_y;
+	struct rotate_plane src[3];
+	struct rotate_plane dst[3];
+
+	uint32_t frames;
+	uint64_t total_us;
+	uint64_t max_us;
+};
+
+/* "<0|90|180|270>[,h|v|hv][,sw]", e.g. 90 or 180,h or 270,sw */
+int rotate_parse(const char *arg, struct rotate_op *op);
+/* size of the rotated picture */
+void rotate_dims(const struct rotate_op *op, uint32_t w, uint32_t h,
+		 uint32_t *r_w, uint32_t *r_h);
+/* "NEON", "SSE2" or "C" */
+const char *rotate_simd_name(void);
+
+/* strides as init_scale_context() sets them for w x h and r_w x r_h */
+int rotator_init(struct rotator *r, const struct rotate_op *op, uint32_t f,
+		 uint32_t w, uint32_t h, const uint32_t *src_stride,
+		 const uint32_t *dst_stride);
+/* src and dst are cpu mappings of the whole buffers */
+void rotator_run(struct rotator *r, const uint8_t *src, uint8_t *dst);
+void rotator_print_stats(struct rotator *r);
+
+/*
+ * Display plane rotation through the KMS "rotation" property. Only pure
+ * rotations and pure flips (180 with a flip is one) are handed to the
+ * plane, the order drivers apply a reflection in against a quarter turn
+ * is not reliable.
+ * -ENOTSUP if the plane can not do op.
+ */
+int rotate_plane_probe(int drm_fd, uint32_t plane_id,
+		       const struct rotate_op *op, uint32_t *prop_id,
+		       uint64_t *value);
+int rotate_plane_set(int drm_fd, uint32_t plane_id, uint32_t prop_id,
+		     uint64_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
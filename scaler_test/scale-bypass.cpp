@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <linux/videodev2.h>
+#include <libdrm/drm_fourcc.h>
+#include <nx-scaler.h>
+#include <dp.h>
+
+#include "scale-modes.h"
+
+/*
+ * -B: one plan for the whole run, made before anything is sized. The
+ * plane either takes the capture buffers as they are, or scales what the
+ * scaler brought to the plan's mid size.
+ */
+int scale_bypass(struct scaler_session *ss,
+	const struct scaler_options *o)
+{
+	struct nx_scaler_context l_ctx;
+	struct plane_caps caps;
+	struct path_plan plan;
+	struct dp_framebuffer *src_fbs[MAX_BUFFER_COUNT] = { NULL, };
+	bool layout_ok;
+	int shown = -1;
+	uint32_t n;
+	int index;
+	int ret;
+	int i;
+
+	ret = plane_caps_query(&caps, o->bypass,
+			dp_device_find_plane_by_index(ss->device, 0, 0),
+			DRM_FORMAT_YUV420);
+	if (ret)
+		return ret;
+
+	/* the plane takes a capture buffer laid out like a scaler dst */
+	init_scale_context(ss->w, ss->h, ss->w, ss->h, ss->bus_f, 1, ss->full,
+			   &l_ctx);
+	layout_ok = ss->f == V4L2_PIX_FMT_YUV420 &&
+		!memcmp(l_ctx.src_stride, l_ctx.dst_stride,
+			sizeof(l_ctx.src_stride));
+
+	path_plan_build(&plan, &caps, ss->w, ss->h, ss->full, ss->s_w,
+			ss->s_h, ss->max_w, ss->max_h, layout_ok);
+	path_plan_print(&plan);
+
+	ss->s_w = plan.mid_width;
+	ss->s_h = plan.mid_height;
+	if (plan.path != SCALE_PATH_PLANE)
+		return scale_frames(ss, o, &plan);
+
+	ret = session_open(ss, ss->s_w, ss->s_h, false, false);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
+		src_fbs[i] = display_buffer_init(ss->device, ss->w, ss->h,
+				ss->gem_fds[i],
+				static_cast<int>(ss->alloc_size));
+		if (!src_fbs[i]) {
+			printf("fail : framebuffer Init %m\n");
+			ret = -1;
+			goto out;
+		}
+	}
+
+	ret = session_start(ss);
+	if (ret)
+		goto out;
+
+	for (n = 0; n < ss->count; n++) {
+		ret = session_dqbuf(ss, &index, NULL);
+		if (ret)
+			break;
+
+		/* the plane scans the buffer until the next is shown */
+		path_plan_show(&plan, ss->device, src_fbs[index], true);
+
+		if (shown >= 0) {
+			ret = session_requeue(ss, shown);
+			if (ret)
+				break;
+		}
+		shown = index;
+	}
+
+	path_plan_print_stats(&plan);
+
+out:
+	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
+		if (src_fbs[i]) {
+			dp_framebuffer_delfb2(src_fbs[i]);
+			dp_framebuffer_free(src_fbs[i]);
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <nx-scaler.h>
+
+#include "scale-cache.h"
+
+static uint64_t cache_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void scale_cache_init(struct scale_cache *c, scale_build_t build)
+{
+	memset(c, 0, sizeof(*c));
+	c->build = build;
+}
+
+static bool scale_key_valid(const struct scale_key *k)
+{
+	if (!k->src_width || !k->src_height || !k->dst_width ||
+	    !k->dst_height || !k->crop.width || !k->crop.height)
+		return false;
+
+	return k->crop.x + k->crop.width <= k->src_width &&
+		k->crop.y + k->crop.height <= k->src_height;
+}
+
+struct nx_scaler_context *scale_cache_get(struct scale_cache *c,
+					  uint32_t w, uint32_t h,
+					  struct rect crop, uint32_t s_w,
+					  uint32_t s_h, uint32_t code)
+{
+	struct scale_cache_entry *e;
+	struct scale_key key;
+	int i;
+
+	if (!crop.width || !crop.height) {
+		crop.x = 0;
+		crop.y = 0;
+		crop.width = w;
+		crop.height = h;
+	}
+
+	/* no padding in the key, memcmp is safe */
+	key.src_width = w;
+	key.src_height = h;
+	key.crop = crop;
+	key.dst_width = s_w;
+	key.dst_height = s_h;
+	key.code = code;
+
+	c->clock++;
+	for (i = 0; i < c->count; i++) {
+		e = &c->entries[i];
+		if (!memcmp(&e->key, &key, sizeof(key))) {
+			e->hits++;
+			e->last_used = c->clock;
+			c->hits++;
+			return &e->ctx;
+		}
+	}
+
+	if (!scale_key_valid(&key)) {
+		fprintf(stderr, "invalid scale %ux%u (%ux%u+%u+%u) to %ux%u\n",
+			w, h, crop.width, crop.height, crop.x, crop.y, s_w,
+			s_h);
+		c->rejects++;
+		return NULL;
+	}
+
+	c->misses++;
+	if (c->count < MAX_SCALE_CACHE) {
+		e = &c->entries[c->count++];
+	} else {
+		e = &c->entries[0];
+		for (i = 1; i < c->count; i++)
+			if (c->entries[i].last_used < e->last_used)
+				e = &c->entries[i];
+		c->evictions++;
+	}
+
+	e->key = key;
+	e->hits = 0;
+	e->last_used = c->clock;
+	memset(&e->ctx, 0, sizeof(e->ctx));
+	c->build(w, h, s_w, s_h, code, 1, crop, &e->ctx);
+
+	return &e->ctx;
+}
+
+void scale_cache_print_stats(struct scale_cache *c)
+{
+	printf("scale cache: %d contexts, %u hits, %u misses, %u evictions, "
+	       "%u rejected\n", c->count, c->hits, c->misses, c->evictions,
+	       c->rejects);
+}
+
+int scale_batch_run(int handle, struct scale_job *jobs, int count)
+{
+	uint64_t t0, t1;
+	int failed = 0;
+	int i;
+
+	t0 = cache_now_us();
+	for (i = 0; i < count; i++) {
+		struct scale_job *j = &jobs[i];
+
+		j->ctx->src_fds[0] = j->src_fd;
+		j->ctx->dst_fds[0] = j->dst_fd;
+		j->ret = nx_scaler_run(handle, j->ctx) == -1 ?
+			(errno ? -errno : -EIO) : 0;
+
+		t1 = cache_now_us();
+		j->us = t1 - t0;
+		t0 = t1;
+
+		if (j->ret)
+			failed++;
+	}
+
+	return failed;
+}
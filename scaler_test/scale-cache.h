@@ -0,0 +1,82 @@
+#ifndef _SCALE_CACHE_H
+#define _SCALE_CACHE_H
+
+#include <stdint.h>
+
+#include <nx-scaler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_SCALE_CACHE		16
+
+/* init_scale_context() */
+typedef void (*scale_build_t)(uint32_t w, uint32_t h, uint32_t s_w,
+			      uint32_t s_h, uint32_t f, uint32_t plane_num,
+			      struct rect crop,
+			      struct nx_scaler_context *s_ctx);
+
+struct scale_key {
+	uint32_t src_width;
+	uint32_t src_height;
+	struct rect crop;	/* never empty, full frame is spelled out */
+	uint32_t dst_width;
+	uint32_t dst_height;
+	uint32_t code;
+};
+
+struct scale_cache_entry {
+	struct scale_key key;
+	struct nx_scaler_context ctx;
+	uint32_t hits;
+	uint32_t last_used;	/* cache clock, oldest is evicted */
+};
+
+/*
+ * Prepared scaler contexts by geometry, for streams that switch between
+ * a handful of crop/scale setups every frame. A hit is a short compare
+ * over at most MAX_SCALE_CACHE keys; only the fds of the returned
+ * context change per run. A context stays valid until MAX_SCALE_CACHE
+ * other geometries have been asked for.
+ */
+struct scale_cache {
+	scale_build_t build;
+	int count;
+	struct scale_cache_entry entries[MAX_SCALE_CACHE];
+	uint32_t clock;
+
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t evictions;
+	uint32_t rejects;	/* geometry the scaler can not do */
+};
+
+void scale_cache_init(struct scale_cache *c, scale_build_t build);
+/* empty crop is the whole source; NULL if the geometry is invalid */
+struct nx_scaler_context *scale_cache_get(struct scale_cache *c,
+					  uint32_t w, uint32_t h,
+					  struct rect crop, uint32_t s_w,
+					  uint32_t s_h, uint32_t code);
+void scale_cache_print_stats(struct scale_cache *c);
+
+struct scale_job {
+	struct nx_scaler_context *ctx;
+	int src_fd;
+	int dst_fd;
+
+	int ret;		/* 0 or -errno */
+	uint32_t us;
+};
+
+/*
+ * Runs count jobs back to back on handle, a failed job does not stop
+ * the rest. Returns how many failed.
+ */
+int scale_batch_run(int handle, struct scale_job *jobs, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <nx-scaler.h>
+#include <dp.h>
+
+#include "oracle.h"
+#include "rotate-show.h"
+#include "scale-modes.h"
+#include "tile-scale.h"
+
+/*
+ * One scale per frame in the capture loop, for what has to look at or
+ * change every frame there: -Q, -r, tiling, and -B when it scales. plan
+ * is the -B plan, shown through its out size.
+ */
+int scale_frames(struct scaler_session *ss,
+	const struct scaler_options *o, struct path_plan *plan)
+{
+	struct scaler_oracle orc;
+	struct tile_scaler ts;
+	struct scaler_rotate rt;
+	bool tiled = session_tiled(ss);
+	uint32_t n;
+	int index;
+	int ret;
+
+	if (o->rotate) {
+		ret = rotate_probe(&rt, ss->device, ss->drm_fd, o->rotate);
+		if (ret)
+			return ret;
+	}
+
+	ret = session_open(ss, ss->s_w, ss->s_h, o->oracle,
+			   o->rotate && !rt.hw);
+	if (ret)
+		goto out_rotate;
+
+	if (o->oracle) {
+		ret = oracle_init(&orc, o->oracle, ss->f, &ss->s_ctx,
+				  ss->dma_fds, ss->alloc_size,
+				  ss->dst_dma_fds, ss->dst_alloc_size);
+		if (ret)
+			goto out_oracle;
+	}
+
+	if (tiled) {
+		ret = tile_scaler_init(&ts, ss->drm_fd, init_scale_context,
+				       ss->w, ss->h, ss->full, ss->s_w,
+				       ss->s_h, ss->bus_f, ss->f, ss->max_w,
+				       ss->max_h, ss->dst_dma_fds,
+				       MAX_BUFFER_COUNT, ss->dst_alloc_size);
+		if (ret)
+			goto out_tiles;
+	}
+
+	if (o->rotate) {
+		ret = rotate_setup(&rt, ss->f, ss->s_w, ss->s_h,
+				   ss->s_ctx.dst_stride, ss->dst_dma_fds,
+				   ss->dst_alloc_size);
+		if (ret)
+			goto out_tiles;
+	}
+
+	ret = session_start(ss);
+	if (ret)
+		goto out_tiles;
+
+	for (n = 0; n < ss->count; n++) {
+		ret = session_dqbuf(ss, &index, NULL);
+		if (ret)
+			break;
+
+		ss->s_ctx.src_fds[0] = ss->dma_fds[index];
+		ss->s_ctx.dst_fds[0] = ss->dst_dma_fds[index];
+
+		if (tiled)
+			ret = tile_scaler_run(&ts, ss->handle,
+					      ss->dma_fds[index], index);
+		else
+			ret = nx_scaler_run(ss->handle, &ss->s_ctx);
+		if (ret == -1 && o->oracle && errno == EBUSY)
+			ret = oracle_scale(&orc, index);
+		else if (ret != -1 && o->oracle)
+			oracle_check(&orc, index);
+		if (ret == -1) {
+			fprintf(stderr, "failed to scaler set & run ioctl\n");
+			break;
+		}
+
+		printf("dq index : %d\n", index);
+
+		ret = session_requeue(ss, index);
+		if (ret)
+			break;
+		if (o->rotate)
+			rotate_show(&rt, ss->fbs[index], index);
+		else if (plan)
+			path_plan_show(plan, ss->device, ss->fbs[index], false);
+		else
+			set_plane(ss->device, ss->fbs[index], ss->s_w,
+				  ss->s_h);
+	}
+
+	if (tiled)
+		tile_scaler_print_stats(&ts);
+	if (plan)
+		path_plan_print_stats(plan);
+
+out_tiles:
+	if (tiled)
+		tile_scaler_deinit(&ts);
+out_oracle:
+	if (o->oracle)
+		oracle_deinit(&orc);
+out_rotate:
+	if (o->rotate)
+		rotate_deinit(&rt);
+
+	return ret;
+}
+
+int scale_plain(struct scaler_session *ss,
+	const struct scaler_options *o)
+{
+	return scale_frames(ss, o, NULL);
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include <nx-scaler.h>
+#include <dp.h>
+
+#include "frame-handoff.h"
+#include "scale-modes.h"
+
+/* scaler + display stage fed through a frame_handoff (-P option) */
+struct scaler_consumer {
+	struct frame_handoff handoff;
+	struct dp_device *device;
+	struct nx_scaler_context *s_ctx;
+	int handle;
+	int video_fd;
+	int *dma_fds;
+	int *dst_dma_fds;
+	struct dp_framebuffer **fbs;
+	size_t alloc_size;
+	uint32_t s_w;
+	uint32_t s_h;
+	struct crop_ctl *crop_ctl;
+	struct scaler_recover *rec;
+	int ret;
+};
+
+static int requeue_buffer(void *priv, int index)
+{
+	struct scaler_consumer *c = (struct scaler_consumer *)priv;
+
+	return recover_requeue(c->rec, index);
+}
+
+static void *scaler_consumer_thread(void *data)
+{
+	struct scaler_consumer *c = (struct scaler_consumer *)data;
+	int index;
+
+	while (!handoff_get(&c->handoff, &index, NULL)) {
+		if (c->crop_ctl)
+			crop_ctl_fetch(c->crop_ctl, &c->s_ctx->crop);
+
+		c->s_ctx->src_fds[0] = c->dma_fds[index];
+		c->s_ctx->dst_fds[0] = c->dst_dma_fds[index];
+
+		if (nx_scaler_run(c->handle, c->s_ctx) == -1) {
+			fprintf(stderr, "failed to scaler set & run ioctl\n");
+			c->ret = -1;
+		}
+
+		if (handoff_done(&c->handoff, index)) {
+			fprintf(stderr, "failed qbuf index %d\n", index);
+			c->ret = -1;
+		}
+
+		set_plane(c->device, c->fbs[index], c->s_w, c->s_h);
+	}
+
+	return NULL;
+}
+
+/* -P: the capture loop hands frames to a consumer thread */
+int scale_handoff(struct scaler_session *ss,
+	const struct scaler_options *o)
+{
+	struct scaler_consumer c;
+	enum handoff_policy policy;
+	uint32_t nth;
+	int depth;
+	pthread_t thread;
+	uint32_t n;
+	int index;
+	int ret;
+
+	ret = handoff_parse_policy(o->policy, &policy, &nth, &depth);
+	if (ret)
+		return ret;
+
+	/*
+	 * the consumer holds one frame on top of the queue, the driver
+	 * must keep at least two buffers to capture into
+	 */
+	if (depth > MAX_BUFFER_COUNT - 3) {
+		fprintf(stderr, "hand-off depth %d too deep for %d buffers\n",
+			depth, MAX_BUFFER_COUNT);
+		return -EINVAL;
+	}
+
+	ret = session_refuse_tiling(ss, 'P');
+	if (!ret)
+		ret = session_open(ss, ss->s_w, ss->s_h, false, false);
+	if (!ret)
+		ret = session_start(ss);
+	if (ret)
+		return ret;
+
+	c.device = ss->device;
+	c.s_ctx = &ss->s_ctx;
+	c.handle = ss->handle;
+	c.video_fd = ss->clipper_video_fd;
+	c.dma_fds = ss->dma_fds;
+	c.dst_dma_fds = ss->dst_dma_fds;
+	c.fbs = ss->fbs;
+	c.alloc_size = ss->alloc_size;
+	c.s_w = ss->s_w;
+	c.s_h = ss->s_h;
+	c.crop_ctl = ss->crop_ctl;
+	c.rec = &ss->rec;
+	c.ret = 0;
+
+	handoff_init(&c.handoff, policy, nth, depth, requeue_buffer, &c);
+
+	ret = pthread_create(&thread, NULL, scaler_consumer_thread, &c);
+	if (ret) {
+		fprintf(stderr, "failed to start consumer thread\n");
+		handoff_deinit(&c.handoff);
+		return -ret;
+	}
+
+	/* consumer runs decoupled, dropped frames are requeued at once */
+	for (n = 0; n < ss->count; n++) {
+		ret = session_dqbuf(ss, &index, NULL);
+		if (ret)
+			break;
+
+		handoff_put(&c.handoff, index, NULL);
+	}
+
+	handoff_close(&c.handoff);
+	pthread_join(thread, NULL);
+	handoff_print_stats(&c.handoff);
+	handoff_deinit(&c.handoff);
+	if (c.ret)
+		ret = c.ret;
+
+	return ret;
+}
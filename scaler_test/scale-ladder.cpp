@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <nx-drm-allocator.h>
+#include <dp.h>
+
+#include "fanout.h"
+#include "scale-modes.h"
+
+/* -L: rung 0 is the displayed stream, its ring is the displayed buffers */
+struct ladder_display {
+	struct dp_device *device;
+	struct dp_framebuffer **fbs;
+	uint32_t d_w;
+	uint32_t d_h;
+};
+
+static void ladder_show(void *priv, int rung, int index)
+{
+	struct ladder_display *ld = (struct ladder_display *)priv;
+
+	set_plane(ld->device, ld->fbs[index], ld->d_w, ld->d_h);
+}
+
+/* -L: every rung is scaled in the capture loop, one after another */
+int scale_ladder(struct scaler_session *ss,
+	const struct scaler_options *o)
+{
+	struct fanout fo;
+	struct ladder_display ld;
+	int gem_fds[MAX_FANOUT_RUNGS][FANOUT_RING_SIZE];
+	int dma_fds[MAX_FANOUT_RUNGS][FANOUT_RING_SIZE];
+	uint32_t n;
+	int index;
+	int ret;
+	int r, i;
+
+	ret = fanout_parse(o->ladder, &fo);
+	if (ret)
+		return ret;
+
+	/* the first rung is the one on screen */
+	ss->s_w = fo.rungs[0].width;
+	ss->s_h = fo.rungs[0].height;
+
+	ret = session_refuse_tiling(ss, 'L');
+	if (!ret)
+		ret = session_open(ss, ss->s_w, ss->s_h, false, false);
+	if (ret)
+		return ret;
+
+	/* rung 0 rotates through the displayed buffers */
+	for (i = 0; i < FANOUT_RING_SIZE; i++)
+		fo.rungs[0].dst_dma_fds[i] = ss->dst_dma_fds[i];
+
+	memset(gem_fds, -1, sizeof(gem_fds));
+	memset(dma_fds, -1, sizeof(dma_fds));
+	for (r = 1; r < fo.count; r++) {
+		size_t size = calc_alloc_size(fo.rungs[r].width,
+					      fo.rungs[r].height, ss->f);
+
+		for (i = 0; i < FANOUT_RING_SIZE; i++) {
+			gem_fds[r][i] = alloc_gem(ss->drm_fd, size, 0);
+			if (gem_fds[r][i] < 0) {
+				fprintf(stderr, "failed to alloc_gem\n");
+				ret = -1;
+				goto out;
+			}
+
+			dma_fds[r][i] = gem_to_dmafd(ss->drm_fd,
+						     gem_fds[r][i]);
+			if (dma_fds[r][i] < 0) {
+				fprintf(stderr, "failed to gem_to_dmafd\n");
+				ret = -1;
+				goto out;
+			}
+			fo.rungs[r].dst_dma_fds[i] = dma_fds[r][i];
+		}
+	}
+
+	fanout_setup(&fo, init_scale_context, ss->w, ss->h, ss->bus_f);
+
+	ld.device = ss->device;
+	ld.fbs = ss->fbs;
+	ld.d_w = ss->s_w;
+	ld.d_h = ss->s_h;
+	fanout_set_consumer(&fo, 0, ladder_show, &ld);
+
+	ret = session_start(ss);
+	if (ret)
+		goto out;
+
+	for (n = 0; n < ss->count; n++) {
+		ret = session_dqbuf(ss, &index, NULL);
+		if (ret)
+			break;
+
+		/* a new window takes effect from this frame on */
+		if (ss->crop_ctl)
+			crop_ctl_fetch(ss->crop_ctl, &ss->s_ctx.crop);
+
+		/* a failed rung is counted, the others still run */
+		fanout_run(&fo, ss->handle, ss->dma_fds[index],
+			   ss->s_ctx.crop);
+
+		ret = session_requeue(ss, index);
+		if (ret)
+			break;
+	}
+
+	fanout_print_stats(&fo);
+
+out:
+	for (r = 0; r < MAX_FANOUT_RUNGS; r++) {
+		for (i = 0; i < FANOUT_RING_SIZE; i++) {
+			if (dma_fds[r][i] >= 0)
+				close(dma_fds[r][i]);
+			if (gem_fds[r][i] >= 0)
+				close(gem_fds[r][i]);
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _SCALE_MODES_H
+#define _SCALE_MODES_H
+
+#include "option.h"
+#include "path-plan.h"
+#include "session.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * What scaler_test() runs once the session is set up, one per mode
+ * option. Each opens and starts the session itself, scaler_test() closes
+ * it.
+ */
+int scale_handoff(struct scaler_session *ss, const struct scaler_options *o);
+int scale_pipeline(struct scaler_session *ss, const struct scaler_options *o);
+int scale_ladder(struct scaler_session *ss, const struct scaler_options *o);
+int scale_rois(struct scaler_session *ss, const struct scaler_options *o);
+int scale_reconfig(struct scaler_session *ss, const struct scaler_options *o);
+/* plan is the -B plan when it goes through the scaler, NULL otherwise */
+int scale_frames(struct scaler_session *ss, const struct scaler_options *o,
+	struct path_plan *plan);
+int scale_plain(struct scaler_session *ss, const struct scaler_options *o);
+int scale_bypass(struct scaler_session *ss, const struct scaler_options *o);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <nx-scaler.h>
+#include <dp.h>
+
+#include "frame-handoff.h"
+#include "scale-modes.h"
+
+/*
+ * Default mode: capture, scale and display each run on their own thread
+ * so the three latencies overlap. Capture buffers (src ring) go back to
+ * the driver as soon as they are scaled, scaler outputs (dst ring) are
+ * recycled once the next one is on screen.
+ */
+enum {
+	STAGE_CAPTURE,
+	STAGE_SCALE,
+	STAGE_DISPLAY,
+	STAGE_COUNT,
+};
+
+struct scaler_pipeline {
+	struct frame_handoff to_scale;		/* captured src indexes */
+	struct frame_handoff to_display;	/* scaled dst indexes */
+	struct frame_handoff dst_free;		/* dst buffers off screen */
+	struct stage_stats stats[STAGE_COUNT];
+
+	struct dp_device *device;
+	struct nx_scaler_context *s_ctx;
+	int handle;
+	int video_fd;
+	int *dma_fds;
+	int *dst_dma_fds;
+	struct dp_framebuffer **fbs;
+	size_t alloc_size;
+	uint32_t d_w;
+	uint32_t d_h;
+	struct crop_ctl *crop_ctl;
+	struct scaler_recover *rec;
+
+	pthread_t scale_thread;
+	pthread_t display_thread;
+	uint64_t start_us;
+	int ret;
+};
+
+static int pipeline_requeue(struct scaler_pipeline *p, int index)
+{
+	return recover_requeue(p->rec, index);
+}
+
+static void *scale_stage_thread(void *data)
+{
+	struct scaler_pipeline *p = (struct scaler_pipeline *)data;
+	struct stage_stats *st = &p->stats[STAGE_SCALE];
+	uint64_t start;
+	int src, dst;
+
+	while (!handoff_get(&p->to_scale, &src, &st->starved_us)) {
+		/* no free dst: the display stage is behind */
+		if (handoff_get(&p->dst_free, &dst, &st->blocked_us)) {
+			pipeline_requeue(p, src);
+			break;
+		}
+
+		start = stage_now_us();
+		if (p->crop_ctl)
+			crop_ctl_fetch(p->crop_ctl, &p->s_ctx->crop);
+
+		p->s_ctx->src_fds[0] = p->dma_fds[src];
+		p->s_ctx->dst_fds[0] = p->dst_dma_fds[dst];
+
+		if (nx_scaler_run(p->handle, p->s_ctx) == -1) {
+			fprintf(stderr, "failed to scaler set & run ioctl\n");
+			p->ret = -1;
+		}
+
+		if (pipeline_requeue(p, src)) {
+			fprintf(stderr, "failed qbuf index %d\n", src);
+			p->ret = -1;
+		}
+		st->work_us += stage_now_us() - start;
+		st->frames++;
+
+		if (handoff_put(&p->to_display, dst, &st->blocked_us))
+			break;
+	}
+
+	handoff_close(&p->to_display);
+	return NULL;
+}
+
+static void *display_stage_thread(void *data)
+{
+	struct scaler_pipeline *p = (struct scaler_pipeline *)data;
+	struct stage_stats *st = &p->stats[STAGE_DISPLAY];
+	uint64_t start;
+	int dst, shown = -1;
+
+	while (!handoff_get(&p->to_display, &dst, &st->starved_us)) {
+		start = stage_now_us();
+		set_plane(p->device, p->fbs[dst], p->d_w, p->d_h);
+		st->work_us += stage_now_us() - start;
+		st->frames++;
+
+		/* the previous frame is off screen now */
+		if (shown >= 0)
+			handoff_put(&p->dst_free, shown, &st->blocked_us);
+		shown = dst;
+	}
+
+	return NULL;
+}
+
+static int pipeline_start(struct scaler_pipeline *p)
+{
+	int ret, i;
+
+	/*
+	 * the scale stage holds one src buffer on top of the queue, so the
+	 * driver keeps at least two to capture into while the capture loop
+	 * waits for the sensor
+	 */
+	ret = handoff_init(&p->to_scale, HANDOFF_BLOCK, 1,
+			   MAX_BUFFER_COUNT - 3, NULL, NULL);
+	if (!ret)
+		ret = handoff_init(&p->to_display, HANDOFF_BLOCK, 1,
+				   MAX_BUFFER_COUNT, NULL, NULL);
+	if (!ret)
+		ret = handoff_init(&p->dst_free, HANDOFF_BLOCK, 1,
+				   MAX_BUFFER_COUNT, NULL, NULL);
+	if (ret)
+		return ret;
+
+	memset(p->stats, 0, sizeof(p->stats));
+	for (i = 0; i < MAX_BUFFER_COUNT; i++)
+		handoff_put(&p->dst_free, i, NULL);
+
+	p->stats[STAGE_CAPTURE].name = "capture";
+	p->stats[STAGE_SCALE].name = "scale";
+	p->stats[STAGE_DISPLAY].name = "display";
+	p->ret = 0;
+	p->start_us = stage_now_us();
+
+	ret = pthread_create(&p->scale_thread, NULL, scale_stage_thread, p);
+	if (ret) {
+		fprintf(stderr, "failed to start scale thread\n");
+		return -ret;
+	}
+
+	ret = pthread_create(&p->display_thread, NULL, display_stage_thread,
+			     p);
+	if (ret) {
+		fprintf(stderr, "failed to start display thread\n");
+		handoff_close(&p->to_scale);
+		pthread_join(p->scale_thread, NULL);
+		return -ret;
+	}
+
+	return 0;
+}
+
+/* drains both stages, the last frame stays on screen */
+static int pipeline_stop(struct scaler_pipeline *p)
+{
+	handoff_close(&p->to_scale);
+	pthread_join(p->scale_thread, NULL);
+	pthread_join(p->display_thread, NULL);
+
+	stage_print_stats(p->stats, STAGE_COUNT,
+			  stage_now_us() - p->start_us);
+
+	handoff_deinit(&p->dst_free);
+	handoff_deinit(&p->to_display);
+	handoff_deinit(&p->to_scale);
+
+	return p->ret;
+}
+
+/* default: capture, scale and display on a thread each */
+int scale_pipeline(struct scaler_session *ss,
+	const struct scaler_options *o)
+{
+	struct scaler_pipeline p;
+	struct stage_stats *cap = &p.stats[STAGE_CAPTURE];
+	uint32_t n;
+	int index;
+	int ret, err;
+
+	ret = session_open(ss, ss->s_w, ss->s_h, false, false);
+	if (!ret)
+		ret = session_start(ss);
+	if (ret)
+		return ret;
+
+	p.device = ss->device;
+	p.s_ctx = &ss->s_ctx;
+	p.handle = ss->handle;
+	p.video_fd = ss->clipper_video_fd;
+	p.dma_fds = ss->dma_fds;
+	p.dst_dma_fds = ss->dst_dma_fds;
+	p.fbs = ss->fbs;
+	p.alloc_size = ss->alloc_size;
+	p.d_w = ss->s_w;
+	p.d_h = ss->s_h;
+	p.crop_ctl = ss->crop_ctl;
+	p.rec = &ss->rec;
+
+	ret = pipeline_start(&p);
+	if (ret)
+		return ret;
+
+	for (n = 0; n < ss->count; n++) {
+		uint64_t start = stage_now_us(), starved = 0;
+
+		ret = session_dqbuf(ss, &index, &starved);
+		if (ret)
+			break;
+
+		/* time spent waiting for the sensor */
+		cap->starved_us += starved;
+		cap->work_us += stage_now_us() - start - starved;
+		cap->frames++;
+		if (handoff_put(&p.to_scale, index, &cap->blocked_us))
+			break;
+	}
+
+	err = pipeline_stop(&p);
+	if (err)
+		ret = err;
+
+	return ret;
+}
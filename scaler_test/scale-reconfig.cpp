@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <nx-v4l2.h>
+#include <nx-scaler.h>
+#include <dp.h>
+
+#include "reconfig.h"
+#include "scale-modes.h"
+
+/* live profile switching (-Z option), buffers are never reallocated */
+struct scaler_reconfig {
+	struct dp_device *device;
+	struct rect *clip;
+	int clipper_subdev_fd;
+	int clipper_video_fd;
+	uint32_t f;
+	uint32_t code;
+	struct nx_scaler_context *s_ctx;
+	int *dst_gem_fds;
+	struct dp_framebuffer **fbs;
+	size_t dst_alloc_size;
+	uint32_t def_w;
+	uint32_t def_h;
+	uint32_t d_w;
+	uint32_t d_h;
+};
+
+/* capture window: clipper crop plus the matching video format */
+static int apply_capture_profile(void *priv, const struct reconfig_profile *p)
+{
+	struct scaler_reconfig *r = (struct scaler_reconfig *)priv;
+	int ret;
+
+	ret = nx_v4l2_set_crop(r->clipper_subdev_fd, nx_clipper_subdev, p->x,
+			       p->y, p->width, p->height);
+	if (ret)
+		return ret;
+
+	r->clip->x = p->x;
+	r->clip->y = p->y;
+	r->clip->width = p->width;
+	r->clip->height = p->height;
+
+	return nx_v4l2_set_format(r->clipper_video_fd, nx_clipper_video,
+				  p->width, p->height, r->f);
+}
+
+/* new scaler context and display framebuffers on the same dst buffers */
+static int apply_scaler_profile(struct scaler_reconfig *r,
+				const struct reconfig_profile *p)
+{
+	struct rect crop;
+	int i;
+
+	r->d_w = p->scale_width ? p->scale_width : r->def_w;
+	r->d_h = p->scale_width ? p->scale_height : r->def_h;
+
+	crop.x = 0;
+	crop.y = 0;
+	crop.width = p->width;
+	crop.height = p->height;
+	init_scale_context(p->width, p->height, r->d_w, r->d_h, r->code, 1,
+			   crop, r->s_ctx);
+
+	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
+		if (r->fbs[i]) {
+			dp_framebuffer_delfb2(r->fbs[i]);
+			dp_framebuffer_free(r->fbs[i]);
+		}
+		r->fbs[i] = display_buffer_init(r->device, r->d_w, r->d_h,
+				r->dst_gem_fds[i],
+				static_cast<int>(r->dst_alloc_size));
+		if (!r->fbs[i]) {
+			fprintf(stderr, "failed to create %ux%u framebuffer\n",
+				r->d_w, r->d_h);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* -Z: the stream is stopped and reconfigured between profiles */
+int scale_reconfig(struct scaler_session *ss,
+	const struct scaler_options *o)
+{
+	struct reconfig_list profiles;
+	struct scaler_reconfig rc;
+	const struct reconfig_profile *next;
+	uint32_t d_w = ss->s_w, d_h = ss->s_h;
+	uint32_t n;
+	int index;
+	int ret;
+	int i;
+
+	ret = reconfig_parse(o->reconfig, &profiles);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < profiles.count; i++) {
+		struct reconfig_profile *p = &profiles.profiles[i];
+
+		if (p->x + p->width > (int)ss->w ||
+		    p->y + p->height > (int)ss->h) {
+			fprintf(stderr, "profile %d is outside %ux%u\n",
+				i, ss->w, ss->h);
+			return -EINVAL;
+		}
+
+		/* dst buffers are sized for the largest output */
+		if (p->scale_width > 0 &&
+		    calc_alloc_size(p->scale_width, p->scale_height, ss->f) >
+		    calc_alloc_size(d_w, d_h, ss->f)) {
+			d_w = p->scale_width;
+			d_h = p->scale_height;
+		}
+	}
+
+	ret = session_refuse_tiling(ss, 'Z');
+	if (!ret)
+		ret = session_open(ss, d_w, d_h, false, false);
+	if (ret)
+		return ret;
+
+	rc.device = ss->device;
+	rc.clip = &ss->rec.clip;
+	rc.clipper_subdev_fd = ss->clipper_subdev_fd;
+	rc.clipper_video_fd = ss->clipper_video_fd;
+	rc.f = ss->f;
+	rc.code = ss->bus_f;
+	rc.s_ctx = &ss->s_ctx;
+	rc.dst_gem_fds = ss->dst_gem_fds;
+	rc.fbs = ss->fbs;
+	rc.dst_alloc_size = ss->dst_alloc_size;
+	rc.def_w = ss->s_w;
+	rc.def_h = ss->s_h;
+
+	/* stream is still off, profile 0 goes straight in */
+	ret = apply_capture_profile(&rc, &profiles.profiles[0]);
+	if (!ret)
+		ret = apply_scaler_profile(&rc, &profiles.profiles[0]);
+	if (ret) {
+		fprintf(stderr, "failed to apply first profile\n");
+		return ret;
+	}
+
+	ret = session_start(ss);
+	if (ret)
+		return ret;
+
+	for (n = 0; n < ss->count; n++) {
+		ret = session_dqbuf(ss, &index, NULL);
+		if (ret)
+			break;
+
+		ss->s_ctx.src_fds[0] = ss->dma_fds[index];
+		ss->s_ctx.dst_fds[0] = ss->dst_dma_fds[index];
+		ret = nx_scaler_run(ss->handle, &ss->s_ctx);
+		if (ret == -1) {
+			fprintf(stderr, "failed to scaler set & run ioctl\n");
+			break;
+		}
+
+		printf("dq index : %d\n", index);
+
+		next = reconfig_next(&profiles, n + 1);
+		if (next) {
+			/* requeues every buffer, index included */
+			ret = reconfig_stream(ss->clipper_video_fd,
+					      nx_clipper_video, ss->dma_fds,
+					      MAX_BUFFER_COUNT, ss->alloc_size,
+					      apply_capture_profile, &rc, next);
+			if (!ret)
+				ret = apply_scaler_profile(&rc, next);
+			if (ret)
+				break;
+			__atomic_fetch_and(&ss->rec.owned, ~(1U << index),
+					   __ATOMIC_RELEASE);
+			continue;
+		}
+
+		ret = session_requeue(ss, index);
+		if (ret)
+			break;
+		set_plane(ss->device, ss->fbs[index], rc.d_w, rc.d_h);
+	}
+
+	return ret;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <dp.h>
+
+#include "roi-batch.h"
+#include "scale-modes.h"
+
+/* -O: every ROI scaled to -W/-H, ROI 0 to the displayed buffers */
+int scale_rois(struct scaler_session *ss,
+	const struct scaler_options *o)
+{
+	struct roi_batch rb;
+	uint32_t n;
+	int index;
+	int ret;
+
+	ret = roi_batch_parse(o->rois, &rb);
+	if (!ret)
+		ret = roi_batch_check_limit(&rb, ss->s_w, ss->s_h, ss->max_w,
+					    ss->max_h);
+	if (!ret)
+		ret = session_open(ss, ss->s_w, ss->s_h, false, false);
+	if (ret)
+		return ret;
+
+	/* the rest is pooled */
+	ret = roi_batch_init(&rb, ss->drm_fd, init_scale_context, ss->w,
+			     ss->h, ss->bus_f, ss->s_w, ss->s_h,
+			     ss->dst_alloc_size);
+	if (!ret)
+		ret = session_start(ss);
+	if (ret)
+		goto out;
+
+	for (n = 0; n < ss->count; n++) {
+		ret = session_dqbuf(ss, &index, NULL);
+		if (ret)
+			break;
+
+		/* a failed ROI is counted, the others still run */
+		roi_batch_run(&rb, ss->handle, ss->dma_fds[index],
+			      ss->dst_dma_fds[index]);
+
+		ret = session_requeue(ss, index);
+		if (ret)
+			break;
+		set_plane(ss->device, ss->fbs[index], ss->s_w, ss->s_h);
+	}
+
+	roi_batch_print_stats(&rb);
+
+out:
+	roi_batch_deinit(&rb);
+	return ret;
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <linux/videodev2.h>
+
+#include <nx-scaler.h>
+
+#include "scaler-bench.h"
+
+#define I420	V4L2_PIX_FMT_YUV420
+#define YUY2	V4L2_PIX_FMT_YUYV
+
+/* every distinct scaler setup of test_1.sh ... test_82.sh */
+const struct bench_case bench_cases[] = {
+	/* format */
+	{ "test_1", 320, 240, I420, { 0, 0, 320, 240 }, 320, 240, 1, false },
+	{ "test_2", 640, 480, YUY2, { 0, 0, 640, 480 }, 640, 480, 1, true },
+	/* crop outside the input */
+	{ "test_3", 320, 240, I420, { 0, 0, 640, 480 }, 320, 240, 1, true },
+	{ "test_4", 320, 240, I420, { 10, 10, 320, 240 }, 320, 240, 1, true },
+	/* no scaling */
+	{ "test_8", 640, 480, I420, { 0, 0, 640, 480 }, 640, 480, 1, false },
+	{ "test_9", 1280, 720, I420, { 0, 0, 1280, 720 }, 1280, 720, 1, false },
+	{ "test_10", 1920, 1080, I420, { 0, 0, 1920, 1080 }, 1920, 1080, 1, false },
+	{ "test_11", 1280, 720, I420, { 0, 0, 320, 240 }, 320, 240, 1, false },
+	{ "test_13", 320, 240, I420, { 0, 0, 320, 240 }, 320, 240, 0, false },
+	{ "test_15", 640, 480, I420, { 0, 0, 640, 480 }, 640, 480, 0, false },
+	{ "test_17", 1280, 720, I420, { 0, 0, 1280, 720 }, 1280, 720, 0, false },
+	{ "test_19", 1920, 1080, I420, { 0, 0, 1920, 1080 }, 1920, 1080, 0, false },
+	{ "test_20", 1920, 1080, I420, { 0, 0, 1280, 720 }, 1280, 720, 1, false },
+	/* up scaling */
+	{ "test_29", 320, 240, I420, { 0, 0, 320, 240 }, 640, 480, 1, false },
+	{ "test_30", 320, 240, I420, { 0, 0, 320, 240 }, 640, 480, 0, false },
+	{ "test_31", 320, 240, I420, { 0, 0, 320, 240 }, 1280, 720, 1, false },
+	{ "test_32", 320, 240, I420, { 0, 0, 320, 240 }, 1280, 720, 0, false },
+	{ "test_33", 320, 240, I420, { 0, 0, 320, 240 }, 1920, 1080, 1, false },
+	{ "test_34", 320, 240, I420, { 0, 0, 320, 240 }, 1920, 1080, 0, false },
+	{ "test_35", 640, 480, I420, { 0, 0, 640, 480 }, 1280, 720, 1, false },
+	{ "test_36", 640, 480, I420, { 0, 0, 640, 480 }, 1280, 720, 0, false },
+	{ "test_37", 640, 480, I420, { 0, 0, 640, 480 }, 1920, 1080, 1, false },
+	{ "test_38", 640, 480, I420, { 0, 0, 640, 480 }, 1920, 1080, 0, false },
+	{ "test_39", 1280, 720, I420, { 0, 0, 1280, 720 }, 1920, 1080, 1, false },
+	{ "test_40", 1280, 720, I420, { 0, 0, 1280, 720 }, 1920, 1080, 0, false },
+	/* down scaling */
+	{ "test_59", 1920, 1080, I420, { 0, 0, 1920, 1080 }, 1280, 720, 1, false },
+	{ "test_60", 1920, 1080, I420, { 0, 0, 1920, 1080 }, 1280, 720, 0, false },
+	{ "test_61", 1920, 1080, I420, { 0, 0, 1920, 1080 }, 640, 480, 1, false },
+	{ "test_62", 1920, 1080, I420, { 0, 0, 1920, 1080 }, 640, 480, 0, false },
+	{ "test_63", 1920, 1080, I420, { 0, 0, 1920, 1080 }, 320, 240, 1, false },
+	{ "test_64", 1920, 1080, I420, { 0, 0, 1920, 1080 }, 320, 240, 0, false },
+	{ "test_65", 1280, 720, I420, { 0, 0, 1280, 720 }, 640, 480, 1, false },
+	{ "test_66", 1280, 720, I420, { 0, 0, 1280, 720 }, 640, 480, 0, false },
+	{ "test_67", 1280, 720, I420, { 0, 0, 1280, 720 }, 320, 240, 1, false },
+	{ "test_68", 1280, 720, I420, { 0, 0, 1280, 720 }, 320, 240, 0, false },
+	{ "test_69", 640, 480, I420, { 0, 0, 640, 480 }, 320, 240, 1, false },
+	{ "test_70", 640, 480, I420, { 0, 0, 640, 480 }, 320, 240, 0, false },
+	/* crop offsets, the scripts only try one as an error case */
+	{ "crop_1", 1920, 1080, I420, { 320, 180, 1280, 720 }, 1280, 720, 1,
+	  false },
+	{ "crop_2", 1920, 1080, I420, { 640, 360, 640, 360 }, 1920, 1080, 1,
+	  false },
+	{ "crop_3", 1280, 720, I420, { 16, 8, 1248, 704 }, 320, 240, 1,
+	  false },
+	{ "crop_4", 640, 480, I420, { 10, 10, 320, 240 }, 640, 480, 0,
+	  false },
+};
+
+const int bench_case_count = sizeof(bench_cases) / sizeof(bench_cases[0]);
+
+const char *bench_kind(const struct bench_case *c)
+{
+	uint64_t src = (uint64_t)c->crop.width * c->crop.height;
+	uint64_t dst = (uint64_t)c->dst_w * c->dst_h;
+
+	if (dst > src)
+		return "up";
+	if (dst < src)
+		return "down";
+	return "none";
+}
+
+static int bench_cmp(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+void bench_percentiles(uint32_t *lat, uint32_t n, uint32_t *p50,
+		       uint32_t *p90, uint32_t *p99, uint32_t *max)
+{
+	if (!n) {
+		*p50 = *p90 = *p99 = *max = 0;
+		return;
+	}
+
+	qsort(lat, n, sizeof(*lat), bench_cmp);
+	/* nearest rank */
+	*p50 = lat[(n * 50 + 99) / 100 - 1];
+	*p90 = lat[(n * 90 + 99) / 100 - 1];
+	*p99 = lat[(n * 99 + 99) / 100 - 1];
+	*max = lat[n - 1];
+}
+
+int bench_report_open(struct bench_report *r, const char *path)
+{
+	size_t len = strlen(path);
+
+	memset(r, 0, sizeof(*r));
+	r->json = len > 5 && !strcmp(path + len - 5, ".json");
+
+	if (!strcmp(path, "-")) {
+		r->fp = stdout;
+	} else {
+		r->fp = fopen(path, "w");
+		if (!r->fp) {
+			fprintf(stderr, "failed to open %s: %s\n", path,
+				strerror(errno));
+			return -errno;
+		}
+	}
+
+	if (r->json)
+		fprintf(r->fp, "[\n");
+	else
+		fprintf(r->fp, "case,kind,input,crop,dst,buffer_type,status,"
+			"frames,p50_us,p90_us,p99_us,max_us,total_p50_us,"
+			"total_p99_us,fps\n");
+
+	return 0;
+}
+
+static const char *bench_status(const struct bench_result *res)
+{
+	if (res->status)
+		return res->c->expect_reject ? "rejected" : "failed";
+	return res->c->expect_reject ? "accepted" : "ok";
+}
+
+void bench_report_add(struct bench_report *r, const struct bench_result *res)
+{
+	const struct bench_case *c = res->c;
+	uint64_t fps100 = res->wall_us ?
+		res->frames * 100000000ULL / res->wall_us : 0;
+
+	if ((res->status != 0) != c->expect_reject)
+		r->failed++;
+
+	if (r->json)
+		fprintf(r->fp, "%s  { \"case\": \"%s\", \"kind\": \"%s\", "
+			"\"input\": \"%ux%u\", \"crop\": \"%ux%u+%u+%u\", "
+			"\"dst\": \"%ux%u\", \"buffer_type\": %d, "
+			"\"status\": \"%s\", \"frames\": %u, \"p50_us\": %u, "
+			"\"p90_us\": %u, \"p99_us\": %u, \"max_us\": %u, "
+			"\"total_p50_us\": %u, \"total_p99_us\": %u, "
+			"\"fps\": %llu.%02llu }",
+			r->rows ? ",\n" : "", c->name, bench_kind(c),
+			c->in_w, c->in_h, c->crop.width, c->crop.height,
+			c->crop.x, c->crop.y, c->dst_w, c->dst_h,
+			c->buffer_type, bench_status(res), res->frames,
+			res->p50_us, res->p90_us, res->p99_us, res->max_us,
+			res->total_p50_us, res->total_p99_us,
+			(unsigned long long)(fps100 / 100),
+			(unsigned long long)(fps100 % 100));
+	else
+		fprintf(r->fp, "%s,%s,%ux%u,%ux%u+%u+%u,%ux%u,%d,%s,%u,%u,%u,"
+			"%u,%u,%u,%u,%llu.%02llu\n", c->name, bench_kind(c),
+			c->in_w, c->in_h, c->crop.width, c->crop.height,
+			c->crop.x, c->crop.y, c->dst_w, c->dst_h,
+			c->buffer_type, bench_status(res), res->frames,
+			res->p50_us, res->p90_us, res->p99_us, res->max_us,
+			res->total_p50_us, res->total_p99_us,
+			(unsigned long long)(fps100 / 100),
+			(unsigned long long)(fps100 % 100));
+	fflush(r->fp);
+	r->rows++;
+}
+
+void bench_report_close(struct bench_report *r)
+{
+	if (r->json)
+		fprintf(r->fp, "\n]\n");
+
+	if (r->fp && r->fp != stdout)
+		fclose(r->fp);
+	r->fp = NULL;
+}
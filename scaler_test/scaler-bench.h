@@ -0,0 +1,73 @@
+#ifndef _SCALER_BENCH_H
+#define _SCALER_BENCH_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <nx-scaler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BENCH_DEFAULT_FRAMES	100
+#define BENCH_WARMUP_FRAMES	3
+
+/*
+ * One scaler setup of gsttest/nxscaler (-M option). Sinks are left out,
+ * scripts that differ only in the sink share a case. buffer_type follows
+ * the nxscaler property: 1 hands dma-bufs through, 0 goes through system
+ * memory, so frames are copied into the scaler and back out.
+ */
+struct bench_case {
+	const char *name;	/* first script the case stands for */
+	uint32_t in_w;
+	uint32_t in_h;
+	uint32_t format;	/* V4L2_PIX_FMT_* */
+	struct rect crop;
+	uint32_t dst_w;
+	uint32_t dst_h;
+	int buffer_type;
+	bool expect_reject;	/* error case of the scripts */
+};
+
+extern const struct bench_case bench_cases[];
+extern const int bench_case_count;
+
+struct bench_result {
+	const struct bench_case *c;
+	int status;		/* 0 or negative errno of the rejection */
+	uint32_t frames;
+	uint32_t p50_us;	/* nx_scaler_run() only */
+	uint32_t p90_us;
+	uint32_t p99_us;
+	uint32_t max_us;
+	uint32_t total_p50_us;	/* with the copies of buffer type 0 */
+	uint32_t total_p99_us;
+	uint64_t wall_us;
+};
+
+struct bench_report {
+	FILE *fp;
+	bool json;
+	int rows;
+	int failed;		/* result is not what the case expects */
+};
+
+/* "up", "down" or "none" */
+const char *bench_kind(const struct bench_case *c);
+/* sorts lat in place */
+void bench_percentiles(uint32_t *lat, uint32_t n, uint32_t *p50,
+		       uint32_t *p90, uint32_t *p99, uint32_t *max);
+
+/* "-" is stdout, a .json suffix picks JSON, CSV otherwise */
+int bench_report_open(struct bench_report *r, const char *path);
+void bench_report_add(struct bench_report *r, const struct bench_result *res);
+void bench_report_close(struct bench_report *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
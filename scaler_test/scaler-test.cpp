@@ -27,14 +27,17 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <string.h>
+#include <time.h>
 #ifdef HAVE_SYS_SELECT_H
 #include <sys/select.h>
 #endif
 
 #include <sys/types.h>
+#include <sys/mman.h>
 
 #include <linux/videodev2.h>
 
+#include <drm/nexell_drm.h>
 #include <media-bus-format.h>
 #include <nx-drm-allocator.h>
 #include <nx-v4l2.h>
@@ -45,11 +48,18 @@
 #include <dp_common.h>
 #include <nx-scaler.h>
 
+#include "capture-trace.h"
 #include "option.h"
-
-#ifndef ALIGN
-#define ALIGN(x, a) (((x) + (a) - 1) & ~((a) - 1))
-#endif
+#include "phase-timer.h"
+#include "scaler-bench.h"
+#include "tile-scale.h"
+#include "roi-batch.h"
+#include "mosaic.h"
+#include "oracle.h"
+#include "rotate-show.h"
+#include "scale-modes.h"
+#include "scaler-test.h"
+#include "session.h"
 
 #define YUV_STRIDE_ALIGN_FACTOR		64
 #define YUV_VSTRIDE_ALIGN_FACTOR	16
@@ -223,7 +233,7 @@ void init_scale_context(uint32_t w, uint32_t h, uint32_t s_w, uint32_t s_h,
 	s_ctx->dst_stride[2] = dst_c_stride;
 }
 
-static size_t calc_alloc_size(uint32_t w, uint32_t h, uint32_t f)
+size_t calc_alloc_size(uint32_t w, uint32_t h, uint32_t f)
 {
 	uint32_t y_stride = ALIGN(w, 32);
 	uint32_t y_size = y_stride * ALIGN(h, 16);
@@ -250,255 +260,1076 @@ static size_t calc_alloc_size(uint32_t w, uint32_t h, uint32_t f)
 	return size;
 }
 
-#define MAX_BUFFER_COUNT	4
+/*
+ * Modes that take over the capture loop, the first one given wins.
+ * takes lists the other mode options it can be combined with.
+ */
+static const struct scaler_mode {
+	char flag;
+	const char *takes;
+	int (*run)(struct scaler_session *ss, const struct scaler_options *o);
+} scaler_modes[] = {
+	{ 'P', "CR", scale_handoff },
+	{ 'Z', "", scale_reconfig },
+	{ 'L', "CR", scale_ladder },
+	{ 'O', "R", scale_rois },
+	{ 'B', "R", scale_bypass },
+	{ 'Q', "rR", scale_plain },
+	{ 'r', "R", scale_plain },
+};
 
-int scaler_test(struct dp_device *device, int drm_fd, uint32_t m, uint32_t w,
-	uint32_t h, uint32_t s_w, uint32_t s_h, uint32_t f, uint32_t bus_f,
-	uint32_t count, struct rect crop)
+/* the mode options on the command line, as their flags */
+static void scaler_mode_flags(const struct scaler_options *o, char *flags)
 {
-	struct nx_scaler_context s_ctx;
+	if (o->policy)
+		*flags++ = 'P';
+	if (o->reconfig)
+		*flags++ = 'Z';
+	if (o->ladder)
+		*flags++ = 'L';
+	if (o->rois)
+		*flags++ = 'O';
+	if (o->bypass)
+		*flags++ = 'B';
+	if (o->oracle)
+		*flags++ = 'Q';
+	if (o->rotate)
+		*flags++ = 'r';
+	if (o->crop_pipe)
+		*flags++ = 'C';
+	if (o->record)
+		*flags++ = 'R';
+	*flags = '\0';
+}
+
+int scaler_test(struct dp_device *device, int drm_fd,
+	const struct scaler_options *o)
+{
+	const struct scaler_mode *mode = NULL;
+	struct scaler_session ss;
+	char flags[16];
+	const char *p;
 	int ret;
-	int handle=0;
+	size_t i;
+
+	ret = session_init(&ss, device, drm_fd, o);
+	if (ret)
+		return ret;
+
+	scaler_mode_flags(o, flags);
+	for (i = 0; !mode && i < ARRAY_SIZE(scaler_modes); i++)
+		if (strchr(flags, scaler_modes[i].flag))
+			mode = &scaler_modes[i];
+
+	for (p = flags; mode && *p; p++) {
+		if (*p != mode->flag && !strchr(mode->takes, *p)) {
+			fprintf(stderr, "-%c can not be combined with -%c\n",
+				mode->flag, *p);
+			ret = -EINVAL;
+			goto out;
+		}
+	}
+
+	if (mode)
+		ret = mode->run(&ss, o);
+	else if (session_tiled(&ss) && o->crop_pipe)
+		ret = session_refuse_tiling(&ss, 'C');
+	else if (session_tiled(&ss))
+		ret = scale_plain(&ss, o);
+	else
+		ret = scale_pipeline(&ss, o);
+
+out:
+	session_close(&ss);
+	return ret;
+}
+
+static uint64_t replay_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void replay_sleep_until(uint64_t ns)
+{
+	struct timespec ts;
+
+	ts.tv_sec = ns / 1000000000;
+	ts.tv_nsec = ns % 1000000000;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) ==
+	       EINTR)
+		;
+}
+
+/*
+ * Feeds a recorded capture trace (-I option) through scaler and display,
+ * no camera involved. Frames go out at the recorded cadence, drops
+ * included, or back to back with -X. count 0 plays the trace once,
+ * otherwise count frames, looping. With -Q every frame is also checked
+ * against the software scaler, the same trace before and after a
+ * kernel update shows whether the hardware output moved.
+ */
+int scaler_replay(struct dp_device *device, int drm_fd, const char *path,
+	uint32_t s_w, uint32_t s_h, uint32_t count, struct rect crop,
+	bool fast, const char *oracle, const char *tile_limit,
+	const char *rois, const char *rotate)
+{
+	struct nx_scaler_context s_ctx;
+	struct scaler_oracle orc, *o = NULL;
+	struct tile_scaler ts, *tiles = NULL;
+	struct roi_batch rb, *roi = NULL;
+	struct scaler_rotate rt, *rot = NULL;
+	uint32_t max_w, max_h;
+	struct capture_trace trace;
+	const struct trace_record *rec;
+	int handle;
+	int ret = 0;
 	int i;
 
 	int gem_fds[MAX_BUFFER_COUNT] = { -1, };
 	int dma_fds[MAX_BUFFER_COUNT] = { -1, };
+	uint8_t *vaddr[MAX_BUFFER_COUNT] = { NULL, };
 	int dst_gem_fds[MAX_BUFFER_COUNT] = { -1, };
 	int dst_dma_fds[MAX_BUFFER_COUNT] = { -1, };
-	struct dp_framebuffer *fbs[MAX_BUFFER_COUNT] = {NULL,};
+	struct dp_framebuffer *fbs[MAX_BUFFER_COUNT] = { NULL, };
+	uint64_t start, pts, period, late_ns;
+	uint64_t prev_ts = 0;
+	uint64_t copy_ns = 0, scale_ns = 0, t0, t1;
+	uint32_t n, frames, late = 0;
+	uint32_t w, h, f, bus_f;
+
+	if (rois) {
+		if (oracle) {
+			fprintf(stderr, "-O can not be combined with -Q\n");
+			return -EINVAL;
+		}
 
-	if (f == 0)
-		f = V4L2_PIX_FMT_YUV420;
+		ret = roi_batch_parse(rois, &rb);
+		if (ret)
+			return ret;
+	}
 
-	if (bus_f == 0)
-		bus_f = MEDIA_BUS_FMT_YUYV8_2X8;
+	ret = trace_reader_open(&trace, path);
+	if (ret)
+		return ret;
+	trace_print_info(&trace);
+
+	w = trace.hdr.width;
+	h = trace.hdr.height;
+	f = trace.hdr.format;
+	bus_f = trace.hdr.bus_format ? trace.hdr.bus_format :
+		MEDIA_BUS_FMT_YUYV8_2X8;
+
+	/* the payload is copied as is, so it must be our own src layout */
+	if (!trace.hdr.frame_count || f != V4L2_PIX_FMT_YUV420 ||
+	    trace.hdr.frame_size != calc_alloc_size(w, h, f)) {
+		fprintf(stderr, "trace %s can not be replayed\n", path);
+		trace_reader_close(&trace);
+		return -EINVAL;
+	}
 
+	if (!crop.width || !crop.height) {
+		crop.x = 0;
+		crop.y = 0;
+		crop.width = w;
+		crop.height = h;
+	}
 	init_scale_context(w, h, s_w, s_h, bus_f, 1, crop, &s_ctx);
+
+	if (rotate) {
+		ret = rotate_probe(&rt, device, drm_fd, rotate);
+		if (ret) {
+			trace_reader_close(&trace);
+			return ret;
+		}
+	}
+
 	handle = scaler_open();
 	if (handle == -1) {
 		fprintf(stderr, "failed to open scaler\n");
+		trace_reader_close(&trace);
 		return -ENODEV;
 	}
-	int sensor_fd = nx_v4l2_open_device(nx_sensor_subdev, m);
-	if (sensor_fd < 0) {
-		fprintf(stderr, "failed to open camera %d sensor\n", m);
-		return -1;
-	}
 
-	bool is_mipi = nx_v4l2_is_mipi_camera(m);
+	size_t alloc_size = trace.hdr.frame_size;
+	size_t dst_alloc_size = calc_alloc_size(s_w, s_h, f);
+
+	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
+		gem_fds[i] = alloc_gem(drm_fd, alloc_size, 0);
+		dma_fds[i] = gem_fds[i] < 0 ? -1 :
+			gem_to_dmafd(drm_fd, gem_fds[i]);
+		if (dma_fds[i] < 0) {
+			fprintf(stderr, "failed to alloc src buffer %d\n", i);
+			ret = -ENOMEM;
+			goto out;
+		}
 
-	int csi_subdev_fd;
-	if (is_mipi) {
-		csi_subdev_fd = nx_v4l2_open_device(nx_csi_subdev, m);
-		if (csi_subdev_fd < 0) {
-			fprintf(stderr, "failed open mipi csi\n");
-			return -1;
+		void *map = mmap(NULL, alloc_size, PROT_READ | PROT_WRITE,
+				 MAP_SHARED, dma_fds[i], 0);
+		if (map == MAP_FAILED) {
+			fprintf(stderr, "failed to mmap src buffer %d\n", i);
+			ret = -ENOMEM;
+			goto out;
+		}
+		vaddr[i] = (uint8_t *)map;
+
+		dst_gem_fds[i] = alloc_gem(drm_fd, dst_alloc_size,
+				rotate && !rt.hw ? NX_BO_CACHABLE : 0);
+		dst_dma_fds[i] = dst_gem_fds[i] < 0 ? -1 :
+			gem_to_dmafd(drm_fd, dst_gem_fds[i]);
+		if (dst_dma_fds[i] < 0) {
+			fprintf(stderr, "failed to alloc dst buffer %d\n", i);
+			ret = -ENOMEM;
+			goto out;
+		}
+
+		fbs[i] = display_buffer_init(device, s_w, s_h, dst_gem_fds[i],
+				static_cast<int>(dst_alloc_size));
+		if (!fbs[i]) {
+			printf("fail : framebuffer Init %m\n");
+			ret = -1;
+			goto out;
 		}
 	}
 
-	int clipper_subdev_fd = nx_v4l2_open_device(nx_clipper_subdev, m);
-	if (clipper_subdev_fd < 0) {
-		fprintf(stderr, "failed to open clipper_subdev %d\n", m);
-		return -1;
+	if (oracle) {
+		o = &orc;
+		ret = oracle_init(o, oracle, f, &s_ctx, dma_fds, alloc_size,
+				  dst_dma_fds, dst_alloc_size);
+		if (ret)
+			goto out;
 	}
 
-	int clipper_video_fd = nx_v4l2_open_device(nx_clipper_video, m);
-	if (clipper_video_fd < 0) {
-		fprintf(stderr, "failed to open clipper_video %d\n", m);
-		return -1;
+	ret = tile_parse_limit(tile_limit, &max_w, &max_h);
+	if (ret)
+		goto out;
+
+	if (rois) {
+		roi = &rb;
+		ret = roi_batch_check_limit(roi, s_w, s_h, max_w, max_h);
+		if (!ret)
+			ret = roi_batch_init(roi, drm_fd, init_scale_context,
+					     w, h, bus_f, s_w, s_h,
+					     dst_alloc_size);
+		if (ret)
+			goto out;
 	}
 
-	nx_v4l2_streamoff(clipper_video_fd, nx_clipper_video);
+	/* e.g. 4K traces, the hardware still scales them */
+	if (!roi && tile_needed(crop, s_w, s_h, max_w, max_h)) {
+		tiles = &ts;
+		ret = tile_scaler_init(tiles, drm_fd, init_scale_context, w, h,
+				       crop, s_w, s_h, bus_f, f, max_w, max_h,
+				       dst_dma_fds, MAX_BUFFER_COUNT,
+				       dst_alloc_size);
+		if (ret)
+			goto out;
+	}
 
-	ret = nx_v4l2_link(true, m, nx_clipper_subdev, 1,
-			nx_clipper_video, 0);
-	if (is_mipi) {
-		ret = nx_v4l2_link(true, m, nx_sensor_subdev, 0, nx_csi_subdev,
-				0);
-		if (ret) {
-			fprintf(stderr, "failed to link sensor to csi\n");
-			return ret;
+	if (rotate) {
+		rot = &rt;
+		ret = rotate_setup(rot, f, s_w, s_h, s_ctx.dst_stride,
+				   dst_dma_fds, dst_alloc_size);
+		if (ret)
+			goto out;
+	}
+
+	frames = count ? count : trace.hdr.frame_count;
+	/* step used when the trace wraps around */
+	period = trace.hdr.frame_count > 1 ?
+		(trace.hdr.last_ts_ns - trace.hdr.first_ts_ns) /
+		(trace.hdr.frame_count - 1) : 33333333;
+	/* a frame is late once it misses its slot by half a period */
+	late_ns = period / 2;
+
+	start = replay_now_ns();
+	pts = 0;
+
+	for (n = 0; n < frames; n++) {
+		uint32_t t = n % trace.hdr.frame_count;
+		const uint8_t *src = trace_reader_frame(&trace, t, &rec);
+		int index = n % MAX_BUFFER_COUNT;
+
+		if (!src) {
+			fprintf(stderr, "trace frame %u is damaged\n", t);
+			ret = -EIO;
+			break;
 		}
 
-		ret = nx_v4l2_link(true, m, nx_csi_subdev, 1, nx_clipper_subdev,
-				0);
-		if (ret) {
-			fprintf(stderr, "failed to link csi to clipper\n");
-			return ret;
+		if (n)
+			pts += t ? rec->timestamp_ns - prev_ts : period;
+		prev_ts = rec->timestamp_ns;
+
+		if (!fast) {
+			uint64_t now = replay_now_ns();
+
+			if (now < start + pts)
+				replay_sleep_until(start + pts);
+			else if (now - (start + pts) > late_ns)
+				late++;
 		}
-	} else {
-		ret = nx_v4l2_link(true, m, nx_sensor_subdev, 0,
-				nx_clipper_subdev, 0);
-		if (ret) {
-			fprintf(stderr, "failed to link sensor to clipper\n");
-			return ret;
+
+		t0 = replay_now_ns();
+		memcpy(vaddr[index], src, alloc_size);
+		t1 = replay_now_ns();
+		copy_ns += t1 - t0;
+
+		s_ctx.src_fds[0] = dma_fds[index];
+		s_ctx.dst_fds[0] = dst_dma_fds[index];
+		if (roi) {
+			/* failed ROIs are counted, replay goes on */
+			roi_batch_run(roi, handle, dma_fds[index],
+				      dst_dma_fds[index]);
+			ret = 0;
+		} else if (tiles) {
+			ret = tile_scaler_run(tiles, handle, dma_fds[index],
+					      index);
+		} else {
+			ret = nx_scaler_run(handle, &s_ctx);
 		}
-	}
+		if (ret == -1) {
+			fprintf(stderr, "failed to scaler set & run ioctl\n");
+			break;
+		}
+		scale_ns += replay_now_ns() - t1;
 
-	ret = nx_v4l2_set_format(sensor_fd, nx_sensor_subdev, w, h,
-			bus_f);
-	if (ret) {
-		fprintf(stderr, "failed to set_format for sensor\n");
-		return ret;
+		if (o)
+			oracle_check(o, index);
+
+		if (rot)
+			rotate_show(rot, fbs[index], index);
+		else
+			set_plane(device, fbs[index], s_w, s_h);
 	}
 
-	if (is_mipi) {
-		ret = nx_v4l2_set_format(csi_subdev_fd, nx_csi_subdev, w, h, f);
-		if (ret) {
-			fprintf(stderr, "failed to set_format for csi\n");
-			return ret;
-		}
+	if (n) {
+		uint64_t elapsed = replay_now_ns() - start;
+
+		printf("replay: %u frames in %llu ms, %llu.%02llu fps, %u late, "
+		       "copy avg %llu us, scale avg %llu us\n", n,
+		       (unsigned long long)(elapsed / 1000000),
+		       (unsigned long long)(n * 1000000000ULL / elapsed),
+		       (unsigned long long)(n * 100000000000ULL / elapsed % 100),
+		       late, (unsigned long long)(copy_ns / n / 1000),
+		       (unsigned long long)(scale_ns / n / 1000));
 	}
 
-	ret = nx_v4l2_set_format(clipper_subdev_fd, nx_clipper_subdev, w, h,
-			bus_f);
-	if (ret) {
-		fprintf(stderr, "failed to set_format for clipper subdev\n");
-		return ret;
+out:
+	if (o)
+		oracle_deinit(o);
+
+	if (tiles) {
+		tile_scaler_print_stats(tiles);
+		tile_scaler_deinit(tiles);
 	}
 
-	ret = nx_v4l2_set_format(clipper_video_fd, nx_clipper_video, w, h, f);
-	if (ret) {
-		fprintf(stderr, "failed to set_format for clipper video\n");
-		return ret;
+	if (roi) {
+		roi_batch_print_stats(roi);
+		roi_batch_deinit(roi);
 	}
 
-	ret = nx_v4l2_set_crop(clipper_subdev_fd, nx_clipper_subdev, 0, 0, w,
-			h);
-	if (ret) {
-		fprintf(stderr, "failed to set_crop for clipper subdev\n");
-		return ret;
+	if (rot)
+		rotate_deinit(rot);
+
+	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
+		if (fbs[i]) {
+			dp_framebuffer_delfb2(fbs[i]);
+			dp_framebuffer_free(fbs[i]);
+		}
+		if (vaddr[i])
+			munmap(vaddr[i], alloc_size);
+		if (dma_fds[i] >= 0)
+			close(dma_fds[i]);
+		if (gem_fds[i] >= 0)
+			close(gem_fds[i]);
+		if (dst_dma_fds[i] >= 0)
+			close(dst_dma_fds[i]);
+		if (dst_gem_fds[i] >= 0)
+			close(dst_gem_fds[i]);
 	}
+	nx_scaler_close(handle);
+	trace_reader_close(&trace);
 
-	ret = nx_v4l2_reqbuf(clipper_video_fd, nx_clipper_video,
-			MAX_BUFFER_COUNT);
-	if (ret) {
-		fprintf(stderr, "failed to reqbuf\n");
-		return ret;
+	return ret;
+}
+
+/* what the gst element checks before it scales */
+static int bench_validate(const struct bench_case *c)
+{
+	if (c->format != V4L2_PIX_FMT_YUV420)
+		return -EINVAL;
+
+	if (c->crop.x + c->crop.width > c->in_w ||
+	    c->crop.y + c->crop.height > c->in_h)
+		return -ERANGE;
+
+	return 0;
+}
+
+static int bench_run_case(int drm_fd, int handle, const struct bench_case *c,
+	uint32_t frames, uint32_t *lat, uint32_t *total,
+	struct bench_result *res)
+{
+	struct nx_scaler_context s_ctx;
+	size_t src_size, dst_size;
+	int src_gem = -1, src_fd = -1;
+	int dst_gem = -1, dst_fd = -1;
+	uint8_t *src_map = NULL, *dst_map = NULL;
+	uint8_t *src_mem = NULL, *dst_mem = NULL;
+	void *map;
+	uint64_t start = 0, t0, t1, t2;
+	uint32_t n;
+	size_t i;
+	int ret = 0;
+
+	memset(res, 0, sizeof(*res));
+	res->c = c;
+	res->status = bench_validate(c);
+	if (res->status)
+		return 0;
+
+	src_size = calc_alloc_size(c->in_w, c->in_h, c->format);
+	dst_size = calc_alloc_size(c->dst_w, c->dst_h, c->format);
+	init_scale_context(c->in_w, c->in_h, c->dst_w, c->dst_h,
+			   MEDIA_BUS_FMT_YUYV8_2X8, 1, c->crop, &s_ctx);
+
+	src_gem = alloc_gem(drm_fd, src_size, 0);
+	src_fd = src_gem < 0 ? -1 : gem_to_dmafd(drm_fd, src_gem);
+	dst_gem = alloc_gem(drm_fd, dst_size, 0);
+	dst_fd = dst_gem < 0 ? -1 : gem_to_dmafd(drm_fd, dst_gem);
+	if (src_fd < 0 || dst_fd < 0) {
+		fprintf(stderr, "failed to alloc %s buffers\n", c->name);
+		ret = -ENOMEM;
+		goto out;
 	}
 
-	size_t alloc_size = calc_alloc_size(w, h, f);
-	if (alloc_size <= 0) {
-		fprintf(stderr, "invalid alloc size %lu\n", alloc_size);
-		return -1;
+	map = mmap(NULL, src_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		   src_fd, 0);
+	if (map != MAP_FAILED)
+		src_map = (uint8_t *)map;
+	map = mmap(NULL, dst_size, PROT_READ, MAP_SHARED, dst_fd, 0);
+	if (map != MAP_FAILED)
+		dst_map = (uint8_t *)map;
+	if (!src_map || !dst_map) {
+		fprintf(stderr, "failed to mmap %s buffers\n", c->name);
+		ret = -ENOMEM;
+		goto out;
 	}
 
-	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
-		int gem_fd = alloc_gem(drm_fd, alloc_size, 0);
-		if (gem_fd < 0) {
-			fprintf(stderr, "failed to alloc_gem\n");
-			return -1;
+	/* the same busy picture for every case */
+	for (i = 0; i < src_size; i++)
+		src_map[i] = (uint8_t)(i * 7 ^ (i >> 9));
+
+	if (c->buffer_type == 0) {
+		src_mem = (uint8_t *)malloc(src_size);
+		dst_mem = (uint8_t *)malloc(dst_size);
+		if (!src_mem || !dst_mem) {
+			ret = -ENOMEM;
+			goto out;
 		}
+		memcpy(src_mem, src_map, src_size);
+	}
 
-		int dma_fd = gem_to_dmafd(drm_fd, gem_fd);
-		if (dma_fd < 0) {
-			fprintf(stderr, "failed to gem_to_dmafd\n");
-			return -1;
+	s_ctx.src_fds[0] = src_fd;
+	s_ctx.dst_fds[0] = dst_fd;
+
+	for (n = 0; n < BENCH_WARMUP_FRAMES + frames; n++) {
+		if (n == BENCH_WARMUP_FRAMES)
+			start = replay_now_ns();
+
+		t0 = replay_now_ns();
+		if (src_mem)
+			memcpy(src_map, src_mem, src_size);
+		t1 = replay_now_ns();
+		if (nx_scaler_run(handle, &s_ctx) == -1) {
+			res->status = errno ? -errno : -EIO;
+			break;
 		}
+		t2 = replay_now_ns();
+		if (dst_mem)
+			memcpy(dst_mem, dst_map, dst_size);
+
+		if (n < BENCH_WARMUP_FRAMES)
+			continue;
 
-		gem_fds[i] = gem_fd;
-		dma_fds[i] = dma_fd;
+		lat[res->frames] = (t2 - t1) / 1000;
+		total[res->frames] = (replay_now_ns() - t0) / 1000;
+		res->frames++;
 	}
 
-	size_t dst_alloc_size = calc_alloc_size(s_w, s_h, f);
-	if (dst_alloc_size <= 0) {
-		fprintf(stderr, "invalid alloc size %lu\n",
-				dst_alloc_size);
-		return -1;
+	if (res->frames) {
+		uint32_t p90, max;
+
+		res->wall_us = (replay_now_ns() - start) / 1000;
+		bench_percentiles(lat, res->frames, &res->p50_us,
+				  &res->p90_us, &res->p99_us, &res->max_us);
+		bench_percentiles(total, res->frames, &res->total_p50_us,
+				  &p90, &res->total_p99_us, &max);
 	}
 
-	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
-		int gem_fd = alloc_gem(drm_fd, dst_alloc_size, 0);
-		if (gem_fd < 0) {
-			fprintf(stderr, "failed to alloc_gem\n");
-			return -1;
+out:
+	free(src_mem);
+	free(dst_mem);
+	if (src_map)
+		munmap(src_map, src_size);
+	if (dst_map)
+		munmap(dst_map, dst_size);
+	if (src_fd >= 0)
+		close(src_fd);
+	if (src_gem >= 0)
+		close(src_gem);
+	if (dst_fd >= 0)
+		close(dst_fd);
+	if (dst_gem >= 0)
+		close(dst_gem);
+
+	return ret;
+}
+
+/*
+ * Runs the gsttest/nxscaler matrix (-M option) straight on the scaler,
+ * no camera, no display and no sleeps, frames per case from -c. One
+ * row per case goes to out, CSV or JSON.
+ */
+int scaler_bench(int drm_fd, const char *out, uint32_t frames)
+{
+	struct bench_report report;
+	struct bench_result res;
+	uint32_t *lat, *total;
+	FILE *log;
+	int handle;
+	int ret;
+	int i;
+
+	if (!frames)
+		frames = BENCH_DEFAULT_FRAMES;
+
+	lat = (uint32_t *)malloc(frames * sizeof(*lat));
+	total = (uint32_t *)malloc(frames * sizeof(*total));
+	if (!lat || !total) {
+		free(lat);
+		free(total);
+		return -ENOMEM;
+	}
+
+	handle = scaler_open();
+	if (handle == -1) {
+		fprintf(stderr, "failed to open scaler\n");
+		free(lat);
+		free(total);
+		return -ENODEV;
+	}
+
+	ret = bench_report_open(&report, out);
+	if (ret)
+		goto out;
+	/* keep the table clean when it goes to stdout */
+	log = report.fp == stdout ? stderr : stdout;
+
+	for (i = 0; i < bench_case_count; i++) {
+		ret = bench_run_case(drm_fd, handle, &bench_cases[i], frames,
+				     lat, total, &res);
+		if (ret)
+			break;
+
+		bench_report_add(&report, &res);
+		fprintf(log, "bench %s %s: %u frames, p50 %u us, p99 %u us\n",
+			bench_cases[i].name, res.status ? "rejected" : "done",
+			res.frames, res.p50_us, res.p99_us);
+	}
+
+	fprintf(log, "bench: %d cases, %d not as expected\n", report.rows,
+		report.failed);
+	if (!ret && report.failed)
+		ret = -EIO;
+	bench_report_close(&report);
+
+out:
+	nx_scaler_close(handle);
+	free(lat);
+	free(total);
+
+	return ret;
+}
+
+#define MOSAIC_DEFAULT_VSYNCS	600
+#define MOSAIC_VSYNC_NS		16666667	/* timer when there is no vblank */
+#define MOSAIC_FRAME_US		33333		/* budget at 30 fps */
+#define MOSAIC_BENCH_W		1920
+#define MOSAIC_BENCH_H		1080
+#define MOSAIC_FEED_W		1280
+#define MOSAIC_FEED_H		720
+
+/* a recorded camera stream in one mosaic cell, at its own rate */
+struct mosaic_feed {
+	struct capture_trace trace;
+	bool opened;
+	uint64_t period;	/* ns between frames */
+	uint64_t due;
+	uint32_t next;		/* trace frame delivered next */
+	int gem_fd;
+	int dma_fd;
+	uint8_t *map;
+	size_t size;
+
+	uint32_t frames;
+	uint32_t missed;	/* frames that were due while composing */
+};
+
+/* "<trace>[@<fps>]", spec is cut at the '@' */
+static int mosaic_feed_open(struct mosaic_feed *feed, int drm_fd, char *spec)
+{
+	struct trace_header *hdr = &feed->trace.hdr;
+	char *at = strchr(spec, '@');
+	uint32_t fps = 0;
+	void *map;
+	int ret;
+
+	if (at) {
+		*at = '\0';
+		fps = atoi(at + 1);
+		if (!fps) {
+			fprintf(stderr, "invalid feed rate %s\n", at + 1);
+			return -EINVAL;
 		}
+	}
+
+	ret = trace_reader_open(&feed->trace, spec);
+	if (ret)
+		return ret;
+	feed->opened = true;
+
+	/* frames are copied as they are, like -I */
+	if (!hdr->frame_count || hdr->format != V4L2_PIX_FMT_YUV420 ||
+	    hdr->frame_size != calc_alloc_size(hdr->width, hdr->height,
+					       hdr->format)) {
+		fprintf(stderr, "trace %s can not be a mosaic feed\n", spec);
+		return -EINVAL;
+	}
+
+	if (fps)
+		feed->period = 1000000000ULL / fps;
+	else
+		feed->period = hdr->frame_count > 1 ?
+			(hdr->last_ts_ns - hdr->first_ts_ns) /
+			(hdr->frame_count - 1) : 33333333;
+
+	feed->size = hdr->frame_size;
+	feed->gem_fd = alloc_gem(drm_fd, feed->size, 0);
+	feed->dma_fd = feed->gem_fd < 0 ? -1 : gem_to_dmafd(drm_fd, feed->gem_fd);
+	if (feed->dma_fd < 0) {
+		fprintf(stderr, "failed to alloc feed buffer\n");
+		return -ENOMEM;
+	}
+
+	map = mmap(NULL, feed->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		   feed->dma_fd, 0);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "failed to mmap feed buffer\n");
+		return -ENOMEM;
+	}
+	feed->map = (uint8_t *)map;
+
+	return 0;
+}
+
+static void mosaic_feed_close(struct mosaic_feed *feed)
+{
+	if (feed->map)
+		munmap(feed->map, feed->size);
+	if (feed->dma_fd >= 0)
+		close(feed->dma_fd);
+	if (feed->gem_fd >= 0)
+		close(feed->gem_fd);
+	if (feed->opened)
+		trace_reader_close(&feed->trace);
+}
+
+/* -1 if the driver has no vblank interrupt */
+static int mosaic_wait_vblank(int drm_fd)
+{
+	drmVBlank vbl;
+
+	memset(&vbl, 0, sizeof(vbl));
+	vbl.request.type = DRM_VBLANK_RELATIVE;
+	vbl.request.sequence = 1;
+
+	return drmWaitVBlank(drm_fd, &vbl);
+}
+
+/*
+ * Several recorded camera streams composed into one s_w x s_h frame
+ * (-V option), "<cols>x<rows>:<trace>[@<fps>][,<trace>[@<fps>]...]".
+ * Cell i plays feed i, the list repeats when there are more cells, so
+ * one trace at a few rates fills a grid. Feeds without a rate keep
+ * their recorded cadence. Every vblank the feeds that are due hand in
+ * a frame, the cells they changed are brought up to date in the back
+ * buffer and that buffer is flipped to, once; vblanks where no feed
+ * delivered leave the screen alone. count is vblanks, 0 plays
+ * MOSAIC_DEFAULT_VSYNCS.
+ */
+int scaler_mosaic(struct dp_device *device, int drm_fd, const char *arg,
+	uint32_t s_w, uint32_t s_h, uint32_t count)
+{
+	struct mosaic_feed feeds[MAX_MOSAIC_CELLS];
+	struct mosaic mos, *m = NULL;
+	char *specs[MAX_MOSAIC_CELLS];
+	char *list, *p;
+	int gem_fds[MOSAIC_BUFFERS] = { -1, -1 };
+	int dma_fds[MOSAIC_BUFFERS] = { -1, -1 };
+	struct dp_framebuffer *fbs[MOSAIC_BUFFERS] = { NULL, };
+	size_t dst_size = calc_alloc_size(s_w, s_h, V4L2_PIX_FMT_YUV420);
+	uint64_t start, now, next_vsync = 0;
+	uint32_t v, vsyncs, flips = 0;
+	bool timer = false;
+	int cols, rows, n = 0;
+	int handle = -1;
+	int ret;
+	int i;
 
-		int dma_fd = gem_to_dmafd(drm_fd, gem_fd);
-		if (dma_fd < 0) {
-			fprintf(stderr, "failed to gem_to_dmafd\n");
-			return -1;
+	memset(feeds, 0, sizeof(feeds));
+	for (i = 0; i < MAX_MOSAIC_CELLS; i++) {
+		feeds[i].gem_fd = -1;
+		feeds[i].dma_fd = -1;
+	}
+
+	ret = mosaic_parse_grid(arg, &cols, &rows);
+	if (ret)
+		return ret;
+
+	p = (char *)strchr(arg, ':');
+	if (!p || !p[1]) {
+		fprintf(stderr, "mosaic %s has no feeds\n", arg);
+		return -EINVAL;
+	}
+
+	list = strdup(p + 1);
+	if (!list)
+		return -ENOMEM;
+	for (p = list; p && n < MAX_MOSAIC_CELLS; n++) {
+		specs[n] = p;
+		p = strchr(p, ',');
+		if (p)
+			*p++ = '\0';
+	}
+
+	for (i = 0; i < MOSAIC_BUFFERS; i++) {
+		gem_fds[i] = alloc_gem(drm_fd, dst_size, NX_BO_CACHABLE);
+		dma_fds[i] = gem_fds[i] < 0 ? -1 :
+			gem_to_dmafd(drm_fd, gem_fds[i]);
+		if (dma_fds[i] < 0) {
+			fprintf(stderr, "failed to alloc mosaic buffer %d\n", i);
+			ret = -ENOMEM;
+			goto out;
 		}
-		struct dp_framebuffer *fb = display_buffer_init(device, s_w,
-				s_h, gem_fd, static_cast<int>(dst_alloc_size));
-		if (!fb) {
+
+		fbs[i] = display_buffer_init(device, s_w, s_h, gem_fds[i],
+				static_cast<int>(dst_size));
+		if (!fbs[i]) {
 			printf("fail : framebuffer Init %m\n");
 			ret = -1;
-			return ret;
+			goto out;
 		}
-		fbs[i] = fb;
-
-		dst_gem_fds[i] = gem_fd;
-		dst_dma_fds[i] = dma_fd;
 	}
 
-	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
-		ret = nx_v4l2_qbuf(clipper_video_fd, nx_clipper_video, 1, i,
-				&dma_fds[i], (int *)&alloc_size);
-		if (ret) {
-			fprintf(stderr, "failed qbuf index %d\n", i);
-			return ret;
-		}
+	m = &mos;
+	ret = mosaic_init(m, drm_fd, init_scale_context, cols, rows, s_w, s_h,
+			  dma_fds, dst_size);
+	if (ret)
+		goto out;
+
+	for (i = 0; i < m->count; i++) {
+		struct mosaic_feed *feed = &feeds[i];
+		char spec[256];
+
+		snprintf(spec, sizeof(spec), "%s", specs[i % n]);
+		ret = mosaic_feed_open(feed, drm_fd, spec);
+		if (ret)
+			goto out;
+
+		ret = mosaic_cell_source(m, i, feed->trace.hdr.width,
+				feed->trace.hdr.height,
+				feed->trace.hdr.bus_format ?
+				feed->trace.hdr.bus_format :
+				MEDIA_BUS_FMT_YUYV8_2X8);
+		if (ret)
+			goto out;
+
+		printf("cell %d: %s %ux%u at %llu.%02llu fps\n", i, spec,
+		       feed->trace.hdr.width, feed->trace.hdr.height,
+		       (unsigned long long)(1000000000ULL / feed->period),
+		       (unsigned long long)(100000000000ULL / feed->period % 100));
 	}
 
-	ret = nx_v4l2_streamon(clipper_video_fd, nx_clipper_video);
-	if (ret) {
-		fprintf(stderr, "failed to streamon\n");
-		return ret;
+	handle = scaler_open();
+	if (handle == -1) {
+		fprintf(stderr, "failed to open scaler\n");
+		ret = -ENODEV;
+		goto out;
 	}
 
-	int loop_count = count;
-	while (loop_count--) {
-		int dq_index;
+	vsyncs = count ? count : MOSAIC_DEFAULT_VSYNCS;
+	start = replay_now_ns();
+	for (i = 0; i < m->count; i++)
+		feeds[i].due = start;
 
-		ret = nx_v4l2_dqbuf(clipper_video_fd, nx_clipper_video, 1,
-				&dq_index);
-		if (ret) {
-			fprintf(stderr, "failed to dqbuf\n");
-			return ret;
-		}
+	for (v = 0; v < vsyncs; v++) {
+		int index;
 
-		s_ctx.src_fds[0] = dma_fds[dq_index];
-		s_ctx.dst_fds[0] = dst_dma_fds[dq_index];
+		if (!timer && mosaic_wait_vblank(drm_fd)) {
+			printf("no vblank event, flipping on a %u us timer\n",
+			       MOSAIC_VSYNC_NS / 1000);
+			timer = true;
+			next_vsync = replay_now_ns();
+		}
+		if (timer) {
+			next_vsync += MOSAIC_VSYNC_NS;
+			replay_sleep_until(next_vsync);
+		}
 
-		ret = nx_scaler_run(handle, &s_ctx);
-		if (ret == -1) {
-			fprintf(stderr, "failed to scaler set & run ioctl\n");
-			return ret;
+		now = replay_now_ns();
+		for (i = 0; i < m->count; i++) {
+			struct mosaic_feed *feed = &feeds[i];
+			const struct trace_record *rec;
+			const uint8_t *src;
+
+			if (now < feed->due)
+				continue;
+
+			src = trace_reader_frame(&feed->trace, feed->next, &rec);
+			if (!src) {
+				fprintf(stderr, "trace frame %u is damaged\n",
+					feed->next);
+				ret = -EIO;
+				goto out;
+			}
+			memcpy(feed->map, src, feed->size);
+			mosaic_update(m, i, feed->dma_fd);
+
+			feed->next = (feed->next + 1) % feed->trace.hdr.frame_count;
+			feed->frames++;
+			feed->due += feed->period;
+			/* the frames a slow compose sat on are gone */
+			while (now >= feed->due) {
+				feed->due += feed->period;
+				feed->missed++;
+			}
 		}
 
-		printf("dq index : %d\n", dq_index);
-		ret = nx_v4l2_qbuf(clipper_video_fd, nx_clipper_video, 1,
-				dq_index, &dma_fds[dq_index],
-				(int *)&alloc_size);
-		if (ret) {
-			fprintf(stderr, "failed qbuf index %d\n", dq_index);
-			return ret;
+		index = mosaic_compose(m, handle);
+		if (index == -2) {
+			ret = -EIO;
+			break;
+		}
+		if (index >= 0) {
+			set_plane(device, fbs[index], s_w, s_h);
+			flips++;
 		}
-		set_plane(device,fbs[dq_index],s_w,s_h);
+	}
 
+	now = replay_now_ns();
+	printf("mosaic: %u vblanks in %llu ms, %u flips\n", v,
+	       (unsigned long long)((now - start) / 1000000), flips);
+	for (i = 0; i < m->count; i++)
+		printf("  feed %d: %u frames, %u missed\n", i,
+		       feeds[i].frames, feeds[i].missed);
+
+out:
+	if (m) {
+		mosaic_print_stats(m);
+		mosaic_deinit(m);
 	}
 
-	nx_v4l2_streamoff(clipper_video_fd, nx_clipper_video);
+	for (i = 0; i < MAX_MOSAIC_CELLS; i++)
+		mosaic_feed_close(&feeds[i]);
 
-	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
-		if (fbs[i])
-		{
+	for (i = 0; i < MOSAIC_BUFFERS; i++) {
+		if (fbs[i]) {
 			dp_framebuffer_delfb2(fbs[i]);
 			dp_framebuffer_free(fbs[i]);
 		}
+		if (dma_fds[i] >= 0)
+			close(dma_fds[i]);
+		if (gem_fds[i] >= 0)
+			close(gem_fds[i]);
+	}
+	if (handle != -1)
+		nx_scaler_close(handle);
+	free(list);
 
+	return ret;
+}
+
+/* one grid: every feed count from 1 to the cells of the grid */
+static int mosaic_bench_grid(int drm_fd, int handle, int cols, int rows,
+	const int *src_fds, uint32_t frames, uint32_t *lat)
+{
+	struct mosaic mos;
+	int gem_fds[MOSAIC_BUFFERS] = { -1, -1 };
+	int dma_fds[MOSAIC_BUFFERS] = { -1, -1 };
+	size_t dst_size = calc_alloc_size(MOSAIC_BENCH_W, MOSAIC_BENCH_H,
+					  V4L2_PIX_FMT_YUV420);
+	uint32_t p50 = 0, p90, p99 = 0, max, per_feed = 0;
+	uint32_t f;
+	int fit = 0;
+	int n, i;
+	int ret;
+
+	for (i = 0; i < MOSAIC_BUFFERS; i++) {
+		gem_fds[i] = alloc_gem(drm_fd, dst_size, NX_BO_CACHABLE);
+		dma_fds[i] = gem_fds[i] < 0 ? -1 :
+			gem_to_dmafd(drm_fd, gem_fds[i]);
+		if (dma_fds[i] < 0) {
+			fprintf(stderr, "failed to alloc mosaic buffer %d\n", i);
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+
+	ret = mosaic_init(&mos, drm_fd, init_scale_context, cols, rows,
+			  MOSAIC_BENCH_W, MOSAIC_BENCH_H, dma_fds, dst_size);
+	for (i = 0; !ret && i < mos.count; i++)
+		ret = mosaic_cell_source(&mos, i, MOSAIC_FEED_W,
+					 MOSAIC_FEED_H,
+					 MEDIA_BUS_FMT_YUYV8_2X8);
+	if (ret)
+		goto deinit;
+
+	printf("mosaic bench %dx%d in %ux%u, %ux%u feeds, %u frames\n",
+	       cols, rows, MOSAIC_BENCH_W, MOSAIC_BENCH_H, MOSAIC_FEED_W,
+	       MOSAIC_FEED_H, frames);
+
+	/* feeds in lock step, every cell in use changes every frame */
+	for (n = 1; n <= mos.count; n++) {
+		for (f = 0; f < BENCH_WARMUP_FRAMES + frames; f++) {
+			uint64_t t0 = replay_now_ns();
+
+			for (i = 0; i < n; i++)
+				mosaic_update(&mos, i, src_fds[i]);
+			if (mosaic_compose(&mos, handle) < 0) {
+				ret = -EIO;
+				goto deinit;
+			}
+
+			if (f >= BENCH_WARMUP_FRAMES)
+				lat[f - BENCH_WARMUP_FRAMES] =
+					(replay_now_ns() - t0) / 1000;
+		}
+
+		bench_percentiles(lat, frames, &p50, &p90, &p99, &max);
+		printf("  %d feeds: p50 %u us, p99 %u us, max %u us, %s\n", n,
+		       p50, p99, max,
+		       p99 <= MOSAIC_FRAME_US ? "30 fps" : "too slow");
+		if (p99 > MOSAIC_FRAME_US)
+			break;
+		fit = n;
+		per_feed = p99 / n;
+	}
+
+	printf("mosaic bench %dx%d: %d of %d feeds at 30 fps", cols, rows,
+	       fit, mos.count);
+	if (fit == mos.count && per_feed)
+		printf(", about %u would fit the frame time",
+		       MOSAIC_FRAME_US / per_feed);
+	printf("\n");
+
+deinit:
+	mosaic_print_stats(&mos);
+	mosaic_deinit(&mos);
+out:
+	for (i = 0; i < MOSAIC_BUFFERS; i++) {
 		if (dma_fds[i] >= 0)
 			close(dma_fds[i]);
 		if (gem_fds[i] >= 0)
 			close(gem_fds[i]);
+	}
 
-		if (dst_dma_fds[i] >= 0)
-			close(dst_dma_fds[i]);
-		if (dst_gem_fds[i] >= 0)
-			close(dst_gem_fds[i]);
+	return ret;
+}
+
+/*
+ * How many 720p feeds one mosaic takes at 30 fps (-V bench), in 2x2
+ * and 3x3 grids of a 1080p frame. Every feed hands in a frame before
+ * each compose, the worst case for dirty tracking. A feed count fits
+ * when the compose p99 stays in the frame time. No display, no sleeps,
+ * frames per feed count from -c.
+ */
+int scaler_mosaic_bench(int drm_fd, uint32_t frames)
+{
+	static const int grids[] = { 2, 3 };
+	int src_gems[MAX_MOSAIC_CELLS], src_fds[MAX_MOSAIC_CELLS];
+	size_t src_size = calc_alloc_size(MOSAIC_FEED_W, MOSAIC_FEED_H,
+					  V4L2_PIX_FMT_YUV420);
+	uint32_t *lat;
+	int last = grids[ARRAY_SIZE(grids) - 1];
+	int feeds = last * last;
+	int handle;
+	int ret = 0;
+	int i;
+
+	if (!frames)
+		frames = BENCH_DEFAULT_FRAMES;
+
+	for (i = 0; i < MAX_MOSAIC_CELLS; i++) {
+		src_gems[i] = -1;
+		src_fds[i] = -1;
+	}
+
+	lat = (uint32_t *)malloc(frames * sizeof(*lat));
+	if (!lat)
+		return -ENOMEM;
+
+	handle = scaler_open();
+	if (handle == -1) {
+		fprintf(stderr, "failed to open scaler\n");
+		free(lat);
+		return -ENODEV;
+	}
+
+	/* a picture of its own per feed, as separate cameras would give */
+	for (i = 0; i < feeds; i++) {
+		void *map;
+		size_t k;
+
+		src_gems[i] = alloc_gem(drm_fd, src_size, 0);
+		src_fds[i] = src_gems[i] < 0 ? -1 :
+			gem_to_dmafd(drm_fd, src_gems[i]);
+		if (src_fds[i] < 0) {
+			fprintf(stderr, "failed to alloc feed %d\n", i);
+			ret = -ENOMEM;
+			goto out;
+		}
+
+		map = mmap(NULL, src_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			   src_fds[i], 0);
+		if (map == MAP_FAILED) {
+			fprintf(stderr, "failed to mmap feed %d\n", i);
+			ret = -ENOMEM;
+			goto out;
+		}
+		for (k = 0; k < src_size; k++)
+			((uint8_t *)map)[k] = (uint8_t)(k * (7 + i) ^ (k >> 9));
+		munmap(map, src_size);
+	}
+
+	for (i = 0; i < (int)ARRAY_SIZE(grids); i++) {
+		ret = mosaic_bench_grid(drm_fd, handle, grids[i], grids[i],
+					src_fds, frames, lat);
+		if (ret)
+			break;
+	}
+
+out:
+	for (i = 0; i < MAX_MOSAIC_CELLS; i++) {
+		if (src_fds[i] >= 0)
+			close(src_fds[i]);
+		if (src_gems[i] >= 0)
+			close(src_gems[i]);
 	}
 	nx_scaler_close(handle);
+	free(lat);
 
 	return ret;
 }
@@ -506,26 +1337,23 @@ int scaler_test(struct dp_device *device, int drm_fd, uint32_t m, uint32_t w,
 int main(int argc, char *argv[])
 {
 	int ret, drm_fd, err;
-	uint32_t m, w, h, f, bus_f, count;
+	struct scaler_options o;
 	struct dp_device *device;
 	int dbg_on = 0;
-	uint32_t s_w, s_h;
-	struct rect crop;
-
-	crop.x = 0;
-	crop.y = 0;
-	crop.width = 0;
-	crop.height = 0;
 
 	dp_debug_on(dbg_on);
 
-	ret = handle_option(argc, argv, &m, &w, &h, &s_w, &s_h, &f, &bus_f,
-		&count, &crop);
+	ret = handle_option(argc, argv, &o);
 	if (ret) {
 		fprintf(stderr, "failed to handle_option\n");
 		return ret;
 	}
 
+	if (o.mosaic && (o.bench || o.replay)) {
+		fprintf(stderr, "-V can not be combined with -M or -I\n");
+		return -EINVAL;
+	}
+
 	printf(" open drm device \n");
 	drm_fd = open_drm_device();
 	if (drm_fd < 0) {
@@ -540,8 +1368,24 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
-	err = scaler_test(device, drm_fd, m, w, h, s_w, s_h, f, bus_f, count,
-			crop);
+	if (o.bench)
+		err = scaler_bench(drm_fd, o.bench, o.count);
+	else if (o.mosaic && !strcmp(o.mosaic, "bench"))
+		err = scaler_mosaic_bench(drm_fd, o.count);
+	else if (o.mosaic)
+		err = scaler_mosaic(device, drm_fd, o.mosaic, o.s_w, o.s_h,
+				    o.count);
+	else if (o.replay)
+		err = scaler_replay(device, drm_fd, o.replay, o.s_w, o.s_h,
+				    o.count, o.crop, o.fast, o.oracle,
+				    o.tile_limit, o.rois, o.rotate);
+	else
+		err = scaler_test(device, drm_fd, &o);
+
+	phase_print_waterfall();
+	if (o.trace)
+		phase_write_trace(o.trace);
+
 	if (err < 0) {
 		fprintf(stderr, "failed to do camera_test \n");
 		return -1;
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _SCALER_TEST_H
+#define _SCALER_TEST_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <dp.h>
+#include <nx-scaler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef ALIGN
+#define ALIGN(x, a) (((x) + (a) - 1) & ~((a) - 1))
+#endif
+
+#define MAX_BUFFER_COUNT	4
+
+/* display and buffer helpers of scaler-test.cpp the modes share */
+void set_plane(struct dp_device *device, struct dp_framebuffer *fb,
+	uint32_t w, uint32_t h);
+struct dp_framebuffer *display_buffer_init(struct dp_device *device, int x,
+	int y, int gem_fd, int buf_size);
+void init_scale_context(uint32_t w, uint32_t h, uint32_t s_w, uint32_t s_h,
+	uint32_t f, uint32_t plane_num, struct rect crop,
+	struct nx_scaler_context *s_ctx);
+size_t calc_alloc_size(uint32_t w, uint32_t h, uint32_t f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
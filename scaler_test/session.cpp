@@ -0,0 +1,519 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <linux/videodev2.h>
+
+#include <drm/nexell_drm.h>
+#include <media-bus-format.h>
+#include <nx-drm-allocator.h>
+#include <nx-v4l2.h>
+#ifdef NX_V4L2_MOCK
+#include <nx-v4l2-mock.h>
+#endif
+
+#include "frame-handoff.h"
+#include "phase-timer.h"
+#include "session.h"
+#include "tile-scale.h"
+
+#ifdef NX_V4L2_MOCK
+#define close_device(fd)	nx_v4l2_mock_close(fd)
+#else
+#define close_device(fd)	close(fd)
+#endif
+
+static int recover_stream(void *priv, enum watchdog_level level)
+{
+	struct scaler_recover *r = (struct scaler_recover *)priv;
+	uint32_t owned;
+	int ret, i;
+
+	if (level == WATCHDOG_RESET) {
+		ret = nx_v4l2_set_format(r->sensor_fd, nx_sensor_subdev,
+					 r->w, r->h, r->bus_f);
+		if (!ret)
+			ret = nx_v4l2_set_format(r->clipper_subdev_fd,
+						 nx_clipper_subdev, r->w, r->h,
+						 r->bus_f);
+		if (!ret)
+			ret = nx_v4l2_set_crop(r->clipper_subdev_fd,
+					       nx_clipper_subdev, r->clip.x,
+					       r->clip.y, r->clip.width,
+					       r->clip.height);
+		if (ret) {
+			fprintf(stderr, "failed to reset subdevs\n");
+			return ret;
+		}
+	}
+
+	/*
+	 * frames the -P consumer or the scale stage still hold are
+	 * requeued by them, r->lock keeps them out until streamon
+	 */
+	owned = __atomic_load_n(&r->owned, __ATOMIC_ACQUIRE);
+	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
+		if (owned & (1U << i))
+			continue;
+		ret = nx_v4l2_qbuf(r->video_fd, nx_clipper_video, 1, i,
+				   &r->dma_fds[i], (int *)&r->alloc_size);
+		if (ret) {
+			fprintf(stderr, "failed qbuf index %d\n", i);
+			return ret;
+		}
+	}
+
+	return nx_v4l2_streamon(r->video_fd, nx_clipper_video);
+}
+
+int recover_requeue(struct scaler_recover *r, int index)
+{
+	int ret;
+
+	pthread_mutex_lock(&r->lock);
+	ret = nx_v4l2_qbuf(r->video_fd, nx_clipper_video, 1, index,
+			   &r->dma_fds[index], (int *)&r->alloc_size);
+	if (!ret)
+		__atomic_fetch_and(&r->owned, ~(1U << index), __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&r->lock);
+
+	return ret;
+}
+
+int session_init(struct scaler_session *ss, struct dp_device *device,
+	int drm_fd, const struct scaler_options *o)
+{
+	int ret;
+
+	memset(ss, 0, sizeof(*ss));
+	ret = tile_parse_limit(o->tile_limit, &ss->max_w, &ss->max_h);
+	if (ret)
+		return ret;
+
+	ss->device = device;
+	ss->drm_fd = drm_fd;
+	ss->m = o->m;
+	ss->w = o->w;
+	ss->h = o->h;
+	ss->f = o->f ? o->f : V4L2_PIX_FMT_YUV420;
+	ss->bus_f = o->bus_f ? o->bus_f : MEDIA_BUS_FMT_YUYV8_2X8;
+	ss->s_w = o->s_w;
+	ss->s_h = o->s_h;
+	ss->crop = o->crop;
+	ss->full = o->crop;
+	if (!ss->full.width || !ss->full.height) {
+		ss->full.x = 0;
+		ss->full.y = 0;
+		ss->full.width = ss->w;
+		ss->full.height = ss->h;
+	}
+	ss->count = o->count;
+	ss->timeout = o->timeout;
+	ss->record = o->record;
+	ss->crop_pipe = o->crop_pipe;
+
+	ss->handle = -1;
+	ss->sensor_fd = -1;
+	ss->csi_subdev_fd = -1;
+	ss->clipper_subdev_fd = -1;
+	ss->clipper_video_fd = -1;
+	memset(ss->gem_fds, -1, sizeof(ss->gem_fds));
+	memset(ss->dma_fds, -1, sizeof(ss->dma_fds));
+	memset(ss->dst_gem_fds, -1, sizeof(ss->dst_gem_fds));
+	memset(ss->dst_dma_fds, -1, sizeof(ss->dst_dma_fds));
+	ss->ph_total = -1;
+	ss->ph = -1;
+	pthread_mutex_init(&ss->rec.lock, NULL);
+
+	return 0;
+}
+
+bool session_tiled(struct scaler_session *ss)
+{
+	return tile_needed(ss->full, ss->s_w, ss->s_h, ss->max_w, ss->max_h);
+}
+
+int session_refuse_tiling(struct scaler_session *ss, char flag)
+{
+	if (!session_tiled(ss))
+		return 0;
+
+	fprintf(stderr, "tiling can not be combined with -%c\n", flag);
+	return -EINVAL;
+}
+
+/*
+ * Leaves the "allocation" phase open, buffers a mode sets up on top of
+ * these count in it until session_start(). cpu_src and cpu_dst allocate
+ * cached buffers for the cpu to read, -R always reads src.
+ */
+int session_open(struct scaler_session *ss, uint32_t d_w, uint32_t d_h,
+	bool cpu_src, bool cpu_dst)
+{
+	uint32_t m = ss->m, w = ss->w, h = ss->h, f = ss->f;
+	uint32_t bus_f = ss->bus_f;
+	int ret;
+	int i;
+
+	ss->ph_total = phase_begin("first frame");
+
+	init_scale_context(w, h, ss->s_w, ss->s_h, bus_f, 1, ss->crop,
+			   &ss->s_ctx);
+
+	ss->ph = phase_begin("open");
+	ss->handle = scaler_open();
+	if (ss->handle == -1) {
+		fprintf(stderr, "failed to open scaler\n");
+		return -ENODEV;
+	}
+	ss->sensor_fd = nx_v4l2_open_device(nx_sensor_subdev, m);
+	if (ss->sensor_fd < 0) {
+		fprintf(stderr, "failed to open camera %d sensor\n", m);
+		return -1;
+	}
+
+	bool is_mipi = nx_v4l2_is_mipi_camera(m);
+
+	if (is_mipi) {
+		ss->csi_subdev_fd = nx_v4l2_open_device(nx_csi_subdev, m);
+		if (ss->csi_subdev_fd < 0) {
+			fprintf(stderr, "failed open mipi csi\n");
+			return -1;
+		}
+	}
+
+	ss->clipper_subdev_fd = nx_v4l2_open_device(nx_clipper_subdev, m);
+	if (ss->clipper_subdev_fd < 0) {
+		fprintf(stderr, "failed to open clipper_subdev %d\n", m);
+		return -1;
+	}
+
+	ss->clipper_video_fd = nx_v4l2_open_device(nx_clipper_video, m);
+	if (ss->clipper_video_fd < 0) {
+		fprintf(stderr, "failed to open clipper_video %d\n", m);
+		return -1;
+	}
+
+	phase_end(ss->ph);
+
+	nx_v4l2_streamoff(ss->clipper_video_fd, nx_clipper_video);
+
+	ss->ph = phase_begin("link");
+	ret = nx_v4l2_link(true, m, nx_clipper_subdev, 1,
+			nx_clipper_video, 0);
+	if (is_mipi) {
+		ret = nx_v4l2_link(true, m, nx_sensor_subdev, 0, nx_csi_subdev,
+				0);
+		if (ret) {
+			fprintf(stderr, "failed to link sensor to csi\n");
+			return ret;
+		}
+
+		ret = nx_v4l2_link(true, m, nx_csi_subdev, 1, nx_clipper_subdev,
+				0);
+		if (ret) {
+			fprintf(stderr, "failed to link csi to clipper\n");
+			return ret;
+		}
+	} else {
+		ret = nx_v4l2_link(true, m, nx_sensor_subdev, 0,
+				nx_clipper_subdev, 0);
+		if (ret) {
+			fprintf(stderr, "failed to link sensor to clipper\n");
+			return ret;
+		}
+	}
+	phase_end(ss->ph);
+
+	ss->ph = phase_begin("set_format");
+	ret = nx_v4l2_set_format(ss->sensor_fd, nx_sensor_subdev, w, h,
+			bus_f);
+	if (ret) {
+		fprintf(stderr, "failed to set_format for sensor\n");
+		return ret;
+	}
+
+	if (is_mipi) {
+		ret = nx_v4l2_set_format(ss->csi_subdev_fd, nx_csi_subdev, w, h,
+				f);
+		if (ret) {
+			fprintf(stderr, "failed to set_format for csi\n");
+			return ret;
+		}
+	}
+
+	ret = nx_v4l2_set_format(ss->clipper_subdev_fd, nx_clipper_subdev, w,
+			h, bus_f);
+	if (ret) {
+		fprintf(stderr, "failed to set_format for clipper subdev\n");
+		return ret;
+	}
+
+	ret = nx_v4l2_set_format(ss->clipper_video_fd, nx_clipper_video, w, h,
+			f);
+	if (ret) {
+		fprintf(stderr, "failed to set_format for clipper video\n");
+		return ret;
+	}
+
+	ret = nx_v4l2_set_crop(ss->clipper_subdev_fd, nx_clipper_subdev, 0, 0,
+			w, h);
+	if (ret) {
+		fprintf(stderr, "failed to set_crop for clipper subdev\n");
+		return ret;
+	}
+	phase_end(ss->ph);
+
+	ss->ph = phase_begin("reqbuf");
+	ret = nx_v4l2_reqbuf(ss->clipper_video_fd, nx_clipper_video,
+			MAX_BUFFER_COUNT);
+	if (ret) {
+		fprintf(stderr, "failed to reqbuf\n");
+		return ret;
+	}
+	phase_end(ss->ph);
+
+	ss->ph = phase_begin("allocation");
+	ss->alloc_size = calc_alloc_size(w, h, f);
+	if (ss->alloc_size <= 0) {
+		fprintf(stderr, "invalid alloc size %lu\n", ss->alloc_size);
+		return -1;
+	}
+
+	/* read by the cpu: cached, access bracketed with DMA_BUF_IOCTL_SYNC */
+	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
+		int gem_fd = alloc_gem(ss->drm_fd, ss->alloc_size,
+				       cpu_src || ss->record ?
+				       NX_BO_CACHABLE : 0);
+		if (gem_fd < 0) {
+			fprintf(stderr, "failed to alloc_gem\n");
+			return -1;
+		}
+		ss->gem_fds[i] = gem_fd;
+
+		int dma_fd = gem_to_dmafd(ss->drm_fd, gem_fd);
+		if (dma_fd < 0) {
+			fprintf(stderr, "failed to gem_to_dmafd\n");
+			return -1;
+		}
+		ss->dma_fds[i] = dma_fd;
+	}
+
+	ss->dst_alloc_size = calc_alloc_size(d_w, d_h, f);
+	if (ss->dst_alloc_size <= 0) {
+		fprintf(stderr, "invalid alloc size %lu\n",
+				ss->dst_alloc_size);
+		return -1;
+	}
+
+	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
+		int gem_fd = alloc_gem(ss->drm_fd, ss->dst_alloc_size,
+				       cpu_dst ? NX_BO_CACHABLE : 0);
+		if (gem_fd < 0) {
+			fprintf(stderr, "failed to alloc_gem\n");
+			return -1;
+		}
+		ss->dst_gem_fds[i] = gem_fd;
+
+		int dma_fd = gem_to_dmafd(ss->drm_fd, gem_fd);
+		if (dma_fd < 0) {
+			fprintf(stderr, "failed to gem_to_dmafd\n");
+			return -1;
+		}
+		ss->dst_dma_fds[i] = dma_fd;
+
+		ss->fbs[i] = display_buffer_init(ss->device, ss->s_w, ss->s_h,
+				gem_fd, static_cast<int>(ss->dst_alloc_size));
+		if (!ss->fbs[i]) {
+			printf("fail : framebuffer Init %m\n");
+			return -1;
+		}
+	}
+
+	ss->rec.video_fd = ss->clipper_video_fd;
+	ss->rec.sensor_fd = ss->sensor_fd;
+	ss->rec.clipper_subdev_fd = ss->clipper_subdev_fd;
+	ss->rec.dma_fds = ss->dma_fds;
+	ss->rec.alloc_size = ss->alloc_size;
+	ss->rec.w = w;
+	ss->rec.h = h;
+	ss->rec.bus_f = bus_f;
+	ss->rec.clip.x = 0;
+	ss->rec.clip.y = 0;
+	ss->rec.clip.width = w;
+	ss->rec.clip.height = h;
+	ss->rec.owned = 0;
+
+	return 0;
+}
+
+int session_start(struct scaler_session *ss)
+{
+	int ret;
+	int i;
+
+	phase_end(ss->ph);
+
+	if (ss->record) {
+		ret = trace_writer_open(&ss->trace, ss->record, ss->w, ss->h,
+					ss->f, ss->bus_f, ss->clipper_video_fd,
+					ss->dma_fds, MAX_BUFFER_COUNT,
+					ss->alloc_size);
+		if (ret) {
+			fprintf(stderr, "failed to open trace %s\n",
+				ss->record);
+			return ret;
+		}
+		ss->recording = true;
+	}
+
+	ss->ph = phase_begin("qbuf");
+	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
+		ret = nx_v4l2_qbuf(ss->clipper_video_fd, nx_clipper_video, 1,
+				i, &ss->dma_fds[i], (int *)&ss->alloc_size);
+		if (ret) {
+			fprintf(stderr, "failed qbuf index %d\n", i);
+			return ret;
+		}
+	}
+	phase_end(ss->ph);
+
+	ss->ph = phase_begin("streamon");
+	ret = nx_v4l2_streamon(ss->clipper_video_fd, nx_clipper_video);
+	if (ret) {
+		fprintf(stderr, "failed to streamon\n");
+		return ret;
+	}
+	ss->streaming = true;
+	phase_end(ss->ph);
+
+	if (ss->crop_pipe) {
+		ret = crop_ctl_init(&ss->cc, ss->crop_pipe, ss->w, ss->h,
+				    &ss->crop);
+		if (ret)
+			return ret;
+		ss->crop_ctl = &ss->cc;
+		ss->s_ctx.crop = ss->cc.cur;
+
+		ret = crop_ctl_start(&ss->cc);
+		if (ret)
+			return ret;
+	}
+
+	stall_watchdog_init(&ss->wd, ss->clipper_video_fd, nx_clipper_video,
+			    1, MAX_BUFFER_COUNT, ss->timeout, recover_stream,
+			    &ss->rec);
+	stall_watchdog_set_queue_lock(&ss->wd, &ss->rec.lock);
+	ss->watching = true;
+
+	ss->ph = phase_begin("first dqbuf");
+	return 0;
+}
+
+/* next captured frame, wait_us adds up the time spent waiting for it */
+int session_dqbuf(struct scaler_session *ss, int *index,
+	uint64_t *wait_us)
+{
+	uint64_t start = stage_now_us();
+	int ret;
+
+	ret = stall_watchdog_dqbuf(&ss->wd, index);
+	if (ret) {
+		fprintf(stderr, "failed to dqbuf\n");
+		return ret;
+	}
+	__atomic_fetch_or(&ss->rec.owned, 1U << *index, __ATOMIC_RELAXED);
+	if (wait_us)
+		*wait_us += stage_now_us() - start;
+
+	if (ss->ph >= 0) {
+		phase_end(ss->ph);
+		phase_end(ss->ph_total);
+		ss->ph = -1;
+	}
+
+	/* before a hand-off, which may requeue it at once */
+	if (ss->recording)
+		return trace_writer_add(&ss->trace, *index);
+
+	return 0;
+}
+
+int session_requeue(struct scaler_session *ss, int index)
+{
+	int ret;
+
+	ret = recover_requeue(&ss->rec, index);
+	if (ret)
+		fprintf(stderr, "failed qbuf index %d\n", index);
+
+	return ret;
+}
+
+void session_close(struct scaler_session *ss)
+{
+	int i;
+
+	if (ss->crop_ctl) {
+		crop_ctl_deinit(&ss->cc);
+		crop_ctl_print_stats(&ss->cc);
+	}
+
+	if (ss->recording)
+		trace_writer_close(&ss->trace);
+
+	if (ss->watching)
+		stall_watchdog_print_stats(&ss->wd);
+
+	if (ss->streaming)
+		nx_v4l2_streamoff(ss->clipper_video_fd, nx_clipper_video);
+
+	for (i = 0; i < MAX_BUFFER_COUNT; i++) {
+		if (ss->fbs[i]) {
+			dp_framebuffer_delfb2(ss->fbs[i]);
+			dp_framebuffer_free(ss->fbs[i]);
+		}
+
+		if (ss->dma_fds[i] >= 0)
+			close(ss->dma_fds[i]);
+		if (ss->gem_fds[i] >= 0)
+			close(ss->gem_fds[i]);
+
+		if (ss->dst_dma_fds[i] >= 0)
+			close(ss->dst_dma_fds[i]);
+		if (ss->dst_gem_fds[i] >= 0)
+			close(ss->dst_gem_fds[i]);
+	}
+
+	if (ss->clipper_video_fd >= 0)
+		close_device(ss->clipper_video_fd);
+	if (ss->clipper_subdev_fd >= 0)
+		close_device(ss->clipper_subdev_fd);
+	if (ss->csi_subdev_fd >= 0)
+		close_device(ss->csi_subdev_fd);
+	if (ss->sensor_fd >= 0)
+		close_device(ss->sensor_fd);
+	if (ss->handle != -1)
+		nx_scaler_close(ss->handle);
+
+	pthread_mutex_destroy(&ss->rec.lock);
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _SESSION_H
+#define _SESSION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include <dp.h>
+#include <nx-scaler.h>
+
+#include "capture-trace.h"
+#include "crop-ctl.h"
+#include "option.h"
+#include "scaler-test.h"
+#include "stall-watchdog.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* what the watchdog needs to bring a stalled stream back */
+struct scaler_recover {
+	int video_fd;
+	int sensor_fd;
+	int clipper_subdev_fd;
+	int *dma_fds;
+	size_t alloc_size;
+	uint32_t w;
+	uint32_t h;
+	uint32_t bus_f;
+	struct rect clip;	/* current clipper crop */
+	uint32_t owned;		/* indexes dequeued and not given back yet */
+	/* qbuf from other threads against streamoff + recover_stream() */
+	pthread_mutex_t lock;
+};
+
+/*
+ * Capture pipeline and buffers every mode of scaler_test() runs on.
+ * session_open() brings up the devices and buffers, session_start()
+ * queues them and starts streaming, session_close() undoes whatever of
+ * that got done.
+ */
+struct scaler_session {
+	struct dp_device *device;
+	int drm_fd;
+	uint32_t m;
+	uint32_t w;
+	uint32_t h;
+	uint32_t f;
+	uint32_t bus_f;
+	uint32_t s_w;		/* scaled and shown size */
+	uint32_t s_h;
+	struct rect crop;	/* -S, zero sized for the full frame */
+	struct rect full;	/* -S or the full frame */
+	uint32_t max_w;		/* largest scale the scaler takes (-G) */
+	uint32_t max_h;
+	uint32_t count;
+	uint32_t timeout;
+
+	struct nx_scaler_context s_ctx;
+	int handle;
+	int sensor_fd;
+	int csi_subdev_fd;
+	int clipper_subdev_fd;
+	int clipper_video_fd;
+
+	int gem_fds[MAX_BUFFER_COUNT];
+	int dma_fds[MAX_BUFFER_COUNT];
+	int dst_gem_fds[MAX_BUFFER_COUNT];
+	int dst_dma_fds[MAX_BUFFER_COUNT];
+	struct dp_framebuffer *fbs[MAX_BUFFER_COUNT];
+	size_t alloc_size;
+	size_t dst_alloc_size;
+
+	struct scaler_recover rec;
+	struct stall_watchdog wd;
+	const char *record;
+	struct capture_trace trace;
+	bool recording;
+	const char *crop_pipe;
+	struct crop_ctl cc;
+	struct crop_ctl *crop_ctl;	/* &cc once -C is running */
+	bool streaming;
+	bool watching;
+
+	int ph_total;
+	int ph;
+};
+
+int session_init(struct scaler_session *ss, struct dp_device *device,
+	int drm_fd, const struct scaler_options *o);
+/* too big for the scaler in one go, only the plain loop scales tiles */
+bool session_tiled(struct scaler_session *ss);
+int session_refuse_tiling(struct scaler_session *ss, char flag);
+int session_open(struct scaler_session *ss, uint32_t d_w, uint32_t d_h,
+	bool cpu_src, bool cpu_dst);
+int session_start(struct scaler_session *ss);
+int session_dqbuf(struct scaler_session *ss, int *index, uint64_t *wait_us);
+int session_requeue(struct scaler_session *ss, int index);
+void session_close(struct scaler_session *ss);
+
+/* gives index back to the driver from a thread other than the capture loop */
+int recover_requeue(struct scaler_recover *r, int index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,662 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <linux/videodev2.h>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <nx-scaler.h>
+
+#include "sw-scaler.h"
+
+#ifndef ALIGN
+#define ALIGN(x, a) (((x) + (a) - 1) & ~((a) - 1))
+#endif
+
+static uint64_t sw_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static double sw_kernel(enum sw_scale_filter filter, double d)
+{
+	if (d < 0)
+		d = -d;
+
+	if (filter == SW_SCALE_BILINEAR)
+		return d < 1.0 ? 1.0 - d : 0.0;
+
+	/* lanczos-2: sinc(d) * sinc(d / 2) */
+	if (d < 1e-6)
+		return 1.0;
+	if (d >= 2.0)
+		return 0.0;
+	return 2.0 * sin(M_PI * d) * sin(M_PI * d / 2.0) / (M_PI * M_PI * d * d);
+}
+
+/*
+ * window is how many source pixels each output pixel may touch, taps
+ * are folded into it at the crop edges so the kernels never read
+ * outside the crop; 0 means just the taps of the filter.
+ */
+static int sw_filter_init(struct sw_filter *fl, enum sw_scale_filter filter,
+			  uint32_t src_len, uint32_t dst_len, int window)
+{
+	double scale = (double)src_len / dst_len;
+	double stretch = 1.0;
+	double w[SW_SCALE_MAX_TAPS];
+	int taps, n, k;
+	uint32_t x;
+
+	if (filter == SW_SCALE_BILINEAR) {
+		taps = 2;
+	} else {
+		/* widened by the downscale ratio, aliases past 2:1 */
+		if (scale > 1.0)
+			stretch = scale;
+		taps = 2 * (int)ceil(2.0 * stretch);
+		if (taps > SW_SCALE_MAX_TAPS) {
+			taps = SW_SCALE_MAX_TAPS;
+			stretch = SW_SCALE_MAX_TAPS / 4.0;
+		}
+	}
+
+	n = window ? window : taps;
+	if (src_len < (uint32_t)n)
+		return -EINVAL;
+
+	fl->dst_len = dst_len;
+	fl->taps = n;
+	fl->start = (int32_t *)malloc(dst_len * sizeof(*fl->start));
+	fl->coef = (int16_t *)calloc(dst_len * SW_SCALE_MAX_TAPS,
+				     sizeof(*fl->coef));
+	if (!fl->start || !fl->coef)
+		return -ENOMEM;
+
+	for (x = 0; x < dst_len; x++) {
+		int16_t *coef = fl->coef + x * SW_SCALE_MAX_TAPS;
+		double center = (x + 0.5) * scale - 0.5;
+		double total = 0;
+		int base, start, sum = 0, peak = 0;
+
+		/* the hardware filter only knows a fixed set of phases */
+		if (filter == SW_SCALE_POLYPHASE)
+			center = floor(center * SW_SCALE_PHASES + 0.5) /
+				SW_SCALE_PHASES;
+
+		base = (int)floor(center) - taps / 2 + 1;
+		for (k = 0; k < taps; k++) {
+			w[k] = sw_kernel(filter, (base + k - center) / stretch);
+			total += w[k];
+		}
+
+		start = base < 0 ? 0 : base;
+		if (start > (int)src_len - n)
+			start = src_len - n;
+		fl->start[x] = start;
+
+		for (k = 0; k < taps; k++) {
+			int i = base + k;
+			int v = (int)lround(w[k] / total * SW_SCALE_ONE);
+
+			if (i < 0)
+				i = 0;
+			if (i > (int)src_len - 1)
+				i = src_len - 1;
+			coef[i - start] += v;
+			sum += v;
+		}
+
+		/* rounding error goes to the strongest tap */
+		for (k = 1; k < n; k++)
+			if (coef[k] > coef[peak])
+				peak = k;
+		coef[peak] += SW_SCALE_ONE - sum;
+	}
+
+	return 0;
+}
+
+static void sw_filter_deinit(struct sw_filter *fl)
+{
+	free(fl->start);
+	free(fl->coef);
+	fl->start = NULL;
+	fl->coef = NULL;
+}
+
+/* sum of rows[k] * coef[k] as 16 bit with 6 fraction bits */
+static void sw_vscale(int16_t *out, const uint8_t *const *rows,
+		      const int16_t *coef, int taps, uint32_t len)
+{
+	uint32_t x = 0;
+	int k;
+
+#if defined(__aarch64__)
+	for (; x + 8 <= len; x += 8) {
+		int32x4_t lo = vdupq_n_s32(1 << 7);
+		int32x4_t hi = lo;
+
+		for (k = 0; k < taps; k++) {
+			int16x8_t v = vreinterpretq_s16_u16(
+					vmovl_u8(vld1_u8(rows[k] + x)));
+
+			lo = vmlal_n_s16(lo, vget_low_s16(v), coef[k]);
+			hi = vmlal_n_s16(hi, vget_high_s16(v), coef[k]);
+		}
+		vst1q_s16(out + x, vcombine_s16(vshrn_n_s32(lo, 8),
+						 vshrn_n_s32(hi, 8)));
+	}
+#elif defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; x + 8 <= len; x += 8) {
+		__m128i lo = _mm_set1_epi32(1 << 7);
+		__m128i hi = lo;
+
+		/* two rows per madd, interleaved with their coefficients */
+		for (k = 0; k < taps; k += 2) {
+			__m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64(
+					(const __m128i *)(rows[k] + x)), zero);
+			__m128i b = zero;
+			uint32_t c = (uint16_t)coef[k];
+
+			if (k + 1 < taps) {
+				b = _mm_unpacklo_epi8(_mm_loadl_epi64(
+					(const __m128i *)(rows[k + 1] + x)), zero);
+				c |= (uint32_t)(uint16_t)coef[k + 1] << 16;
+			}
+
+			__m128i cc = _mm_set1_epi32(c);
+
+			lo = _mm_add_epi32(lo, _mm_madd_epi16(
+					_mm_unpacklo_epi16(a, b), cc));
+			hi = _mm_add_epi32(hi, _mm_madd_epi16(
+					_mm_unpackhi_epi16(a, b), cc));
+		}
+		_mm_storeu_si128((__m128i *)(out + x),
+				 _mm_packs_epi32(_mm_srai_epi32(lo, 8),
+						 _mm_srai_epi32(hi, 8)));
+	}
+#endif
+
+	for (; x < len; x++) {
+		int32_t acc = 1 << 7;
+
+		for (k = 0; k < taps; k++)
+			acc += coef[k] * rows[k][x];
+		out[x] = (int16_t)(acc >> 8);
+	}
+}
+
+static inline uint8_t sw_clamp(int32_t v)
+{
+	return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+/* 8 taps per output pixel, every step-th byte of out */
+static void sw_hscale(uint8_t *out, int step, const int16_t *in,
+		      const struct sw_filter *fl)
+{
+	const int32_t *start = fl->start;
+	const int16_t *coef = fl->coef;
+	uint32_t x = 0;
+	int k;
+
+#if defined(__aarch64__)
+	for (; x + 4 <= fl->dst_len; x += 4) {
+		int32x4_t a[4];
+
+		for (k = 0; k < 4; k++) {
+			int16x8_t s = vld1q_s16(in + start[x + k]);
+			int16x8_t c = vld1q_s16(coef +
+					(x + k) * SW_SCALE_MAX_TAPS);
+
+			a[k] = vmull_s16(vget_low_s16(s), vget_low_s16(c));
+			a[k] = vmlal_high_s16(a[k], s, c);
+		}
+
+		/* lane k ends up as the sum of a[k] */
+		int32x4_t sum = vpaddq_s32(vpaddq_s32(a[0], a[1]),
+					   vpaddq_s32(a[2], a[3]));
+		sum = vshrq_n_s32(vaddq_s32(sum, vdupq_n_s32(1 << 19)), 20);
+		int16x4_t h = vqmovn_s32(sum);
+		uint8x8_t v = vqmovun_s16(vcombine_s16(h, h));
+
+		out[x * step] = vget_lane_u8(v, 0);
+		out[(x + 1) * step] = vget_lane_u8(v, 1);
+		out[(x + 2) * step] = vget_lane_u8(v, 2);
+		out[(x + 3) * step] = vget_lane_u8(v, 3);
+	}
+#elif defined(__SSE2__)
+	for (; x + 4 <= fl->dst_len; x += 4) {
+		__m128i a[4];
+
+		for (k = 0; k < 4; k++)
+			a[k] = _mm_madd_epi16(
+				_mm_loadu_si128((const __m128i *)
+						(in + start[x + k])),
+				_mm_loadu_si128((const __m128i *)
+						(coef + (x + k) *
+						 SW_SCALE_MAX_TAPS)));
+
+		/* transpose and add, lane k ends up as the sum of a[k] */
+		__m128i t0 = _mm_add_epi32(_mm_unpacklo_epi32(a[0], a[1]),
+					   _mm_unpackhi_epi32(a[0], a[1]));
+		__m128i t1 = _mm_add_epi32(_mm_unpacklo_epi32(a[2], a[3]),
+					   _mm_unpackhi_epi32(a[2], a[3]));
+		__m128i sum = _mm_add_epi32(_mm_unpacklo_epi64(t0, t1),
+					    _mm_unpackhi_epi64(t0, t1));
+
+		sum = _mm_srai_epi32(_mm_add_epi32(sum,
+					_mm_set1_epi32(1 << 19)), 20);
+		sum = _mm_packs_epi32(sum, sum);
+		uint32_t v = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+
+		out[x * step] = v;
+		out[(x + 1) * step] = v >> 8;
+		out[(x + 2) * step] = v >> 16;
+		out[(x + 3) * step] = v >> 24;
+	}
+#endif
+
+	for (; x < fl->dst_len; x++) {
+		const int16_t *s = in + start[x];
+		const int16_t *c = coef + x * SW_SCALE_MAX_TAPS;
+		int32_t acc = 1 << 19;
+
+		for (k = 0; k < SW_SCALE_MAX_TAPS; k++)
+			acc += s[k] * c[k];
+		out[x * step] = sw_clamp(acc >> 20);
+	}
+}
+
+static void sw_scale_rows(struct sw_scaler *s, int p, const uint8_t *src,
+			  uint8_t *dst, uint32_t y0, uint32_t y1,
+			  int16_t *tmp, uint32_t tmp_len)
+{
+	const struct sw_plane *sp = &s->src[p];
+	const struct sw_plane *dp = &s->dst[p];
+	const struct sw_filter *hf = &s->hf[p ? 1 : 0];
+	const struct sw_filter *vf = &s->vf[p ? 1 : 0];
+	const uint8_t *rows[SW_SCALE_MAX_TAPS];
+	bool nv12 = p && s->planes == 2;
+	uint32_t len = nv12 ? sp->width * 2 : sp->width;
+	uint32_t xoff = nv12 ? sp->x * 2 : sp->x;
+	int16_t *cb = tmp + tmp_len;
+	int16_t *cr = cb + tmp_len;
+	uint32_t x, y;
+	int k;
+
+	for (y = y0; y < y1; y++) {
+		uint8_t *out = dst + dp->offset + y * dp->stride;
+
+		for (k = 0; k < vf->taps; k++)
+			rows[k] = src + sp->offset +
+				(sp->y + vf->start[y] + k) * sp->stride + xoff;
+		sw_vscale(tmp, rows, vf->coef + y * SW_SCALE_MAX_TAPS,
+			  vf->taps, len);
+
+		if (!nv12) {
+			sw_hscale(out, 1, tmp, hf);
+			continue;
+		}
+
+		/* split cb and cr so the horizontal taps stay contiguous */
+		for (x = 0; x < sp->width; x++) {
+			cb[x] = tmp[2 * x];
+			cr[x] = tmp[2 * x + 1];
+		}
+		sw_hscale(out, 2, cb, hf);
+		sw_hscale(out + 1, 2, cr, hf);
+	}
+}
+
+struct sw_band {
+	struct sw_scaler *s;
+	const uint8_t *src;
+	uint8_t *dst;
+	int index;
+	bool started;
+	pthread_t thread;
+};
+
+static void *sw_band_thread(void *data)
+{
+	struct sw_band *b = (struct sw_band *)data;
+	struct sw_scaler *s = b->s;
+	uint32_t tmp_len = ALIGN(s->src[0].width + 2, 16);
+	int p;
+
+	for (p = 0; p < s->planes; p++) {
+		uint32_t h = s->dst[p].height;
+
+		sw_scale_rows(s, p, b->src, b->dst,
+			      h * b->index / s->threads,
+			      h * (b->index + 1) / s->threads,
+			      s->tmp[b->index], tmp_len);
+	}
+
+	return NULL;
+}
+
+int sw_scale_parse_filter(const char *name, enum sw_scale_filter *filter)
+{
+	size_t len = strcspn(name, ",");
+
+	if (len == 8 && !strncmp(name, "bilinear", len)) {
+		*filter = SW_SCALE_BILINEAR;
+	} else if (len == 9 && !strncmp(name, "polyphase", len)) {
+		*filter = SW_SCALE_POLYPHASE;
+	} else {
+		fprintf(stderr, "unknown scale filter %.*s\n", (int)len, name);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int sw_scaler_init(struct sw_scaler *s, enum sw_scale_filter filter,
+		   int threads, uint32_t f,
+		   const struct nx_scaler_context *ctx)
+{
+	struct rect crop = ctx->crop;
+	uint32_t src_y_size, dst_y_size;
+	uint32_t tmp_len;
+	int ret = 0;
+	int i;
+
+	memset(s, 0, sizeof(*s));
+
+	if (f != V4L2_PIX_FMT_YUV420 && f != V4L2_PIX_FMT_NV12) {
+		fprintf(stderr, "software scaler supports I420 and NV12 only\n");
+		return -EINVAL;
+	}
+
+	if (!crop.width || !crop.height) {
+		crop.x = 0;
+		crop.y = 0;
+		crop.width = ctx->src_width;
+		crop.height = ctx->src_height;
+	}
+
+	if (crop.x + crop.width > ctx->src_width ||
+	    crop.y + crop.height > ctx->src_height) {
+		fprintf(stderr, "crop %ux%u+%u+%u is outside %ux%u\n",
+			crop.width, crop.height, crop.x, crop.y,
+			ctx->src_width, ctx->src_height);
+		return -EINVAL;
+	}
+
+	/* chroma still needs a full horizontal window */
+	if (crop.width < 2 * SW_SCALE_MAX_TAPS ||
+	    crop.height < 2 * SW_SCALE_MAX_TAPS ||
+	    ctx->dst_width < 2 || ctx->dst_height < 2) {
+		fprintf(stderr, "%ux%u to %ux%u is too small to scale\n",
+			crop.width, crop.height, ctx->dst_width,
+			ctx->dst_height);
+		return -EINVAL;
+	}
+
+	s->format = f;
+	s->filter = filter;
+	s->threads = threads < 1 ? 1 : threads > SW_SCALE_MAX_THREADS ?
+		SW_SCALE_MAX_THREADS : threads;
+	s->planes = f == V4L2_PIX_FMT_YUV420 ? 3 : 2;
+
+	s->src[0].stride = ctx->src_stride[0];
+	s->src[0].x = crop.x;
+	s->src[0].y = crop.y;
+	s->src[0].width = crop.width;
+	s->src[0].height = crop.height;
+
+	s->dst[0].stride = ctx->dst_stride[0];
+	s->dst[0].width = ctx->dst_width;
+	s->dst[0].height = ctx->dst_height;
+
+	src_y_size = ctx->src_stride[0] * ALIGN(ctx->src_height, 16);
+	dst_y_size = ctx->dst_stride[0] * ALIGN(ctx->dst_height, 16);
+
+	for (i = 1; i < s->planes; i++) {
+		struct sw_plane *sp = &s->src[i];
+		struct sw_plane *dp = &s->dst[i];
+
+		/* NV12 interleaves cb and cr at the luma stride */
+		sp->stride = s->planes == 2 ? ctx->src_stride[0] :
+			ctx->src_stride[i];
+		sp->offset = src_y_size;
+		if (i == 2)
+			sp->offset += s->src[1].stride *
+				ALIGN(ctx->src_height >> 1, 16);
+		sp->x = crop.x >> 1;
+		sp->y = crop.y >> 1;
+		sp->width = crop.width >> 1;
+		sp->height = crop.height >> 1;
+
+		dp->stride = s->planes == 2 ? ctx->dst_stride[0] :
+			ctx->dst_stride[i];
+		dp->offset = dst_y_size;
+		if (i == 2)
+			dp->offset += s->dst[1].stride *
+				ALIGN(ctx->dst_height >> 1, 16);
+		dp->width = ctx->dst_width >> 1;
+		dp->height = ctx->dst_height >> 1;
+	}
+
+	ret = sw_filter_init(&s->hf[0], filter, s->src[0].width,
+			     s->dst[0].width, SW_SCALE_MAX_TAPS);
+	if (!ret)
+		ret = sw_filter_init(&s->vf[0], filter, s->src[0].height,
+				     s->dst[0].height, 0);
+	if (!ret)
+		ret = sw_filter_init(&s->hf[1], filter, s->src[1].width,
+				     s->dst[1].width, SW_SCALE_MAX_TAPS);
+	if (!ret)
+		ret = sw_filter_init(&s->vf[1], filter, s->src[1].height,
+				     s->dst[1].height, 0);
+	if (ret) {
+		fprintf(stderr, "failed to build scale filters\n");
+		sw_scaler_deinit(s);
+		return ret;
+	}
+
+	/* vertical result, then cb and cr split out of it */
+	tmp_len = ALIGN(s->src[0].width + 2, 16);
+	for (i = 0; i < s->threads; i++) {
+		s->tmp[i] = (int16_t *)malloc(3 * tmp_len * sizeof(int16_t));
+		if (!s->tmp[i]) {
+			sw_scaler_deinit(s);
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+int sw_scaler_run(struct sw_scaler *s, const uint8_t *src, uint8_t *dst)
+{
+	struct sw_band bands[SW_SCALE_MAX_THREADS];
+	uint64_t start = sw_now_us(), t;
+	int i;
+
+	for (i = 0; i < s->threads; i++) {
+		bands[i].s = s;
+		bands[i].src = src;
+		bands[i].dst = dst;
+		bands[i].index = i;
+		/* the calling thread takes band 0 */
+		bands[i].started = i && !pthread_create(&bands[i].thread, NULL,
+							sw_band_thread,
+							&bands[i]);
+	}
+
+	for (i = 0; i < s->threads; i++)
+		if (!bands[i].started)
+			sw_band_thread(&bands[i]);
+
+	for (i = 1; i < s->threads; i++)
+		if (bands[i].started)
+			pthread_join(bands[i].thread, NULL);
+
+	t = sw_now_us() - start;
+	s->total_us += t;
+	if (t > s->max_us)
+		s->max_us = t;
+	s->runs++;
+
+	return 0;
+}
+
+void sw_scaler_deinit(struct sw_scaler *s)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		sw_filter_deinit(&s->hf[i]);
+		sw_filter_deinit(&s->vf[i]);
+	}
+
+	for (i = 0; i < SW_SCALE_MAX_THREADS; i++) {
+		free(s->tmp[i]);
+		s->tmp[i] = NULL;
+	}
+}
+
+/* component c of the dst layout: Y, Cb, Cr */
+static double sw_psnr(struct sw_scaler *s, int c, const uint8_t *a,
+		      const uint8_t *b)
+{
+	const struct sw_plane *pl = &s->dst[c < s->planes ? c : 1];
+	int step = c && s->planes == 2 ? 2 : 1;
+	uint32_t first = c == 2 && s->planes == 2 ? 1 : 0;
+	uint64_t sse = 0;
+	uint32_t x, y;
+	double mse, psnr;
+
+	for (y = 0; y < pl->height; y++) {
+		const uint8_t *pa = a + pl->offset + y * pl->stride + first;
+		const uint8_t *pb = b + pl->offset + y * pl->stride + first;
+
+		for (x = 0; x < pl->width; x++) {
+			int d = pa[x * step] - pb[x * step];
+
+			sse += d * d;
+		}
+	}
+
+	if (!sse)
+		return SW_PSNR_MAX;
+
+	mse = (double)sse / (pl->width * pl->height);
+	psnr = 10.0 * log10(255.0 * 255.0 / mse);
+	return psnr < SW_PSNR_MAX ? psnr : SW_PSNR_MAX;
+}
+
+int sw_compare_init(struct sw_compare *c, const char *arg, uint32_t f,
+		    const struct nx_scaler_context *ctx, size_t size)
+{
+	enum sw_scale_filter filter;
+	const char *p = strchr(arg, ',');
+	int threads = p ? atoi(p + 1) : SW_SCALE_MAX_THREADS;
+	int ret;
+	int i;
+
+	memset(c, 0, sizeof(*c));
+
+	ret = sw_scale_parse_filter(arg, &filter);
+	if (ret)
+		return ret;
+
+	ret = sw_scaler_init(&c->scaler, filter, threads, f, ctx);
+	if (ret)
+		return ret;
+
+	c->ref = (uint8_t *)malloc(size);
+	if (!c->ref) {
+		sw_scaler_deinit(&c->scaler);
+		return -ENOMEM;
+	}
+	c->size = size;
+
+	for (i = 0; i < 3; i++)
+		c->psnr_min[i] = SW_PSNR_MAX;
+
+	return 0;
+}
+
+int sw_compare_frame(struct sw_compare *c, const uint8_t *src,
+		     const uint8_t *hw)
+{
+	int ret;
+	int i;
+
+	ret = sw_scaler_run(&c->scaler, src, c->ref);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < 3; i++) {
+		double psnr = sw_psnr(&c->scaler, i, c->ref, hw);
+
+		c->psnr_sum[i] += psnr;
+		if (psnr < c->psnr_min[i])
+			c->psnr_min[i] = psnr;
+	}
+	c->frames++;
+
+	return 0;
+}
+
+void sw_compare_print_stats(struct sw_compare *c)
+{
+	struct sw_scaler *s = &c->scaler;
+
+	if (!c->frames)
+		return;
+
+	printf("compare %s, %d threads: %u frames, PSNR Y avg %.2f min %.2f, "
+	       "Cb avg %.2f min %.2f, Cr avg %.2f min %.2f dB\n",
+	       s->filter == SW_SCALE_BILINEAR ? "bilinear" : "polyphase",
+	       s->threads, c->frames,
+	       c->psnr_sum[0] / c->frames, c->psnr_min[0],
+	       c->psnr_sum[1] / c->frames, c->psnr_min[1],
+	       c->psnr_sum[2] / c->frames, c->psnr_min[2]);
+	printf("software scale: avg %llu us, max %llu us\n",
+	       (unsigned long long)(s->total_us / s->runs),
+	       (unsigned long long)s->max_us);
+}
+
+void sw_compare_deinit(struct sw_compare *c)
+{
+	sw_scaler_deinit(&c->scaler);
+	free(c->ref);
+	c->ref = NULL;
+}
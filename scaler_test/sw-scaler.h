@@ -0,0 +1,102 @@
+#ifndef _SW_SCALER_H
+#define _SW_SCALER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <nx-scaler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SW_SCALE_MAX_TAPS	8	/* horizontal loads are always 8 wide */
+#define SW_SCALE_PHASES		64	/* sub pixel positions of polyphase */
+#define SW_SCALE_MAX_THREADS	4
+#define SW_SCALE_ONE		(1 << 14)	/* coefficient sum */
+
+enum sw_scale_filter {
+	SW_SCALE_BILINEAR,
+	SW_SCALE_POLYPHASE,	/* lanczos-2, widened when scaling down */
+};
+
+/* one direction of one plane, coefficients for every output pixel */
+struct sw_filter {
+	uint32_t dst_len;
+	int taps;		/* coefficients applied per output pixel */
+	int32_t *start;		/* first source pixel, inside the crop */
+	int16_t *coef;		/* dst_len rows of SW_SCALE_MAX_TAPS */
+};
+
+struct sw_plane {
+	uint32_t offset;
+	uint32_t stride;
+	uint32_t x;		/* crop, source planes only */
+	uint32_t y;
+	uint32_t width;
+	uint32_t height;
+};
+
+/*
+ * CPU stand-in for nx_scaler_run() on I420 and NV12 buffers in the one
+ * fd layout of calc_alloc_size(): chroma starts at stride[0] *
+ * ALIGN(height, 16). Sizes, strides and crop come from the scaler
+ * context, so both paths can be fed from the same setup. Every plane is
+ * scaled vertically into a 16 bit row, then horizontally, dst rows are
+ * split into bands over up to SW_SCALE_MAX_THREADS threads.
+ */
+struct sw_scaler {
+	uint32_t format;	/* V4L2_PIX_FMT_YUV420 or V4L2_PIX_FMT_NV12 */
+	enum sw_scale_filter filter;
+	int threads;
+	int planes;		/* 3 for I420, 2 for NV12 */
+	struct sw_plane src[3];
+	struct sw_plane dst[3];
+	struct sw_filter hf[2];	/* luma, chroma */
+	struct sw_filter vf[2];
+	int16_t *tmp[SW_SCALE_MAX_THREADS];
+
+	uint32_t runs;
+	uint64_t total_us;
+	uint64_t max_us;
+};
+
+/* "bilinear" or "polyphase" */
+int sw_scale_parse_filter(const char *name, enum sw_scale_filter *filter);
+
+int sw_scaler_init(struct sw_scaler *s, enum sw_scale_filter filter,
+		   int threads, uint32_t f,
+		   const struct nx_scaler_context *ctx);
+/* src and dst are cpu mappings of the whole buffers */
+int sw_scaler_run(struct sw_scaler *s, const uint8_t *src, uint8_t *dst);
+void sw_scaler_deinit(struct sw_scaler *s);
+
+/*
+ * Oracle mode (-Q option): the frame the hardware just scaled is scaled
+ * once more on the cpu and both results are compared plane by plane.
+ */
+#define SW_PSNR_MAX		99.0	/* reported for identical planes */
+
+struct sw_compare {
+	struct sw_scaler scaler;
+	uint8_t *ref;
+	size_t size;
+
+	uint32_t frames;
+	double psnr_sum[3];
+	double psnr_min[3];
+};
+
+/* "<filter>[,<threads>]", size is the dst buffer size */
+int sw_compare_init(struct sw_compare *c, const char *arg, uint32_t f,
+		    const struct nx_scaler_context *ctx, size_t size);
+int sw_compare_frame(struct sw_compare *c, const uint8_t *src,
+		     const uint8_t *hw);
+void sw_compare_print_stats(struct sw_compare *c);
+void sw_compare_deinit(struct sw_compare *c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
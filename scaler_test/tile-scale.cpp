@@ -0,0 +1,454 @@
+/*
+ * Copyright (C) 2016  Nexell Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include <linux/videodev2.h>
+#include <linux/dma-buf.h>
+
+#include <drm/nexell_drm.h>
+#include <nx-drm-allocator.h>
+#include <nx-scaler.h>
+
+#include "tile-scale.h"
+
+#ifndef ALIGN
+#define ALIGN(x, a) (((x) + (a) - 1) & ~((a) - 1))
+#endif
+
+/* one axis of the grid */
+struct tile_span {
+	uint32_t src;		/* source window, relative to the crop */
+	uint32_t src_len;
+	uint32_t dst_len;	/* scaled window, overlap included */
+	uint32_t keep;		/* first kept pixel inside the window */
+	uint32_t out;		/* kept part in dst */
+	uint32_t out_len;
+};
+
+static uint64_t tile_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* chroma is subsampled, windows start and end on even pixels */
+static uint32_t even_round(double v)
+{
+	return 2 * (uint32_t)floor(v / 2.0 + 0.5);
+}
+
+/* how far the source position of dst pixel b is off an even pixel */
+static double tile_pos_err(double ratio, uint32_t b)
+{
+	double s = b * ratio;
+
+	return fabs(s - even_round(s));
+}
+
+/* a cut at b ends one window at b + ext and starts the next at b - ext */
+static double tile_cut_err(double ratio, uint32_t b, uint32_t ext,
+			   uint32_t dst_len)
+{
+	double lo = b > ext ? tile_pos_err(ratio, b - ext) : 0;
+	double hi = b + ext < dst_len ? tile_pos_err(ratio, b + ext) : 0;
+
+	return lo > hi ? lo : hi;
+}
+
+static int tile_split(struct tile_span *spans, int n, uint32_t src_len,
+		      uint32_t dst_len, uint32_t limit, uint32_t *err_mpx)
+{
+	double ratio = (double)src_len / dst_len;
+	uint32_t ext = 2 * (uint32_t)ceil(TILE_OVERLAP / ratio / 2.0);
+	uint32_t cuts[MAX_TILE_SPLIT + 1];
+	uint32_t worst = 0;
+	int k, d;
+
+	cuts[0] = 0;
+	cuts[n] = dst_len;
+	for (k = 1; k < n; k++) {
+		uint32_t ideal = even_round((double)dst_len * k / n);
+		uint32_t best = ideal;
+		double best_err = tile_cut_err(ratio, ideal, ext, dst_len);
+		double e;
+
+		for (d = 2; d <= TILE_PHASE_SEARCH; d += 2) {
+			if (ideal + d < dst_len) {
+				e = tile_cut_err(ratio, ideal + d, ext, dst_len);
+				if (e < best_err - 1e-9) {
+					best = ideal + d;
+					best_err = e;
+				}
+			}
+			if (ideal > cuts[k - 1] + d) {
+				e = tile_cut_err(ratio, ideal - d, ext, dst_len);
+				if (e < best_err - 1e-9) {
+					best = ideal - d;
+					best_err = e;
+				}
+			}
+		}
+
+		if (best <= cuts[k - 1])
+			return -EINVAL;
+		cuts[k] = best;
+	}
+
+	for (k = 0; k < n; k++) {
+		struct tile_span *sp = &spans[k];
+		uint32_t a = cuts[k], b = cuts[k + 1];
+		uint32_t ea = a > ext ? a - ext : 0;
+		uint32_t eb = b + ext < dst_len ? b + ext : dst_len;
+		uint32_t sa = ea ? even_round(ea * ratio) : 0;
+		uint32_t sb = eb < dst_len ? even_round(eb * ratio) : src_len;
+		uint32_t x;
+
+		if (sb > src_len)
+			sb = src_len;
+
+		sp->src = sa;
+		sp->src_len = sb - sa;
+		sp->dst_len = eb - ea;
+		sp->keep = a - ea;
+		sp->out = a;
+		sp->out_len = b - a;
+
+		if (sp->src_len > limit || sp->dst_len > limit)
+			return -E2BIG;
+
+		/* where the scaler samples the kept ends, against one pass */
+		for (x = a; x < b; x += b - a - 1 ? b - a - 1 : 1) {
+			double hw = sa + (x - ea + 0.5) * (sb - sa) /
+				(eb - ea) - 0.5;
+			double want = (x + 0.5) * ratio - 0.5;
+			uint32_t err = (uint32_t)(fabs(hw - want) * 1000 + 0.5);
+
+			if (err > worst)
+				worst = err;
+		}
+	}
+
+	*err_mpx = worst;
+	return 0;
+}
+
+int tile_parse_limit(const char *arg, uint32_t *max_w, uint32_t *max_h)
+{
+	*max_w = TILE_MAX_WIDTH;
+	*max_h = TILE_MAX_HEIGHT;
+	if (!arg)
+		return 0;
+
+	/* below the overlap a tile would be all overlap */
+	if (sscanf(arg, "%ux%u", max_w, max_h) != 2 ||
+	    *max_w < 4 * TILE_OVERLAP || *max_h < 4 * TILE_OVERLAP) {
+		fprintf(stderr, "invalid tile limit %s\n", arg);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+bool tile_needed(struct rect crop, uint32_t s_w, uint32_t s_h,
+		 uint32_t max_w, uint32_t max_h)
+{
+	return crop.width > max_w || s_w > max_w ||
+		crop.height > max_h || s_h > max_h;
+}
+
+int tile_plan_build(struct tile_plan *p, struct rect crop, uint32_t s_w,
+		    uint32_t s_h, uint32_t max_w, uint32_t max_h)
+{
+	struct tile_span xs[MAX_TILE_SPLIT], ys[MAX_TILE_SPLIT];
+	uint32_t ex = 0, ey = 0;
+	int c, r;
+
+	memset(p, 0, sizeof(*p));
+
+	for (p->cols = 1; p->cols <= MAX_TILE_SPLIT; p->cols++)
+		if (!tile_split(xs, p->cols, crop.width, s_w, max_w, &ex))
+			break;
+
+	for (p->rows = 1; p->rows <= MAX_TILE_SPLIT; p->rows++)
+		if (!tile_split(ys, p->rows, crop.height, s_h, max_h, &ey))
+			break;
+
+	if (p->cols > MAX_TILE_SPLIT || p->rows > MAX_TILE_SPLIT) {
+		fprintf(stderr, "%ux%u to %ux%u does not fit in %dx%d tiles "
+			"of %ux%u\n", crop.width, crop.height, s_w, s_h,
+			MAX_TILE_SPLIT, MAX_TILE_SPLIT, max_w, max_h);
+		return -E2BIG;
+	}
+
+	for (r = 0; r < p->rows; r++) {
+		for (c = 0; c < p->cols; c++) {
+			struct tile *t = &p->tiles[p->count++];
+
+			t->crop.x = crop.x + xs[c].src;
+			t->crop.y = crop.y + ys[r].src;
+			t->crop.width = xs[c].src_len;
+			t->crop.height = ys[r].src_len;
+			t->dst_width = xs[c].dst_len;
+			t->dst_height = ys[r].dst_len;
+			t->keep_x = xs[c].keep;
+			t->keep_y = ys[r].keep;
+			t->out.x = xs[c].out;
+			t->out.y = ys[r].out;
+			t->out.width = xs[c].out_len;
+			t->out.height = ys[r].out_len;
+			t->gem_fd = -1;
+			t->dma_fd = -1;
+		}
+	}
+	p->phase_err_mpx = ex > ey ? ex : ey;
+
+	return 0;
+}
+
+/* calc_alloc_size() layout at the scaler strides */
+static void tile_plane(const uint32_t *stride, uint32_t h, uint32_t f, int p,
+		       uint32_t *offset, uint32_t *pstride)
+{
+	uint32_t y_size = stride[0] * ALIGN(h, 16);
+
+	if (!p) {
+		*offset = 0;
+		*pstride = stride[0];
+	} else if (f == V4L2_PIX_FMT_NV12) {
+		*offset = y_size;
+		*pstride = stride[0];
+	} else {
+		*offset = y_size + (p == 2 ? stride[1] * ALIGN(h >> 1, 16) : 0);
+		*pstride = stride[p];
+	}
+}
+
+static size_t tile_size(const uint32_t *stride, uint32_t h, uint32_t f)
+{
+	uint32_t offset, pstride;
+
+	tile_plane(stride, h, f, f == V4L2_PIX_FMT_NV12 ? 1 : 2, &offset,
+		   &pstride);
+	return ALIGN(offset + pstride * ALIGN(h >> 1, 16), 4096);
+}
+
+static void tile_sync(int fd, uint64_t flags)
+{
+#ifdef DMA_BUF_IOCTL_SYNC
+	struct dma_buf_sync sync;
+
+	sync.flags = flags;
+	ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync);
+#endif
+}
+
+int tile_scaler_init(struct tile_scaler *t, int drm_fd, scale_build_t build,
+		     uint32_t w, uint32_t h, struct rect crop, uint32_t s_w,
+		     uint32_t s_h, uint32_t code, uint32_t f,
+		     uint32_t max_w, uint32_t max_h, const int *dst_fds,
+		     int count, size_t dst_size)
+{
+	struct nx_scaler_context full;
+	int ret;
+	int i;
+
+	memset(t, 0, sizeof(*t));
+
+	if (f != V4L2_PIX_FMT_YUV420 && f != V4L2_PIX_FMT_NV12) {
+		fprintf(stderr, "tiles can be stitched for I420 and NV12 only\n");
+		return -EINVAL;
+	}
+
+	if (count > MAX_TILE_DST) {
+		fprintf(stderr, "too many tile dst buffers %d\n", count);
+		return -EINVAL;
+	}
+
+	ret = tile_plan_build(&t->plan, crop, s_w, s_h, max_w, max_h);
+	if (ret)
+		return ret;
+
+	scale_cache_init(&t->cache, build);
+	t->format = f;
+	t->dst_width = s_w;
+	t->dst_height = s_h;
+	t->dst_count = count;
+	t->dst_fds = dst_fds;
+	t->dst_size = dst_size;
+
+	build(w, h, s_w, s_h, code, 1, crop, &full);
+	memcpy(t->dst_stride, full.dst_stride, sizeof(t->dst_stride));
+
+	for (i = 0; i < t->plan.count; i++) {
+		struct tile *tl = &t->plan.tiles[i];
+		void *map;
+
+		/* at most MAX_TILES entries, they are never evicted */
+		tl->ctx = scale_cache_get(&t->cache, w, h, tl->crop,
+					  tl->dst_width, tl->dst_height, code);
+		if (!tl->ctx)
+			return -EINVAL;
+
+		tl->size = tile_size(tl->ctx->dst_stride, tl->dst_height, f);
+		/* cached, tiles are read back by the cpu */
+		tl->gem_fd = alloc_gem(drm_fd, tl->size, NX_BO_CACHABLE);
+		tl->dma_fd = tl->gem_fd < 0 ? -1 :
+			gem_to_dmafd(drm_fd, tl->gem_fd);
+		if (tl->dma_fd < 0) {
+			fprintf(stderr, "failed to alloc tile %d\n", i);
+			return -ENOMEM;
+		}
+
+		map = mmap(NULL, tl->size, PROT_READ, MAP_SHARED, tl->dma_fd, 0);
+		if (map == MAP_FAILED) {
+			fprintf(stderr, "failed to mmap tile %d\n", i);
+			return -ENOMEM;
+		}
+		tl->map = (uint8_t *)map;
+	}
+
+	for (i = 0; i < count; i++) {
+		void *map = mmap(NULL, dst_size, PROT_READ | PROT_WRITE,
+				 MAP_SHARED, dst_fds[i], 0);
+
+		if (map == MAP_FAILED) {
+			fprintf(stderr, "failed to mmap dst %d\n", i);
+			return -ENOMEM;
+		}
+		t->dst_map[i] = (uint8_t *)map;
+	}
+
+	printf("tiling %ux%u+%u+%u to %ux%u as %dx%d tiles, worst phase "
+	       "error %u.%03u px\n", crop.width, crop.height, crop.x, crop.y,
+	       s_w, s_h, t->plan.cols, t->plan.rows,
+	       t->plan.phase_err_mpx / 1000, t->plan.phase_err_mpx % 1000);
+
+	return 0;
+}
+
+static void tile_stitch(struct tile_scaler *t, const struct tile *tl,
+			uint8_t *dst)
+{
+	int planes = t->format == V4L2_PIX_FMT_NV12 ? 2 : 3;
+	int p;
+
+	for (p = 0; p < planes; p++) {
+		/* NV12 chroma pairs keep the byte width of luma */
+		uint32_t xs = p && planes == 3 ? 1 : 0;
+		uint32_t ys = p ? 1 : 0;
+		uint32_t s_off, s_stride, d_off, d_stride, r;
+		const uint8_t *s;
+		uint8_t *d;
+
+		tile_plane(tl->ctx->dst_stride, tl->dst_height, t->format, p,
+			   &s_off, &s_stride);
+		tile_plane(t->dst_stride, t->dst_height, t->format, p, &d_off,
+			   &d_stride);
+
+		s = tl->map + s_off + (tl->keep_y >> ys) * s_stride +
+			(tl->keep_x >> xs);
+		d = dst + d_off + (tl->out.y >> ys) * d_stride +
+			(tl->out.x >> xs);
+		for (r = 0; r < tl->out.height >> ys; r++)
+			memcpy(d + r * d_stride, s + r * s_stride,
+			       tl->out.width >> xs);
+	}
+}
+
+int tile_scaler_run(struct tile_scaler *t, int handle, int src_fd, int dst)
+{
+	struct scale_job jobs[MAX_TILES];
+	uint64_t t0, t1, t2;
+	int i;
+
+	for (i = 0; i < t->plan.count; i++) {
+		jobs[i].ctx = t->plan.tiles[i].ctx;
+		jobs[i].src_fd = src_fd;
+		jobs[i].dst_fd = t->plan.tiles[i].dma_fd;
+	}
+
+	t0 = tile_now_us();
+	if (scale_batch_run(handle, jobs, t->plan.count)) {
+		fprintf(stderr, "failed to scale tiles\n");
+		t->errors++;
+		return -1;
+	}
+	t1 = tile_now_us();
+
+	tile_sync(t->dst_fds[dst], DMA_BUF_SYNC_START | DMA_BUF_SYNC_WRITE);
+	for (i = 0; i < t->plan.count; i++) {
+		struct tile *tl = &t->plan.tiles[i];
+
+		tile_sync(tl->dma_fd, DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ);
+		tile_stitch(t, tl, t->dst_map[dst]);
+		tile_sync(tl->dma_fd, DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ);
+	}
+	tile_sync(t->dst_fds[dst], DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE);
+	t2 = tile_now_us();
+
+	t->scale_us += t1 - t0;
+	t->stitch_us += t2 - t1;
+	if (t2 - t0 > t->max_us)
+		t->max_us = t2 - t0;
+	t->frames++;
+
+	return 0;
+}
+
+void tile_scaler_print_stats(struct tile_scaler *t)
+{
+	if (!t->frames)
+		return;
+
+	printf("tiling: %u frames, %u errors, scale avg %llu us, stitch avg "
+	       "%llu us, max %llu us per frame\n", t->frames, t->errors,
+	       (unsigned long long)(t->scale_us / t->frames),
+	       (unsigned long long)(t->stitch_us / t->frames),
+	       (unsigned long long)t->max_us);
+}
+
+void tile_scaler_deinit(struct tile_scaler *t)
+{
+	int i;
+
+	for (i = 0; i < t->plan.count; i++) {
+		struct tile *tl = &t->plan.tiles[i];
+
+		if (tl->map)
+			munmap(tl->map, tl->size);
+		if (tl->dma_fd >= 0)
+			close(tl->dma_fd);
+		if (tl->gem_fd >= 0)
+			close(tl->gem_fd);
+	}
+
+	for (i = 0; i < t->dst_count; i++)
+		if (t->dst_map[i])
+			munmap(t->dst_map[i], t->dst_size);
+}
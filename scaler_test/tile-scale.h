@@ -0,0 +1,101 @@
+#ifndef _TILE_SCALE_H
+#define _TILE_SCALE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <nx-scaler.h>
+
+#include "scale-cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TILE_MAX_WIDTH		2048	/* scaler line buffer */
+#define TILE_MAX_HEIGHT		2048
+#define MAX_TILE_SPLIT		4	/* per axis */
+#define MAX_TILES		(MAX_TILE_SPLIT * MAX_TILE_SPLIT)
+#define TILE_OVERLAP		16	/* source pixels of filter context */
+#define TILE_PHASE_SEARCH	32	/* dst pixels a cut may move */
+#define MAX_TILE_DST		8
+
+struct tile {
+	struct rect crop;	/* source window, overlap included */
+	uint32_t dst_width;	/* what the scaler writes for it */
+	uint32_t dst_height;
+	uint32_t keep_x;	/* start of the part that is kept */
+	uint32_t keep_y;
+	struct rect out;	/* where the kept part goes in dst */
+
+	struct nx_scaler_context *ctx;
+	int gem_fd;
+	int dma_fd;
+	uint8_t *map;
+	size_t size;
+};
+
+/*
+ * Crop + scale split into a grid of tiles that each fit the scaler
+ * limits. Cuts sit on even dst pixels whose source position is as
+ * close to an even source pixel as the search allows, so every tile
+ * starts in the same filter phase as the whole frame would. Tiles
+ * overlap by TILE_OVERLAP source pixels and the overlap is cut away
+ * again when the tiles are stitched.
+ *
+ * Sources are addressed in place through the crop of each tile, the
+ * context has no dst offset, so every tile is scaled into a buffer of
+ * its own and copied into dst.
+ */
+struct tile_plan {
+	int cols;
+	int rows;
+	int count;
+	struct tile tiles[MAX_TILES];
+	uint32_t phase_err_mpx;	/* worst source phase error, 1/1000 px */
+};
+
+struct tile_scaler {
+	struct tile_plan plan;
+	struct scale_cache cache;
+	uint32_t format;	/* V4L2_PIX_FMT_YUV420 or V4L2_PIX_FMT_NV12 */
+	uint32_t dst_width;
+	uint32_t dst_height;
+	uint32_t dst_stride[3];
+	int dst_count;
+	const int *dst_fds;
+	uint8_t *dst_map[MAX_TILE_DST];
+	size_t dst_size;
+
+	uint32_t frames;
+	uint32_t errors;
+	uint64_t scale_us;
+	uint64_t stitch_us;
+	uint64_t max_us;
+};
+
+/* "<w>x<h>" (-G option), NULL keeps TILE_MAX_WIDTH x TILE_MAX_HEIGHT */
+int tile_parse_limit(const char *arg, uint32_t *max_w, uint32_t *max_h);
+/* crop must not be empty */
+bool tile_needed(struct rect crop, uint32_t s_w, uint32_t s_h,
+		 uint32_t max_w, uint32_t max_h);
+/* one tile if the scaler can do it in one go */
+int tile_plan_build(struct tile_plan *p, struct rect crop, uint32_t s_w,
+		    uint32_t s_h, uint32_t max_w, uint32_t max_h);
+
+/* dst_fds are the count buffers tile_scaler_run() may stitch into */
+int tile_scaler_init(struct tile_scaler *t, int drm_fd, scale_build_t build,
+		     uint32_t w, uint32_t h, struct rect crop, uint32_t s_w,
+		     uint32_t s_h, uint32_t code, uint32_t f,
+		     uint32_t max_w, uint32_t max_h, const int *dst_fds,
+		     int count, size_t dst_size);
+int tile_scaler_run(struct tile_scaler *t, int handle, int src_fd, int dst);
+void tile_scaler_print_stats(struct tile_scaler *t);
+void tile_scaler_deinit(struct tile_scaler *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -26,6 +26,11 @@
 #include <media-bus-format.h>
 #include <nx-drm-allocator.h>
 #include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+
+#include "NX_PhaseTimer.h"
+#include "Util.h"
 
 #ifndef ALIGN
 #define ALIGN(x, a) (((x) + (a) - 1) & ~((a) - 1))
@@ -35,6 +40,13 @@
 NX_CV4l2Camera::NX_CV4l2Camera()
 	: m_hV4l2		( NULL )
 	, m_iCurQueuedSize( 0 )
+	, m_iFirstFramePhase( -1 )
+	, m_iDqTimeout	( CAMERA_DQ_TIMEOUT )
+	, m_iRecoverCnt	( 0 )
+	, m_iFrameCnt	( 0 )
+	, m_iStallCnt	( 0 )
+	, m_iTotalRecoverCnt( 0 )
+	, m_iLastFrameTime( 0 )
 {
 	for(int32_t i = 0; i < MAX_BUF_NUM; i++ )
 	{
@@ -54,37 +66,47 @@ NX_CV4l2Camera::~NX_CV4l2Camera()
 int32_t NX_CV4l2Camera::V4l2CameraInit( NX_V4l2_INFO *pInfo, int32_t bUseMipi )
 {
 	int32_t ret = 0, i = 0;
+	int32_t iPhase;
 
+	iPhase = NX_PhaseBegin( "camera open" );
 	ret = V4l2OpenDevices( pInfo );
 	if( -1 == ret )
 	{
 		printf( "Fail, V4l2OpenDevices().\n" );
 		return -1;
 	}
+	NX_PhaseEnd( iPhase );
 
 	pInfo->cameraBufNum = CAMERA_BUF_NUM;
 
+	iPhase = NX_PhaseBegin( "camera link" );
 	ret = V4l2Link( pInfo );
 	if( -1 == ret )
 	{
 		printf( "Fail, V4l2Link().\n" );
 		return -1;
 	}
+	NX_PhaseEnd( iPhase );
 
+	iPhase = NX_PhaseBegin( "camera set_format" );
 	ret = V4l2SetFormat( pInfo, bUseMipi );
 	if( -1 == ret )
 	{
 		printf( "Fail, V4l2SetFormat().\n" );
 		return -1;
 	}
+	NX_PhaseEnd( iPhase );
 
+	iPhase = NX_PhaseBegin( "camera allocation" );
 	ret = V4l2CreateBuffer(pInfo);
 	if (ret == -1)
 	{
 		printf( "Fail, V4l2CreateBuffer().\n" );
 		return -1;
 	}
+	NX_PhaseEnd( iPhase );
 
+	iPhase = NX_PhaseBegin( "camera reqbuf" );
 	ret = nx_v4l2_reqbuf(pInfo->clipperVideoFd, nx_clipper_video,
 						pInfo->cameraBufNum);
 	if (ret)
@@ -92,7 +114,9 @@ int32_t NX_CV4l2Camera::V4l2CameraInit( NX_V4l2_INFO *pInfo, int32_t bUseMipi )
 		printf( "failed to reqbuf\n");
 		return -1;
 	}
+	NX_PhaseEnd( iPhase );
 
+	iPhase = NX_PhaseBegin( "camera qbuf" );
 	for (i = 0; i < pInfo->cameraBufNum; i++)
 	{
 		ret = nx_v4l2_qbuf(pInfo->clipperVideoFd,
@@ -105,13 +129,20 @@ int32_t NX_CV4l2Camera::V4l2CameraInit( NX_V4l2_INFO *pInfo, int32_t bUseMipi )
 			return -1;
 		}
 	}
+	NX_PhaseEnd( iPhase );
 
+	iPhase = NX_PhaseBegin( "camera streamon" );
 	ret = nx_v4l2_streamon(pInfo->clipperVideoFd, nx_clipper_video);
 	if (ret)
 	{
 		printf( "failed to streamon");
 		return -1;
 	}
+	NX_PhaseEnd( iPhase );
+
+	//	closed by the first successful DequeueBuffer()
+	m_iFirstFramePhase = NX_PhaseBegin( "camera first dqbuf" );
+	m_iLastFrameTime = NX_GetTickCount();
 
 	return 0;
 }
@@ -374,6 +405,9 @@ int32_t NX_CV4l2Camera::Init( NX_VIP_INFO *pInfo )
 	m_hV4l2->cropWidth = pInfo->iCropWidth;
 	m_hV4l2->cropHeight = pInfo->iCropHeight;
 
+	if( pInfo->iDqTimeout > 0 )
+		m_iDqTimeout = pInfo->iDqTimeout;
+
 	ret = V4l2CameraInit( m_hV4l2, pInfo->bUseMipi );
 	if( -1 == ret )
 	{
@@ -389,6 +423,9 @@ void NX_CV4l2Camera::Deinit( void )
 {
 	if( m_hV4l2 )
 	{
+		printf( "Camera : %u frames, %u stalls, %u recoveries\n",
+			m_iFrameCnt, m_iStallCnt, m_iTotalRecoverCnt );
+
 		if( m_hV4l2 )
 		{
 			V4l2Deinit( m_hV4l2 );
@@ -486,14 +523,22 @@ int32_t NX_CV4l2Camera::DequeueBuffer( int32_t *pBufferIndex, NX_VID_MEMORY_INFO
 	}
 	pthread_mutex_unlock( &m_hLock );
 
-	iRet = nx_v4l2_dqbuf(m_hV4l2->clipperVideoFd, nx_clipper_video, m_hV4l2->numPlane, &iSlotIndex);
-
+	iRet = V4l2WaitFrame();
 	if( 0 > iRet )
-	{
+		printf( "Fail, V4l2WaitFrame().\n" );
+	else if( 0 > (iRet = nx_v4l2_dqbuf(m_hV4l2->clipperVideoFd, nx_clipper_video, m_hV4l2->numPlane, &iSlotIndex)) )
 		printf( "Fail, nx_v4l2_dqbuf().\n" );
-		return iRet;
+
+	//	also when the stream gave up, the report then shows the time spent waiting
+	if( m_iFirstFramePhase >= 0 )
+	{
+		NX_PhaseEnd( m_iFirstFramePhase );
+		m_iFirstFramePhase = -1;
 	}
 
+	if( 0 > iRet )
+		return iRet;
+
 	*ppVidMem = m_pMemSlot[iSlotIndex];
 	m_pMemSlot[iSlotIndex] = NULL;
 	if( *ppVidMem == NULL )
@@ -525,6 +570,112 @@ int32_t NX_CV4l2Camera::DequeueBuffer( int32_t *pBufferIndex, NX_VID_MEMORY_INFO
 	m_iCurQueuedSize--;
 	pthread_mutex_unlock( &m_hLock );
 
+	m_iFrameCnt++;
+	m_iRecoverCnt = 0;
+	m_iLastFrameTime = NX_GetTickCount();
+
+	return iRet;
+}
+
+//------------------------------------------------------------------------------
+//	Wait for a frame at most m_iDqTimeout. A stalled stream is restarted,
+//	the second time in a row the sensor and clipper are programmed again.
+//
+int32_t NX_CV4l2Camera::V4l2WaitFrame( void )
+{
+	struct pollfd hPoll;
+	int32_t iRet;
+
+	hPoll.fd = m_hV4l2->clipperVideoFd;
+	hPoll.events = POLLIN;
+
+	for( ;; )
+	{
+		iRet = poll( &hPoll, 1, m_iDqTimeout );
+		if( 0 < iRet )
+			return 0;
+
+		if( 0 > iRet )
+		{
+			if( errno == EINTR )
+				continue;
+			printf( "Fail, poll().\n" );
+			return -1;
+		}
+
+		m_iStallCnt++;
+		printf( "Camera stall : no frame for %llu msec, %d buffers queued, last frame %u\n",
+			(unsigned long long)(NX_GetTickCount() - m_iLastFrameTime),
+			m_iCurQueuedSize, m_iFrameCnt );
+
+		if( m_iRecoverCnt >= CAMERA_MAX_RECOVERY )
+		{
+			printf( "Fail, camera did not recover after %d tries.\n", m_iRecoverCnt );
+			return -1;
+		}
+
+		iRet = V4l2Recover( m_iRecoverCnt > 0 );
+		m_iRecoverCnt++;
+		m_iTotalRecoverCnt++;
+		if( 0 > iRet )
+		{
+			printf( "Fail, V4l2Recover().\n" );
+			return -1;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+int32_t NX_CV4l2Camera::V4l2Recover( int32_t bResetSubdev )
+{
+	uint64_t startTime = NX_GetTickCount();
+	int32_t iRet = 0;
+
+	pthread_mutex_lock( &m_hLock );
+
+	//	every buffer comes back, the ones in a slot were queued
+	nx_v4l2_streamoff( m_hV4l2->clipperVideoFd, nx_clipper_video );
+
+	if( bResetSubdev )
+	{
+		iRet = nx_v4l2_set_format( m_hV4l2->sensorFd, nx_sensor_subdev, m_hV4l2->width, m_hV4l2->height, m_hV4l2->busFormat );
+		if( 0 == iRet )
+			iRet = nx_v4l2_set_format( m_hV4l2->clipperSubdevFd, nx_clipper_subdev, m_hV4l2->width, m_hV4l2->height, m_hV4l2->busFormat );
+		if( 0 == iRet && m_hV4l2->cropWidth && m_hV4l2->cropHeight )
+			iRet = nx_v4l2_set_crop( m_hV4l2->clipperSubdevFd, nx_clipper_subdev,
+									m_hV4l2->cropX, m_hV4l2->cropY,
+									m_hV4l2->cropWidth, m_hV4l2->cropHeight );
+		if( 0 != iRet )
+		{
+			printf( "Fail, subdev reset.\n" );
+			goto ERROR;
+		}
+	}
+
+	for( int32_t i = 0; i < m_hV4l2->cameraBufNum; i++ )
+	{
+		if( m_pMemSlot[i] == NULL )
+			continue;
+
+		iRet = nx_v4l2_qbuf( m_hV4l2->clipperVideoFd, nx_clipper_video, m_hV4l2->numPlane, i,
+							&m_hV4l2->dmaFds[i], (int32_t *)&m_hV4l2->cameraBufSize );
+		if( 0 != iRet )
+		{
+			printf( "Fail, nx_v4l2_qbuf(). ( index = %d )\n", i );
+			goto ERROR;
+		}
+	}
+
+	iRet = nx_v4l2_streamon( m_hV4l2->clipperVideoFd, nx_clipper_video );
+	if( 0 != iRet )
+		printf( "Fail, nx_v4l2_streamon().\n" );
+
+ERROR:
+	pthread_mutex_unlock( &m_hLock );
+
+	printf( "Camera %s %s ( %llu msec )\n", bResetSubdev ? "reset" : "restart",
+		iRet ? "failed" : "done", (unsigned long long)(NX_GetTickCount() - startTime) );
+
 	return iRet;
 }
 
@@ -55,8 +55,13 @@ typedef struct _NX_VIP_INFO
 
 	int32_t		iOutWidth;		//	Decimator width
 	int32_t		iOutHeight;		//	Decimator height
+
+	int32_t		iDqTimeout;		//	Stall timeout (msec), 0 = default
 } NX_VIP_INFO;
 
+#define CAMERA_DQ_TIMEOUT		1000	//	msec
+#define CAMERA_MAX_RECOVERY		3		//	in a row, then DequeueBuffer() fails
+
 #define CAMERA_BUF_NUM	8
 typedef struct _NX_V4l2_INFO
 {
@@ -113,6 +118,8 @@ private:
 	int32_t	V4l2CreateBuffer( NX_V4l2_INFO *pInfo );
 	int32_t	V4l2CalcAllocSize(uint32_t width, uint32_t height, uint32_t format);
 	void	V4l2Deinit( NX_V4l2_INFO *pInfo );
+	int32_t	V4l2WaitFrame( void );
+	int32_t	V4l2Recover( int32_t bResetSubdev );
 
 private:
 	enum {	MAX_BUF_NUM = 32 };
@@ -120,8 +127,17 @@ private:
 	NX_V4l2_INFO			*m_hV4l2;
 	NX_VID_MEMORY_INFO		*m_pMemSlot[MAX_BUF_NUM];
 	int32_t					m_iCurQueuedSize;
+	int32_t					m_iFirstFramePhase;
 	pthread_mutex_t			m_hLock;
 
+	//	stall watchdog
+	int32_t					m_iDqTimeout;
+	int32_t					m_iRecoverCnt;		//	recoveries since the last frame
+	uint32_t				m_iFrameCnt;
+	uint32_t				m_iStallCnt;
+	uint32_t				m_iTotalRecoverCnt;
+	uint64_t				m_iLastFrameTime;
+
 private:
 	NX_CV4l2Camera (NX_CV4l2Camera &Ref);
 	NX_CV4l2Camera &operator=(NX_CV4l2Camera &Ref);
@@ -0,0 +1,233 @@
+//------------------------------------------------------------------------------
+//
+//	Copyright (C) 2016 Nexell Co. All Rights Reserved
+//	Nexell Co. Proprietary & Confidential
+//
+//	NEXELL INFORMS THAT THIS CODE AND INFORMATION IS PROVIDED "AS IS" BASE
+//  AND	WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS
+//  FOR A PARTICULAR PURPOSE.
+//
+//	Module		: Capture Trace
+//	File		:
+//	Description	:
+//	Author		:
+//	Export		:
+//	History		:
+//
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/videodev2.h>
+
+#include "NX_CaptureTrace.h"
+
+#ifndef ALIGN
+#define ALIGN(X,N)		( ((X) + (N) - 1) & ~((N) - 1) )
+#endif
+
+//	On-disk layout, must match common/capture-trace.h
+#define TRACE_MAGIC			0x5443584e		//	"NXCT"
+#define TRACE_RECORD_MAGIC	0x5246584e		//	"NXFR"
+#define TRACE_VERSION		1
+
+typedef struct {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	headerSize;
+	uint32_t	recordSize;
+	uint32_t	frameSize;
+	uint32_t	width;
+	uint32_t	height;
+	uint32_t	format;
+	uint32_t	busFormat;
+	uint32_t	numPlanes;
+	uint32_t	offset[3];
+	uint32_t	stride[3];
+	uint32_t	frameCount;
+	uint32_t	reserved;
+	uint64_t	firstTimeStamp;
+	uint64_t	lastTimeStamp;
+} TRACE_HEADER;
+
+typedef struct {
+	uint32_t	magic;
+	uint32_t	sequence;
+	uint64_t	timeStamp;
+	uint32_t	bytesUsed;
+	uint32_t	index;
+} TRACE_RECORD;
+
+struct NX_CAPTURE_TRACE {
+	int32_t			fd;
+	uint8_t			*pMap;
+	uint64_t		mapSize;
+	TRACE_HEADER	hdr;
+};
+
+//------------------------------------------------------------------------------
+static const uint8_t *GetFrame( NX_CAPTURE_TRACE *pTrace, uint32_t iFrame, const TRACE_RECORD **ppRec )
+{
+	uint64_t offset = (uint64_t)pTrace->hdr.headerSize + (uint64_t)iFrame * pTrace->hdr.recordSize;
+	const TRACE_RECORD *pRec;
+
+	if( offset + pTrace->hdr.recordSize > pTrace->mapSize )
+		return NULL;
+
+	pRec = (const TRACE_RECORD*)(pTrace->pMap + offset + pTrace->hdr.recordSize - sizeof(TRACE_RECORD));
+	if( pRec->magic != TRACE_RECORD_MAGIC )
+		return NULL;
+
+	if( ppRec )
+		*ppRec = pRec;
+	return pTrace->pMap + offset;
+}
+
+//------------------------------------------------------------------------------
+NX_CAPTURE_TRACE_HANDLE NX_CaptureTraceOpen( const char *pFileName )
+{
+	NX_CAPTURE_TRACE *pTrace;
+	struct stat st;
+	void *pMap;
+	uint32_t iCount;
+
+	pTrace = (NX_CAPTURE_TRACE*)calloc( 1, sizeof(NX_CAPTURE_TRACE) );
+	if( !pTrace )
+		return NULL;
+
+	pTrace->fd = open( pFileName, O_RDONLY );
+	if( pTrace->fd < 0 )
+	{
+		printf( "Fail, open %s.\n", pFileName );
+		free( pTrace );
+		return NULL;
+	}
+
+	if( fstat( pTrace->fd, &st ) || st.st_size < (off_t)sizeof(TRACE_HEADER) )
+		goto ERROR_EXIT;
+
+	pMap = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, pTrace->fd, 0 );
+	if( pMap == MAP_FAILED )
+		goto ERROR_EXIT;
+
+	pTrace->pMap    = (uint8_t*)pMap;
+	pTrace->mapSize = st.st_size;
+	memcpy( &pTrace->hdr, pTrace->pMap, sizeof(TRACE_HEADER) );
+
+	if( pTrace->hdr.magic != TRACE_MAGIC || pTrace->hdr.version != TRACE_VERSION ||
+		pTrace->hdr.frameSize + sizeof(TRACE_RECORD) > pTrace->hdr.recordSize )
+		goto ERROR_EXIT;
+
+	//	recording was interrupted, keep the complete records
+	iCount = (pTrace->mapSize - pTrace->hdr.headerSize) / pTrace->hdr.recordSize;
+	if( pTrace->hdr.frameCount == 0 || pTrace->hdr.frameCount > iCount )
+	{
+		const TRACE_RECORD *pRec;
+
+		while( iCount > 0 && !GetFrame( pTrace, iCount - 1, &pRec ) )
+			iCount--;
+		pTrace->hdr.frameCount = iCount;
+		if( iCount > 0 )
+		{
+			GetFrame( pTrace, 0, &pRec );
+			pTrace->hdr.firstTimeStamp = pRec->timeStamp;
+			GetFrame( pTrace, iCount - 1, &pRec );
+			pTrace->hdr.lastTimeStamp = pRec->timeStamp;
+		}
+	}
+
+	return pTrace;
+
+ERROR_EXIT:
+	printf( "Fail, %s is not a capture trace.\n", pFileName );
+	NX_CaptureTraceClose( pTrace );
+	return NULL;
+}
+
+//------------------------------------------------------------------------------
+void NX_CaptureTraceGetInfo( NX_CAPTURE_TRACE_HANDLE hTrace, NX_CAPTURE_TRACE_INFO *pInfo )
+{
+	pInfo->width    = hTrace->hdr.width;
+	pInfo->height   = hTrace->hdr.height;
+	pInfo->format   = hTrace->hdr.format;
+	pInfo->frames   = hTrace->hdr.frameCount;
+	pInfo->duration = hTrace->hdr.lastTimeStamp - hTrace->hdr.firstTimeStamp;
+}
+
+//------------------------------------------------------------------------------
+int32_t NX_CaptureTraceLoad( NX_CAPTURE_TRACE_HANDLE hTrace, int32_t iFrame,
+							 NX_VID_MEMORY_INFO *pImg, uint64_t *pTimeStamp )
+{
+	const TRACE_HEADER *pHdr = &hTrace->hdr;
+	const TRACE_RECORD *pRec;
+	const uint8_t *pSrc;
+	uint8_t *pDst[3];
+	uint32_t dstStride[3];
+	uint32_t w = pHdr->width, h = pHdr->height;
+
+	if( pHdr->format != V4L2_PIX_FMT_YUV420 || pHdr->numPlanes != 3 ||
+		(uint32_t)pImg->width != w || (uint32_t)pImg->height != h )
+		return -1;
+
+	pSrc = GetFrame( hTrace, iFrame, &pRec );
+	if( !pSrc )
+		return -1;
+
+	//	destination as LoadImage() fills it
+	dstStride[0] = pImg->stride[0] ? pImg->stride[0] : ALIGN(w, 32);
+	if( pImg->planes == 1 )
+	{
+		dstStride[1] = dstStride[2] = ALIGN(dstStride[0] >> 1, 16);
+		pDst[0] = (uint8_t*)pImg->pBuffer[0];
+		pDst[1] = pDst[0] + dstStride[0] * ALIGN(h, 16);
+		pDst[2] = pDst[1] + dstStride[1] * ALIGN(h >> 1, 16);
+	}
+	else
+	{
+		for( int32_t i = 0; i < 3; i++ )
+			pDst[i] = (uint8_t*)pImg->pBuffer[i];
+		dstStride[1] = pImg->stride[1] ? pImg->stride[1] : ALIGN(dstStride[0] >> 1, 16);
+		dstStride[2] = pImg->stride[2] ? pImg->stride[2] : dstStride[1];
+	}
+
+	for( int32_t i = 0; i < 3; i++ )
+	{
+		const uint8_t *pPlane = pSrc + pHdr->offset[i];
+		uint32_t width  = i ? w / 2 : w;
+		uint32_t height = i ? h / 2 : h;
+
+		//	same stride both sides, one copy for the whole plane
+		if( dstStride[i] == pHdr->stride[i] )
+		{
+			memcpy( pDst[i], pPlane, dstStride[i] * (height - 1) + width );
+			continue;
+		}
+
+		for( uint32_t y = 0; y < height; y++ )
+			memcpy( pDst[i] + y * dstStride[i], pPlane + y * pHdr->stride[i], width );
+	}
+
+	if( pTimeStamp )
+		*pTimeStamp = pRec->timeStamp;
+
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+void NX_CaptureTraceClose( NX_CAPTURE_TRACE_HANDLE hTrace )
+{
+	if( !hTrace )
+		return;
+
+	if( hTrace->pMap )
+		munmap( hTrace->pMap, hTrace->mapSize );
+	if( hTrace->fd >= 0 )
+		close( hTrace->fd );
+	free( hTrace );
+}
@@ -0,0 +1,50 @@
+//------------------------------------------------------------------------------
+//
+//	Copyright (C) 2016 Nexell Co. All Rights Reserved
+//	Nexell Co. Proprietary & Confidential
+//
+//	NEXELL INFORMS THAT THIS CODE AND INFORMATION IS PROVIDED "AS IS" BASE
+//  AND	WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS
+//  FOR A PARTICULAR PURPOSE.
+//
+//	Module		: Capture Trace
+//	File		:
+//	Description	: Reader for capture traces recorded by nx-camera-test -R
+//				  and nx-scaler-test -R (see common/capture-trace.h).
+//	Author		:
+//	Export		:
+//	History		:
+//
+//------------------------------------------------------------------------------
+
+#ifndef __NX_CAPTURETRACE_H__
+#define __NX_CAPTURETRACE_H__
+
+#include <stdint.h>
+#include <nx_video_api.h>
+
+typedef struct NX_CAPTURE_TRACE *NX_CAPTURE_TRACE_HANDLE;
+
+typedef struct
+{
+	int32_t		width;
+	int32_t		height;
+	uint32_t	format;			//	V4L2_PIX_FMT_*
+	int32_t		frames;
+	uint64_t	duration;		//	first to last timestamp, nano-seconds
+} NX_CAPTURE_TRACE_INFO;
+
+//	The file is mapped, frames are read in place.
+NX_CAPTURE_TRACE_HANDLE NX_CaptureTraceOpen( const char *pFileName );
+
+void NX_CaptureTraceGetInfo( NX_CAPTURE_TRACE_HANDLE hTrace, NX_CAPTURE_TRACE_INFO *pInfo );
+
+//	Copy frame iFrame into pImg (YUV420, same size as the trace).
+//	pTimeStamp : capture timestamp in nano-seconds, may be NULL
+int32_t NX_CaptureTraceLoad( NX_CAPTURE_TRACE_HANDLE hTrace, int32_t iFrame,
+							 NX_VID_MEMORY_INFO *pImg, uint64_t *pTimeStamp );
+
+void NX_CaptureTraceClose( NX_CAPTURE_TRACE_HANDLE hTrace );
+
+#endif	// __NX_CAPTURETRACE_H__
@@ -0,0 +1,531 @@
+//------------------------------------------------------------------------------
+//
+//	Copyright (C) 2016 Nexell Co. All Rights Reserved
+//	Nexell Co. Proprietary & Confidential
+//
+//	NEXELL INFORMS THAT THIS CODE AND INFORMATION IS PROVIDED "AS IS" BASE
+//  AND	WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS
+//  FOR A PARTICULAR PURPOSE.
+//
+//	Module		: Frame Checksum
+//	File		:
+//	Description	:
+//	Author		:
+//	Export		:
+//	History		:
+//
+//------------------------------------------------------------------------------
+
+//	The CRC instructions are optional in ARMv8.0, enable them here and
+//	pick the implementation at run time from HWCAP.
+#if defined(__aarch64__) && !defined(__ARM_FEATURE_CRC32)
+#pragma GCC target("+crc")
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <linux/videodev2.h>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32		(1 << 7)
+#endif
+#else
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+#endif
+
+#include "NX_FrameChecksum.h"
+#include "Util.h"
+
+#ifndef ALIGN
+#define ALIGN(X,N)		( ((X) + (N) - 1) & ~((N) - 1) )
+#endif
+
+#define CHK_MAX_PLANES	3
+
+typedef struct {
+	const uint8_t	*pData;
+	uint32_t	stride;
+	uint32_t	rowBytes;		//	visible bytes per row
+	uint32_t	rows;
+	uint8_t		lo, hi;			//	legal sample range
+} CHK_PLANE;
+
+typedef struct {
+	uint32_t	crc;
+	uint8_t		min, max;
+	uint64_t	outOfRange;
+	uint64_t	samples;
+} CHK_RESULT;
+
+struct NX_FRAME_CHECKSUM {
+	FILE		*fpLog;
+	int32_t		bRangeCheck;
+	int32_t		bHwCrc;
+
+	NX_VID_MEMORY_INFO	queue[NX_CHK_QUEUE_DEPTH];
+	int32_t		head;
+	int32_t		pending;			//	queued + being checked
+	int32_t		bExit;
+
+	pthread_t		hThread;
+	pthread_mutex_t	hLock;
+	pthread_cond_t	hWorkCond;
+	pthread_cond_t	hDoneCond;
+
+	uint32_t	prevCrc[CHK_MAX_PLANES];
+	int32_t		prevPlanes;
+
+	//	statistics
+	uint32_t	frameCnt;
+	uint32_t	zeroCnt;
+	uint32_t	stuckCnt;
+	uint32_t	rangeCnt;
+	uint32_t	waitCnt;			//	Push found the queue full
+	uint64_t	totalTime;			//	nano-seconds
+	uint64_t	maxTime;
+};
+
+static uint32_t gCrcTable[256];
+static pthread_once_t gCrcOnce = PTHREAD_ONCE_INIT;
+
+//------------------------------------------------------------------------------
+static void InitCrcTable( void )
+{
+	for( uint32_t i = 0; i < 256; i++ )
+	{
+		uint32_t crc = i;
+		for( int32_t j = 0; j < 8; j++ )
+			crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78 : 0);	//	Castagnoli, reflected
+		gCrcTable[i] = crc;
+	}
+}
+
+//------------------------------------------------------------------------------
+static uint32_t Crc32cSw( uint32_t crc, const uint8_t *pBuf, uint32_t len )
+{
+	while( len-- )
+		crc = gCrcTable[(crc ^ *pBuf++) & 0xFF] ^ (crc >> 8);
+	return crc;
+}
+
+//------------------------------------------------------------------------------
+static uint32_t Crc32cHw( uint32_t crc, const uint8_t *pBuf, uint32_t len )
+{
+#if defined(__aarch64__)
+	for( ; len >= 8; len -= 8, pBuf += 8 )
+	{
+		uint64_t v;
+		memcpy( &v, pBuf, 8 );
+		crc = __crc32cd( crc, v );
+	}
+	while( len-- )
+		crc = __crc32cb( crc, *pBuf++ );
+	return crc;
+#elif defined(__SSE4_2__) && defined(__x86_64__)
+	uint64_t c = crc;
+	for( ; len >= 8; len -= 8, pBuf += 8 )
+	{
+		uint64_t v;
+		memcpy( &v, pBuf, 8 );
+		c = _mm_crc32_u64( c, v );
+	}
+	crc = (uint32_t)c;
+	while( len-- )
+		crc = _mm_crc32_u8( crc, *pBuf++ );
+	return crc;
+#else
+	return Crc32cSw( crc, pBuf, len );
+#endif
+}
+
+//------------------------------------------------------------------------------
+//	min / max / out-of-range count of one row
+static void RowStats( const uint8_t *pRow, uint32_t len, uint8_t lo, uint8_t hi, CHK_RESULT *pRes )
+{
+	uint32_t i = 0;
+	uint8_t vMin = pRes->min, vMax = pRes->max;
+	uint64_t bad = 0;
+
+#if defined(__aarch64__)
+	if( len >= 16 )
+	{
+		uint8x16_t qMin = vdupq_n_u8( 255 ), qMax = vdupq_n_u8( 0 );
+		uint8x16_t qLo = vdupq_n_u8( lo ), qHi = vdupq_n_u8( hi );
+		uint16x8_t qBad = vdupq_n_u16( 0 );
+
+		//	a row is at most a few KB, 16 bit lanes can not overflow
+		for( ; i + 16 <= len; i += 16 )
+		{
+			uint8x16_t v = vld1q_u8( pRow + i );
+			uint8x16_t m = vorrq_u8( vcltq_u8(v, qLo), vcgtq_u8(v, qHi) );
+			qMin = vminq_u8( qMin, v );
+			qMax = vmaxq_u8( qMax, v );
+			qBad = vpadalq_u8( qBad, vshrq_n_u8(m, 7) );
+		}
+		if( vminvq_u8(qMin) < vMin )	vMin = vminvq_u8( qMin );
+		if( vmaxvq_u8(qMax) > vMax )	vMax = vmaxvq_u8( qMax );
+		bad += vaddlvq_u16( qBad );
+	}
+#elif defined(__SSE2__)
+	if( len >= 16 )
+	{
+		__m128i qMin = _mm_set1_epi8( (char)255 ), qMax = _mm_setzero_si128();
+		__m128i qLo = _mm_set1_epi8( (char)lo ), qHi = _mm_set1_epi8( (char)hi );
+		__m128i qZero = _mm_setzero_si128();
+		uint8_t tmp[16];
+
+		for( ; i + 16 <= len; i += 16 )
+		{
+			__m128i v = _mm_loadu_si128( (const __m128i*)(pRow + i) );
+			__m128i ok = _mm_and_si128( _mm_cmpeq_epi8(_mm_subs_epu8(qLo, v), qZero),
+										_mm_cmpeq_epi8(_mm_subs_epu8(v, qHi), qZero) );
+			qMin = _mm_min_epu8( qMin, v );
+			qMax = _mm_max_epu8( qMax, v );
+			bad += 16 - __builtin_popcount( _mm_movemask_epi8(ok) );
+		}
+		_mm_storeu_si128( (__m128i*)tmp, qMin );
+		for( int32_t j = 0; j < 16; j++ )	if( tmp[j] < vMin ) vMin = tmp[j];
+		_mm_storeu_si128( (__m128i*)tmp, qMax );
+		for( int32_t j = 0; j < 16; j++ )	if( tmp[j] > vMax ) vMax = tmp[j];
+	}
+#endif
+
+	for( ; i < len; i++ )
+	{
+		uint8_t v = pRow[i];
+		if( v < vMin )	vMin = v;
+		if( v > vMax )	vMax = v;
+		if( v < lo || v > hi )	bad++;
+	}
+
+	pRes->min = vMin;
+	pRes->max = vMax;
+	pRes->outOfRange += bad;
+	pRes->samples += len;
+}
+
+//------------------------------------------------------------------------------
+//	Visible area of each plane. Multi-planar (xxxM) formats carry one
+//	buffer per plane, single buffer formats use the layout of
+//	NX_CV4l2Camera::V4l2CalcAllocSize().
+static int32_t GetPlanes( const NX_VID_MEMORY_INFO *pImg, CHK_PLANE *pPlane )
+{
+	uint32_t w = pImg->width, h = pImg->height;
+	uint32_t cw = w, ch = h;		//	chroma plane bytes per row / rows
+	int32_t num = 2, i;
+	int32_t bContig = (pImg->planes == 1);
+	uint32_t yStride = pImg->stride[0] ? pImg->stride[0] : ALIGN(w, 32);
+
+	memset( pPlane, 0, sizeof(CHK_PLANE) * CHK_MAX_PLANES );
+
+	switch( pImg->format )
+	{
+	case V4L2_PIX_FMT_NV12:		case V4L2_PIX_FMT_NV21:
+	case V4L2_PIX_FMT_NV12M:	case V4L2_PIX_FMT_NV21M:
+		ch = (h + 1) / 2;
+		break;
+	case V4L2_PIX_FMT_NV16:		case V4L2_PIX_FMT_NV61:
+	case V4L2_PIX_FMT_NV16M:	case V4L2_PIX_FMT_NV61M:
+		break;
+	case V4L2_PIX_FMT_YUV420:	case V4L2_PIX_FMT_YVU420:
+	case V4L2_PIX_FMT_YUV420M:	case V4L2_PIX_FMT_YVU420M:
+		cw = (w + 1) / 2;
+		ch = (h + 1) / 2;
+		num = 3;
+		break;
+	case V4L2_PIX_FMT_YUV422P:	case V4L2_PIX_FMT_YUV422M:
+		cw = (w + 1) / 2;
+		num = 3;
+		break;
+	case V4L2_PIX_FMT_YUV444M:
+		num = 3;
+		break;
+	case V4L2_PIX_FMT_YUYV:		case V4L2_PIX_FMT_YVYU:
+	case V4L2_PIX_FMT_UYVY:		case V4L2_PIX_FMT_VYUY:
+		pPlane[0].pData    = (const uint8_t*)pImg->pBuffer[0];
+		pPlane[0].stride   = pImg->stride[0] ? pImg->stride[0] : ALIGN(w, 32) * 2;
+		pPlane[0].rowBytes = w * 2;
+		pPlane[0].rows     = h;
+		pPlane[0].lo       = 16;
+		pPlane[0].hi       = 240;
+		return 1;
+	default:	//	V4L2_PIX_FMT_GREY and unknown formats: luma only
+		num = 1;
+		break;
+	}
+
+	pPlane[0].pData    = (const uint8_t*)pImg->pBuffer[0];
+	pPlane[0].stride   = yStride;
+	pPlane[0].rowBytes = w;
+	pPlane[0].rows     = h;
+	pPlane[0].lo       = 16;
+	pPlane[0].hi       = 235;
+
+	for( i = 1; i < num; i++ )
+	{
+		if( bContig )
+		{
+			uint32_t cStride = (num == 3) ? ALIGN(yStride >> 1, 16) : yStride;
+			uint32_t cRows = (ch == h) ? ALIGN(h, 16) : ALIGN(h >> 1, 16);
+
+			pPlane[i].stride = cStride;
+			pPlane[i].pData  = pPlane[0].pData + yStride * ALIGN(h, 16) + (i - 1) * cStride * cRows;
+		}
+		else
+		{
+			if( i >= pImg->planes || !pImg->pBuffer[i] )
+				break;
+			pPlane[i].pData  = (const uint8_t*)pImg->pBuffer[i];
+			pPlane[i].stride = pImg->stride[i] ? pImg->stride[i] : ((num == 3) ? ALIGN(yStride >> 1, 16) : yStride);
+		}
+		pPlane[i].rowBytes = cw;
+		pPlane[i].rows     = ch;
+		pPlane[i].lo       = 16;
+		pPlane[i].hi       = 240;
+	}
+	num = i;
+
+	//	never read past a single buffer whose size is known
+	if( bContig && pImg->size[0] > 0 )
+	{
+		const uint8_t *pEnd = pPlane[0].pData + pImg->size[0];
+		for( i = 0; i < num; i++ )
+		{
+			if( pPlane[i].pData + (uint64_t)pPlane[i].stride * (pPlane[i].rows - 1) + pPlane[i].rowBytes > pEnd )
+				break;
+		}
+		num = i;
+	}
+
+	return num;
+}
+
+//------------------------------------------------------------------------------
+static void CheckFrame( NX_FRAME_CHECKSUM *pChk, const NX_VID_MEMORY_INFO *pImg )
+{
+	CHK_PLANE plane[CHK_MAX_PLANES];
+	CHK_RESULT res[CHK_MAX_PLANES];
+	uint64_t bad = 0, samples = 0;
+	uint32_t flags = 0;
+	int32_t num, i, bZero = 1, bSame;
+	uint64_t startTime = NX_GetTickCountNs();
+
+	num = GetPlanes( pImg, plane );
+
+	for( i = 0; i < num; i++ )
+	{
+		const uint8_t *pRow = plane[i].pData;
+
+		res[i].crc = 0xFFFFFFFF;
+		res[i].min = 255;
+		res[i].max = 0;
+		res[i].outOfRange = 0;
+		res[i].samples = 0;
+
+		//	row by row, stride padding is not part of the picture
+		for( uint32_t y = 0; y < plane[i].rows; y++, pRow += plane[i].stride )
+		{
+			res[i].crc = pChk->bHwCrc ? Crc32cHw( res[i].crc, pRow, plane[i].rowBytes ) :
+										Crc32cSw( res[i].crc, pRow, plane[i].rowBytes );
+			RowStats( pRow, plane[i].rowBytes, plane[i].lo, plane[i].hi, &res[i] );
+		}
+		res[i].crc ^= 0xFFFFFFFF;
+
+		if( res[i].max != 0 )
+			bZero = 0;
+		bad += res[i].outOfRange;
+		samples += res[i].samples;
+	}
+
+	bSame = (num > 0) && (num == pChk->prevPlanes);
+	for( i = 0; i < num && bSame; i++ )
+		bSame = (res[i].crc == pChk->prevCrc[i]);
+
+	if( num > 0 && bZero )
+		flags |= NX_CHK_FLAG_ZERO;
+	else if( bSame )
+		flags |= NX_CHK_FLAG_STUCK;
+	if( pChk->bRangeCheck && !bZero && samples && (bad * 1000 >= samples * NX_CHK_RANGE_PERMILLE) )
+		flags |= NX_CHK_FLAG_RANGE;
+
+	for( i = 0; i < num; i++ )
+		pChk->prevCrc[i] = res[i].crc;
+	pChk->prevPlanes = num;
+
+	if( flags )
+	{
+		printf("Checksum : frame %u%s%s%s (crc %08x, luma %u~%u, out of range %llu/%llu)\n",
+			pChk->frameCnt,
+			(flags & NX_CHK_FLAG_ZERO)  ? " all-zero" : "",
+			(flags & NX_CHK_FLAG_STUCK) ? " stuck" : "",
+			(flags & NX_CHK_FLAG_RANGE) ? " out-of-range" : "",
+			num ? res[0].crc : 0, num ? res[0].min : 0, num ? res[0].max : 0,
+			(unsigned long long)bad, (unsigned long long)samples);
+	}
+
+	if( pChk->fpLog )
+	{
+		fprintf( pChk->fpLog, "%u", pChk->frameCnt );
+		for( i = 0; i < num; i++ )
+			fprintf( pChk->fpLog, " %08x", res[i].crc );
+		fprintf( pChk->fpLog, " %x\n", flags );
+	}
+
+	startTime = NX_GetTickCountNs() - startTime;
+	pChk->frameCnt++;
+	pChk->totalTime += startTime;
+	if( startTime > pChk->maxTime )
+		pChk->maxTime = startTime;
+	if( flags & NX_CHK_FLAG_ZERO )	pChk->zeroCnt++;
+	if( flags & NX_CHK_FLAG_STUCK )	pChk->stuckCnt++;
+	if( flags & NX_CHK_FLAG_RANGE )	pChk->rangeCnt++;
+}
+
+//------------------------------------------------------------------------------
+static void *ChecksumThread( void *pArg )
+{
+	NX_FRAME_CHECKSUM *pChk = (NX_FRAME_CHECKSUM*)pArg;
+
+	pthread_mutex_lock( &pChk->hLock );
+	for( ;; )
+	{
+		while( !pChk->bExit && (pChk->pending == 0) )
+			pthread_cond_wait( &pChk->hWorkCond, &pChk->hLock );
+
+		if( pChk->pending == 0 )
+			break;
+
+		//	the slot stays owned by the worker until pending drops
+		NX_VID_MEMORY_INFO *pImg = &pChk->queue[pChk->head];
+		pthread_mutex_unlock( &pChk->hLock );
+
+		CheckFrame( pChk, pImg );
+
+		pthread_mutex_lock( &pChk->hLock );
+		pChk->head = (pChk->head + 1) % NX_CHK_QUEUE_DEPTH;
+		pChk->pending--;
+		pthread_cond_broadcast( &pChk->hDoneCond );
+	}
+	pthread_mutex_unlock( &pChk->hLock );
+
+	return NULL;
+}
+
+//------------------------------------------------------------------------------
+NX_FRAME_CHECKSUM_HANDLE NX_FrameChecksumOpen( const char *pLogFile, int32_t bRangeCheck )
+{
+	NX_FRAME_CHECKSUM *pChk;
+
+	pthread_once( &gCrcOnce, InitCrcTable );
+
+	pChk = (NX_FRAME_CHECKSUM*)calloc( 1, sizeof(NX_FRAME_CHECKSUM) );
+	if( pChk == NULL )
+		return NULL;
+
+	if( pLogFile )
+	{
+		pChk->fpLog = fopen( pLogFile, "w" );
+		if( pChk->fpLog == NULL )
+		{
+			printf("Fail, open checksum log(%s).\n", pLogFile);
+			free( pChk );
+			return NULL;
+		}
+	}
+
+	pChk->bRangeCheck = bRangeCheck;
+#if defined(__aarch64__)
+	pChk->bHwCrc = (getauxval(AT_HWCAP) & HWCAP_CRC32) ? 1 : 0;
+#elif defined(__SSE4_2__) && defined(__x86_64__)
+	pChk->bHwCrc = 1;
+#endif
+
+	pthread_mutex_init( &pChk->hLock, NULL );
+	pthread_cond_init( &pChk->hWorkCond, NULL );
+	pthread_cond_init( &pChk->hDoneCond, NULL );
+
+	if( 0 != pthread_create( &pChk->hThread, NULL, ChecksumThread, pChk ) )
+	{
+		printf("Fail, create checksum thread.\n");
+		pthread_cond_destroy( &pChk->hDoneCond );
+		pthread_cond_destroy( &pChk->hWorkCond );
+		pthread_mutex_destroy( &pChk->hLock );
+		if( pChk->fpLog )
+			fclose( pChk->fpLog );
+		free( pChk );
+		return NULL;
+	}
+
+	printf("Checksum : CRC32C %s, range check %s%s%s\n",
+		pChk->bHwCrc ? "hardware" : "table", bRangeCheck ? "on" : "off",
+		pLogFile ? ", log " : "", pLogFile ? pLogFile : "");
+
+	return pChk;
+}
+
+//------------------------------------------------------------------------------
+int32_t NX_FrameChecksumPush( NX_FRAME_CHECKSUM_HANDLE hChk, NX_VID_MEMORY_INFO *pImg )
+{
+	pthread_mutex_lock( &hChk->hLock );
+	if( hChk->pending >= NX_CHK_QUEUE_DEPTH )
+	{
+		hChk->waitCnt++;
+		while( hChk->pending >= NX_CHK_QUEUE_DEPTH )
+			pthread_cond_wait( &hChk->hDoneCond, &hChk->hLock );
+	}
+
+	hChk->queue[(hChk->head + hChk->pending) % NX_CHK_QUEUE_DEPTH] = *pImg;
+	hChk->pending++;
+	pthread_cond_signal( &hChk->hWorkCond );
+	pthread_mutex_unlock( &hChk->hLock );
+
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+void NX_FrameChecksumSync( NX_FRAME_CHECKSUM_HANDLE hChk, int32_t iKeep )
+{
+	pthread_mutex_lock( &hChk->hLock );
+	while( hChk->pending > iKeep )
+		pthread_cond_wait( &hChk->hDoneCond, &hChk->hLock );
+	pthread_mutex_unlock( &hChk->hLock );
+}
+
+//------------------------------------------------------------------------------
+void NX_FrameChecksumClose( NX_FRAME_CHECKSUM_HANDLE hChk )
+{
+	if( hChk == NULL )
+		return;
+
+	pthread_mutex_lock( &hChk->hLock );
+	hChk->bExit = 1;
+	pthread_cond_signal( &hChk->hWorkCond );
+	pthread_mutex_unlock( &hChk->hLock );
+
+	pthread_join( hChk->hThread, NULL );
+
+	printf("Checksum : frames = %u, all-zero = %u, stuck = %u, out-of-range = %u, queue full = %u, avg = %.3f ms, max = %.3f ms\n",
+		hChk->frameCnt, hChk->zeroCnt, hChk->stuckCnt, hChk->rangeCnt, hChk->waitCnt,
+		hChk->frameCnt ? (double)hChk->totalTime / hChk->frameCnt / 1000000. : 0.,
+		(double)hChk->maxTime / 1000000.);
+
+	if( hChk->fpLog )
+		fclose( hChk->fpLog );
+
+	pthread_cond_destroy( &hChk->hDoneCond );
+	pthread_cond_destroy( &hChk->hWorkCond );
+	pthread_mutex_destroy( &hChk->hLock );
+	free( hChk );
+}
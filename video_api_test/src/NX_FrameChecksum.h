@@ -0,0 +1,52 @@
+//------------------------------------------------------------------------------
+//
+//	Copyright (C) 2016 Nexell Co. All Rights Reserved
+//	Nexell Co. Proprietary & Confidential
+//
+//	NEXELL INFORMS THAT THIS CODE AND INFORMATION IS PROVIDED "AS IS" BASE
+//  AND	WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS
+//  FOR A PARTICULAR PURPOSE.
+//
+//	Module		: Frame Checksum
+//	File		:
+//	Description	: Per-plane CRC32C of the visible pixels, computed on a
+//				  worker thread. Flags all-zero, stuck and out-of-range frames.
+//	Author		:
+//	Export		:
+//	History		:
+//
+//------------------------------------------------------------------------------
+
+#ifndef __NX_FRAMECHECKSUM_H__
+#define __NX_FRAMECHECKSUM_H__
+
+#include <stdint.h>
+#include <nx_video_api.h>
+
+#define NX_CHK_QUEUE_DEPTH		4		//	frames in flight
+#define NX_CHK_RANGE_PERMILLE	10		//	out-of-range samples to flag a frame
+
+//	Frame flags, also written to the log file
+#define NX_CHK_FLAG_ZERO		(1 << 0)	//	every sample of every plane is 0
+#define NX_CHK_FLAG_STUCK		(1 << 1)	//	same checksums as the previous frame
+#define NX_CHK_FLAG_RANGE		(1 << 2)	//	too many samples outside 16-235/240
+
+typedef struct NX_FRAME_CHECKSUM *NX_FRAME_CHECKSUM_HANDLE;
+
+//	pLogFile    : one line per frame "<frame> <crc plane0> [..] <flags>", may be NULL
+//	bRangeCheck : 1 = limited (video) range content, 0 = full range (JPEG)
+NX_FRAME_CHECKSUM_HANDLE NX_FrameChecksumOpen( const char *pLogFile, int32_t bRangeCheck );
+
+//	Queue pImg for checking. Only the descriptor is copied: the pixels must
+//	stay valid until NX_FrameChecksumSync() says the frame is done.
+int32_t NX_FrameChecksumPush( NX_FRAME_CHECKSUM_HANDLE hChk, NX_VID_MEMORY_INFO *pImg );
+
+//	Wait until at most iKeep frames are still being checked.
+//	Call it before a pushed buffer goes back to the driver.
+void NX_FrameChecksumSync( NX_FRAME_CHECKSUM_HANDLE hChk, int32_t iKeep );
+
+//	Check the remaining frames, stop the worker and print statistics.
+void NX_FrameChecksumClose( NX_FRAME_CHECKSUM_HANDLE hChk );
+
+#endif	// __NX_FRAMECHECKSUM_H__
@@ -0,0 +1,551 @@
+//------------------------------------------------------------------------------
+//
+//	Copyright (C) 2016 Nexell Co. All Rights Reserved
+//	Nexell Co. Proprietary & Confidential
+//
+//	NEXELL INFORMS THAT THIS CODE AND INFORMATION IS PROVIDED "AS IS" BASE
+//  AND	WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS
+//  FOR A PARTICULAR PURPOSE.
+//
+//	Module		: Frame Pattern
+//	File		:
+//	Description	:
+//	Author		:
+//	Export		:
+//	History		:
+//
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <linux/videodev2.h>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "NX_FramePattern.h"
+#include "Util.h"
+
+#ifndef ALIGN
+#define ALIGN(X,N)		( ((X) + (N) - 1) & ~((N) - 1) )
+#endif
+
+#define PAT_MAGIC			0xA55A
+#define PAT_STAMP_BITS		80			//	magic 16 + frame 32 + tick 32
+#define PAT_STAMP_COLUMNS	16
+#define PAT_BLACK			16
+#define PAT_WHITE			235
+
+typedef struct {
+	uint8_t		*pY;
+	uint8_t		*pU, *pV;			//	planar chroma
+	uint8_t		*pUV;				//	interleaved chroma, NV12 / NV21
+	int32_t		bSwapUV;			//	NV21: V first
+	uint32_t	yStride, cStride;
+} PAT_PLANES;
+
+struct NX_FRAME_PATTERN {
+	int32_t		iPattern;
+	int32_t		iWidth;
+	int32_t		iHeight;
+
+	//	colour bars, two periods wide so any scroll offset is one memcpy
+	uint8_t		*pBarY;
+	uint8_t		*pBarU;
+	uint8_t		*pBarV;
+	uint8_t		*pRowUV;			//	interleaved chroma scratch row
+
+	//	zone plate, 16 bit phase of the horizontal term and a cosine table
+	uint16_t	*pZoneX;
+	uint32_t	iZoneK;
+	uint8_t		cosTable[256];
+
+	uint32_t	iSeed;
+};
+
+static const char *gPatternName[NX_PATTERN_MAX] = {
+	"bars", "box", "noise", "zone",
+};
+
+//	75% bars: white, yellow, cyan, green, magenta, red, blue, black (BT.601)
+static const uint8_t gBarYUV[8][3] = {
+	{ 180, 128, 128 }, { 162,  44, 142 }, { 131, 156,  44 }, { 112,  72,  58 },
+	{  84, 184, 198 }, {  65, 100, 212 }, {  35, 212, 114 }, {  16, 128, 128 },
+};
+
+//------------------------------------------------------------------------------
+static inline int32_t BlockSize( int32_t iWidth )
+{
+	return (iWidth >= 1280) ? 16 : 8;
+}
+
+//------------------------------------------------------------------------------
+//	Same layout rules as the checksum stage and LoadImage(): a single
+//	buffer keeps the chroma planes behind the 16 line aligned luma.
+static int32_t GetPlanes( const NX_VID_MEMORY_INFO *pImg, PAT_PLANES *pPlanes )
+{
+	uint32_t w = pImg->width, h = pImg->height;
+	int32_t bContig = (pImg->planes == 1);
+	uint8_t *pBase = (uint8_t*)pImg->pBuffer[0];
+	int32_t bPlanar;
+
+	memset( pPlanes, 0, sizeof(PAT_PLANES) );
+
+	switch( pImg->format )
+	{
+	case V4L2_PIX_FMT_YUV420:	case V4L2_PIX_FMT_YUV420M:
+		bPlanar = 1;
+		break;
+	case V4L2_PIX_FMT_YVU420:	case V4L2_PIX_FMT_YVU420M:
+		bPlanar = 1;
+		pPlanes->bSwapUV = 1;
+		break;
+	case V4L2_PIX_FMT_NV12:		case V4L2_PIX_FMT_NV12M:
+		bPlanar = 0;
+		break;
+	case V4L2_PIX_FMT_NV21:		case V4L2_PIX_FMT_NV21M:
+		bPlanar = 0;
+		pPlanes->bSwapUV = 1;
+		break;
+	default:
+		return -1;
+	}
+
+	if( !pBase || (!bContig && !pImg->pBuffer[1]) )
+		return -1;
+
+	pPlanes->pY = pBase;
+	pPlanes->yStride = pImg->stride[0] ? pImg->stride[0] : ALIGN(w, 32);
+
+	if( bPlanar )
+	{
+		uint8_t *pCb, *pCr;
+
+		if( bContig )
+		{
+			pPlanes->cStride = ALIGN(pPlanes->yStride >> 1, 16);
+			pCb = pBase + pPlanes->yStride * ALIGN(h, 16);
+			pCr = pCb + pPlanes->cStride * ALIGN(h >> 1, 16);
+		}
+		else
+		{
+			if( pImg->planes < 3 || !pImg->pBuffer[2] )
+				return -1;
+			pPlanes->cStride = pImg->stride[1] ? pImg->stride[1] : ALIGN(pPlanes->yStride >> 1, 16);
+			pCb = (uint8_t*)pImg->pBuffer[1];
+			pCr = (uint8_t*)pImg->pBuffer[2];
+		}
+		pPlanes->pU = pPlanes->bSwapUV ? pCr : pCb;
+		pPlanes->pV = pPlanes->bSwapUV ? pCb : pCr;
+	}
+	else
+	{
+		pPlanes->cStride = bContig ? pPlanes->yStride :
+			(pImg->stride[1] ? pImg->stride[1] : pPlanes->yStride);
+		pPlanes->pUV = bContig ? pBase + pPlanes->yStride * ALIGN(h, 16) :
+			(uint8_t*)pImg->pBuffer[1];
+	}
+
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+static void FillChroma( const PAT_PLANES *pPlanes, int32_t y0, int32_t y1,
+						int32_t x0, int32_t x1, uint8_t u, uint8_t v )
+{
+	for( int32_t y = y0; y < y1; y++ )
+	{
+		if( pPlanes->pUV )
+		{
+			uint8_t *pRow = pPlanes->pUV + y * pPlanes->cStride + x0 * 2;
+			uint8_t a = pPlanes->bSwapUV ? v : u;
+			uint8_t b = pPlanes->bSwapUV ? u : v;
+
+			if( a == b )
+			{
+				memset( pRow, a, (x1 - x0) * 2 );
+				continue;
+			}
+			for( int32_t x = x0; x < x1; x++ )
+			{
+				*pRow++ = a;
+				*pRow++ = b;
+			}
+		}
+		else
+		{
+			memset( pPlanes->pU + y * pPlanes->cStride + x0, u, x1 - x0 );
+			memset( pPlanes->pV + y * pPlanes->cStride + x0, v, x1 - x0 );
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+static void FillBars( NX_FRAME_PATTERN *pPat, const PAT_PLANES *pPlanes, uint32_t iFrame )
+{
+	int32_t w = pPat->iWidth, h = pPat->iHeight;
+	int32_t cw = w / 2, ch = h / 2;
+	int32_t off = (iFrame * 4) % w & ~1;
+	int32_t y;
+
+	for( y = 0; y < h; y++ )
+		memcpy( pPlanes->pY + y * pPlanes->yStride, pPat->pBarY + off, w );
+
+	if( pPlanes->pUV )
+	{
+		const uint8_t *pA = pPlanes->bSwapUV ? pPat->pBarV : pPat->pBarU;
+		const uint8_t *pB = pPlanes->bSwapUV ? pPat->pBarU : pPat->pBarV;
+
+		for( int32_t x = 0; x < cw; x++ )
+		{
+			pPat->pRowUV[2 * x]     = pA[off / 2 + x];
+			pPat->pRowUV[2 * x + 1] = pB[off / 2 + x];
+		}
+		for( y = 0; y < ch; y++ )
+			memcpy( pPlanes->pUV + y * pPlanes->cStride, pPat->pRowUV, cw * 2 );
+	}
+	else
+	{
+		for( y = 0; y < ch; y++ )
+		{
+			memcpy( pPlanes->pU + y * pPlanes->cStride, pPat->pBarU + off / 2, cw );
+			memcpy( pPlanes->pV + y * pPlanes->cStride, pPat->pBarV + off / 2, cw );
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+static int32_t Bounce( uint32_t iPos, int32_t iRange )
+{
+	if( iRange <= 0 )
+		return 0;
+	iPos %= 2 * iRange;
+	return (iPos < (uint32_t)iRange) ? iPos : 2 * iRange - iPos;
+}
+
+//------------------------------------------------------------------------------
+static void FillBox( NX_FRAME_PATTERN *pPat, const PAT_PLANES *pPlanes, uint32_t iFrame )
+{
+	int32_t w = pPat->iWidth, h = pPat->iHeight;
+	int32_t bw = ALIGN(w / 8, 2), bh = ALIGN(h / 8, 2);
+	int32_t bx = Bounce( iFrame * 6, w - bw ) & ~1;
+	int32_t by = Bounce( iFrame * 4, h - bh ) & ~1;
+	int32_t y;
+
+	for( y = 0; y < h; y++ )
+		memset( pPlanes->pY + y * pPlanes->yStride, 41, w );
+	FillChroma( pPlanes, 0, h / 2, 0, w / 2, 240, 110 );		//	blue
+
+	for( y = by; y < by + bh; y++ )
+		memset( pPlanes->pY + y * pPlanes->yStride + bx, PAT_WHITE, bw );
+	FillChroma( pPlanes, by / 2, (by + bh) / 2, bx / 2, (bx + bw) / 2, 128, 128 );
+}
+
+//------------------------------------------------------------------------------
+//	xorshift32, four independent generators per vector
+static uint32_t NoiseRow( uint8_t *pDst, int32_t iLen, uint32_t iSeed )
+{
+	int32_t i = 0;
+
+#if defined(__aarch64__)
+	uint32_t init[4] = { iSeed, iSeed * 1664525 + 1013904223, iSeed ^ 0x9E3779B9, iSeed * 22695477 + 1 };
+	for( int32_t k = 0; k < 4; k++ )
+		if( !init[k] ) init[k] = 0x2545F491;
+	uint32x4_t s = vld1q_u32( init );
+
+	for( ; i + 16 <= iLen; i += 16 )
+	{
+		s = veorq_u32( s, vshlq_n_u32( s, 13 ) );
+		s = veorq_u32( s, vshrq_n_u32( s, 17 ) );
+		s = veorq_u32( s, vshlq_n_u32( s, 5 ) );
+		vst1q_u8( pDst + i, vreinterpretq_u8_u32( s ) );
+	}
+	iSeed = vgetq_lane_u32( s, 0 );
+#elif defined(__SSE2__)
+	__m128i s = _mm_set_epi32( iSeed * 22695477 + 1, iSeed ^ 0x9E3779B9, iSeed * 1664525 + 1013904223, iSeed | 1 );
+
+	for( ; i + 16 <= iLen; i += 16 )
+	{
+		s = _mm_xor_si128( s, _mm_slli_epi32( s, 13 ) );
+		s = _mm_xor_si128( s, _mm_srli_epi32( s, 17 ) );
+		s = _mm_xor_si128( s, _mm_slli_epi32( s, 5 ) );
+		_mm_storeu_si128( (__m128i*)(pDst + i), s );
+	}
+	iSeed = _mm_cvtsi128_si32( s );
+#endif
+
+	if( !iSeed )
+		iSeed = 0x2545F491;
+	for( ; i < iLen; i++ )
+	{
+		iSeed ^= iSeed << 13;
+		iSeed ^= iSeed >> 17;
+		iSeed ^= iSeed << 5;
+		pDst[i] = (uint8_t)iSeed;
+	}
+
+	return iSeed;
+}
+
+//------------------------------------------------------------------------------
+static void FillNoise( NX_FRAME_PATTERN *pPat, const PAT_PLANES *pPlanes, uint32_t iFrame )
+{
+	int32_t w = pPat->iWidth, h = pPat->iHeight;
+	uint32_t iSeed = pPat->iSeed ^ (iFrame * 0x9E3779B9);
+	int32_t y;
+
+	for( y = 0; y < h; y++ )
+		iSeed = NoiseRow( pPlanes->pY + y * pPlanes->yStride, w, iSeed + y );
+
+	for( y = 0; y < h / 2; y++ )
+	{
+		if( pPlanes->pUV )
+		{
+			iSeed = NoiseRow( pPlanes->pUV + y * pPlanes->cStride, w, iSeed + y );
+		}
+		else
+		{
+			iSeed = NoiseRow( pPlanes->pU + y * pPlanes->cStride, w / 2, iSeed + y );
+			iSeed = NoiseRow( pPlanes->pV + y * pPlanes->cStride, w / 2, iSeed + y );
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+//	Y = cos((x^2 + y^2) * k + t), the 16 bit phase wraps for free and its
+//	top byte indexes the cosine table.
+static void ZoneRow( NX_FRAME_PATTERN *pPat, uint8_t *pDst, uint16_t iRowPhase )
+{
+	const uint16_t *pX = pPat->pZoneX;
+	int32_t w = pPat->iWidth;
+	int32_t x = 0;
+
+#if defined(__aarch64__)
+	uint8x16x4_t t0, t1, t2, t3;
+	for( int32_t i = 0; i < 4; i++ )
+	{
+		t0.val[i] = vld1q_u8( pPat->cosTable + 16 * i );
+		t1.val[i] = vld1q_u8( pPat->cosTable + 64 + 16 * i );
+		t2.val[i] = vld1q_u8( pPat->cosTable + 128 + 16 * i );
+		t3.val[i] = vld1q_u8( pPat->cosTable + 192 + 16 * i );
+	}
+	uint16x8_t row = vdupq_n_u16( iRowPhase );
+	uint8x16_t k64 = vdupq_n_u8( 64 );
+
+	for( ; x + 16 <= w; x += 16 )
+	{
+		uint8x8_t lo = vshrn_n_u16( vaddq_u16( vld1q_u16( pX + x ), row ), 8 );
+		uint8x8_t hi = vshrn_n_u16( vaddq_u16( vld1q_u16( pX + x + 8 ), row ), 8 );
+		uint8x16_t idx = vcombine_u8( lo, hi );
+		uint8x16_t r;
+
+		//	tbx keeps the lanes whose index is outside its 64 entries
+		r = vqtbl4q_u8( t0, idx );
+		idx = vsubq_u8( idx, k64 );
+		r = vqtbx4q_u8( r, t1, idx );
+		idx = vsubq_u8( idx, k64 );
+		r = vqtbx4q_u8( r, t2, idx );
+		idx = vsubq_u8( idx, k64 );
+		r = vqtbx4q_u8( r, t3, idx );
+		vst1q_u8( pDst + x, r );
+	}
+#endif
+
+	for( ; x < w; x++ )
+		pDst[x] = pPat->cosTable[(uint16_t)(pX[x] + iRowPhase) >> 8];
+}
+
+//------------------------------------------------------------------------------
+static void FillZone( NX_FRAME_PATTERN *pPat, const PAT_PLANES *pPlanes, uint32_t iFrame )
+{
+	int32_t h = pPat->iHeight;
+	int32_t cy = h / 2;
+	uint16_t t = (uint16_t)(iFrame * 1024);
+
+	for( int32_t y = 0; y < h; y++ )
+	{
+		uint32_t dy = (y - cy) * (y - cy);
+		ZoneRow( pPat, pPlanes->pY + y * pPlanes->yStride, (uint16_t)(dy * pPat->iZoneK) + t );
+	}
+	FillChroma( pPlanes, 0, h / 2, 0, pPat->iWidth / 2, 128, 128 );
+}
+
+//------------------------------------------------------------------------------
+static void DrawStamp( NX_FRAME_PATTERN *pPat, const PAT_PLANES *pPlanes, uint32_t iFrame )
+{
+	int32_t b = BlockSize( pPat->iWidth );
+	uint32_t iTick = (uint32_t)NX_GetTickCount();
+
+	for( int32_t i = 0; i < PAT_STAMP_BITS; i++ )
+	{
+		int32_t bit;
+		int32_t bx = (i % PAT_STAMP_COLUMNS) * b;
+		int32_t by = (i / PAT_STAMP_COLUMNS) * b;
+
+		if( i < 16 )
+			bit = (PAT_MAGIC >> (15 - i)) & 1;
+		else if( i < 48 )
+			bit = (iFrame >> (47 - i)) & 1;
+		else
+			bit = (iTick >> (79 - i)) & 1;
+
+		for( int32_t y = by; y < by + b; y++ )
+			memset( pPlanes->pY + y * pPlanes->yStride + bx, bit ? PAT_WHITE : PAT_BLACK, b );
+	}
+
+	FillChroma( pPlanes, 0, PAT_STAMP_BITS / PAT_STAMP_COLUMNS * b / 2,
+				0, PAT_STAMP_COLUMNS * b / 2, 128, 128 );
+}
+
+//------------------------------------------------------------------------------
+NX_FRAME_PATTERN_HANDLE NX_FramePatternOpen( const char *pName, int32_t iWidth, int32_t iHeight )
+{
+	NX_FRAME_PATTERN *pPat;
+	int32_t iPattern, b = BlockSize( iWidth );
+
+	for( iPattern = 0; iPattern < NX_PATTERN_MAX; iPattern++ )
+	{
+		if( !strcmp( pName, gPatternName[iPattern] ) )
+			break;
+	}
+
+	if( iPattern == NX_PATTERN_MAX )
+	{
+		printf( "Fail, unknown pattern %s ( bars, box, noise, zone ).\n", pName );
+		return NULL;
+	}
+
+	//	the stamp has to fit and chroma is subsampled by two
+	if( (iWidth & 1) || (iHeight & 1) ||
+		iWidth < PAT_STAMP_COLUMNS * b || iHeight < PAT_STAMP_BITS / PAT_STAMP_COLUMNS * b )
+	{
+		printf( "Fail, %dx%d too small for a pattern.\n", iWidth, iHeight );
+		return NULL;
+	}
+
+	pPat = (NX_FRAME_PATTERN*)calloc( 1, sizeof(NX_FRAME_PATTERN) );
+	if( !pPat )
+		return NULL;
+
+	pPat->iPattern = iPattern;
+	pPat->iWidth   = iWidth;
+	pPat->iHeight  = iHeight;
+	pPat->iSeed    = 0x12345678;
+
+	pPat->pBarY  = (uint8_t*)malloc( iWidth * 2 );
+	pPat->pBarU  = (uint8_t*)malloc( iWidth );
+	pPat->pBarV  = (uint8_t*)malloc( iWidth );
+	pPat->pRowUV = (uint8_t*)malloc( iWidth );
+	pPat->pZoneX = (uint16_t*)malloc( iWidth * sizeof(uint16_t) );
+	if( !pPat->pBarY || !pPat->pBarU || !pPat->pBarV || !pPat->pRowUV || !pPat->pZoneX )
+	{
+		NX_FramePatternClose( pPat );
+		return NULL;
+	}
+
+	for( int32_t x = 0; x < iWidth * 2; x++ )
+	{
+		const uint8_t *pBar = gBarYUV[(x % iWidth) * 8 / iWidth];
+
+		pPat->pBarY[x] = pBar[0];
+		if( !(x & 1) )
+		{
+			pPat->pBarU[x / 2] = pBar[1];
+			pPat->pBarV[x / 2] = pBar[2];
+		}
+	}
+
+	//	phase step reaches half a period per pixel at the frame edge
+	pPat->iZoneK = 32768 / iWidth;
+	for( int32_t x = 0; x < iWidth; x++ )
+	{
+		uint32_t dx = (x - iWidth / 2) * (x - iWidth / 2);
+		pPat->pZoneX[x] = (uint16_t)(dx * pPat->iZoneK);
+	}
+	for( int32_t i = 0; i < 256; i++ )
+		pPat->cosTable[i] = (uint8_t)(126 + 109 * cos( i * 2 * M_PI / 256 ));
+
+	return pPat;
+}
+
+//------------------------------------------------------------------------------
+int32_t NX_FramePatternFill( NX_FRAME_PATTERN_HANDLE hPat, NX_VID_MEMORY_INFO *pImg, uint32_t iFrame )
+{
+	PAT_PLANES planes;
+
+	if( !hPat || !pImg || pImg->width != hPat->iWidth || pImg->height != hPat->iHeight )
+		return -1;
+
+	if( 0 != GetPlanes( pImg, &planes ) )
+	{
+		printf( "Fail, pattern format 0x%08x not supported.\n", pImg->format );
+		return -1;
+	}
+
+	switch( hPat->iPattern )
+	{
+	case NX_PATTERN_BARS:	FillBars( hPat, &planes, iFrame );	break;
+	case NX_PATTERN_BOX:	FillBox( hPat, &planes, iFrame );	break;
+	case NX_PATTERN_NOISE:	FillNoise( hPat, &planes, iFrame );	break;
+	case NX_PATTERN_ZONE:	FillZone( hPat, &planes, iFrame );	break;
+	}
+
+	DrawStamp( hPat, &planes, iFrame );
+
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+void NX_FramePatternClose( NX_FRAME_PATTERN_HANDLE hPat )
+{
+	if( !hPat )
+		return;
+
+	free( hPat->pBarY );
+	free( hPat->pBarU );
+	free( hPat->pBarV );
+	free( hPat->pRowUV );
+	free( hPat->pZoneX );
+	free( hPat );
+}
+
+//------------------------------------------------------------------------------
+int32_t NX_FramePatternReadStamp( const NX_VID_MEMORY_INFO *pImg, NX_PATTERN_STAMP *pStamp )
+{
+	int32_t b = BlockSize( pImg->width );
+	const uint8_t *pY = (const uint8_t*)pImg->pBuffer[0];
+	uint32_t yStride = pImg->stride[0] ? pImg->stride[0] : ALIGN(pImg->width, 32);
+	uint32_t iMagic = 0, iFrame = 0, iTick = 0;
+
+	if( !pY || pImg->width < PAT_STAMP_COLUMNS * b ||
+		pImg->height < PAT_STAMP_BITS / PAT_STAMP_COLUMNS * b )
+		return -1;
+
+	for( int32_t i = 0; i < PAT_STAMP_BITS; i++ )
+	{
+		//	centre of the block, far from edges a codec may smear
+		int32_t x = (i % PAT_STAMP_COLUMNS) * b + b / 2;
+		int32_t y = (i / PAT_STAMP_COLUMNS) * b + b / 2;
+		uint32_t bit = pY[y * yStride + x] > (PAT_BLACK + PAT_WHITE) / 2;
+
+		if( i < 16 )
+			iMagic = (iMagic << 1) | bit;
+		else if( i < 48 )
+			iFrame = (iFrame << 1) | bit;
+		else
+			iTick = (iTick << 1) | bit;
+	}
+
+	if( iMagic != PAT_MAGIC )
+		return -1;
+
+	pStamp->frame  = iFrame;
+	pStamp->tickMs = iTick;
+	return 0;
+}
@@ -0,0 +1,58 @@
+//------------------------------------------------------------------------------
+//
+//	Copyright (C) 2016 Nexell Co. All Rights Reserved
+//	Nexell Co. Proprietary & Confidential
+//
+//	NEXELL INFORMS THAT THIS CODE AND INFORMATION IS PROVIDED "AS IS" BASE
+//  AND	WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS
+//  FOR A PARTICULAR PURPOSE.
+//
+//	Module		: Frame Pattern
+//	File		:
+//	Description	: Synthetic 4:2:0 test frames written straight into mapped
+//				  video memory, with a machine readable frame counter.
+//	Author		:
+//	Export		:
+//	History		:
+//
+//------------------------------------------------------------------------------
+
+#ifndef __NX_FRAMEPATTERN_H__
+#define __NX_FRAMEPATTERN_H__
+
+#include <stdint.h>
+#include <nx_video_api.h>
+
+enum
+{
+	NX_PATTERN_BARS,			//	colour bars, scrolling
+	NX_PATTERN_BOX,				//	bouncing box on a flat background
+	NX_PATTERN_NOISE,			//	new random luma and chroma every frame
+	NX_PATTERN_ZONE,			//	circular zone plate, phase moves
+	NX_PATTERN_MAX
+};
+
+typedef struct NX_FRAME_PATTERN *NX_FRAME_PATTERN_HANDLE;
+
+//	Frame counter overlay, top left corner of the luma plane:
+//	16 bit magic, 32 bit frame number and the low 32 bits of
+//	NX_GetTickCount() at fill time as black / white blocks.
+typedef struct
+{
+	uint32_t	frame;
+	uint32_t	tickMs;
+} NX_PATTERN_STAMP;
+
+//	pName : "bars", "box", "noise" or "zone", NULL when unknown
+NX_FRAME_PATTERN_HANDLE NX_FramePatternOpen( const char *pName, int32_t iWidth, int32_t iHeight );
+
+//	YUV420, YVU420, NV12 and NV21, single or multi planar.
+int32_t NX_FramePatternFill( NX_FRAME_PATTERN_HANDLE hPat, NX_VID_MEMORY_INFO *pImg, uint32_t iFrame );
+
+void NX_FramePatternClose( NX_FRAME_PATTERN_HANDLE hPat );
+
+//	Sink side: 0 and the stamp when pImg carries a counter overlay.
+int32_t NX_FramePatternReadStamp( const NX_VID_MEMORY_INFO *pImg, NX_PATTERN_STAMP *pStamp );
+
+#endif	// __NX_FRAMEPATTERN_H__
@@ -0,0 +1,430 @@
+//------------------------------------------------------------------------------
+//
+//	Copyright (C) 2016 Nexell Co. All Rights Reserved
+//	Nexell Co. Proprietary & Confidential
+//
+//	NEXELL INFORMS THAT THIS CODE AND INFORMATION IS PROVIDED "AS IS" BASE
+//  AND	WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS
+//  FOR A PARTICULAR PURPOSE.
+//
+//	Module		: Frame Recorder
+//	File		:
+//	Description	:
+//	Author		:
+//	Export		:
+//	History		:
+//
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/uio.h>
+
+#include "NX_FrameRecorder.h"
+#include "Util.h"
+
+#define REC_ALIGN		4096
+
+//
+//	The ring is addressed with monotonic byte counters (wrPos / rdPos).
+//	Push only queues the frame descriptor, like the checksum stage, so the
+//	caller never reads the (uncached) frame itself. One copy thread fills
+//	the ring and one writer thread drains it. The copy thread copies
+//	outside the lock and only publishes wrPos afterwards, so the writer
+//	never sees a partially copied frame. Every write except the final tail
+//	is a multiple of NX_REC_CHUNK_SIZE starting on a chunk boundary, which
+//	keeps buffer address, length and file offset aligned for O_DIRECT.
+//
+struct NX_FRAME_RECORDER {
+	int32_t		fd;
+	int32_t		bDirect;
+	int32_t		bDropOnFull;
+
+	uint8_t		*pRing;
+	uint64_t	ringSize;
+	uint64_t	wrPos;
+	uint64_t	rdPos;
+
+	NX_VID_MEMORY_INFO	queue[NX_REC_QUEUE_DEPTH];
+	int32_t		head;
+	int32_t		pending;			//	queued + being copied
+
+	int32_t		bCopyExit;
+	int32_t		bExit;
+	int32_t		iError;
+
+	pthread_t		hCopyThread;
+	pthread_t		hThread;
+	pthread_mutex_t	hLock;
+	pthread_cond_t	hWorkCond;
+	pthread_cond_t	hDoneCond;
+	pthread_cond_t	hDataCond;
+	pthread_cond_t	hSpaceCond;
+
+	//	statistics
+	uint32_t	frameCnt;
+	uint32_t	dropCnt;
+	uint32_t	writeCnt;
+	uint64_t	maxFill;
+	uint64_t	maxWriteTime;	//	nano-seconds
+};
+
+//------------------------------------------------------------------------------
+static void CopyToRing( NX_FRAME_RECORDER *pRec, uint64_t pos, const uint8_t *pSrc, uint64_t len )
+{
+	uint64_t off = pos % pRec->ringSize;
+	uint64_t first = pRec->ringSize - off;
+
+	if( first > len )
+		first = len;
+
+	memcpy( pRec->pRing + off, pSrc, first );
+	if( len > first )
+		memcpy( pRec->pRing, pSrc + first, len - first );
+}
+
+//------------------------------------------------------------------------------
+static int32_t WriteRing( NX_FRAME_RECORDER *pRec, uint64_t pos, uint64_t len )
+{
+	uint64_t off = pos % pRec->ringSize;
+	uint64_t first = pRec->ringSize - off;
+	struct iovec iov[2];
+	int32_t iovCnt = 1, i = 0;
+
+	if( first > len )
+		first = len;
+
+	iov[0].iov_base = pRec->pRing + off;
+	iov[0].iov_len  = first;
+	if( len > first )
+	{
+		iov[1].iov_base = pRec->pRing;
+		iov[1].iov_len  = len - first;
+		iovCnt = 2;
+	}
+
+	while( i < iovCnt )
+	{
+		ssize_t written = writev( pRec->fd, &iov[i], iovCnt - i );
+
+		if( written < 0 )
+		{
+			if( errno == EINTR )
+				continue;
+
+			//	Filesystem accepted O_DIRECT at open() but not at write()
+			if( (errno == EINVAL) && pRec->bDirect )
+			{
+				fcntl( pRec->fd, F_SETFL, fcntl(pRec->fd, F_GETFL) & ~O_DIRECT );
+				pRec->bDirect = 0;
+				continue;
+			}
+
+			printf("Fail, recorder write (%s).\n", strerror(errno));
+			return -1;
+		}
+
+		while( (i < iovCnt) && ((size_t)written >= iov[i].iov_len) )
+		{
+			written -= iov[i].iov_len;
+			i++;
+		}
+
+		if( i < iovCnt )
+		{
+			iov[i].iov_base = (uint8_t*)iov[i].iov_base + written;
+			iov[i].iov_len -= written;
+		}
+	}
+
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+static void CopyFrame( NX_FRAME_RECORDER *pRec, NX_VID_MEMORY_INFO *pImg )
+{
+	uint64_t frameSize = 0, pos, fill;
+	int32_t i;
+
+	for( i = 0; i < pImg->planes; i++ )
+		frameSize += pImg->size[i];
+
+	pthread_mutex_lock( &pRec->hLock );
+	while( pRec->iError || (pRec->ringSize - (pRec->wrPos - pRec->rdPos) < frameSize) )
+	{
+		if( pRec->bDropOnFull || pRec->iError || (frameSize > pRec->ringSize) )
+		{
+			pRec->dropCnt++;
+			pthread_mutex_unlock( &pRec->hLock );
+			return;
+		}
+		pthread_cond_wait( &pRec->hSpaceCond, &pRec->hLock );
+	}
+	pos = pRec->wrPos;
+	pthread_mutex_unlock( &pRec->hLock );
+
+	for( i = 0; i < pImg->planes; i++ )
+	{
+		CopyToRing( pRec, pos, (const uint8_t*)pImg->pBuffer[i], pImg->size[i] );
+		pos += pImg->size[i];
+	}
+
+	pthread_mutex_lock( &pRec->hLock );
+	pRec->wrPos = pos;
+	pRec->frameCnt++;
+	fill = pRec->wrPos - pRec->rdPos;
+	if( fill > pRec->maxFill )
+		pRec->maxFill = fill;
+	if( fill >= NX_REC_CHUNK_SIZE )
+		pthread_cond_signal( &pRec->hDataCond );
+	pthread_mutex_unlock( &pRec->hLock );
+}
+
+//------------------------------------------------------------------------------
+static void *CopyThread( void *pArg )
+{
+	NX_FRAME_RECORDER *pRec = (NX_FRAME_RECORDER*)pArg;
+
+	pthread_mutex_lock( &pRec->hLock );
+	for( ;; )
+	{
+		while( !pRec->bCopyExit && (pRec->pending == 0) )
+			pthread_cond_wait( &pRec->hWorkCond, &pRec->hLock );
+
+		if( pRec->pending == 0 )
+			break;
+
+		//	the slot stays owned by the copy thread until pending drops
+		NX_VID_MEMORY_INFO *pImg = &pRec->queue[pRec->head];
+		pthread_mutex_unlock( &pRec->hLock );
+
+		CopyFrame( pRec, pImg );
+
+		pthread_mutex_lock( &pRec->hLock );
+		pRec->head = (pRec->head + 1) % NX_REC_QUEUE_DEPTH;
+		pRec->pending--;
+		pthread_cond_broadcast( &pRec->hDoneCond );
+	}
+	pthread_mutex_unlock( &pRec->hLock );
+
+	return NULL;
+}
+
+//------------------------------------------------------------------------------
+static void *RecorderThread( void *pArg )
+{
+	NX_FRAME_RECORDER *pRec = (NX_FRAME_RECORDER*)pArg;
+
+	pthread_mutex_lock( &pRec->hLock );
+	for( ;; )
+	{
+		uint64_t pos, len, tail = 0, startTime;
+		int32_t iRet;
+
+		while( !pRec->bExit && (pRec->wrPos - pRec->rdPos < NX_REC_CHUNK_SIZE) )
+			pthread_cond_wait( &pRec->hDataCond, &pRec->hLock );
+
+		pos = pRec->rdPos;
+		len = pRec->wrPos - pRec->rdPos;
+
+		if( pRec->bExit )
+		{
+			if( len == 0 )
+				break;
+			tail = len % NX_REC_CHUNK_SIZE;
+		}
+		len -= len % NX_REC_CHUNK_SIZE;
+		pthread_mutex_unlock( &pRec->hLock );
+
+		startTime = NX_GetTickCountNs();
+
+		iRet = 0;
+		if( (len > 0) && !pRec->iError )
+			iRet = WriteRing( pRec, pos, len );
+
+		//	Last partial chunk can not go through O_DIRECT
+		if( (tail > 0) && !pRec->iError && !iRet )
+		{
+			if( pRec->bDirect )
+			{
+				fcntl( pRec->fd, F_SETFL, fcntl(pRec->fd, F_GETFL) & ~O_DIRECT );
+				pRec->bDirect = 0;
+			}
+			iRet = WriteRing( pRec, pos + len, tail );
+		}
+
+		startTime = NX_GetTickCountNs() - startTime;
+
+		pthread_mutex_lock( &pRec->hLock );
+		if( iRet < 0 )
+			pRec->iError = 1;
+		if( startTime > pRec->maxWriteTime )
+			pRec->maxWriteTime = startTime;
+		pRec->writeCnt++;
+		pRec->rdPos += len + tail;
+		pthread_cond_broadcast( &pRec->hSpaceCond );
+	}
+	pthread_mutex_unlock( &pRec->hLock );
+
+	return NULL;
+}
+
+//------------------------------------------------------------------------------
+NX_FRAME_RECORDER_HANDLE NX_FrameRecorderOpen( const char *pFileName, uint32_t ringSize, int32_t bDropOnFull )
+{
+	NX_FRAME_RECORDER *pRec;
+	void *pRing = NULL;
+
+	if( ringSize == 0 )
+		ringSize = NX_REC_RING_SIZE;
+
+	//	Whole chunks only, at least double buffered
+	ringSize = (ringSize + NX_REC_CHUNK_SIZE - 1) / NX_REC_CHUNK_SIZE * NX_REC_CHUNK_SIZE;
+	if( ringSize < 2 * NX_REC_CHUNK_SIZE )
+		ringSize = 2 * NX_REC_CHUNK_SIZE;
+
+	pRec = (NX_FRAME_RECORDER*)calloc( 1, sizeof(NX_FRAME_RECORDER) );
+	if( pRec == NULL )
+		return NULL;
+
+	pRec->bDirect = 1;
+	pRec->fd = open( pFileName, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644 );
+	if( (pRec->fd < 0) && (errno == EINVAL) )
+	{
+		pRec->bDirect = 0;
+		pRec->fd = open( pFileName, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+	}
+
+	if( pRec->fd < 0 )
+	{
+		printf("Fail, open recorder file(%s).\n", pFileName);
+		free( pRec );
+		return NULL;
+	}
+
+	if( posix_memalign( &pRing, REC_ALIGN, ringSize ) )
+	{
+		printf("Fail, allocate recorder ring (%u bytes).\n", ringSize);
+		close( pRec->fd );
+		free( pRec );
+		return NULL;
+	}
+
+	pRec->pRing       = (uint8_t*)pRing;
+	pRec->ringSize    = ringSize;
+	pRec->bDropOnFull = bDropOnFull;
+
+	pthread_mutex_init( &pRec->hLock, NULL );
+	pthread_cond_init( &pRec->hWorkCond, NULL );
+	pthread_cond_init( &pRec->hDoneCond, NULL );
+	pthread_cond_init( &pRec->hDataCond, NULL );
+	pthread_cond_init( &pRec->hSpaceCond, NULL );
+
+	if( 0 != pthread_create( &pRec->hThread, NULL, RecorderThread, pRec ) )
+	{
+		printf("Fail, create recorder thread.\n");
+		goto ERROR_THREAD;
+	}
+
+	if( 0 != pthread_create( &pRec->hCopyThread, NULL, CopyThread, pRec ) )
+	{
+		printf("Fail, create recorder copy thread.\n");
+		pthread_mutex_lock( &pRec->hLock );
+		pRec->bExit = 1;
+		pthread_cond_signal( &pRec->hDataCond );
+		pthread_mutex_unlock( &pRec->hLock );
+		pthread_join( pRec->hThread, NULL );
+		goto ERROR_THREAD;
+	}
+
+	printf("Recorder : %s, ring %u KB, %s, %s\n", pFileName, ringSize / 1024,
+		pRec->bDirect ? "O_DIRECT" : "buffered", bDropOnFull ? "drop on full" : "blocking");
+
+	return pRec;
+
+ERROR_THREAD:
+	pthread_cond_destroy( &pRec->hSpaceCond );
+	pthread_cond_destroy( &pRec->hDataCond );
+	pthread_cond_destroy( &pRec->hDoneCond );
+	pthread_cond_destroy( &pRec->hWorkCond );
+	pthread_mutex_destroy( &pRec->hLock );
+	free( pRec->pRing );
+	close( pRec->fd );
+	free( pRec );
+	return NULL;
+}
+
+//------------------------------------------------------------------------------
+int32_t NX_FrameRecorderPush( NX_FRAME_RECORDER_HANDLE hRec, NX_VID_MEMORY_INFO *pImg )
+{
+	pthread_mutex_lock( &hRec->hLock );
+	while( hRec->pending >= NX_REC_QUEUE_DEPTH )
+	{
+		if( hRec->bDropOnFull )
+		{
+			hRec->dropCnt++;
+			pthread_mutex_unlock( &hRec->hLock );
+			return -1;
+		}
+		pthread_cond_wait( &hRec->hDoneCond, &hRec->hLock );
+	}
+
+	hRec->queue[(hRec->head + hRec->pending) % NX_REC_QUEUE_DEPTH] = *pImg;
+	hRec->pending++;
+	pthread_cond_signal( &hRec->hWorkCond );
+	pthread_mutex_unlock( &hRec->hLock );
+
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+void NX_FrameRecorderSync( NX_FRAME_RECORDER_HANDLE hRec, int32_t iKeep )
+{
+	pthread_mutex_lock( &hRec->hLock );
+	while( hRec->pending > iKeep )
+		pthread_cond_wait( &hRec->hDoneCond, &hRec->hLock );
+	pthread_mutex_unlock( &hRec->hLock );
+}
+
+//------------------------------------------------------------------------------
+void NX_FrameRecorderClose( NX_FRAME_RECORDER_HANDLE hRec )
+{
+	if( hRec == NULL )
+		return;
+
+	//	copy what is queued, then let the writer flush the tail
+	pthread_mutex_lock( &hRec->hLock );
+	hRec->bCopyExit = 1;
+	pthread_cond_signal( &hRec->hWorkCond );
+	pthread_mutex_unlock( &hRec->hLock );
+
+	pthread_join( hRec->hCopyThread, NULL );
+
+	pthread_mutex_lock( &hRec->hLock );
+	hRec->bExit = 1;
+	pthread_cond_signal( &hRec->hDataCond );
+	pthread_mutex_unlock( &hRec->hLock );
+
+	pthread_join( hRec->hThread, NULL );
+
+	printf("Recorder : frames = %u, dropped = %u, bytes = %llu, writes = %u, max fill = %llu%%, max write = %.3f ms%s\n",
+		hRec->frameCnt, hRec->dropCnt, (unsigned long long)hRec->rdPos, hRec->writeCnt,
+		(unsigned long long)(hRec->maxFill * 100 / hRec->ringSize),
+		(double)hRec->maxWriteTime / 1000000., hRec->iError ? ", write error" : "");
+
+	pthread_cond_destroy( &hRec->hSpaceCond );
+	pthread_cond_destroy( &hRec->hDataCond );
+	pthread_cond_destroy( &hRec->hDoneCond );
+	pthread_cond_destroy( &hRec->hWorkCond );
+	pthread_mutex_destroy( &hRec->hLock );
+
+	close( hRec->fd );
+	free( hRec->pRing );
+	free( hRec );
+}
@@ -0,0 +1,52 @@
+//------------------------------------------------------------------------------
+//
+//	Copyright (C) 2016 Nexell Co. All Rights Reserved
+//	Nexell Co. Proprietary & Confidential
+//
+//	NEXELL INFORMS THAT THIS CODE AND INFORMATION IS PROVIDED "AS IS" BASE
+//  AND	WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS
+//  FOR A PARTICULAR PURPOSE.
+//
+//	Module		: Frame Recorder
+//	File		:
+//	Description	: Asynchronous raw frame writer.
+//				  Frames are copied into a bounded byte ring and written by a
+//				  dedicated thread in large aligned chunks.
+//	Author		:
+//	Export		:
+//	History		:
+//
+//------------------------------------------------------------------------------
+
+#ifndef __NX_FRAMERECORDER_H__
+#define __NX_FRAMERECORDER_H__
+
+#include <stdint.h>
+#include <nx_video_api.h>
+
+#define NX_REC_CHUNK_SIZE		(1024 * 1024)			//	write unit
+#define NX_REC_RING_SIZE		(64 * 1024 * 1024)		//	default ring size
+#define NX_REC_QUEUE_DEPTH		4						//	frames waiting to be copied
+
+typedef struct NX_FRAME_RECORDER *NX_FRAME_RECORDER_HANDLE;
+
+//	ringSize    : ring buffer size in bytes (0 = NX_REC_RING_SIZE)
+//	bDropOnFull : 1 = drop the frame when the ring is full (capture)
+//	              0 = wait for free space (file decoding)
+NX_FRAME_RECORDER_HANDLE NX_FrameRecorderOpen( const char *pFileName, uint32_t ringSize, int32_t bDropOnFull );
+
+//	Queue pImg to be copied into the ring by the recorder's copy thread.
+//	Only the descriptor is copied: the pixels must stay valid until
+//	NX_FrameRecorderSync() says the frame is done. Returns 0, or -1 when
+//	the frame is dropped because the queue is full (bDropOnFull).
+int32_t NX_FrameRecorderPush( NX_FRAME_RECORDER_HANDLE hRec, NX_VID_MEMORY_INFO *pImg );
+
+//	Wait until at most iKeep frames are still being copied.
+//	Call it before a pushed buffer goes back to the driver.
+void NX_FrameRecorderSync( NX_FRAME_RECORDER_HANDLE hRec, int32_t iKeep );
+
+//	Flush pending data, stop the writer thread and print statistics.
+void NX_FrameRecorderClose( NX_FRAME_RECORDER_HANDLE hRec );
+
+#endif	// __NX_FRAMERECORDER_H__
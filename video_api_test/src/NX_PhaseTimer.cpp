@@ -0,0 +1,178 @@
+//------------------------------------------------------------------------------
+//
+//	Copyright (C) 2016 Nexell Co. All Rights Reserved
+//	Nexell Co. Proprietary & Confidential
+//
+//	NEXELL INFORMS THAT THIS CODE AND INFORMATION IS PROVIDED "AS IS" BASE
+//  AND	WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS
+//  FOR A PARTICULAR PURPOSE.
+//
+//	Module		: Phase Timer
+//	File		:
+//	Description	:
+//	Author		:
+//	Export		:
+//	History		:
+//
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "NX_PhaseTimer.h"
+#include "Util.h"
+
+#define WATERFALL_COLUMNS	48
+
+typedef struct NX_PHASE_INFO {
+	const char	*pName;
+	uint64_t	startTime;		//	nano-seconds
+	uint64_t	endTime;		//	nano-seconds, 0 = not closed
+	int32_t		tid;
+} NX_PHASE_INFO;
+
+static NX_PHASE_INFO gstPhase[NX_MAX_PHASE_NUM];
+static int32_t giPhaseNum = 0;
+
+//------------------------------------------------------------------------------
+int32_t NX_PhaseBegin( const char *pName )
+{
+	int32_t iPhase = __sync_fetch_and_add( &giPhaseNum, 1 );
+
+	if( iPhase >= NX_MAX_PHASE_NUM )
+		return -1;
+
+	gstPhase[iPhase].pName   = pName;
+	gstPhase[iPhase].tid     = (int32_t)syscall( SYS_gettid );
+	gstPhase[iPhase].endTime = 0;
+	gstPhase[iPhase].startTime = NX_GetTickCountNs();
+
+	return iPhase;
+}
+
+//------------------------------------------------------------------------------
+void NX_PhaseEnd( int32_t iPhase )
+{
+	if( (iPhase < 0) || (iPhase >= NX_MAX_PHASE_NUM) )
+		return;
+
+	gstPhase[iPhase].endTime = NX_GetTickCountNs();
+}
+
+//------------------------------------------------------------------------------
+static int32_t GetPhaseNum( void )
+{
+	return (giPhaseNum > NX_MAX_PHASE_NUM) ? NX_MAX_PHASE_NUM : giPhaseNum;
+}
+
+//	Number of closed phases enclosing iPhase
+static int32_t GetPhaseDepth( int32_t iPhase, int32_t iNum )
+{
+	NX_PHASE_INFO *pCur = &gstPhase[iPhase];
+	int32_t i, iDepth = 0;
+
+	for( i = 0; i < iNum; i++ )
+	{
+		NX_PHASE_INFO *pOut = &gstPhase[i];
+
+		if( (i == iPhase) || (pOut->endTime == 0) )
+			continue;
+
+		if( (pOut->startTime <= pCur->startTime) && (pOut->endTime >= pCur->endTime) &&
+			((pOut->startTime != pCur->startTime) || (pOut->endTime != pCur->endTime) || (i < iPhase)) )
+			iDepth++;
+	}
+
+	return iDepth;
+}
+
+//------------------------------------------------------------------------------
+void NX_PhasePrint( void )
+{
+	int32_t iNum = GetPhaseNum();
+	uint64_t origin = (uint64_t)-1, last = 0, span;
+	int32_t i, j;
+
+	for( i = 0; i < iNum; i++ )
+	{
+		if( gstPhase[i].endTime == 0 )
+			continue;
+		if( gstPhase[i].startTime < origin )	origin = gstPhase[i].startTime;
+		if( gstPhase[i].endTime > last )		last = gstPhase[i].endTime;
+	}
+
+	if( last == 0 )
+	{
+		printf("No startup phase recorded.\n");
+		return;
+	}
+
+	span = (last > origin) ? (last - origin) : 1;
+
+	printf("\n%-24s %10s %10s  waterfall (total %.3f ms)\n",
+		"phase", "start(ms)", "dur(ms)", (double)span / 1000000.);
+
+	for( i = 0; i < iNum; i++ )
+	{
+		NX_PHASE_INFO *pPhase = &gstPhase[i];
+		char label[25];
+		int32_t from, to;
+
+		if( pPhase->endTime == 0 )
+			continue;
+
+		snprintf( label, sizeof(label), "%*s%s", GetPhaseDepth(i, iNum) * 2, "", pPhase->pName );
+
+		from = (int32_t)((pPhase->startTime - origin) * WATERFALL_COLUMNS / span);
+		to   = (int32_t)((pPhase->endTime - origin) * WATERFALL_COLUMNS / span);
+		if( to == from )
+			to = from + 1;
+
+		printf("%-24s %10.3f %10.3f  |", label,
+			(double)(pPhase->startTime - origin) / 1000000.,
+			(double)(pPhase->endTime - pPhase->startTime) / 1000000.);
+		for( j = 0; j < WATERFALL_COLUMNS; j++ )
+			putchar( (j >= from && j < to) ? '#' : ' ' );
+		printf("|\n");
+	}
+}
+
+//------------------------------------------------------------------------------
+int32_t NX_PhaseWriteTrace( const char *pFileName )
+{
+	int32_t iNum = GetPhaseNum();
+	int32_t pid = (int32_t)getpid();
+	int32_t i, bFirst = 1;
+	FILE *fp;
+
+	fp = fopen( pFileName, "w" );
+	if( fp == NULL )
+	{
+		printf("Fail, open trace file(%s).\n", pFileName);
+		return -1;
+	}
+
+	fprintf( fp, "{\"traceEvents\":[\n" );
+	for( i = 0; i < iNum; i++ )
+	{
+		NX_PHASE_INFO *pPhase = &gstPhase[i];
+
+		if( pPhase->endTime == 0 )
+			continue;
+
+		//	complete event, timestamps in micro-seconds
+		fprintf( fp, "%s{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}",
+			bFirst ? "" : ",\n", pPhase->pName,
+			(double)pPhase->startTime / 1000.,
+			(double)(pPhase->endTime - pPhase->startTime) / 1000.,
+			pid, pPhase->tid );
+		bFirst = 0;
+	}
+	fprintf( fp, "\n],\"displayTimeUnit\":\"ms\"}\n" );
+	fclose( fp );
+
+	printf("Startup phase trace : %s\n", pFileName);
+	return 0;
+}
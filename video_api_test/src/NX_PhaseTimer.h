@@ -0,0 +1,37 @@
+//------------------------------------------------------------------------------
+//
+//	Copyright (C) 2016 Nexell Co. All Rights Reserved
+//	Nexell Co. Proprietary & Confidential
+//
+//	NEXELL INFORMS THAT THIS CODE AND INFORMATION IS PROVIDED "AS IS" BASE
+//  AND	WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS
+//  FOR A PARTICULAR PURPOSE.
+//
+//	Module		: Phase Timer
+//	File		:
+//	Description	: Startup phase profiler (CLOCK_MONOTONIC, nano-seconds)
+//	Author		:
+//	Export		:
+//	History		:
+//
+//------------------------------------------------------------------------------
+
+#ifndef __NX_PHASETIMER_H__
+#define __NX_PHASETIMER_H__
+
+#include <stdint.h>
+
+#define NX_MAX_PHASE_NUM	64
+
+//	Returns phase index (or -1 when the phase table is full)
+int32_t NX_PhaseBegin( const char *pName );
+void	NX_PhaseEnd( int32_t iPhase );
+
+//	Print waterfall of all closed phases to stdout
+void	NX_PhasePrint( void );
+
+//	Write closed phases as Chrome trace JSON (chrome://tracing, Perfetto)
+int32_t NX_PhaseWriteTrace( const char *pFileName );
+
+#endif	// __NX_PHASETIMER_H__
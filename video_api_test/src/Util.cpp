@@ -1,17 +1,19 @@
 #include <stdio.h>
-#include <sys/time.h>
+#include <time.h>
 
 #include "Util.h"
 
 
 uint64_t NX_GetTickCount( void )
 {
-	uint64_t ret;
-	struct timeval	tv;
-	struct timezone	zv;
-	gettimeofday( &tv, &zv );
-	ret = ((uint64_t)tv.tv_sec)*1000 + tv.tv_usec/1000;
-	return ret;
+	return NX_GetTickCountNs() / 1000000;
+}
+
+uint64_t NX_GetTickCountNs( void )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ((uint64_t)ts.tv_sec)*1000000000 + ts.tv_nsec;
 }
 
 void dumpdata( void *data, int32_t len, const char *msg )
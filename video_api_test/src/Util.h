@@ -3,7 +3,8 @@
 
 #include <stdint.h>
 
-uint64_t NX_GetTickCount( void );
+uint64_t NX_GetTickCount( void );		//	milli-seconds, CLOCK_MONOTONIC
+uint64_t NX_GetTickCountNs( void );		//	nano-seconds, CLOCK_MONOTONIC
 void dumpdata( void *data, int32_t len, const char *msg );
 
 
@@ -23,9 +24,13 @@ typedef struct CODEC_APP_DATA {
 	int32_t qp;					/* Fixed Qp */
 	int32_t vbv;
 	int32_t maxQp;
+	int32_t dqTimeout;			/* Camera Stall Timeout (msec, 0:default) */
 
 	/* Output Options */
 	char *outFileName;			/* Output File Name */
+	char *rawFileName;			/* Raw Capture Dump File Name (Camera Encoder) */
+	char *traceFileName;		/* Startup Phase Trace(Chrome JSON) File Name */
+	char *checksumFileName;		/* Frame Checksum Log File Name ("-": no log) */
 } CODEC_APP_DATA;
 
 #endif // __UTIL_h__
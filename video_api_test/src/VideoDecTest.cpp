@@ -33,6 +33,10 @@
 
 #include "MediaExtractor.h"
 #include "CodecInfo.h"
+#include "NX_FrameRecorder.h"
+#include "NX_FrameChecksum.h"
+#include "NX_FramePattern.h"
+#include "NX_PhaseTimer.h"
 #include "Util.h"
 
 #define ENABLE_DRM_DISPLAY
@@ -98,7 +102,12 @@ int32_t VpuDecMain( CODEC_APP_DATA *pAppData )
 	uint8_t streamBuffer[4*1024*1024];
 	int32_t ret, seqflg = 0;
 	int32_t imgWidth = -1, imgHeight = -1;
+	int32_t iTotalPhase, iPhase;
+	int32_t bFullRange = 0;
 
+	iTotalPhase = NX_PhaseBegin("first frame");
+
+	iPhase = NX_PhaseBegin("media open");
 	CMediaReader *pMediaReader = new CMediaReader();
 	if (!pMediaReader->OpenFile( pAppData->inFileName))
 	{
@@ -106,12 +115,14 @@ int32_t VpuDecMain( CODEC_APP_DATA *pAppData )
 		exit(-1);
 	}
 	pMediaReader->GetVideoResolution(&imgWidth, &imgHeight);
+	NX_PhaseEnd(iPhase);
 
 	register_signal();
 
 	//==============================================================================
 	// DISPLAY INITIALIZATION
 	//==============================================================================
+	iPhase = NX_PhaseBegin("display init");
 	{
 		int drmFd = open("/dev/dri/card0", O_RDWR);
 
@@ -149,6 +160,7 @@ int32_t VpuDecMain( CODEC_APP_DATA *pAppData )
 		InitDrmDisplay(hDsp, PLANE_ID, CRTC_ID, DRM_FORMAT_YUV420, srcRect, dstRect);
 #endif	//	ENABLE_DRM_DISPLAY
 	}
+	NX_PhaseEnd(iPhase);
 
 	//==============================================================================
 	// DECODER INITIALIZATION
@@ -161,13 +173,16 @@ int32_t VpuDecMain( CODEC_APP_DATA *pAppData )
 
 		pMediaReader->GetCodecTagId(AVMEDIA_TYPE_VIDEO, &fourcc, &codecId);
 		v4l2CodecType = CodecIdToV4l2Type(codecId, fourcc);
+		bFullRange = (v4l2CodecType == V4L2_PIX_FMT_MJPEG);
 
+		iPhase = NX_PhaseBegin("decoder open");
 		hDec = NX_V4l2DecOpen(v4l2CodecType);
 		if (hDec == NULL)
 		{
 			printf("Fail, NX_V4l2DecOpen().\n");
 			exit(-1);
 		}
+		NX_PhaseEnd(iPhase);
 
 		memset(&seqIn, 0, sizeof(seqIn));
 
@@ -192,6 +207,7 @@ int32_t VpuDecMain( CODEC_APP_DATA *pAppData )
 			seqflg = 1;
 		}
 
+		iPhase = NX_PhaseBegin("ParseVideoCfg");
 		ret = NX_V4l2DecParseVideoCfg(hDec, &seqIn, &seqOut);
 		if ((ret < 0) && (seqIn.seqSize == 0))
 		{
@@ -203,6 +219,7 @@ int32_t VpuDecMain( CODEC_APP_DATA *pAppData )
 
 			ret = NX_V4l2DecParseVideoCfg(hDec, &seqIn, &seqOut);
 		}
+		NX_PhaseEnd(iPhase);
 
 		if (ret < 0)
 		{
@@ -228,12 +245,14 @@ int32_t VpuDecMain( CODEC_APP_DATA *pAppData )
 		seqIn.imgFormat	= seqOut.imgFourCC;
 #endif
 
+		iPhase = NX_PhaseBegin("decoder init");
 		ret = NX_V4l2DecInit(hDec, &seqIn);
 		if (ret < 0)
 		{
 			printf("File, NX_V4l2DecInit().\n");
 			goto DEC_TERMINATE;
 		}
+		NX_PhaseEnd(iPhase);
 	}
 
 	//==============================================================================
@@ -243,22 +262,44 @@ int32_t VpuDecMain( CODEC_APP_DATA *pAppData )
 		int frmCnt = 0, size = 0;
 		uint64_t startTime, endTime, totalTime = 0;
 		int64_t timeStamp = -1;
-		FILE *fpOut = NULL;
+		NX_FRAME_RECORDER_HANDLE hRec = NULL;
+		NX_FRAME_CHECKSUM_HANDLE hChk = NULL;
 		int32_t prvIndex = -1;
 
+		//	streams encoded from -i pattern:<name> carry a frame counter
+		NX_PATTERN_STAMP stamp;
+		uint32_t stampFrames = 0, stampLost = 0, stampRepeat = 0, stampNext = 0;
+
 		NX_V4L2DEC_IN decIn;
 		NX_V4L2DEC_OUT decOut;
 
 		if (pAppData->outFileName)
 		{
-			fpOut = fopen(pAppData->outFileName, "wb");
-			if (fpOut == NULL) {
+			//	file decoding may wait for the writer, never drop
+			hRec = NX_FrameRecorderOpen(pAppData->outFileName, 0, 0);
+			if (hRec == NULL) {
 				printf("output file open error!!\n");
 				ret = -1;
 				goto DEC_TERMINATE;
 			}
 		}
 
+		if (pAppData->checksumFileName)
+		{
+			//	JPEG decodes to full range samples
+			hChk = NX_FrameChecksumOpen(strcmp(pAppData->checksumFileName, "-") ? pAppData->checksumFileName : NULL,
+				!bFullRange);
+			if (hChk == NULL) {
+				if (hRec)
+					NX_FrameRecorderClose(hRec);
+				ret = -1;
+				goto DEC_TERMINATE;
+			}
+		}
+
+		//	closed by the first displayable frame
+		iPhase = NX_PhaseBegin("first decode");
+
 		while(!bExitLoop)
 		{
 			memset(&decIn, 0, sizeof(NX_V4L2DEC_IN));
@@ -300,12 +341,33 @@ int32_t VpuDecMain( CODEC_APP_DATA *pAppData )
 
 			if (decOut.dispIdx >= 0)
 			{
-				if (fpOut)
+				if (iPhase >= 0)
 				{
-					int i;
+					NX_PhaseEnd(iPhase);
+					NX_PhaseEnd(iTotalPhase);
+					iPhase = -1;
+				}
+
+				if (hRec)
+					NX_FrameRecorderPush(hRec, &decOut.hImg);
+
+				if (hChk)
+					NX_FrameChecksumPush(hChk, &decOut.hImg);
 
-					for (i=0 ; i<decOut.hImg.planes; i++)
-						fwrite((void*)decOut.hImg.pBuffer[i], 1, decOut.hImg.size[i], fpOut);
+				if (0 == NX_FramePatternReadStamp(&decOut.hImg, &stamp))
+				{
+					if (stampFrames && stamp.frame < stampNext)
+					{
+						printf("Pattern frame %u repeated or reordered (expected %u)\n", stamp.frame, stampNext);
+						stampRepeat++;
+					}
+					else if (stampFrames && stamp.frame > stampNext)
+					{
+						printf("Pattern frames %u..%u lost\n", stampNext, stamp.frame - 1);
+						stampLost += stamp.frame - stampNext;
+					}
+					stampNext = stamp.frame + 1;
+					stampFrames++;
 				}
 
 #ifdef ENABLE_DRM_DISPLAY
@@ -314,6 +376,13 @@ int32_t VpuDecMain( CODEC_APP_DATA *pAppData )
 
 				if( prvIndex >= 0 )
 				{
+					//	previous frame must be copied and checked before the decoder reuses it
+					if (hRec)
+						NX_FrameRecorderSync(hRec, 1);
+
+					if (hChk)
+						NX_FrameChecksumSync(hChk, 1);
+
 					ret = NX_V4l2DecClrDspFlag(hDec, NULL, prvIndex);
 					if (ret < 0)
 						break;
@@ -325,8 +394,14 @@ int32_t VpuDecMain( CODEC_APP_DATA *pAppData )
 			frmCnt++;
 		}
 
-		if (fpOut)
-			fclose(fpOut);
+		if (hRec)
+			NX_FrameRecorderClose(hRec);
+
+		if (hChk)
+			NX_FrameChecksumClose(hChk);
+
+		if (stampFrames)
+			printf("Pattern stamps : %u frames, %u lost, %u repeated\n", stampFrames, stampLost, stampRepeat);
 	}
 
 	//==============================================================================
@@ -339,6 +414,10 @@ DEC_TERMINATE:
 	if (pMediaReader)
 		delete pMediaReader;
 
+	NX_PhasePrint();
+	if (pAppData->traceFileName)
+		NX_PhaseWriteTrace(pAppData->traceFileName);
+
 	printf("Decode End!!(ret = %d)\n", ret);
 	return ret;
 }
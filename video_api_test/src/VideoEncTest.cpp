@@ -32,7 +32,12 @@
 #include <nx_video_alloc.h>
 #include <nx_video_api.h>
 
+#include "NX_CaptureTrace.h"
 #include "NX_CV4l2Camera.h"
+#include "NX_FrameRecorder.h"
+#include "NX_FrameChecksum.h"
+#include "NX_FramePattern.h"
+#include "NX_PhaseTimer.h"
 #include "Util.h"
 
 #define ENABLE_DRM_DISPLAY
@@ -284,6 +289,8 @@ static int32_t VpuCamEncMain( CODEC_APP_DATA *pAppData )
 	NX_VIP_INFO info;
 	NX_CV4l2Camera*	pV4l2Camera = NULL;
 	NX_VID_MEMORY_HANDLE hVideoMemory[IMAGE_BUFFER_NUM];
+	NX_FRAME_RECORDER_HANDLE hRec = NULL;
+	NX_FRAME_CHECKSUM_HANDLE hChk = NULL;
 
 	int32_t inWidth = 0;
 	int32_t inHeight = 0;
@@ -301,6 +308,9 @@ static int32_t VpuCamEncMain( CODEC_APP_DATA *pAppData )
 
 	int32_t ret = 0, i;
 	int32_t planes = IMG_PLANE_NUM;
+	int32_t iTotalPhase, iPhase;
+
+	iTotalPhase = NX_PhaseBegin("first frame");
 
 	FILE *fpOut = fopen(pAppData->outFileName, "wb");
 
@@ -310,11 +320,33 @@ static int32_t VpuCamEncMain( CODEC_APP_DATA *pAppData )
 		goto CAM_ENC_TERMINATE;
 	}
 
+	//	raw capture dump, frames are dropped (and counted) if storage lags
+	if (pAppData->rawFileName)
+	{
+		hRec = NX_FrameRecorderOpen(pAppData->rawFileName, 0, 1);
+		if (hRec == NULL)
+		{
+			ret = -1;
+			goto CAM_ENC_TERMINATE;
+		}
+	}
+
+	if (pAppData->checksumFileName)
+	{
+		hChk = NX_FrameChecksumOpen(strcmp(pAppData->checksumFileName, "-") ? pAppData->checksumFileName : NULL, 1);
+		if (hChk == NULL)
+		{
+			ret = -1;
+			goto CAM_ENC_TERMINATE;
+		}
+	}
+
 	register_signal();
 
 	//==============================================================================
 	// DISPLAY INITIALIZATION
 	//==============================================================================
+	iPhase = NX_PhaseBegin("display init");
 	{
 		int drmFd = open("/dev/dri/card0", O_RDWR);
 
@@ -352,6 +384,7 @@ static int32_t VpuCamEncMain( CODEC_APP_DATA *pAppData )
 		InitDrmDisplay(hDsp, PLANE_ID, CRTC_ID, DRM_FORMAT_YUV420, srcRect, dstRect );
 #endif	//	ENABLE_DRM_DISPLAY
 	}
+	NX_PhaseEnd(iPhase);
 
 	//==============================================================================
 	// CAMERA INITIALIZATION
@@ -377,6 +410,9 @@ static int32_t VpuCamEncMain( CODEC_APP_DATA *pAppData )
 
 		info.iOutWidth		= inWidth;
 		info.iOutHeight		= inHeight;
+
+		info.iDqTimeout		= pAppData->dqTimeout;
+		iPhase = NX_PhaseBegin("camera init");
 		pV4l2Camera = new NX_CV4l2Camera();
 		if( 0 > pV4l2Camera->Init( &info ) )
 		{
@@ -386,6 +422,7 @@ static int32_t VpuCamEncMain( CODEC_APP_DATA *pAppData )
 			printf( "Fail, V4l2Camera Init().\n");
 			goto CAM_ENC_TERMINATE;
 		}
+		NX_PhaseEnd(iPhase);
 
 		for( i = 0; i < IMAGE_BUFFER_NUM; i++ )
 		{
@@ -427,6 +464,7 @@ static int32_t VpuCamEncMain( CODEC_APP_DATA *pAppData )
 			goto CAM_ENC_TERMINATE;
 		}
 
+		iPhase = NX_PhaseBegin("encoder open");
 		hEnc = NX_V4l2EncOpen(pAppData->codec);
 		if (hEnc == NULL)
 		{
@@ -434,6 +472,7 @@ static int32_t VpuCamEncMain( CODEC_APP_DATA *pAppData )
 			ret = -1;
 			goto CAM_ENC_TERMINATE;
 		}
+		NX_PhaseEnd(iPhase);
 
 		memset(&encPara, 0, sizeof(encPara));
 		encPara.width = inWidth;
@@ -458,12 +497,14 @@ static int32_t VpuCamEncMain( CODEC_APP_DATA *pAppData )
 		if (pAppData->codec == V4L2_PIX_FMT_MJPEG)
 			encPara.jpgQuality = (pAppData->qp == 0) ? (90) : (pAppData->qp);
 
+		iPhase = NX_PhaseBegin("encoder init");
 		ret = NX_V4l2EncInit(hEnc, &encPara);
 		if (ret < 0)
 		{
 			printf("video encoder initialization is failed!!!");
 			goto CAM_ENC_TERMINATE;
 		}
+		NX_PhaseEnd(iPhase);
 
 		ret = NX_V4l2EncGetSeqInfo(hEnc, &pSeqData, &seqSize);
 		if (ret < 0)
@@ -483,6 +524,9 @@ static int32_t VpuCamEncMain( CODEC_APP_DATA *pAppData )
 		int32_t frmCnt = 0;
 		uint64_t startTime, endTime;
 
+		//	closed by the first encoded frame
+		iPhase = NX_PhaseBegin("first encode");
+
 		while (!bExitLoop)
 		{
 			NX_V4L2ENC_IN encIn;
@@ -501,6 +545,13 @@ static int32_t VpuCamEncMain( CODEC_APP_DATA *pAppData )
 #ifdef ENABLE_DRM_DISPLAY
 			UpdateBuffer(hDsp, pBuf, NULL);
 #endif
+			//	copied and checked while the frame is being encoded
+			if (hRec)
+				NX_FrameRecorderPush(hRec, pBuf);
+
+			if (hChk)
+				NX_FrameChecksumPush(hChk, pBuf);
+
 			memset(&encIn, 0, sizeof(NX_V4L2ENC_IN));
 			memset(&encOut, 0, sizeof(NX_V4L2ENC_OUT));
 
@@ -520,12 +571,25 @@ static int32_t VpuCamEncMain( CODEC_APP_DATA *pAppData )
 				break;
 			}
 
+			if (hRec)
+				NX_FrameRecorderSync(hRec, 0);
+
+			if (hChk)
+				NX_FrameChecksumSync(hChk, 0);
+
 			if( 0 >  pV4l2Camera->QueueBuffer( pBuf ) )
 			{
 				printf( "Fail, DequeueBuffer().\n" );
 				break;
 			}
 
+			if (iPhase >= 0)
+			{
+				NX_PhaseEnd(iPhase);
+				NX_PhaseEnd(iTotalPhase);
+				iPhase = -1;
+			}
+
 			printf("[%04d Frm]Size = %5d, Type = %1d, TIme = %6lu\n", frmCnt, encOut.strmSize, encOut.frameType, (endTime - startTime));
 
 			if (fpOut && encOut.strmSize > 0)
@@ -533,6 +597,13 @@ static int32_t VpuCamEncMain( CODEC_APP_DATA *pAppData )
 
 			frmCnt++;
 		}//while end
+
+		//	no frame was encoded, the phases end where the loop gave up
+		if (iPhase >= 0)
+		{
+			NX_PhaseEnd(iPhase);
+			NX_PhaseEnd(iTotalPhase);
+		}
 	}
 
 	//==============================================================================
@@ -542,6 +613,13 @@ CAM_ENC_TERMINATE:
 	if (hEnc)
 		NX_V4l2EncClose(hEnc);
 
+	//	before the capture buffers go away
+	if (hRec)
+		NX_FrameRecorderClose(hRec);
+
+	if (hChk)
+		NX_FrameChecksumClose(hChk);
+
 	if( pV4l2Camera )
 	{
 		pV4l2Camera->Deinit();
@@ -561,6 +639,10 @@ CAM_ENC_TERMINATE:
 	if (fpOut)
 		fclose(fpOut);
 
+	NX_PhasePrint();
+	if (pAppData->traceFileName)
+		NX_PhaseWriteTrace(pAppData->traceFileName);
+
 	printf("Cam Encode End!!\n" );
 
 	return ret;
@@ -579,11 +661,72 @@ static int32_t VpuEncPerfMain(CODEC_APP_DATA *pAppData)
 	int32_t inHeight = pAppData->height;
 	int32_t ret = 0, i;
 	int32_t planes = IMG_PLANE_NUM;
-
-	FILE *fpIn = fopen(pAppData->inFileName, "rb");
+	int32_t iTotalPhase, iPhase;
+
+	iTotalPhase = NX_PhaseBegin("first frame");
+
+	NX_FRAME_PATTERN_HANDLE hPat = NULL;
+	int32_t iPatFrames = 0;
+	uint64_t iPatFillNs = 0;
+	NX_CAPTURE_TRACE_HANDLE hTrace = NULL;
+	NX_CAPTURE_TRACE_INFO traceInfo;
+	int32_t bTraceFast = 0, iTraceLate = 0;
+	uint64_t traceStart = 0, traceFirst = 0;
+	FILE *fpIn = NULL;
 	FILE *fpOut = fopen(pAppData->outFileName, "wb");
 
-	if (fpIn == NULL || fpOut == NULL)
+	//	-i pattern:<name>[,<frames>] generates the input instead of reading it
+	if (!strncmp(pAppData->inFileName, "pattern:", 8))
+	{
+		char patName[16];
+		const char *pCount = strchr(pAppData->inFileName + 8, ',');
+		size_t nameLen = pCount ? (size_t)(pCount - pAppData->inFileName - 8) : strlen(pAppData->inFileName + 8);
+
+		if (nameLen >= sizeof(patName))
+			nameLen = sizeof(patName) - 1;
+		memcpy(patName, pAppData->inFileName + 8, nameLen);
+		patName[nameLen] = '\0';
+
+		iPatFrames = pCount ? atoi(pCount + 1) : 300;
+		hPat = NX_FramePatternOpen(patName, inWidth, inHeight);
+	}
+	//	-i trace:<file>[,fast] replays a capture trace, at its own cadence
+	//	unless fast is given, in the size it was recorded at
+	else if (!strncmp(pAppData->inFileName, "trace:", 6))
+	{
+		char traceName[1024];
+		const char *pFile = pAppData->inFileName + 6;
+		size_t fileLen = strlen(pFile);
+
+		if (fileLen > 5 && !strcmp(pFile + fileLen - 5, ",fast"))
+		{
+			fileLen -= 5;
+			bTraceFast = 1;
+		}
+
+		//	the argument stays as given, the name is cut in a copy
+		if (fileLen < sizeof(traceName))
+		{
+			memcpy(traceName, pFile, fileLen);
+			traceName[fileLen] = '\0';
+			hTrace = NX_CaptureTraceOpen(traceName);
+		}
+
+		if (hTrace)
+		{
+			NX_CaptureTraceGetInfo(hTrace, &traceInfo);
+			inWidth = traceInfo.width;
+			inHeight = traceInfo.height;
+			printf("Trace : %dx%d, %d frames, %llu ms\n", inWidth, inHeight, traceInfo.frames,
+				(unsigned long long)(traceInfo.duration / 1000000));
+		}
+	}
+	else
+	{
+		fpIn = fopen(pAppData->inFileName, "rb");
+	}
+
+	if ((fpIn == NULL && hPat == NULL && hTrace == NULL) || fpOut == NULL)
 	{
 		printf("input file or output file open error!!\n");
 		goto ENC_TERMINATE;
@@ -594,6 +737,7 @@ static int32_t VpuEncPerfMain(CODEC_APP_DATA *pAppData)
 	//==============================================================================
 	// DISPLAY INITIALIZATION
 	//==============================================================================
+	iPhase = NX_PhaseBegin("display init");
 	{
 		int drmFd = open("/dev/dri/card0", O_RDWR);
 
@@ -631,6 +775,7 @@ static int32_t VpuEncPerfMain(CODEC_APP_DATA *pAppData)
 		InitDrmDisplay(hDsp, PLANE_ID, CRTC_ID, DRM_FORMAT_YUV420, srcRect, dstRect );
 #endif	//	ENABLE_DRM_DISPLAY
 	}
+	NX_PhaseEnd(iPhase);
 
 	//==============================================================================
 	// ENCODER INITIALIZATION
@@ -664,6 +809,7 @@ static int32_t VpuEncPerfMain(CODEC_APP_DATA *pAppData)
 			goto ENC_TERMINATE;
 		}
 
+		iPhase = NX_PhaseBegin("encoder open");
 		hEnc = NX_V4l2EncOpen(pAppData->codec);
 		if (hEnc == NULL)
 		{
@@ -671,6 +817,7 @@ static int32_t VpuEncPerfMain(CODEC_APP_DATA *pAppData)
 			ret = -1;
 			goto ENC_TERMINATE;
 		}
+		NX_PhaseEnd(iPhase);
 
 		memset(&encPara, 0, sizeof(encPara));
 		encPara.width = inWidth;
@@ -695,12 +842,14 @@ static int32_t VpuEncPerfMain(CODEC_APP_DATA *pAppData)
 		if (pAppData->codec == V4L2_PIX_FMT_MJPEG)
 			encPara.jpgQuality = (pAppData->qp == 0) ? (90) : (pAppData->qp);
 
+		iPhase = NX_PhaseBegin("encoder init");
 		ret = NX_V4l2EncInit(hEnc, &encPara);
 		if (ret < 0)
 		{
 			printf("video encoder initialization is failed!!!");
 			goto ENC_TERMINATE;
 		}
+		NX_PhaseEnd(iPhase);
 
 		ret = NX_V4l2EncGetSeqInfo(hEnc, &pSeqData, &seqSize);
 		if (ret < 0)
@@ -726,6 +875,7 @@ static int32_t VpuEncPerfMain(CODEC_APP_DATA *pAppData)
 		GetImgInfo(IMG_FORMAT, inWidth*inHeight, &imgSize);
 
 		// Allocate Output Buffer
+		iPhase = NX_PhaseBegin("buffer alloc");
 		for (i = 0; i < IMAGE_BUFFER_NUM; i++)
 		{
 			hImage[i] = NX_AllocateVideoMemory(inWidth, inHeight, planes, IMG_FORMAT, 4096);
@@ -743,8 +893,13 @@ static int32_t VpuEncPerfMain(CODEC_APP_DATA *pAppData)
 			}
 		}
 
+		NX_PhaseEnd(iPhase);
+
 		pSrcBuf = (uint8_t *)malloc(imgSize);
 
+		//	closed by the first encoded frame
+		iPhase = NX_PhaseBegin("first encode");
+
 		while (!bExitLoop)
 		{
 			NX_V4L2ENC_IN encIn;
@@ -762,6 +917,53 @@ static int32_t VpuEncPerfMain(CODEC_APP_DATA *pAppData)
 
 				LoadImage(pSrcBuf, inWidth, inHeight, hImage[index]);
 			}
+			else if (hPat)
+			{
+				uint64_t fillStart;
+
+				if (frmCnt >= iPatFrames)
+				{
+					printf("End of Pattern\n");
+					break;
+				}
+
+				fillStart = NX_GetTickCountNs();
+				NX_FramePatternFill(hPat, hImage[index], frmCnt);
+				iPatFillNs += NX_GetTickCountNs() - fillStart;
+			}
+			else if (hTrace)
+			{
+				uint64_t timeStamp, now;
+
+				if (frmCnt >= traceInfo.frames)
+				{
+					printf("End of Trace\n");
+					break;
+				}
+
+				if (0 != NX_CaptureTraceLoad(hTrace, frmCnt, hImage[index], &timeStamp))
+				{
+					printf("Fail, trace frame %d.\n", frmCnt);
+					break;
+				}
+
+				//	the first frame sets the clock, later ones wait for their slot
+				now = NX_GetTickCountNs();
+				if (frmCnt == 0)
+				{
+					traceStart = now;
+					traceFirst = timeStamp;
+				}
+				else if (!bTraceFast)
+				{
+					uint64_t target = traceStart + (timeStamp - traceFirst);
+
+					if (now < target)
+						usleep((target - now) / 1000);
+					else if (now - target > traceInfo.duration / traceInfo.frames / 2)
+						iTraceLate++;
+				}
+			}
 
 #ifdef ENABLE_DRM_DISPLAY
 			UpdateBuffer(hDsp, hImage[index], NULL);
@@ -786,6 +988,13 @@ static int32_t VpuEncPerfMain(CODEC_APP_DATA *pAppData)
 				break;
 			}
 
+			if (iPhase >= 0)
+			{
+				NX_PhaseEnd(iPhase);
+				NX_PhaseEnd(iTotalPhase);
+				iPhase = -1;
+			}
+
 			printf("[%04d Frm]Size = %5d, Type = %1d, TIme = %6lu\n", frmCnt, encOut.strmSize, encOut.frameType, (endTime - startTime));
 
 			if (fpOut && encOut.strmSize > 0)
@@ -796,6 +1005,17 @@ static int32_t VpuEncPerfMain(CODEC_APP_DATA *pAppData)
 
 		if (pSrcBuf)
 			free(pSrcBuf);
+
+		if (hPat && frmCnt > 0)
+			printf("Pattern fill : %d frames, avg %llu us\n", frmCnt, (unsigned long long)(iPatFillNs / frmCnt / 1000));
+
+		if (hTrace && frmCnt > 0)
+		{
+			uint64_t elapsed = NX_GetTickCountNs() - traceStart;
+
+			printf("Trace replay : %d frames in %llu ms, %d late\n", frmCnt,
+				(unsigned long long)(elapsed / 1000000), iTraceLate);
+		}
 	}
 
 	//==============================================================================
@@ -811,9 +1031,19 @@ ENC_TERMINATE:
 	if (fpIn)
 		fclose(fpIn);
 
+	if (hPat)
+		NX_FramePatternClose(hPat);
+
+	if (hTrace)
+		NX_CaptureTraceClose(hTrace);
+
 	if (fpOut)
 		fclose(fpOut);
 
+	NX_PhasePrint();
+	if (pAppData->traceFileName)
+		NX_PhaseWriteTrace(pAppData->traceFileName);
+
 	printf("Encode End!!\n" );
 
 	return ret;
@@ -45,6 +45,8 @@ void print_usage(const char *appName)
 		"     -m [mode]                  [O]   : 1:decoder mode, 2:encoder mode (def:decoder mode)\n"
 		"     -i [input file name]       [M]   : input media file name (When is camera encoder, the value set NULL\n"
 		"     -o [output file name]      [O]   : output file name\n"
+		"     -T [trace file name]       [O]   : startup phase trace file (Chrome JSON)\n"
+		"     -k [checksum log name]     [O]   : per-frame CRC32C, flags all-zero/stuck/out-of-range frames ('-' : no log)\n"
 		"     -h : help\n"
 		" -------------------------------------------------------------------------------------------------------------------\n"
 		"  only encoder options :\n"
@@ -56,6 +58,10 @@ void print_usage(const char *appName)
 		"     -q [quality or QP]         [O]   : Jpeg Quality or Other codec Quantization Parameter(When is VBR, it is valid) \n"
 		"     -v [VBV]                   [O]   : VBV Size (def:2Sec)\n"
 		"     -x [Max Qp]                [O]   : Maximum Qp \n"
+		"     -r [raw file name]         [O]   : camera raw frame dump (asynchronous, drops are counted)\n"
+		"     -t [msec]                  [O]   : camera stall timeout, then the stream is restarted (def:1000)\n"
+		"     -i pattern:[name][,frames] [O]   : synthetic input instead of a file, bars/box/noise/zone (def:300 frames)\n"
+		"     -i trace:[file][,fast]     [O]   : replay a capture trace (nx-camera-test -R) at its cadence or as fast as possible\n"
 		" ===================================================================================================================\n\n"
 		,appName);
 	printf(
@@ -69,6 +75,9 @@ void print_usage(const char *appName)
 	printf(
 		" Encoder File Mode :(H.264, 1920x1080, 10Mbps, 30fps, 30 gop)\n"
 		"     #> %s -m 2 -i [input filename] -o [output filename] -s 1920,1080 -f 30,1 -b 10000 -g 30 \n", appName);
+	printf(
+		" Encoder Pattern Mode :(zone plate, 600 frames)\n"
+		"     #> %s -m 2 -i pattern:zone,600 -o [output filename] -s 1920,1080 -b 10000 \n", appName);
 }
 
 //------------------------------------------------------------------------------
@@ -80,7 +89,7 @@ int32_t main(int32_t argc, char *argv[])
 
 	memset(&appData, 0, sizeof(CODEC_APP_DATA));
 
-	while (-1 != (opt = getopt(argc, argv, "m:i:o:hc:s:f:b:g:q:v:x:")))
+	while (-1 != (opt = getopt(argc, argv, "m:i:o:hc:s:f:b:g:q:v:x:T:r:k:t:")))
 	{
 		switch (opt)
 		{
@@ -106,6 +115,10 @@ int32_t main(int32_t argc, char *argv[])
 		case 'q':	appData.qp = atoi(optarg);  break;		/* JPEG Quality or Quantization Parameter */
 		case 'v':	appData.vbv = atoi(optarg);  break;
 		case 'x':	appData.maxQp = atoi(optarg);  break;
+		case 'T':	appData.traceFileName = strdup(optarg);  break;
+		case 'r':	appData.rawFileName = strdup(optarg);  break;
+		case 'k':	appData.checksumFileName = strdup(optarg);  break;
+		case 't':	appData.dqTimeout = atoi(optarg);  break;
 		default:		break;
 		}
 	}